@@ -1,4 +1,4 @@
-QT       += core gui network
+QT       += core gui network concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -8,20 +8,87 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+# Сжатие передач: zlib обязателен, zstd подключается через CONFIG+=zstd
+LIBS += -lz
+zstd {
+    DEFINES += FX_HAVE_ZSTD
+    LIBS += -lzstd
+}
+# setsockopt(SO_LINGER) в NetemProxy
+win32: LIBS += -lws2_32
+
 SOURCES += \
     adminwindow.cpp \
     apiclient.cpp \
+    backupjob.cpp \
+    bandwidthlimiter.cpp \
+    batcharchive.cpp \
+    bulkuserimporter.cpp \
+    chunker.cpp \
+    compression.cpp \
+    deltaupload.cpp \
+    downloadcache.cpp \
     filedetailswindow.cpp \
+    fileinfocache.cpp \
+    loadgencli.cpp \
+    loadgenerator.cpp \
     main.cpp \
+    mappedfiledevice.cpp \
+    metadatacache.cpp \
+    mimeservice.cpp \
+    netemproxy.cpp \
+    previewservice.cpp \
+    progressaggregator.cpp \
+    requesthandle.cpp \
+    requestscheduler.cpp \
+    sessionstore.cpp \
+    standinserver.cpp \
     filesexchange.cpp \
+    folderwatcher.cpp \
+    syncengine.cpp \
+    synccli.cpp \
+    throttleduploaddevice.cpp \
+    tracer.cpp \
+    transferqueue.cpp \
+    transferworker.cpp \
+    userlistmodel.cpp \
     userwindow.cpp
 
 HEADERS += \
     adminwindow.h \
     apiclient.h \
+    backupjob.h \
+    bandwidthlimiter.h \
+    batcharchive.h \
+    bulkuserimporter.h \
+    chunker.h \
+    compression.h \
     datatypes.h \
+    deltaupload.h \
+    downloadcache.h \
     filedetailswindow.h \
+    fileinfocache.h \
     filesexchange.h \
+    folderwatcher.h \
+    loadgencli.h \
+    loadgenerator.h \
+    mappedfiledevice.h \
+    metadatacache.h \
+    mimeservice.h \
+    netemproxy.h \
+    previewservice.h \
+    progressaggregator.h \
+    requesthandle.h \
+    requestscheduler.h \
+    sessionstore.h \
+    standinserver.h \
+    synccli.h \
+    syncengine.h \
+    throttleduploaddevice.h \
+    tracer.h \
+    transferqueue.h \
+    transferworker.h \
+    userlistmodel.h \
     userwindow.h
 
 FORMS += \
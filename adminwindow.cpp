@@ -2,18 +2,36 @@
 #include "ui_adminwindow.h"
 #include "apiclient.h"
 #include "ui_userwindow.h"
+#include "userlistmodel.h"
+#include "bulkuserimporter.h"
+#include "backupjob.h"
+#include "progressaggregator.h"
 
 #include <QMessageBox>
 #include <QDebug>
 #include <QInputDialog>
-#include <QTableWidget>
+#include <QTableView>
 #include <QPushButton>
-#include <QHBoxLayout>
 #include <QHeaderView>
+#include <QScrollBar>
+#include <QLabel>
+#include <QTimer>
+#include <QItemSelectionModel>
+#include <QFileDialog>
+#include <QProgressDialog>
+#include <QDir>
+#include <QDateTime>
+#include <QLocale>
 
 AdminWindow::AdminWindow(const QString &token, ApiClient *client, QWidget *parent) :
     UserWindow(token, client, parent),
-    adminUi(nullptr)
+    adminUi(nullptr),
+    usersModel(nullptr),
+    userSearchTimer(nullptr),
+    visibleUsersTimer(nullptr),
+    importer(nullptr),
+    backupJob(nullptr),
+    serverUsersShown(false)
 {
     adminUi = new Ui::AdminWindow(); // Создаем UI админа
     adminUi->setupUi(this); // Устанавливаем UI админа для этого окна
@@ -31,6 +49,7 @@ AdminWindow::AdminWindow(const QString &token, ApiClient *client, QWidget *paren
     }
 
     setupTable();
+    showCachedFiles();
 
     QLineEdit* searchEdit = this->findChild<QLineEdit*>("searchLineEdit");
     if (searchEdit) {
@@ -44,12 +63,9 @@ AdminWindow::AdminWindow(const QString &token, ApiClient *client, QWidget *paren
         uploadBtn->setText("Загрузить файл");
         qDebug() << "AdminWindow: uploadButton подключен.";
     } else { qWarning() << "AdminWindow: Не найден uploadButton!"; }
+    setupSyncButton();
 
     // --- Подключение АДМИНСКИХ сигналов API ---
-    disconnect(apiClient, &ApiClient::userListSuccess, this, &AdminWindow::handleUserListSuccess);
-    connect(apiClient, &ApiClient::userListSuccess, this, &AdminWindow::handleUserListSuccess);
-    disconnect(apiClient, &ApiClient::userListFailed, this, &AdminWindow::handleUserListFailed);
-    connect(apiClient, &ApiClient::userListFailed, this, &AdminWindow::handleUserListFailed);
     disconnect(apiClient, &ApiClient::deleteUserSuccess, this, &AdminWindow::handleDeleteUserSuccess);
     connect(apiClient, &ApiClient::deleteUserSuccess, this, &AdminWindow::handleDeleteUserSuccess);
     disconnect(apiClient, &ApiClient::deleteUserFailed, this, &AdminWindow::handleDeleteUserFailed);
@@ -62,13 +78,14 @@ AdminWindow::AdminWindow(const QString &token, ApiClient *client, QWidget *paren
     connect(apiClient, &ApiClient::createUserSuccess, this, &AdminWindow::handleCreateUserSuccess);
     disconnect(apiClient, &ApiClient::createUserFailed, this, &AdminWindow::handleCreateUserFailed);
     connect(apiClient, &ApiClient::createUserFailed, this, &AdminWindow::handleCreateUserFailed);
-    disconnect(apiClient, &ApiClient::backupSuccess, this, &AdminWindow::handleBackupSuccess);
-    connect(apiClient, &ApiClient::backupSuccess, this, &AdminWindow::handleBackupSuccess);
-    disconnect(apiClient, &ApiClient::backupFailed, this, &AdminWindow::handleBackupFailed);
-    connect(apiClient, &ApiClient::backupFailed, this, &AdminWindow::handleBackupFailed);
     // -----------------------------------------
 
     setupUsersTable(); // Настраиваем таблицу пользователей
+    // Первая страница из кэша видна сразу, запрос ниже обновит ее в фоне
+    QList<UserData> cachedUsers;
+    if (apiClient->metadataCache()->loadUsers(&cachedUsers)) {
+        usersModel->showCachedUsers(cachedUsers);
+    }
     requestUserList(); // Запрашиваем список пользователей при открытии
 }
 
@@ -76,86 +93,117 @@ AdminWindow::~AdminWindow()
 {
     // Отключаем АДМИНСКИЕ сигналы
     if (apiClient) {
-        disconnect(apiClient, &ApiClient::userListSuccess, this, &AdminWindow::handleUserListSuccess);
-        disconnect(apiClient, &ApiClient::userListFailed, this, &AdminWindow::handleUserListFailed);
         disconnect(apiClient, &ApiClient::deleteUserSuccess, this, &AdminWindow::handleDeleteUserSuccess);
         disconnect(apiClient, &ApiClient::deleteUserFailed, this, &AdminWindow::handleDeleteUserFailed);
         disconnect(apiClient, &ApiClient::changePasswordSuccess, this, &AdminWindow::handleChangePasswordSuccess);
         disconnect(apiClient, &ApiClient::changePasswordFailed, this, &AdminWindow::handleChangePasswordFailed);
         disconnect(apiClient, &ApiClient::createUserSuccess, this, &AdminWindow::handleCreateUserSuccess);
         disconnect(apiClient, &ApiClient::createUserFailed, this, &AdminWindow::handleCreateUserFailed);
-        disconnect(apiClient, &ApiClient::backupSuccess, this, &AdminWindow::handleBackupSuccess);
-        disconnect(apiClient, &ApiClient::backupFailed, this, &AdminWindow::handleBackupFailed);
     }
     delete adminUi;
     ui = nullptr;
     qDebug() << "AdminWindow уничтожен.";
 }
 
-// --- Настройка и заполнение таблицы ПОЛЬЗОВАТЕЛЕЙ ---
+void AdminWindow::setToken(const QString &token)
+{
+    UserWindow::setToken(token);
+    if (usersModel) usersModel->setToken(token);
+}
+
+// --- Настройка таблицы ПОЛЬЗОВАТЕЛЕЙ ---
 void AdminWindow::setupUsersTable()
 {
-    if (!adminUi || !adminUi->usersTableWidget) return;
-    adminUi->usersTableWidget->setColumnCount(2); // Имя, Действия
-    adminUi->usersTableWidget->setHorizontalHeaderLabels({"Имя пользователя", "Действия"});
-    adminUi->usersTableWidget->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Stretch);
-    adminUi->usersTableWidget->horizontalHeader()->setSectionResizeMode(1, QHeaderView::Stretch);
-    adminUi->usersTableWidget->setEditTriggers(QAbstractItemView::NoEditTriggers);
-    adminUi->usersTableWidget->setSelectionBehavior(QAbstractItemView::SelectRows);
-    adminUi->usersTableWidget->setSelectionMode(QAbstractItemView::SingleSelection);
-    adminUi->usersTableWidget->verticalHeader()->setVisible(false);
-    adminUi->usersTableWidget->setRowCount(0); // Очистка
+    if (!adminUi || !adminUi->usersTableView) return;
+
+    // Модель держит только загруженные страницы: строки вне экрана не создаются вовсе
+    usersModel = new UserListModel(apiClient, this);
+    usersModel->setToken(apiToken);
+    adminUi->usersTableView->setModel(usersModel);
+    adminUi->usersTableView->horizontalHeader()->setSectionResizeMode(UserListModel::UsernameColumn, QHeaderView::Stretch);
+    adminUi->usersTableView->horizontalHeader()->setSectionResizeMode(UserListModel::IdColumn, QHeaderView::ResizeToContents);
+    adminUi->usersTableView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed); // Без замера высоты каждой строки
+    adminUi->usersTableView->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    adminUi->usersTableView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    adminUi->usersTableView->setSelectionMode(QAbstractItemView::SingleSelection);
+    adminUi->usersTableView->verticalHeader()->setVisible(false);
+
+    connect(adminUi->usersTableView->selectionModel(), &QItemSelectionModel::selectionChanged, this, &AdminWindow::updateUserActions);
+    connect(usersModel, &QAbstractItemModel::modelReset, this, &AdminWindow::updateUserActions);
+    connect(usersModel, &QAbstractItemModel::dataChanged, this, &AdminWindow::updateUserActions);
+    connect(usersModel, &UserListModel::loadFailed, this, &AdminWindow::handleUsersLoadFailed);
+    // Новый фильтр - прежняя ошибка загрузки к нему не относится
+    connect(usersModel, &QAbstractItemModel::modelReset, adminUi->usersStatusLabel, &QLabel::hide);
+
+    // Страницы запрашиваются по видимым строкам (а не из data() при отрисовке)
+    visibleUsersTimer = new QTimer(this);
+    visibleUsersTimer->setSingleShot(true);
+    visibleUsersTimer->setInterval(0);
+    connect(visibleUsersTimer, &QTimer::timeout, this, &AdminWindow::fetchVisibleUsers);
+    QScrollBar *usersScrollBar = adminUi->usersTableView->verticalScrollBar();
+    connect(usersScrollBar, &QScrollBar::valueChanged, visibleUsersTimer, qOverload<>(&QTimer::start));
+    connect(usersScrollBar, &QScrollBar::rangeChanged, visibleUsersTimer, qOverload<>(&QTimer::start));
+    connect(usersModel, &QAbstractItemModel::modelReset, visibleUsersTimer, qOverload<>(&QTimer::start));
+    connect(usersModel, &QAbstractItemModel::rowsInserted, visibleUsersTimer, qOverload<>(&QTimer::start));
+    connect(usersModel, &QAbstractItemModel::rowsRemoved, visibleUsersTimer, qOverload<>(&QTimer::start));
+    connect(usersModel, &QAbstractItemModel::dataChanged, visibleUsersTimer, qOverload<>(&QTimer::start));
+    // Замер от входа до первой страницы пользователей с сервера
+    connect(usersModel, &UserListModel::loadingChanged, this, [this](bool loading) {
+        if (loading || serverUsersShown) return;
+        serverUsersShown = true;
+        const qint64 sinceLogin = apiClient->sessionElapsedMs();
+        if (sinceLogin >= 0) qDebug() << "AdminWindow: Таблица пользователей заполнена через" << sinceLogin << "мс после входа.";
+    });
+
+    // Поиск на сервере по префиксу имени, с задержкой после последнего нажатия
+    userSearchTimer = new QTimer(this);
+    userSearchTimer->setSingleShot(true);
+    userSearchTimer->setInterval(300);
+    connect(userSearchTimer, &QTimer::timeout, this, [this]() {
+        usersModel->setFilter(adminUi->userSearchLineEdit->text());
+    });
+    connect(adminUi->userSearchLineEdit, &QLineEdit::textChanged, userSearchTimer, qOverload<>(&QTimer::start));
+    connect(adminUi->userSearchLineEdit, &QLineEdit::returnPressed, this, [this]() {
+        userSearchTimer->stop();
+        usersModel->setFilter(adminUi->userSearchLineEdit->text());
+    });
+    updateUserActions();
 }
 
 void AdminWindow::requestUserList()
 {
-    if (!apiClient || !adminUi || !adminUi->usersTableWidget) return;
-    adminUi->usersTableWidget->setEnabled(false);
-    apiClient->getUserList(apiToken); // Используем apiToken, унаследованный от UserWindow
+    if (!usersModel) return;
+    adminUi->usersStatusLabel->hide();
+    usersModel->refresh();
+    visibleUsersTimer->start(); // Неудачные страницы снова можно запросить
 }
 
-void AdminWindow::populateUsersTable(const QList<UserData> &usersToDisplay)
+void AdminWindow::fetchVisibleUsers()
 {
-    if (!adminUi || !adminUi->usersTableWidget) return;
-    adminUi->usersTableWidget->setRowCount(0); // Очищаем таблицу
-    allUsers = usersToDisplay; // Сохраняем список
-
-    for (int row = 0; row < usersToDisplay.count(); ++row) {
-        const UserData &user = usersToDisplay.at(row);
-        adminUi->usersTableWidget->insertRow(row);
-
-        QTableWidgetItem *usernameItem = new QTableWidgetItem(user.username);
-        adminUi->usersTableWidget->setItem(row, 0, usernameItem);
-
-        // --- Кнопки действий для пользователя ---
-        QWidget *actionsWidget = new QWidget();
-        QHBoxLayout *actionsLayout = new QHBoxLayout(actionsWidget);
-        actionsLayout->setContentsMargins(2, 0, 2, 0);
-        actionsLayout->setSpacing(3);
-
-        QPushButton *changePassButton = new QPushButton("Пароль");
-        changePassButton->setToolTip("Изменить пароль пользователя");
-        changePassButton->setProperty("userId", user.id);
-        changePassButton->setProperty("username", user.username); // Для диалога
-        connect(changePassButton, &QPushButton::clicked, this, &AdminWindow::changePasswordClicked);
-
-        QPushButton *deleteButton = new QPushButton("Удалить");
-        deleteButton->setToolTip("Удалить пользователя");
-        deleteButton->setStyleSheet("QPushButton { color: red; }");
-        deleteButton->setProperty("userId", user.id);
-        deleteButton->setProperty("username", user.username); // Для диалога
-        connect(deleteButton, &QPushButton::clicked, this, &AdminWindow::deleteUserClicked);
-
-        actionsLayout->addWidget(changePassButton);
-        actionsLayout->addWidget(deleteButton);
-        actionsLayout->addStretch();
-        actionsWidget->setLayout(actionsLayout);
-
-        adminUi->usersTableWidget->setCellWidget(row, 1, actionsWidget);
-    }
-    adminUi->usersTableWidget->setEnabled(true); // Разблокируем после заполнения
+    if (!usersModel) return;
+    QTableView *view = adminUi->usersTableView;
+    const int first = qMax(0, view->rowAt(0));
+    int last = view->rowAt(view->viewport()->height() - 1);
+    if (last < 0) last = usersModel->rowCount() - 1; // Строки не заполняют окно целиком
+    usersModel->fetchRows(first, last);
 }
 
+bool AdminWindow::selectedUser(UserData *user) const
+{
+    if (!usersModel || !adminUi->usersTableView->selectionModel()) return false;
+    const QModelIndexList rows = adminUi->usersTableView->selectionModel()->selectedRows();
+    if (rows.isEmpty()) return false;
+    return usersModel->userAt(rows.first().row(), user);
+}
+
+void AdminWindow::updateUserActions()
+{
+    const bool hasUser = selectedUser(nullptr);
+    adminUi->changePasswordButton->setEnabled(hasUser);
+    adminUi->deleteUserButton->setEnabled(hasUser);
+}
+// ---------------------------------------------
+
 // --- Слоты для кнопок управления пользователями ---
 void AdminWindow::on_addUserButton_clicked()
 {
@@ -170,27 +218,116 @@ void AdminWindow::on_addUserButton_clicked()
     apiClient->createNewUser(apiToken, username.trimmed(), password);
 }
 
+void AdminWindow::on_importUsersButton_clicked()
+{
+    if (importer) return; // Импорт уже идет
+
+    QString filePath = QFileDialog::getOpenFileName(this, "Импорт пользователей", QDir::homePath(), "CSV (*.csv *.txt);;Все файлы (*.*)");
+    if (filePath.isEmpty()) return;
+
+    importer = new BulkUserImporter(apiClient, apiToken, this);
+    QString errorString;
+    if (!importer->loadCsv(filePath, &errorString)) {
+        QMessageBox::warning(this, "Импорт пользователей", QString("Не удалось прочитать файл:\n%1").arg(errorString));
+        importer->deleteLater();
+        importer = nullptr;
+        return;
+    }
+
+    QMessageBox::StandardButton reply = QMessageBox::question(this, "Импорт пользователей",
+        QString("Создать пользователей из файла: %1 строк?").arg(importer->rowCount()), QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+    if (reply != QMessageBox::Yes) {
+        importer->deleteLater();
+        importer = nullptr;
+        return;
+    }
+
+    QProgressDialog *progressDialog = new QProgressDialog("Создание пользователей...", "Остановить", 0, importer->rowCount(), this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(0);
+    progressDialog->setAttribute(Qt::WA_DeleteOnClose);
+    connect(importer, &BulkUserImporter::progress, progressDialog, [progressDialog](int done, int total) {
+        progressDialog->setLabelText(QString("Создание пользователей: %1 из %2").arg(done).arg(total));
+        progressDialog->setValue(done);
+    });
+    connect(progressDialog, &QProgressDialog::canceled, importer, &BulkUserImporter::cancel);
+    connect(importer, &BulkUserImporter::finished, progressDialog, &QProgressDialog::close);
+    connect(importer, &BulkUserImporter::finished, this, &AdminWindow::handleImportFinished);
+
+    adminUi->importUsersButton->setEnabled(false);
+    adminUi->addUserButton->setEnabled(false);
+    importer->start();
+}
+
 void AdminWindow::on_backupButton_clicked()
 {
+    if (backupJob) {
+        // Во время бэкапа кнопка работает как "Отменить"
+        backupJob->cancel();
+        finishBackupUi();
+        return;
+    }
+
     QMessageBox::StandardButton reply;
     reply = QMessageBox::question(this, "Создание бэкапа", "Запустить процесс создания резервной копии?", QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
-    if (reply == QMessageBox::Yes) {
-        qDebug() << "AdminWindow: Запрос на создание бэкапа...";
-        // (Опционально) Блокируем кнопку
-        adminUi->backupButton->setEnabled(false);
-        apiClient->triggerBackup(apiToken);
+    if (reply != QMessageBox::Yes) return;
+
+    // Куда сохранить архив, спрашиваем сразу: дальше все идет без участия пользователя
+    const QString defaultName = QString("backup_%1.zip").arg(QDateTime::currentDateTime().toString("yyyyMMdd_HHmmss"));
+    QString targetPath = QFileDialog::getSaveFileName(this, "Сохранить резервную копию", QDir::homePath() + "/" + defaultName, "Архивы (*.zip *.tar.gz);;Все файлы (*.*)");
+    if (targetPath.isEmpty()) return;
+
+    qDebug() << "AdminWindow: Запрос на создание бэкапа в" << targetPath;
+    backupJob = new BackupJob(apiClient, apiToken, targetPath, this);
+    connect(backupJob, &BackupJob::statusChanged, this, [this](const QString &text) {
+        adminUi->backupProgressBar->setFormat(text + " %p%");
+    });
+    connect(backupJob, &BackupJob::serverProgress, this, [this](int percent) {
+        adminUi->backupProgressBar->setRange(0, 100);
+        adminUi->backupProgressBar->setValue(percent);
+    });
+    // Архив бывает большим: отметки прогресса прореживаем и показываем скорость с оставшимся временем
+    ProgressAggregator *archiveProgress = new ProgressAggregator(backupJob);
+    connect(backupJob, &BackupJob::downloadProgress, archiveProgress, &ProgressAggregator::update);
+    connect(archiveProgress, &ProgressAggregator::progressChanged, this, [this](const TransferProgress &progress) {
+        if (progress.percent >= 0) {
+            adminUi->backupProgressBar->setRange(0, 100);
+            adminUi->backupProgressBar->setValue(progress.percent);
+            adminUi->backupProgressBar->setFormat("Скачивание архива: " + ProgressAggregator::describe(progress) + " (%p%)");
+        } else {
+            adminUi->backupProgressBar->setRange(0, 0);
+            adminUi->backupProgressBar->setFormat("Скачивание архива: " + ProgressAggregator::describe(progress));
+        }
+    });
+    connect(backupJob, &BackupJob::finished, this, &AdminWindow::handleBackupSuccess);
+    connect(backupJob, &BackupJob::failed, this, &AdminWindow::handleBackupFailed);
+
+    adminUi->backupProgressBar->setRange(0, 0); // Пока сервер не сообщил прогресс
+    adminUi->backupProgressBar->setValue(0);
+    adminUi->backupProgressBar->setVisible(true);
+    adminUi->backupButton->setText("Отменить бэкап");
+    backupJob->start();
+}
+
+void AdminWindow::finishBackupUi()
+{
+    if (backupJob) {
+        backupJob->deleteLater();
+        backupJob = nullptr;
     }
+    adminUi->backupProgressBar->setVisible(false);
+    adminUi->backupButton->setText("Создать бэкап");
+    adminUi->backupButton->setEnabled(true);
 }
 // ---------------------------------------------
 
-// --- Слоты для кнопок ВНУТРИ таблицы пользователей ---
-void AdminWindow::deleteUserClicked()
+// --- Слоты для действий над выбранным пользователем ---
+void AdminWindow::on_deleteUserButton_clicked()
 {
-    QPushButton *button = qobject_cast<QPushButton*>(sender());
-    if (!button) return;
-    QString userId = button->property("userId").toString();
-    QString username = button->property("username").toString();
-    if (userId.isEmpty()) return;
+    UserData user;
+    if (!selectedUser(&user) || user.id.isEmpty()) return;
+    const QString userId = user.id;
+    const QString username = user.username;
 
     QMessageBox::StandardButton reply;
     reply = QMessageBox::question(this, "Удаление пользователя", QString("Вы уверены, что хотите удалить пользователя '%1' (ID: %2)?").arg(username).arg(userId), QMessageBox::Yes | QMessageBox::No, QMessageBox::No);
@@ -200,13 +337,12 @@ void AdminWindow::deleteUserClicked()
     }
 }
 
-void AdminWindow::changePasswordClicked()
+void AdminWindow::on_changePasswordButton_clicked()
 {
-    QPushButton *button = qobject_cast<QPushButton*>(sender());
-    if (!button) return;
-    QString userId = button->property("userId").toString();
-    QString username = button->property("username").toString();
-    if (userId.isEmpty()) return;
+    UserData user;
+    if (!selectedUser(&user) || user.id.isEmpty()) return;
+    const QString userId = user.id;
+    const QString username = user.username;
 
     bool ok;
     QString newPassword = QInputDialog::getText(this, "Смена пароля", QString("Введите новый пароль для '%1':").arg(username), QLineEdit::Password, "", &ok);
@@ -220,17 +356,13 @@ void AdminWindow::changePasswordClicked()
 // -----------------------------------------------
 
 // --- Слоты обработки ответов API (пользователи, бэкап) ---
-void AdminWindow::handleUserListSuccess(const QList<UserData> &users)
-{
-    qDebug() << "AdminWindow: Получен список пользователей:" << users.count();
-    populateUsersTable(users);
-}
-
-void AdminWindow::handleUserListFailed(const QString &errorString, int statusCode)
+void AdminWindow::handleUsersLoadFailed(const QString &errorString, int statusCode)
 {
+    // Модель сообщает об ошибке один раз на фильтр, а неудачные страницы не перезапрашивает
+    // сама; окно не модальное, чтобы не мешать работать с уже загруженной частью списка
     qWarning() << "AdminWindow: Ошибка получения списка пользователей. Статус:" << statusCode << "Ошибка:" << errorString;
-    QMessageBox::critical(this, "Ошибка списка пользователей", errorString);
-    adminUi->usersTableWidget->setEnabled(true); // Разблокируем в случае ошибки
+    adminUi->usersStatusLabel->setText(QString("Не удалось загрузить список пользователей: %1").arg(errorString));
+    adminUi->usersStatusLabel->show();
 }
 
 void AdminWindow::handleDeleteUserSuccess(const QString &deletedUserId)
@@ -271,17 +403,42 @@ void AdminWindow::handleCreateUserFailed(const QString &username, const QString
     QMessageBox::warning(this, "Ошибка создания пользователя", errorString);
 }
 
+void AdminWindow::handleImportFinished()
+{
+    if (!importer) return;
+    adminUi->importUsersButton->setEnabled(true);
+    adminUi->addUserButton->setEnabled(true);
+    requestUserList(); // Один раз на весь импорт
+
+    const int succeeded = importer->succeededCount();
+    const int failed = importer->failedCount();
+    qDebug() << "AdminWindow: Импорт завершен. Создано:" << succeeded << "Ошибок:" << failed;
+    QMessageBox::StandardButton reply = QMessageBox::question(this, "Импорт пользователей",
+        QString("Создано пользователей: %1\nНе создано: %2\n\nСохранить отчет по строкам (со сгенерированными паролями)?")
+            .arg(succeeded).arg(failed),
+        QMessageBox::Yes | QMessageBox::No, QMessageBox::Yes);
+    if (reply == QMessageBox::Yes) {
+        QString reportPath = QFileDialog::getSaveFileName(this, "Сохранить отчет", QDir::homePath() + "/import_report.csv", "CSV (*.csv)");
+        QString errorString;
+        if (!reportPath.isEmpty() && !importer->writeReport(reportPath, &errorString)) {
+            QMessageBox::critical(this, "Ошибка сохранения", QString("Не удалось сохранить отчет:\n%1").arg(errorString));
+        }
+    }
+    importer->deleteLater();
+    importer = nullptr;
+}
+
 void AdminWindow::handleBackupSuccess(const QString &message)
 {
     qDebug() << "AdminWindow: Бэкап успешно запущен/завершен. Сообщение:" << message;
-    QMessageBox::information(this, "Резервное копирование", message.isEmpty() ? "Процесс резервного копирования успешно запущен." : message);
-    adminUi->backupButton->setEnabled(true); // Разблокируем кнопку
+    finishBackupUi();
+    QMessageBox::information(this, "Резервное копирование", message.isEmpty() ? "Резервная копия создана." : message);
 }
 
 void AdminWindow::handleBackupFailed(const QString &errorString, int statusCode)
 {
     qWarning() << "AdminWindow: Ошибка резервного копирования. Статус:" << statusCode << "Ошибка:" << errorString;
+    finishBackupUi();
     QMessageBox::critical(this, "Ошибка резервного копирования", errorString);
-    adminUi->backupButton->setEnabled(true); // Разблокируем кнопку
 }
 // -------------------------------------------------------
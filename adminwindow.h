@@ -5,6 +5,10 @@
 #include "datatypes.h"  // Для UserData
 
 namespace Ui { class AdminWindow; } // Используем UI админа
+class UserListModel;
+class BulkUserImporter;
+class BackupJob;
+class QTimer;
 
 class AdminWindow : public UserWindow // Наследование
 {
@@ -14,19 +18,21 @@ public:
     // Конструктор вызывает конструктор базового класса
     explicit AdminWindow(const QString &token, ApiClient *client, QWidget *parent = nullptr);
     ~AdminWindow(); // Деструктор
+    void setToken(const QString &token) override;
 
 private slots:
     // --- Слоты для управления пользователями ---
     void on_addUserButton_clicked();
+    void on_importUsersButton_clicked();
     void on_backupButton_clicked();
 
-    // Слоты для кнопок в таблице пользователей
-    void deleteUserClicked();
-    void changePasswordClicked();
+    // Действия над выбранным в таблице пользователем
+    void on_deleteUserButton_clicked();
+    void on_changePasswordButton_clicked();
+    void updateUserActions();
 
     // Слоты для обработки ответов API (пользователи и бэкап)
-    void handleUserListSuccess(const QList<UserData> &users);
-    void handleUserListFailed(const QString &errorString, int statusCode);
+    void handleUsersLoadFailed(const QString &errorString, int statusCode);
     void handleDeleteUserSuccess(const QString &deletedUserId);
     void handleDeleteUserFailed(const QString &failedUserId, const QString &errorString, int statusCode);
     void handleChangePasswordSuccess(const QString &userId);
@@ -35,15 +41,23 @@ private slots:
     void handleCreateUserFailed(const QString &username, const QString &errorString, int statusCode);
     void handleBackupSuccess(const QString &message);
     void handleBackupFailed(const QString &errorString, int statusCode);
+    void handleImportFinished();
 
 private:
     Ui::AdminWindow *adminUi; // Используем отдельный указатель на UI админа
 
-    QList<UserData> allUsers; // Хранение списка пользователей
+    UserListModel *usersModel; // Постраничный список пользователей с сервера
+    QTimer *userSearchTimer;   // Задержка поиска, чтобы не слать запрос на каждую букву
+    QTimer *visibleUsersTimer; // Склеивает прокрутку и изменения модели в один проход fetchVisibleUsers
+    BulkUserImporter *importer; // Текущий импорт из CSV (nullptr, если не идет)
+    BackupJob *backupJob;       // Текущее задание бэкапа (nullptr, если не идет)
+    bool serverUsersShown;      // Первая страница с сервера уже получена (замер от входа)
 
     void setupUsersTable(); // Настройка таблицы пользователей
-    void requestUserList(); // Запрос списка пользователей
-    void populateUsersTable(const QList<UserData> &usersToDisplay); // Заполнение таблицы пользователей
+    void requestUserList(); // Обновление видимых страниц списка пользователей
+    void fetchVisibleUsers(); // Догрузка страниц, попавших в видимую область таблицы
+    bool selectedUser(UserData *user) const;
+    void finishBackupUi(); // Вернуть кнопку бэкапа и скрыть прогресс
 };
 
 #endif // ADMINWINDOW_H
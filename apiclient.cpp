@@ -1,14 +1,262 @@
 #include "apiclient.h"
+#include "mappedfiledevice.h"
+#include "previewservice.h"
+#include "deltaupload.h"
+#include "bandwidthlimiter.h"
+#include "mimeservice.h"
+#include "requestscheduler.h"
+#include "transferworker.h"
+#include "throttleduploaddevice.h"
+#include "tracer.h"
 #include <QNetworkRequest>
 #include <QDebug>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <QSaveFile>
 #include <QJsonArray>
 #include <QFile>
 #include <QUrlQuery>
+#include <QSettings>
+#include <QTemporaryFile>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QBuffer>
+#include <QRandomGenerator>
+#include <QTimer>
+#include <memory>
+#include <numeric>
+
+// Состояние потокового скачивания: распаковка и хэширование идут по мере прихода данных.
+// Переживает повторные (ranged) запросы, поэтому живет отдельно от QNetworkReply
+struct DownloadState {
+    QPointer<RequestHandle> handle; // Получатель результата и прогресса
+    QString token;
+    QString fileId;
+    QString originalFileName;
+    std::unique_ptr<StreamDecoder> decoder; // Свой для каждого ответа
+    QByteArray data;                        // Тело файла (ответы 200/206), если нет sink
+    std::unique_ptr<QSaveFile> sink;        // downloadFileTo: тело пишется сразу в файл, а не в data
+    qint64 received = 0;                    // Сколько байт файла получено (в data или в sink)
+    QByteArray errorBody;                   // Тело ответа с ошибкой
+    QCryptographicHash hash{QCryptographicHash::Sha256};
+    qint64 wireBytes = 0;
+    qint64 expectedSize = -1;      // Content-Length полного ответа без сжатия
+    QByteArray expectedSha256;     // X-Content-SHA256 (hex), если сервер его отдает
+    bool acceptRanges = false;
+    int resumeAttempts = 0;
+    bool decodeFailed = false;
+    QString decodeError;
+    QElapsedTimer timer;
+    TokenBucket throttle;          // Лимит скорости этой передачи
+    bool pullScheduled = false;    // Ждем токены, чтобы забрать данные из ответа
+    DownloadCache::Entry cached;   // Локальная копия, которую сервер может подтвердить
+    bool cacheHit = false;         // Сервер подтвердил копию - тело из сети не нужно
+    bool rangeMismatch = false;    // 206 не с того байта, что запрошен: скачивание начинается заново
+};
 
 namespace {
 
+// Сколько раз дозапрашиваем недостающий хвост файла через Range
+const int kMaxResumeAttempts = 3;
+
+// Ограничение параллельных фоновых запросов file_info.php
+const int kMaxConcurrentPrefetches = 2;
+// Сколько предзагрузок ждет очереди: при быстром проведении мыши по списку старые наведения
+// вытесняются - к ним пользователь уже не вернется
+const int kMaxQueuedPrefetches = 32;
+
+// Сколько байт начала файла тянем для миниатюры, если на сервере нет thumbnail.php
+const qint64 kPreviewPrefixBytes = 2 * 1024 * 1024;
+
+// Сколько данных держит ответ, пока мы их не забрали: при ограничении скорости
+// TCP-окно закрывается и сервер притормаживает, а не копит файл у нас в памяти
+const qint64 kDownloadReadBufferSize = 256 * 1024;
+
+// Полученное отбрасывается: файл будет получен заново с первого байта
+void resetDownloadedData(DownloadState &state)
+{
+    state.data.clear();
+    if (state.sink) {
+        state.sink->resize(0);
+        state.sink->seek(0);
+    }
+    state.received = 0;
+    state.hash.reset();
+}
+
+// "bytes 100-999/1000" -> начало 100, полный размер 1000 ("*" - неизвестен, -1)
+bool parseContentRange(const QByteArray &header, qint64 *start, qint64 *total)
+{
+    const QByteArray value = header.trimmed();
+    if (!value.startsWith("bytes ")) return false;
+    const qsizetype dash = value.indexOf('-');
+    const qsizetype slash = value.indexOf('/');
+    if (dash < 0 || slash < dash) return false;
+    bool ok = false;
+    *start = value.mid(6, dash - 6).trimmed().toLongLong(&ok);
+    if (!ok) return false;
+    const QByteArray totalText = value.mid(slash + 1).trimmed();
+    *total = totalText == "*" ? -1 : totalText.toLongLong(&ok);
+    return ok;
+}
+
+void consumeDownloadChunk(QNetworkReply *reply, DownloadState &state, qint64 maxBytes = -1)
+{
+    QByteArray chunk = maxBytes < 0 ? reply->readAll() : reply->read(maxBytes);
+    if (chunk.isEmpty() || state.decodeFailed || state.cacheHit || state.rangeMismatch) return;
+
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (statusCode != 200 && statusCode != 206) {
+        state.errorBody.append(chunk);
+        return;
+    }
+
+    if (!state.decoder) {
+        // Первый кусок этого ответа: разбираем заголовки
+        if (statusCode == 206) {
+            // Дозапрос склеивается с уже полученным только с того же байта и того же файла;
+            // иначе куски встанут не на свое место, а заметит это лишь сверка X-Content-SHA256
+            qint64 start = -1;
+            qint64 total = -1;
+            const bool parsed = parseContentRange(reply->rawHeader("Content-Range"), &start, &total);
+            if (!parsed || start != state.received || (total >= 0 && state.expectedSize > 0 && total != state.expectedSize)) {
+                qWarning() << "ApiClient: Сервер вернул не тот диапазон для файла ID:" << state.fileId
+                           << reply->rawHeader("Content-Range") << "вместо байта" << state.received << ", скачивание заново.";
+                state.rangeMismatch = true;
+                resetDownloadedData(state);
+                return;
+            }
+        }
+        const QByteArray contentEncoding = reply->rawHeader("Content-Encoding");
+        state.decoder.reset(new StreamDecoder(contentEncoding));
+        if (statusCode == 200) {
+            if (state.received > 0) {
+                // Сервер проигнорировал Range и прислал файл целиком - начинаем заново
+                qDebug() << "ApiClient: Сервер не поддержал Range для файла ID:" << state.fileId << ", данные получены заново.";
+                resetDownloadedData(state);
+            }
+            const bool identity = contentEncoding.isEmpty() || contentEncoding.trimmed().toLower() == "identity";
+            bool hasLength = false;
+            const qint64 length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&hasLength);
+            state.expectedSize = (identity && hasLength) ? length : -1;
+            state.acceptRanges = identity && reply->rawHeader("Accept-Ranges").trimmed().toLower() == "bytes";
+            state.expectedSha256 = reply->rawHeader("X-Content-SHA256").trimmed().toLower();
+        }
+    }
+
+    state.wireBytes += chunk.size();
+    if (!state.decoder->isSupported()) {
+        state.decodeFailed = true;
+        state.decodeError = state.decoder->errorString();
+        return;
+    }
+    if (state.sink) {
+        // В памяти только текущий кусок: хэшируем и сразу пишем во временный файл QSaveFile
+        QByteArray decoded;
+        if (!state.decoder->decode(chunk, &decoded)) {
+            state.decodeFailed = true;
+            state.decodeError = state.decoder->errorString();
+            return;
+        }
+        state.hash.addData(decoded);
+        state.received += decoded.size();
+        if (state.sink->write(decoded) != decoded.size()) {
+            state.decodeFailed = true;
+            state.decodeError = QString("Ошибка записи файла: %1").arg(state.sink->errorString());
+        }
+        return;
+    }
+    const qsizetype before = state.data.size();
+    if (!state.decoder->decode(chunk, &state.data)) {
+        state.decodeFailed = true;
+        state.decodeError = state.decoder->errorString();
+        return;
+    }
+    // Хэшируем только что полученные байты - второго прохода по файлу не будет
+    state.hash.addData(QByteArrayView(state.data).sliced(before));
+    state.received = state.data.size();
+}
+
+void failWaiters(const QList<QPointer<RequestHandle>> &waiters, const QString &errorString, int statusCode)
+{
+    for (const QPointer<RequestHandle> &waiter : waiters) {
+        if (waiter) waiter->fail(errorString, statusCode);
+    }
+}
+
+bool canResumeDownload(const DownloadState &state)
+{
+    // Никто больше не ждет результата (отмена или окно закрыто) - не дозапрашиваем
+    if (!state.handle || state.handle->isFinished()) return false;
+    return !state.decodeFailed && state.acceptRanges && state.expectedSize > 0
+           && state.received > 0 && state.received < state.expectedSize
+           && state.resumeAttempts < kMaxResumeAttempts;
+}
+
+// Потоковое скачивание архива бэкапа прямо в файл на диске
+struct ArchiveDownload {
+    QFile file;
+    qint64 baseOffset = 0; // С какого байта сервер отдает тело (Range)
+    bool rangeChecked = false;
+    bool rangeMismatch = false; // 206 не с того байта: .part обнулен, нужна новая попытка
+    QByteArray errorBody;
+    TokenBucket throttle;
+    bool pullScheduled = false;
+};
+
+void consumeArchiveChunk(QNetworkReply *reply, ArchiveDownload &state, qint64 maxBytes = -1)
+{
+    const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+    if (statusCode != 200 && statusCode != 206) {
+        state.errorBody.append(reply->readAll());
+        return;
+    }
+    if (state.rangeMismatch) return;
+    if (statusCode == 200 && state.baseOffset > 0) {
+        // Сервер проигнорировал Range и отдает архив целиком - начинаем файл заново
+        qDebug() << "ApiClient: Сервер не поддержал Range для архива, скачивание с начала.";
+        state.file.resize(0);
+        state.file.seek(0);
+        state.baseOffset = 0;
+    }
+    if (statusCode == 206 && !state.rangeChecked) {
+        state.rangeChecked = true;
+        qint64 start = -1;
+        qint64 total = -1;
+        if (!parseContentRange(reply->rawHeader("Content-Range"), &start, &total) || start != state.baseOffset) {
+            // Хвост не к этому .part - дописывать его нельзя, следующая попытка начнет с нуля
+            qWarning() << "ApiClient: Сервер вернул не тот диапазон архива:" << reply->rawHeader("Content-Range")
+                       << "вместо байта" << state.baseOffset;
+            state.rangeMismatch = true;
+            state.file.resize(0);
+            reply->abort();
+            return;
+        }
+    }
+    const QByteArray chunk = maxBytes < 0 ? reply->readAll() : reply->read(maxBytes);
+    if (chunk.isEmpty() || !state.file.isOpen()) return;
+    if (state.file.write(chunk) != chunk.size()) {
+        qWarning() << "ApiClient: Ошибка записи архива:" << state.file.errorString();
+        reply->abort();
+    }
+}
+
+// Файлы меньше этого размера не сжимаем: выигрыш меньше накладных расходов
+const qint64 kMinCompressibleSize = 4 * 1024;
+
+// Файлы от этого размера отправляются по кускам: у мелких выигрыш не окупает лишние запросы
+const qint64 kMinDeltaUploadSize = 8 * 1024 * 1024;
+
+struct CompressionResult {
+    bool ok = false;
+    qint64 logicalBytes = 0;
+    qint64 wireBytes = 0;
+    QString errorString;
+    QByteArray sha256; // Хэш исходного файла, посчитанный во время сжатия
+};
+
 QString parseErrorMessage(const QByteArray &responseData, const QString &defaultPrefix)
 {
     QString errorMsg = defaultPrefix; // Сообщение по умолчанию
@@ -46,20 +294,100 @@ QString parseErrorMessage(const QByteArray &responseData, const QString &default
 
 }
 
-ApiClient::ApiClient(const QString &baseUrl, QObject *parent)
-    : QObject(parent), apiBaseUrl(baseUrl)
+ApiClient::ApiClient(const QString &baseUrl, QObject *parent, TransferWorker *sharedWorker)
+    : QObject(parent), apiBaseUrl(baseUrl), previews(nullptr)
 {
-    networkManager = new QNetworkAccessManager(this);
+    // Интерактивные запросы идут через свой менеджер, передачи файлов - через отдельный пул соединений
+    scheduler = new RequestScheduler(this, sharedWorker);
+    networkManager = scheduler->manager(RequestScheduler::Interactive);
+    activePrefetches = 0;
     if (!apiBaseUrl.isEmpty() && !apiBaseUrl.endsWith('/')) {
         apiBaseUrl.append('/');
     }
+
+    // Сжатие загрузок выключено по умолчанию: серверу нужна поддержка content_encoding
+    QSettings settings;
+    QString compression = settings.value("transfer/uploadCompression", "none").toString();
+    uploadCompression = Compression::Method::None;
+    if (compression == "gzip") {
+        uploadCompression = Compression::Method::Deflate;
+    } else if (compression == "zstd") {
+        uploadCompression = Compression::isZstdAvailable() ? Compression::Method::Zstd : Compression::Method::Deflate;
+    }
+    // Старый путь через QFile оставлен для сравнения пропускной способности
+    mappedUploads = settings.value("transfer/mappedUploads", true).toBool();
+    deltaUploads = settings.value("transfer/deltaUploads", true).toBool();
+    batchUploads = settings.value("transfer/batchUploads", true).toBool();
+    serverThumbnails = true;
+
+    MimeService::warmUp(); // База MIME-типов грузится в фоне, пока идет вход
+    downloads.setScope(apiBaseUrl);
+    limiter = new BandwidthLimiter(this);
+    limiter->loadSettings();
 }
 
 ApiClient::~ApiClient()
 {
+    // Обработчики передач ссылаются на клиент: поток останавливается раньше, чем клиент разрушится.
+    // Общий поток останавливает его владелец до удаления клиентов
+    if (scheduler->ownsTransferWorker()) scheduler->transferWorker()->stop();
     qDebug() << "ApiClient уничтожен.";
 }
 
+void ApiClient::setUploadCompression(Compression::Method method)
+{
+    if (method == Compression::Method::Zstd && !Compression::isZstdAvailable()) {
+        qWarning() << "ApiClient: zstd недоступен в этой сборке, используется gzip.";
+        method = Compression::Method::Deflate;
+    }
+    uploadCompression = method;
+}
+
+Compression::Method ApiClient::uploadCompressionMethod() const
+{
+    return uploadCompression;
+}
+
+MetadataCache *ApiClient::metadataCache()
+{
+    return &metadata;
+}
+
+DownloadCache *ApiClient::downloadCache()
+{
+    return &downloads;
+}
+
+PreviewService *ApiClient::previewService()
+{
+    // Создается по первому запросу: клиентам без окон (--loadgen, синхронизация) кэш миниатюр не нужен
+    if (!previews) previews = new PreviewService(this, this);
+    return previews;
+}
+
+BandwidthLimiter *ApiClient::bandwidthLimiter()
+{
+    return limiter;
+}
+
+RequestScheduler *ApiClient::requestScheduler()
+{
+    return scheduler;
+}
+
+QString ApiClient::defaultBaseUrl()
+{
+    // FX_SERVER - другой сервер без пересборки (StandInServer, эмулятор сети перед ним)
+    const QString overridden = qEnvironmentVariable("FX_SERVER");
+    if (!overridden.isEmpty()) return overridden;
+    return QStringLiteral("https://filesexchange.ru.tuna.am/api/");
+}
+
+QString ApiClient::baseUrl() const
+{
+    return apiBaseUrl;
+}
+
 QUrl ApiClient::buildUrl(const QString &endpoint) const
 {
     QString cleanEndpoint = endpoint;
@@ -83,8 +411,9 @@ void ApiClient::login(const QString &username, const QString &password)
     qDebug() << "ApiClient: Данные:" << postData.toString(QUrl::FullyEncoded).toUtf8();
 
     QNetworkReply *reply = networkManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8());
+    Tracer::traceReply(reply, "auth.php");
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+    connect(reply, &QNetworkReply::finished, this, [this, reply, username]() {
         qDebug() << "ApiClient: Ответ получен для" << reply->url().toString();
 
         if (reply->error() == QNetworkReply::NoError)
@@ -110,6 +439,7 @@ void ApiClient::login(const QString &username, const QString &password)
                         QString role = jsonObj["role"].toString();
                         if (!token.isEmpty()) {
                             qDebug() << "ApiClient: Успешный парсинг. Токен:" << token << "Роль:" << role;
+                            metadata.setScope(apiBaseUrl, username);
                             emit loginSuccess(token, role);
                         } else {
                             qWarning() << "ApiClient: Ошибка парсинга - получен пустой токен.";
@@ -151,14 +481,58 @@ void ApiClient::login(const QString &username, const QString &password)
     });
 }
 
+void ApiClient::resumeSession(const QString &username)
+{
+    qDebug() << "ApiClient: Восстановлена сохраненная сессия пользователя" << username;
+    metadata.setScope(apiBaseUrl, username);
+}
+
+RequestHandle *ApiClient::validateSession(const QString &token)
+{
+    QUrlQuery postData;
+    postData.addQueryItem("token_api", token);
+    return postForJson("session_check.php", postData, "Ошибка проверки сессии");
+}
+
+void ApiClient::prefetchSessionData(const QString &token, const QString &role)
+{
+    if (role != "user" && role != "admin") return; // Окно не откроется - данные не нужны
+    sessionTimer.start();
+    qDebug() << "ApiClient: Начальные запросы сессии (роль" << role << ") отправлены до открытия окна.";
+    initialFilesToken = token;
+    initialFilesReply = sendUserFilesRequest(token);
+    if (role == "admin") {
+        initialUserPageToken = token;
+        initialUserPage = sendUserPageRequest(token, QString(), 0, kUserPageSize);
+    }
+}
+
+qint64 ApiClient::sessionElapsedMs() const
+{
+    return sessionTimer.isValid() ? sessionTimer.elapsed() : -1;
+}
+
 // Метод для запроса списка файлов пользователя
 void ApiClient::getUserFiles(const QString &token)
+{
+    // Список уже запрошен при входе - результат придет тем же сигналом userFilesSuccess.
+    // Присоединяется только первый запрос окна: более поздние (после загрузок) должны видеть свежие данные
+    if (initialFilesReply && !initialFilesReply->isFinished() && initialFilesToken == token) {
+        qDebug() << "ApiClient: Список файлов уже запрашивается с момента входа, ждем этот ответ.";
+        initialFilesReply.clear();
+        return;
+    }
+    initialFilesReply.clear();
+    sendUserFilesRequest(token);
+}
+
+QNetworkReply *ApiClient::sendUserFilesRequest(const QString &token)
 {
     if (token.isEmpty()) {
         qWarning() << "ApiClient::getUserFiles: Попытка запроса файлов с пустым токеном.";
         // Отправляем сигнал ошибки немедленно, не делая запрос
         emit userFilesFailed("Внутренняя ошибка: отсутствует токен авторизации.", 0);
-        return;
+        return nullptr;
     }
     QUrl filesUrl = buildUrl("user_files.php");
     QNetworkRequest request(filesUrl);
@@ -171,6 +545,7 @@ void ApiClient::getUserFiles(const QString &token)
     qDebug() << "ApiClient: Токен:" << token;
 
     QNetworkReply *reply = networkManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8());
+    Tracer::traceReply(reply, "user_files.php");
 
     // Соединяем сигналы ответа с лямбдами
     connect(reply, &QNetworkReply::finished, this, [this, reply]() {
@@ -183,6 +558,8 @@ void ApiClient::getUserFiles(const QString &token)
             qDebug() << "ApiClient: Тело ответа (файлы):" << responseData;
 
             if (statusCode == 200) {
+                // Разбор отдельно от показа: userFilesSuccess синхронно заполняет таблицу
+                const qint64 parseStartUs = Tracer::isEnabled() ? Tracer::nowUs() : -1;
                 QJsonParseError parseError;
                 QJsonDocument doc = QJsonDocument::fromJson(responseData, &parseError);
 
@@ -215,6 +592,11 @@ void ApiClient::getUserFiles(const QString &token)
                             }
                         }
                         qDebug() << "ApiClient: Успешно получено и разобрано" << fileList.count() << "файлов.";
+                        if (parseStartUs >= 0) {
+                            Tracer::complete("parse", "user_files.php", parseStartUs, Tracer::nowUs() - parseStartUs,
+                                             {{"bytes", static_cast<qint64>(responseData.size())}, {"files", static_cast<int>(fileList.count())}});
+                        }
+                        metadata.saveFiles(fileList);
                         emit userFilesSuccess(fileList); // Отправляем список файлов
 
                     } else {
@@ -252,82 +634,380 @@ void ApiClient::getUserFiles(const QString &token)
         emit userFilesFailed(QString("Ошибка сети: %1").arg(reply->errorString()), 0); // 0 для сетевых ошибок
         reply->deleteLater();
     });
+    return reply;
 }
 
 // Метод для загрузки файла
 void ApiClient::uploadFile(const QString &token, const QString &filePath)
 {
+    // Загрузка из окна: результат рассылается общими сигналами
+    RequestHandle *handle = upload(token, filePath);
+    connect(handle, &RequestHandle::progress, this, [this](qint64 bytesSent, qint64 bytesTotal) {
+        emit uploadProgress(bytesSent, bytesTotal);
+    });
+    connect(handle, &RequestHandle::jsonReady, this, [this](const QJsonObject &) {
+        emit uploadSuccess();
+    });
+    connect(handle, &RequestHandle::failed, this, [this](const QString &errorString, int statusCode) {
+        emit uploadFailed(errorString, statusCode);
+    });
+}
+
+RequestHandle *ApiClient::upload(const QString &token, const QString &filePath)
+{
+    RequestHandle *handle = new RequestHandle(this);
     // --- Проверка входных данных ---
     if (token.isEmpty()) {
-        qWarning() << "ApiClient::uploadFile: Попытка загрузки с пустым токеном.";
-        emit uploadFailed("Внутренняя ошибка: отсутствует токен авторизации.", 0);
+        qWarning() << "ApiClient::upload: Попытка загрузки с пустым токеном.";
+        handle->failLater("Внутренняя ошибка: отсутствует токен авторизации.", 0);
+        return handle;
+    }
+    QFileInfo fileInfo(filePath);
+    if (!fileInfo.exists()) {
+        qWarning() << "ApiClient::upload: Файл не найден:" << filePath;
+        handle->failLater(QString("Ошибка: Файл '%1' не найден.").arg(fileInfo.fileName()), 0);
+        return handle;
+    }
+
+    if (deltaUploads && fileInfo.size() >= kMinDeltaUploadSize) {
+        // Повторная загрузка измененного файла: отправятся только отличающиеся куски
+        DeltaUpload *delta = new DeltaUpload(this, handle, token, filePath, MimeService::mimeTypeForFile(filePath).name(), this);
+        connect(delta, &DeltaUpload::completed, this, &ApiClient::transferStats);
+        QPointer<RequestHandle> waiter(handle);
+        connect(delta, &DeltaUpload::unsupported, this, [this, waiter, token, filePath]() {
+            deltaUploads = false; // До конца сессии больше не спрашиваем
+            if (waiter && !waiter->isFinished()) startFullUpload(waiter, token, filePath);
+        });
+        delta->start();
+        return handle;
+    }
+    startFullUpload(handle, token, filePath);
+    return handle;
+}
+
+RequestHandle *ApiClient::uploadBatch(const QString &token, const QStringList &filePaths)
+{
+    RequestHandle *handle = new RequestHandle(this);
+    if (token.isEmpty()) {
+        qWarning() << "ApiClient::uploadBatch: Попытка загрузки с пустым токеном.";
+        handle->failLater("Внутренняя ошибка: отсутствует токен авторизации.", 0);
+        return handle;
+    }
+    if (!batchUploads) {
+        handle->failLater("Сервер не принимает пакеты файлов.", 404);
+        return handle;
+    }
+
+    // Чтение и хэширование сотен файлов - на рабочем потоке
+    QPointer<RequestHandle> waiter(handle);
+    QFutureWatcher<BatchArchive::Packed> *watcher = new QFutureWatcher<BatchArchive::Packed>(this);
+    connect(watcher, &QFutureWatcher<BatchArchive::Packed>::finished, this, [this, watcher, waiter, token]() {
+        const BatchArchive::Packed packed = watcher->result();
+        watcher->deleteLater();
+        if (waiter && !waiter->isFinished()) sendBatch(waiter, token, packed);
+    });
+    watcher->setFuture(QtConcurrent::run([filePaths]() { return BatchArchive::pack(filePaths); }));
+    return handle;
+}
+
+bool ApiClient::batchUploadsEnabled() const
+{
+    return batchUploads;
+}
+
+void ApiClient::setBatchUploads(bool enabled)
+{
+    batchUploads = enabled;
+}
+
+void ApiClient::setMappedUploads(bool enabled)
+{
+    mappedUploads = enabled;
+}
+
+void ApiClient::setDeltaUploads(bool enabled)
+{
+    deltaUploads = enabled;
+}
+
+void ApiClient::sendBatch(RequestHandle *handle, const QString &token, const BatchArchive::Packed &packed)
+{
+    // Результаты в порядке исходного списка: непрочитанные файлы отмечаются сразу
+    QJsonArray unreadable;
+    for (const QPair<QString, QString> &failure : packed.unreadable) {
+        qWarning() << "ApiClient: Файл не попал в пакет:" << failure.first << failure.second;
+        QJsonObject result;
+        result.insert("path", failure.first);
+        result.insert("file_name", QFileInfo(failure.first).fileName());
+        result.insert("status", "error");
+        result.insert("message", QString("Не удалось прочитать файл: %1").arg(failure.second));
+        unreadable.append(result);
+    }
+    for (const QString &path : packed.notBatched) {
+        qDebug() << "ApiClient: Файл вырос после постановки в очередь и отправится отдельно:" << path;
+        QJsonObject result;
+        result.insert("path", path);
+        result.insert("file_name", QFileInfo(path).fileName());
+        result.insert("status", "not_batched");
+        result.insert("message", "Файл слишком большой для пакета");
+        unreadable.append(result);
+    }
+    if (packed.entries.isEmpty()) {
+        QJsonObject data;
+        data.insert("files", unreadable);
+        handle->finishWithJson(data);
+        return;
+    }
+
+    // Ответ сервера приходит в промежуточный дескриптор и сверяется с пакетом здесь, в потоке ApiClient
+    RequestHandle *response = new RequestHandle(this);
+    QPointer<RequestHandle> waiter(handle);
+    connect(handle, &RequestHandle::abortRequested, response, &RequestHandle::abort);
+    connect(response, &RequestHandle::progress, handle, &RequestHandle::reportProgress);
+    connect(response, &RequestHandle::failed, this, [this, waiter](const QString &errorString, int statusCode) {
+        if (statusCode == 404) {
+            qDebug() << "ApiClient: Сервер не принимает пакеты файлов, дальше - по одному.";
+            batchUploads = false; // До конца сессии больше не пробуем
+        }
+        if (waiter) waiter->fail(errorString, statusCode);
+    });
+    const qint64 logicalBytes = std::accumulate(packed.entries.cbegin(), packed.entries.cend(), qint64(0),
+                                                [](qint64 sum, const BatchArchive::Entry &entry) { return sum + entry.size; });
+    const qint64 wireBytes = packed.body.size();
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+    const QList<BatchArchive::Entry> entries = packed.entries;
+    connect(response, &RequestHandle::jsonReady, this, [this, waiter, entries, unreadable, logicalBytes, wireBytes, batchTimer]
+            (const QJsonObject &data) {
+        const QJsonArray serverFiles = data.value("files").toArray();
+        QJsonArray results;
+        int succeeded = 0;
+        for (int i = 0; i < entries.count(); ++i) {
+            const BatchArchive::Entry &entry = entries[i];
+            QJsonObject result = serverFiles.at(i).toObject();
+            result.insert("path", entry.sourcePath);
+            result.insert("file_name", entry.name);
+            const QByteArray serverHash = result.value("sha256").toString().toLatin1().toLower();
+            if (i >= serverFiles.count()) {
+                result.insert("status", "error");
+                result.insert("message", "Сервер не вернул результат для файла");
+            } else if (result.value("status").toString() == "success" && !serverHash.isEmpty() && serverHash != entry.sha256) {
+                qWarning() << "ApiClient: Контрольная сумма файла" << entry.name << "из пакета не совпадает! Локально:"
+                           << entry.sha256 << "Сервер:" << serverHash;
+                result.insert("status", "error");
+                result.insert("message", "Файл поврежден при передаче: контрольная сумма на сервере не совпадает с локальной");
+            }
+            if (result.value("status").toString() == "success") succeeded++;
+            results.append(result);
+        }
+        for (const QJsonValue &failure : unreadable) results.append(failure);
+
+        TransferStats stats;
+        stats.fileName = QString("пакет из %1 файлов").arg(entries.count());
+        stats.direction = "upload";
+        stats.encoding = "batch";
+        stats.wireBytes = wireBytes;
+        stats.logicalBytes = logicalBytes;
+        stats.elapsedMs = batchTimer.elapsed();
+        qDebug() << "ApiClient: Пакет отправлен:" << succeeded << "из" << entries.count() << "файлов,"
+                 << stats.wireBytes << "байт за" << stats.elapsedMs << "мс";
+        emit transferStats(stats);
+
+        QJsonObject result;
+        result.insert("files", results);
+        if (waiter) waiter->finishWithJson(result);
+    });
+
+    // Тело пакета - массовая передача, как и обычная загрузка
+    QPointer<RequestHandle> relay(scheduler->transferWorker()->createRelay(response));
+    const QByteArray body = packed.body;
+    const int count = packed.entries.count();
+    scheduler->schedule(RequestScheduler::Bulk, QString("пакет из %1 файлов").arg(count), [this, relay, token, body, count]()
+                            -> QNetworkReply * {
+        if (!relay || relay->isFinished()) return nullptr;
+        QBuffer *device = new QBuffer;
+        device->setData(body);
+        device->open(QIODevice::ReadOnly);
+
+        QList<QPair<QByteArray, QByteArray>> fields;
+        fields.append({"token_api", token.toUtf8()});
+        fields.append({"count", QByteArray::number(count)});
+        QNetworkReply *reply = postMultipart(QNetworkRequest(buildUrl("upload_batch.php")), fields, "batch",
+                                             BatchArchive::kContentType, device, "batch");
+        connect(reply, &QNetworkReply::uploadProgress, reply, [relay](qint64 bytesSent, qint64 bytesTotal) {
+            if (bytesTotal > 0 && relay) relay->reportProgress(bytesSent, bytesTotal);
+        });
+        watchJsonReply(relay, reply, "upload_batch.php", "Ошибка загрузки пакета файлов");
+        return reply;
+    });
+}
+
+void ApiClient::startFullUpload(RequestHandle *handle, const QString &token, const QString &filePath)
+{
+    QFileInfo fileInfo(filePath);
+    // Тип по кэшу расширений; содержимое читается только для неоднозначных имен
+    QMimeType mimeType = MimeService::mimeTypeForFile(filePath);
+
+    if (uploadCompression == Compression::Method::None || fileInfo.size() < kMinCompressibleSize
+        || !Compression::isCompressibleMimeType(mimeType)) {
+        startUpload(handle, token, filePath, mimeType, filePath, QByteArray(), fileInfo.size(), QByteArray(), nullptr);
         return;
     }
-    QFile *file = new QFile(filePath); // Создаем QFile в куче, чтобы управлять его жизнью
-    if (!file->exists()) {
-        qWarning() << "ApiClient::uploadFile: Файл не найден:" << filePath;
-        emit uploadFailed(QString("Ошибка: Файл '%1' не найден.").arg(QFileInfo(filePath).fileName()), 0);
-        delete file; // Не забываем удалить объект файла
+
+    // --- Сжатие на рабочем потоке во временный файл ---
+    QTemporaryFile *compressedFile = new QTemporaryFile(this);
+    if (!compressedFile->open()) {
+        qWarning() << "ApiClient::uploadFile: Не удалось создать временный файл для сжатия, отправляем без сжатия.";
+        delete compressedFile;
+        startUpload(handle, token, filePath, mimeType, filePath, QByteArray(), fileInfo.size(), QByteArray(), nullptr);
         return;
     }
+    const QString compressedPath = compressedFile->fileName();
+    compressedFile->close(); // Файл остается на диске до удаления объекта
+
+    const Compression::Method method = uploadCompression;
+    qDebug() << "ApiClient: Сжатие" << fileInfo.fileName() << "(" << mimeType.name() << ") методом" << Compression::encodingName(method);
+
+    QPointer<RequestHandle> waiter(handle);
+    QFutureWatcher<CompressionResult> *watcher = new QFutureWatcher<CompressionResult>(this);
+    connect(watcher, &QFutureWatcher<CompressionResult>::finished, this,
+            [this, watcher, waiter, token, filePath, mimeType, compressedFile, compressedPath, method]() {
+        CompressionResult result = watcher->result();
+        watcher->deleteLater();
+        if (!waiter || waiter->isFinished()) {
+            // Загрузку отменили, пока шло сжатие
+            delete compressedFile;
+            return;
+        }
+
+        // Сжатие не удалось или почти ничего не дало - отправляем оригинал
+        if (!result.ok || result.wireBytes >= result.logicalBytes * 9 / 10) {
+            if (!result.ok) {
+                qWarning() << "ApiClient: Ошибка сжатия, отправляем без сжатия:" << result.errorString;
+            } else {
+                qDebug() << "ApiClient: Сжатие неэффективно (" << result.wireBytes << "из" << result.logicalBytes << "байт), отправляем как есть.";
+            }
+            delete compressedFile;
+            startUpload(waiter, token, filePath, mimeType, filePath, QByteArray(), QFileInfo(filePath).size(), QByteArray(), nullptr);
+            return;
+        }
+        startUpload(waiter, token, filePath, mimeType, compressedPath, Compression::encodingName(method),
+                    result.logicalBytes, result.sha256, compressedFile);
+    });
+    watcher->setFuture(QtConcurrent::run([filePath, compressedPath, method]() {
+        CompressionResult result;
+        result.ok = Compression::compressFile(filePath, compressedPath, method,
+                                              &result.logicalBytes, &result.wireBytes, &result.errorString,
+                                              &result.sha256);
+        return result;
+    }));
+}
+
+void ApiClient::startUpload(RequestHandle *handle, const QString &token, const QString &filePath, const QMimeType &mimeType,
+                            const QString &bodyPath, const QByteArray &contentEncoding,
+                            qint64 logicalBytes, const QByteArray &logicalSha256, QObject *bodyOwner)
+{
+    // Тело файла - массовая передача: ждет места в своей очереди, не занимая соединений интерактивных запросов,
+    // и отправляется из потока передач
+    if (!handle) {
+        delete bodyOwner;
+        return;
+    }
+    QPointer<RequestHandle> waiter(scheduler->transferWorker()->createRelay(handle));
+    if (bodyOwner) {
+        // Временный сжатый файл будет привязан к ответу в потоке передач
+        bodyOwner->setParent(nullptr);
+        bodyOwner->moveToThread(scheduler->transferWorker()->networkThread());
+    }
+    QPointer<QObject> owner(bodyOwner);
+    scheduler->schedule(RequestScheduler::Bulk, QFileInfo(filePath).fileName(),
+                        [this, waiter, token, filePath, mimeType, bodyPath, contentEncoding, logicalBytes, logicalSha256, owner]()
+                            -> QNetworkReply * {
+        if (!waiter || waiter->isFinished()) {
+            delete owner.data(); // Загрузку отменили, пока она ждала очереди
+            return nullptr;
+        }
+        return sendUpload(waiter, token, filePath, mimeType, bodyPath, contentEncoding, logicalBytes, logicalSha256, owner);
+    });
+}
+
+QNetworkReply *ApiClient::sendUpload(RequestHandle *handle, const QString &token, const QString &filePath, const QMimeType &mimeType,
+                                     const QString &bodyPath, const QByteArray &contentEncoding,
+                                     qint64 logicalBytes, const QByteArray &logicalSha256, QObject *bodyOwner)
+{
+    QPointer<RequestHandle> waiter(handle);
+    // Создаем устройство в куче, чтобы управлять его жизнью
+    MappedFileDevice *mappedDevice = nullptr;
+    QIODevice *file = nullptr;
+    if (mappedUploads) {
+        mappedDevice = new MappedFileDevice(bodyPath);
+        // Отображается только свой временный файл: исходный файл пользователя могут укоротить во время
+        // отправки, его читает фоновый поток с упреждением
+        mappedDevice->setMappingAllowed(bodyOwner != nullptr);
+        // Несжатое тело = исходный файл: хэшируем его по ходу отправки, без второго прохода
+        if (logicalSha256.isEmpty()) mappedDevice->enableHashing(QCryptographicHash::Sha256);
+        file = mappedDevice;
+    } else {
+        file = new QFile(bodyPath);
+    }
     if (!file->open(QIODevice::ReadOnly)) {
-        qWarning() << "ApiClient::uploadFile: Не удалось открыть файл для чтения:" << filePath << file->errorString();
-        emit uploadFailed(QString("Ошибка: Не удалось открыть файл '%1' для чтения.").arg(QFileInfo(filePath).fileName()), 0);
+        qWarning() << "ApiClient::uploadFile: Не удалось открыть файл для чтения:" << bodyPath << file->errorString();
+        if (waiter) waiter->fail(QString("Ошибка: Не удалось открыть файл '%1' для чтения.").arg(QFileInfo(filePath).fileName()), 0);
         delete file;
-        return;
+        delete bodyOwner;
+        return nullptr;
     }
+    const qint64 wireBytes = file->size();
 
     // --- Подготовка запроса ---
     QUrl uploadUrl = buildUrl("upload_file.php");
     QNetworkRequest request(uploadUrl);
-    // --- Создание multipart/form-data ---
-    // QHttpMultiPart должен существовать до завершения ответа, делаем его дочерним для reply
-    QHttpMultiPart *multiPart = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-
-    // 1. Добавляем токен (как обычное поле формы)
-    QHttpPart tokenPart;
-    tokenPart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant("form-data; name=\"token_api\""));
-    tokenPart.setBody(token.toUtf8());
-    multiPart->append(tokenPart);
-
-    // 2. Добавляем файл
-    QHttpPart filePart;
+
+    // --- Поля формы multipart/form-data ---
+    // 1. Токен (как обычное поле формы)
+    QList<QPair<QByteArray, QByteArray>> fields;
+    fields.append({"token_api", token.toUtf8()});
+
+    // Сжатое тело: сервер распаковывает файл по этим полям
+    if (!contentEncoding.isEmpty()) {
+        fields.append({"content_encoding", contentEncoding});
+        fields.append({"original_size", QByteArray::number(logicalBytes)});
+    }
+
+    // Хэш известен заранее (посчитан при сжатии) - сервер может проверить файл сам
+    if (!logicalSha256.isEmpty()) fields.append({"sha256", logicalSha256.toHex()});
+
+    // 2. Файл: Content-Type исходного файла, даже если тело сжато
     QFileInfo fileInfo(filePath);
     QString fileName = fileInfo.fileName();
-    // Устанавливаем Content-Disposition с именем файла
-    filePart.setHeader(QNetworkRequest::ContentDispositionHeader,
-                       QVariant(QString("form-data; name=\"file\"; filename=\"%1\"").arg(fileName)));
-
-    // Устанавливаем Content-Type файла
-    QMimeDatabase mimeDb;
-    QMimeType mimeType = mimeDb.mimeTypeForFile(fileInfo);
+    QByteArray contentType = "application/octet-stream";
     if (mimeType.isValid()) {
         qDebug() << "ApiClient: Определен MIME-тип файла:" << mimeType.name();
-        filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant(mimeType.name()));
+        contentType = mimeType.name().toLatin1();
     } else {
         qDebug() << "ApiClient: Не удалось определить MIME-тип, используется application/octet-stream";
-        filePart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/octet-stream"));
     }
 
-    filePart.setBodyDevice(file); // Передаем открытый QFile напрямую
-    file->setParent(multiPart);
-    multiPart->append(filePart);
-
     // --- Отправка запроса ---
-    qDebug() << "ApiClient: Отправка файла" << fileName << "на" << uploadUrl.toString();
-    QNetworkReply *reply = networkManager->post(request, multiPart);
-
-    multiPart->setParent(reply);
+    qDebug() << "ApiClient: Отправка файла" << fileName << "на" << uploadUrl.toString()
+             << "кодирование:" << (contentEncoding.isEmpty() ? QByteArray("identity") : contentEncoding)
+             << "источник:" << (mappedDevice ? mappedDevice->sourceName() : "QFile");
+    QElapsedTimer uploadTimer;
+    uploadTimer.start();
+    // Устройство файла передается напрямую (размер известен заранее) и удаляется вместе с reply
+    QNetworkReply *reply = postMultipart(request, fields, fileName, contentType, file);
+    if (bodyOwner) bodyOwner->setParent(reply); // Временный сжатый файл живет до конца запроса
+    if (waiter) connect(waiter, &RequestHandle::abortRequested, reply, &QNetworkReply::abort);
 
     // --- Обработка ответа ---
-    connect(reply, &QNetworkReply::uploadProgress, this, [this](qint64 bytesSent, qint64 bytesTotal) {
-        if (bytesTotal > 0) { // Избегаем деления на ноль и бессмысленных сигналов
-            //qDebug() << "Upload progress:" << bytesSent << "/" << bytesTotal;
-            emit uploadProgress(bytesSent, bytesTotal);
+    connect(reply, &QNetworkReply::uploadProgress, reply, [waiter](qint64 bytesSent, qint64 bytesTotal) {
+        if (bytesTotal > 0 && waiter) { // Избегаем деления на ноль и бессмысленных сигналов
+            waiter->reportProgress(bytesSent, bytesTotal);
         }
     });
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, fileName]() { // Захватываем fileName для логов
+    connect(reply, &QNetworkReply::finished, reply, [this, reply, waiter, fileName, contentEncoding, wireBytes, logicalBytes, uploadTimer,
+                                                    logicalSha256, mappedDevice]() { // Захватываем fileName для логов
         qDebug() << "ApiClient: Ответ на загрузку файла" << fileName << "получен.";
 
         // Проверка на сетевые ошибки
@@ -337,9 +1017,38 @@ void ApiClient::uploadFile(const QString &token, const QString &filePath)
             qDebug() << "ApiClient: Статус код (загрузка):" << statusCode;
             qDebug() << "ApiClient: Тело ответа (загрузка):" << responseData;
 
+            // Сверяем хэш, который вернул сервер, с посчитанным при отправке
+            QByteArray localHash = logicalSha256;
+            if (localHash.isEmpty() && mappedDevice) localHash = mappedDevice->hashResult(); // reply (и устройство) еще живы
+            QByteArray serverHash;
+            QJsonObject responseObj;
             if (statusCode == 200) {
-                qDebug() << "ApiClient: Файл" << fileName << "успешно загружен.";
-                emit uploadSuccess();
+                QJsonDocument doc = QJsonDocument::fromJson(responseData);
+                if (doc.isObject()) responseObj = doc.object();
+                serverHash = responseObj.value("sha256").toString().toLatin1().toLower();
+            }
+
+            if (statusCode == 200 && !serverHash.isEmpty() && !localHash.isEmpty() && serverHash != localHash.toHex()) {
+                qWarning() << "ApiClient: Контрольная сумма загруженного файла" << fileName << "не совпадает! Локально:"
+                           << localHash.toHex() << "Сервер:" << serverHash;
+                if (waiter) waiter->fail(QString("Файл '%1' поврежден при передаче: контрольная сумма на сервере не совпадает с локальной. "
+                                                 "Загрузите файл повторно.").arg(fileName), statusCode);
+            } else if (statusCode == 200) {
+                qDebug() << "ApiClient: Файл" << fileName << "успешно загружен."
+                         << (serverHash.isEmpty() || localHash.isEmpty() ? "(контрольная сумма не проверялась)" : "(контрольная сумма совпала)");
+                TransferStats stats;
+                stats.fileName = fileName;
+                stats.direction = "upload";
+                stats.encoding = contentEncoding.isEmpty() ? QString("identity") : QString::fromLatin1(contentEncoding);
+                stats.wireBytes = wireBytes;
+                stats.logicalBytes = logicalBytes;
+                stats.elapsedMs = uploadTimer.elapsed();
+                qDebug() << "ApiClient: Статистика загрузки" << fileName << "- на проводе:" << stats.wireBytes
+                         << "логически:" << stats.logicalBytes << "за" << stats.elapsedMs << "мс"
+                         << "(" << (stats.elapsedMs > 0 ? stats.wireBytes * 1000 / stats.elapsedMs / 1024 : 0) << "КиБ/с)";
+                emit transferStats(stats);
+                responseObj.insert("file_name", fileName);
+                if (waiter) waiter->finishWithJson(responseObj);
             } else {
                 // Ошибка сервера (не 200 OK)
                 QString errorMsg = QString("Ошибка сервера при загрузке файла '%1' (Код: %2)").arg(fileName).arg(statusCode);
@@ -355,35 +1064,101 @@ void ApiClient::uploadFile(const QString &token, const QString &filePath)
                     errorMsg = QString("Ошибка авторизации при загрузке файла '%1'.").arg(fileName);
                 }
                 qWarning() << "ApiClient: Загрузка файла" << fileName << "завершилась с ошибкой или неожиданным статусом:" << statusCode;
-                emit uploadFailed(errorMsg, statusCode);
+                if (waiter) waiter->fail(errorMsg, statusCode);
             }
         }
         // Сетевая ошибка обработается в errorOccurred
 
-        reply->deleteLater(); // Удалит reply, multiPart и file
+        reply->deleteLater(); // Удалит reply и тело запроса
     });
 
-    connect(reply, &QNetworkReply::errorOccurred, this, [this, reply, fileName](QNetworkReply::NetworkError code) {
+    connect(reply, &QNetworkReply::errorOccurred, reply, [reply, waiter, fileName](QNetworkReply::NetworkError code) {
         if (code == QNetworkReply::NoError) return;
         qWarning() << "ApiClient: Ошибка сети (" << code << ") при загрузке файла" << fileName << "для" << reply->url().toString() << ":" << reply->errorString();
         if (!reply) return;
-        emit uploadFailed(QString("Ошибка сети при загрузке '%1': %2").arg(fileName).arg(reply->errorString()), 0);
-        reply->deleteLater(); // Удалит reply, multiPart и file
+        if (waiter) waiter->fail(QString("Ошибка сети при загрузке '%1': %2").arg(fileName).arg(reply->errorString()), 0);
+        reply->deleteLater(); // Удалит reply и тело запроса
     });
+    return reply;
 }
 
 // Метод для запроса детальной информации о файле
-void ApiClient::getFileInfo(const QString &token, const QString &fileUrlIdentifier)
+RequestHandle *ApiClient::getFileInfo(const QString &token, const QString &fileUrlIdentifier)
 {
+    RequestHandle *handle = new RequestHandle(this);
     if (token.isEmpty() || fileUrlIdentifier.isEmpty()) {
         qWarning() << "ApiClient::getFileInfo: Попытка запроса с пустым токеном или идентификатором файла.";
-        emit fileInfoFailed("Внутренняя ошибка: отсутствует токен или идентификатор файла.", 0);
-        return;
+        handle->failLater("Внутренняя ошибка: отсутствует токен или идентификатор файла.", 0);
+        return handle;
+    }
+
+    // Свежий ответ в кэше - окно деталей заполняется без сетевого запроса
+    QJsonObject cachedData;
+    if (fileInfoCache.lookup(fileUrlIdentifier, &cachedData)) {
+        qDebug() << "ApiClient: Информация о файле" << fileUrlIdentifier << "взята из кэша.";
+        handle->finishWithJsonLater(cachedData);
+        return handle;
+    }
+    // Уже идет запрос (например, предзагрузка) - присоединяемся к нему
+    if (fileInfoInFlight.contains(fileUrlIdentifier)) {
+        fileInfoInFlight[fileUrlIdentifier].append(handle);
+        return handle;
+    }
+    sendFileInfoRequest(token, fileUrlIdentifier, handle);
+    return handle;
+}
+
+// Фоновая предзагрузка деталей (наведение на строку, видимые строки в простое)
+void ApiClient::prefetchFileInfo(const QString &token, const QString &fileUrlIdentifier)
+{
+    if (token.isEmpty() || fileUrlIdentifier.isEmpty()) return;
+    if (fileInfoInFlight.contains(fileUrlIdentifier) || fileInfoCache.contains(fileUrlIdentifier)) return;
+    if (prefetchQueued.contains(fileUrlIdentifier)) return;
+    if (prefetchQueue.size() >= kMaxQueuedPrefetches) prefetchQueued.remove(prefetchQueue.takeFirst().second);
+    prefetchQueue.append(qMakePair(token, fileUrlIdentifier));
+    prefetchQueued.insert(fileUrlIdentifier);
+    startFileInfoPrefetches();
+}
+
+bool ApiClient::cachedFileInfo(const QString &fileUrlIdentifier, QJsonObject *fileData)
+{
+    return fileInfoCache.lookup(fileUrlIdentifier, fileData);
+}
+
+void ApiClient::startFileInfoPrefetches()
+{
+    while (activePrefetches < kMaxConcurrentPrefetches && !prefetchQueue.isEmpty()) {
+        // Сначала последнее наведение - то, что пользователь видит сейчас
+        const QPair<QString, QString> next = prefetchQueue.takeLast();
+        prefetchQueued.remove(next.second);
+        if (fileInfoInFlight.contains(next.second) || fileInfoCache.contains(next.second)) continue;
+        activePrefetches++;
+        // Фоновая очередь планировщика: соединения интерактивного менеджера остаются кликам
+        scheduler->schedule(RequestScheduler::Background, "file_info " + next.second, [this, next]() -> QNetworkReply * {
+            if (fileInfoInFlight.contains(next.second) || fileInfoCache.contains(next.second)) {
+                // Пока ждали очереди, детали запросило окно или они уже в кэше
+                activePrefetches--;
+                QTimer::singleShot(0, this, &ApiClient::startFileInfoPrefetches);
+                return nullptr;
+            }
+            return sendFileInfoRequest(next.first, next.second, nullptr);
+        });
     }
+}
+
+QNetworkReply *ApiClient::sendFileInfoRequest(const QString &token, const QString &fileUrlIdentifier, RequestHandle *handle)
+{
+    // Без дескриптора это предзагрузка: результат только попадает в кэш
+    const bool isPrefetch = (handle == nullptr);
+    QList<QPointer<RequestHandle>> waiters;
+    if (handle) waiters.append(handle);
+    fileInfoInFlight.insert(fileUrlIdentifier, waiters);
 
     QUrl infoUrl = buildUrl("file_info.php");
     QNetworkRequest request(infoUrl);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+    // Предзагрузка уступает место в очереди менеджера запросам, которых ждет пользователь
+    if (isPrefetch) request.setPriority(QNetworkRequest::LowPriority);
 
     QUrlQuery postData;
     postData.addQueryItem("token_api", token);
@@ -393,11 +1168,13 @@ void ApiClient::getFileInfo(const QString &token, const QString &fileUrlIdentifi
     qDebug() << "ApiClient: Токен:" << token << "Идентификатор URL:" << fileUrlIdentifier;
 
     QNetworkReply *reply = networkManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8());
+    Tracer::traceReply(reply, "file_info.php");
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, fileUrlIdentifier]() {
+    connect(reply, &QNetworkReply::finished, this, [this, reply, fileUrlIdentifier, isPrefetch]() {
         qDebug() << "ApiClient: Ответ на запрос информации о файле" << fileUrlIdentifier << "получен.";
 
         if (reply->error() == QNetworkReply::NoError) {
+            const QList<QPointer<RequestHandle>> waiters = fileInfoInFlight.take(fileUrlIdentifier);
             int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
             QByteArray responseData = reply->readAll();
             qDebug() << "ApiClient: Статус код (инфо):" << statusCode;
@@ -412,14 +1189,17 @@ void ApiClient::getFileInfo(const QString &token, const QString &fileUrlIdentifi
                     // Проверяем наличие ключевых полей (можно добавить больше проверок)
                     if (jsonObj.contains("file_name") && jsonObj.contains("file_size")) {
                         qDebug() << "ApiClient: Информация о файле" << fileUrlIdentifier << "успешно получена и разобрана.";
-                        emit fileInfoSuccess(jsonObj); // Отправляем весь JSON объект
+                        fileInfoCache.insert(fileUrlIdentifier, jsonObj);
+                        for (const QPointer<RequestHandle> &waiter : waiters) {
+                            if (waiter) waiter->finishWithJson(jsonObj); // Отправляем весь JSON объект
+                        }
                     } else {
                         qWarning() << "ApiClient: Ошибка ответа сервера (инфо) - отсутствуют необходимые поля.";
-                        emit fileInfoFailed("Ошибка ответа сервера: неверный формат данных.", statusCode);
+                        failWaiters(waiters, "Ошибка ответа сервера: неверный формат данных.", statusCode);
                     }
                 } else {
                     qWarning() << "ApiClient: Ошибка парсинга JSON (инфо):" << parseError.errorString();
-                    emit fileInfoFailed("Ошибка ответа сервера: не удалось разобрать JSON (" + parseError.errorString() + ").", statusCode);
+                    failWaiters(waiters, "Ошибка ответа сервера: не удалось разобрать JSON (" + parseError.errorString() + ").", statusCode);
                 }
             } else {
                 QString errorMsg = QString("Ошибка сервера при получении информации о файле (Код: %1)").arg(statusCode);
@@ -436,10 +1216,14 @@ void ApiClient::getFileInfo(const QString &token, const QString &fileUrlIdentifi
                     errorMsg = "Ошибка авторизации при доступе к информации о файле.";
                 }
                 qWarning() << "ApiClient: Запрос информации о файле" << fileUrlIdentifier << "завершился с ошибкой:" << statusCode;
-                emit fileInfoFailed(errorMsg, statusCode);
+                failWaiters(waiters, errorMsg, statusCode);
             }
         }
         // Сетевая ошибка обработается в errorOccurred
+        if (isPrefetch) {
+            activePrefetches--;
+            startFileInfoPrefetches();
+        }
         reply->deleteLater();
     });
 
@@ -448,61 +1232,184 @@ void ApiClient::getFileInfo(const QString &token, const QString &fileUrlIdentifi
         if (code == QNetworkReply::NoError) return;
         qWarning() << "ApiClient: Ошибка сети (" << code << ") при запросе инфо о файле" << fileUrlIdentifier << ":" << reply->errorString();
         if (!reply) return;
-        emit fileInfoFailed(QString("Ошибка сети: %1").arg(reply->errorString()), 0);
+        failWaiters(fileInfoInFlight.take(fileUrlIdentifier), QString("Ошибка сети: %1").arg(reply->errorString()), 0);
         reply->deleteLater();
     });
+    return reply;
 }
 
 // Метод для скачивания файла
-void ApiClient::downloadFile(const QString &token, const QString &fileId, const QString &originalFileName)
+RequestHandle *ApiClient::downloadFile(const QString &token, const QString &fileId, const QString &originalFileName)
 {
+    RequestHandle *handle = new RequestHandle(this);
     // --- Проверка входных данных ---
     if (token.isEmpty() || fileId.isEmpty()) {
         qWarning() << "ApiClient::downloadFile: Попытка скачивания с пустым токеном или ID файла.";
-        emit downloadFailed(fileId, "Внутренняя ошибка: отсутствует токен или ID файла.", 0);
-        return;
+        handle->failLater("Внутренняя ошибка: отсутствует токен или ID файла.", 0);
+        return handle;
+    }
+
+    std::shared_ptr<DownloadState> state = std::make_shared<DownloadState>();
+    state->handle = scheduler->transferWorker()->createRelay(handle); // Прием и распаковка - в потоке передач
+    state->token = token;
+    state->fileId = fileId;
+    state->originalFileName = originalFileName;
+    state->timer.start();
+    if (downloads.lookup(fileId, &state->cached)) {
+        qDebug() << "ApiClient: Есть локальная копия файла ID:" << fileId << ", проверяем ее на сервере.";
     }
+    sendDownloadRequest(state);
+    return handle;
+}
+
+RequestHandle *ApiClient::downloadFileTo(const QString &token, const QString &fileId, const QString &originalFileName,
+                                         const QString &targetPath)
+{
+    RequestHandle *handle = new RequestHandle(this);
+    if (token.isEmpty() || fileId.isEmpty()) {
+        qWarning() << "ApiClient::downloadFileTo: Попытка скачивания с пустым токеном или ID файла.";
+        handle->failLater("Внутренняя ошибка: отсутствует токен или ID файла.", 0);
+        return handle;
+    }
+
+    std::shared_ptr<DownloadState> state = std::make_shared<DownloadState>();
+    // Временный файл QSaveFile - рядом с целевым: commit() переименовывает его в том же каталоге
+    state->sink.reset(new QSaveFile(targetPath));
+    if (!state->sink->open(QIODevice::WriteOnly)) {
+        handle->failLater(QString("Не удалось открыть файл для записи: %1").arg(state->sink->errorString()), 0);
+        return handle;
+    }
+    state->handle = scheduler->transferWorker()->createRelay(handle);
+    state->token = token;
+    state->fileId = fileId;
+    state->originalFileName = originalFileName;
+    state->timer.start();
+    // Кэш скачиваний держит копии в памяти - для файлов на диск он не используется
+    sendDownloadRequest(state);
+    return handle;
+}
+
+void ApiClient::pullThrottled(QPointer<QNetworkReply> reply, TokenBucket *bucket, bool *pullScheduled,
+                              const std::function<void(qint64)> &consume)
+{
+    // Ответ завершен - остаток заберет обработчик finished
+    if (!reply || reply->isFinished()) return;
+    const qint64 available = reply->bytesAvailable();
+    if (available <= 0) return;
+    const qint64 granted = limiter->take(BandwidthLimiter::Download, available, bucket);
+    if (granted > 0) consume(granted);
+
+    // Новых readyRead не будет, пока буфер ответа полон: забираем остаток по таймеру.
+    // consume держит состояние передачи (а с ним bucket и pullScheduled) живым до срабатывания
+    if (reply && !reply->isFinished() && reply->bytesAvailable() > 0 && !*pullScheduled) {
+        *pullScheduled = true;
+        QTimer::singleShot(limiter->retryDelayMs(BandwidthLimiter::Download, bucket), reply.data(),
+                           [this, reply, bucket, pullScheduled, consume]() {
+            *pullScheduled = false;
+            pullThrottled(reply, bucket, pullScheduled, consume);
+        });
+    }
+}
+
+void ApiClient::sendDownloadRequest(std::shared_ptr<DownloadState> state)
+{
+    scheduler->schedule(RequestScheduler::Bulk, state->originalFileName, [this, state]() -> QNetworkReply * {
+        // Скачивание отменили (или окно закрыли), пока оно ждало очереди
+        if (!state->handle || state->handle->isFinished()) return nullptr;
+        return startDownloadReply(state);
+    });
+}
+
+QNetworkReply *ApiClient::startDownloadReply(std::shared_ptr<DownloadState> state)
+{
+    const QString fileId = state->fileId;
+    const qint64 resumeOffset = state->received;
 
     // --- Подготовка URL с параметрами GET ---
     QUrl downloadUrl = buildUrl("download_file.php"); // Базовый URL эндпоинта
 
     // Создаем объект QUrlQuery для добавления параметров в URL
     QUrlQuery query;
-    query.addQueryItem("token_api", token);
+    query.addQueryItem("token_api", state->token);
     query.addQueryItem("file_id", fileId);
     downloadUrl.setQuery(query); // Добавляем параметры к URL
 
     // --- Подготовка запроса ---
     QNetworkRequest request(downloadUrl); // URL уже содержит параметры GET
+    if (resumeOffset > 0) {
+        // Дозапрос только недостающей части: без сжатия, чтобы смещения совпадали с файлом
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(resumeOffset) + "-");
+        request.setRawHeader("Accept-Encoding", "identity");
+    } else {
+        // Явный Accept-Encoding отключает автораспаковку Qt: распаковываем сами по мере прихода данных,
+        // чтобы считать байты на проводе отдельно от логических
+        request.setRawHeader("Accept-Encoding", Compression::acceptEncodingHeader());
+        // Локальная копия: сервер с поддержкой условных запросов ответит 304 без тела
+        if (state->cached.isValid()) request.setRawHeader("If-None-Match", "\"" + state->cached.sha256 + "\"");
+    }
+    state->decoder.reset();
 
     // --- Отправка запроса GET ---
-    qDebug() << "ApiClient: Запрос GET на скачивание файла:" << downloadUrl.toString(); // Теперь URL включает параметры
-    QNetworkReply *reply = networkManager->get(request); // ИСПОЛЬЗУЕМ GET вместо POST
+    qDebug() << "ApiClient: Запрос GET на скачивание файла ID:" << fileId
+             << (resumeOffset > 0 ? QString("(дозапрос с байта %1)").arg(resumeOffset) : QString());
+    QNetworkReply *reply = scheduler->manager(RequestScheduler::Bulk)->get(request); // ИСПОЛЬЗУЕМ GET вместо POST
+    reply->setReadBufferSize(kDownloadReadBufferSize);
+    if (state->handle) connect(state->handle, &RequestHandle::abortRequested, reply, &QNetworkReply::abort);
 
     // --- Обработка ответа  ---
-    connect(reply, &QNetworkReply::downloadProgress, this, [this, reply, fileId](qint64 bytesReceived, qint64 bytesTotal) {
-        emit downloadProgress(fileId, bytesReceived, bytesTotal);
+    if (resumeOffset == 0 && state->cached.isValid()) {
+        // Проверка локальной копии по заголовкам: 304 или тот же SHA-256 и размер - тело не качаем
+        connect(reply, &QNetworkReply::metaDataChanged, reply, [reply, state]() {
+            if (state->cacheHit) return;
+            const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            bool sameContent = false;
+            if (statusCode == 200) {
+                bool hasLength = false;
+                const qint64 length = reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&hasLength);
+                const QByteArray encoding = reply->rawHeader("Content-Encoding").trimmed().toLower();
+                const bool sizeMatches = !hasLength || !(encoding.isEmpty() || encoding == "identity") || length == state->cached.size;
+                sameContent = sizeMatches && reply->rawHeader("X-Content-SHA256").trimmed().toLower() == state->cached.sha256;
+            }
+            if (statusCode == 304 || sameContent) {
+                state->cacheHit = true;
+                if (statusCode == 200) reply->abort(); // Обработает finished
+            }
+        });
+    }
+    connect(reply, &QNetworkReply::readyRead, reply, [this, reply, state]() {
+        pullThrottled(reply, &state->throttle, &state->pullScheduled, [reply, state](qint64 maxBytes) {
+            consumeDownloadChunk(reply, *state, maxBytes);
+            if (state->rangeMismatch) reply->abort(); // Остаток неверного диапазона не нужен
+        });
     });
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, fileId, originalFileName]() {
+    connect(reply, &QNetworkReply::downloadProgress, reply, [state, resumeOffset](qint64 bytesReceived, qint64 bytesTotal) {
+        if (state->handle) state->handle->reportProgress(resumeOffset + bytesReceived, bytesTotal > 0 ? resumeOffset + bytesTotal : bytesTotal);
+    });
+
+    connect(reply, &QNetworkReply::finished, reply, [this, reply, fileId, state]() {
         qDebug() << "ApiClient: Ответ на скачивание файла ID:" << fileId << "получен.";
+        if (state->cacheHit) {
+            finishFromCache(state);
+            reply->deleteLater();
+            return;
+        }
 
         if (reply->error() == QNetworkReply::NoError) {
             int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
             qDebug() << "ApiClient: Статус код (скачивание):" << statusCode;
-
-            if (statusCode == 200) {
-                QByteArray fileData = reply->readAll();
-                if (!fileData.isEmpty()) {
-                    qDebug() << "ApiClient: Файл ID:" << fileId << "успешно скачан (" << fileData.size() << "байт).";
-                    emit downloadSuccess(fileId, fileData, originalFileName);
-                } else {
-                    qWarning() << "ApiClient: Скачивание файла ID:" << fileId << "завершилось успешно (код 200), но получены пустые данные.";
-                    emit downloadFailed(fileId, "Сервер вернул пустой файл.", statusCode);
-                }
+            consumeDownloadChunk(reply, *state); // Остаток, если readyRead не успел его забрать
+
+            if (state->rangeMismatch) {
+                restartDownload(state);
+            } else if (state->decodeFailed) {
+                qWarning() << "ApiClient: Ошибка распаковки файла ID:" << fileId << state->decodeError;
+                if (state->handle) state->handle->fail(state->decodeError, statusCode);
+            } else if (statusCode == 200 || statusCode == 206) {
+                finishDownload(state, statusCode);
             } else {
                 // Обработка ошибок HTT
-                QByteArray errorData = reply->readAll();
+                QByteArray errorData = state->errorBody;
                 QString errorMsg = QString("Ошибка сервера при скачивании файла (Код: %1)").arg(statusCode);
                 // Пытаемся разобрать JSON ошибку, которую возвращает ваш API при коде 201
                 if (statusCode == 201 && !errorData.isEmpty()) {
@@ -517,7 +1424,7 @@ void ApiClient::downloadFile(const QString &token, const QString &fileId, const
                 }
 
                 qWarning() << "ApiClient: Скачивание файла ID:" << fileId << "завершилось с ошибкой или неожиданным статусом:" << statusCode;
-                emit downloadFailed(fileId, errorMsg, statusCode);
+                if (state->handle) state->handle->fail(errorMsg, statusCode);
             }
         }
         // Сетевая ошибка обработается в errorOccurred
@@ -525,13 +1432,144 @@ void ApiClient::downloadFile(const QString &token, const QString &fileId, const
         reply->deleteLater();
     });
 
-    connect(reply, &QNetworkReply::errorOccurred, this, [this, reply, fileId](QNetworkReply::NetworkError code) {
-        if (code == QNetworkReply::NoError) return;
+    connect(reply, &QNetworkReply::errorOccurred, reply, [this, reply, fileId, state](QNetworkReply::NetworkError code) {
+        if (code == QNetworkReply::NoError || state->cacheHit) return; // Отмена ради локальной копии
+        if (state->rangeMismatch) {
+            // Прервали сами из-за неверного Content-Range
+            restartDownload(state);
+            reply->deleteLater();
+            return;
+        }
         qWarning() << "ApiClient: Ошибка сети (" << code << ") при скачивании файла ID:" << fileId << "для" << reply->url().toString() << ":" << reply->errorString();
         if (!reply) return;
-        emit downloadFailed(fileId, QString("Ошибка сети: %1").arg(reply->errorString()), 0);
+        consumeDownloadChunk(reply, *state);
+        if (canResumeDownload(*state)) {
+            // Обрыв посреди передачи: дозапрашиваем только недостающий хвост
+            state->resumeAttempts++;
+            qWarning() << "ApiClient: Передача файла ID:" << fileId << "оборвана на" << state->received
+                       << "из" << state->expectedSize << "байт, попытка дозапроса" << state->resumeAttempts;
+            sendDownloadRequest(state);
+        } else {
+            if (state->handle) state->handle->fail(QString("Ошибка сети: %1").arg(reply->errorString()), 0);
+        }
         reply->deleteLater();
     });
+    return reply;
+}
+
+// Полученное отброшено (см. DownloadState::rangeMismatch) - файл запрашивается с начала,
+// в счет тех же попыток дозапроса
+void ApiClient::restartDownload(std::shared_ptr<DownloadState> state)
+{
+    state->rangeMismatch = false;
+    if (!state->handle || state->handle->isFinished()) return;
+    if (++state->resumeAttempts > kMaxResumeAttempts) {
+        state->handle->fail("Сервер вернул не ту часть файла при дозапросе.", 206);
+        return;
+    }
+    sendDownloadRequest(state);
+}
+
+// Проверка полноты и целостности скачанного файла
+void ApiClient::finishDownload(std::shared_ptr<DownloadState> state, int statusCode)
+{
+    const QString &fileId = state->fileId;
+    const QByteArray &fileData = state->data;
+    const qint64 fileSize = state->received;
+
+    // Сжатый ответ, оборванный на границе куска, распаковывается без ошибок - проверяем конец потока
+    if (state->decoder && !state->decoder->finish()) {
+        qWarning() << "ApiClient: Файл ID:" << fileId << "получен не полностью:" << state->decoder->errorString();
+        if (state->handle) state->handle->fail(state->decoder->errorString(), statusCode);
+        return;
+    }
+
+    if (state->expectedSize > 0 && fileSize < state->expectedSize) {
+        if (canResumeDownload(*state)) {
+            state->resumeAttempts++;
+            qWarning() << "ApiClient: Файл ID:" << fileId << "получен не полностью (" << fileSize << "из"
+                       << state->expectedSize << "байт), дозапрос недостающей части.";
+            sendDownloadRequest(state);
+            return;
+        }
+        qWarning() << "ApiClient: Файл ID:" << fileId << "получен не полностью:" << fileSize << "из" << state->expectedSize;
+        if (state->handle) state->handle->fail(QString("Файл получен не полностью: %1 из %2 байт.")
+                                                   .arg(fileSize).arg(state->expectedSize), statusCode);
+        return;
+    }
+
+    if (fileSize == 0) {
+        qWarning() << "ApiClient: Скачивание файла ID:" << fileId << "завершилось успешно (код 200), но получены пустые данные.";
+        if (state->handle) state->handle->fail("Сервер вернул пустой файл.", statusCode);
+        return;
+    }
+
+    if (!state->expectedSha256.isEmpty()) {
+        const QByteArray actual = state->hash.result().toHex();
+        if (actual != state->expectedSha256) {
+            qWarning() << "ApiClient: Контрольная сумма файла ID:" << fileId << "не совпадает! Ожидали:"
+                       << state->expectedSha256 << "получили:" << actual;
+            if (state->handle) state->handle->fail("Файл поврежден при передаче: контрольная сумма не совпадает. Скачайте файл повторно.", statusCode);
+            return;
+        }
+        qDebug() << "ApiClient: Контрольная сумма файла ID:" << fileId << "совпала.";
+    }
+
+    qDebug() << "ApiClient: Файл ID:" << fileId << "успешно скачан (" << fileSize << "байт).";
+    TransferStats stats;
+    stats.fileName = state->originalFileName;
+    stats.direction = "download";
+    stats.encoding = QString::fromLatin1(state->decoder ? state->decoder->encoding() : QByteArray("identity"));
+    stats.wireBytes = state->wireBytes;
+    stats.logicalBytes = fileSize;
+    stats.elapsedMs = state->timer.elapsed();
+    qDebug() << "ApiClient: Статистика скачивания" << stats.fileName << "- на проводе:" << stats.wireBytes
+             << "логически:" << stats.logicalBytes << "(" << stats.encoding << ")";
+    emit transferStats(stats);
+    if (state->sink) {
+        // Файл проверен целиком - только теперь он заменяет прежний
+        if (!state->sink->commit()) {
+            qWarning() << "ApiClient: Не удалось сохранить файл ID:" << fileId << state->sink->errorString();
+            if (state->handle) state->handle->fail(QString("Не удалось сохранить файл: %1").arg(state->sink->errorString()), 0);
+            return;
+        }
+        QJsonObject result;
+        result.insert("path", state->sink->fileName());
+        result.insert("size", fileSize);
+        result.insert("sha256", QString::fromLatin1(state->hash.result().toHex()));
+        if (state->handle) state->handle->finishWithJson(result);
+        return;
+    }
+    downloads.store(fileId, fileData, state->hash.result().toHex());
+    if (state->handle) state->handle->finishWithData(fileData, state->originalFileName);
+}
+
+// Сервер подтвердил, что локальная копия совпадает с файлом
+void ApiClient::finishFromCache(std::shared_ptr<DownloadState> state)
+{
+    QByteArray fileData;
+    if (!downloads.read(state->cached, &fileData)) {
+        // Копию успели вытеснить или она повреждена - качаем заново, уже без условия
+        qWarning() << "ApiClient: Локальная копия файла ID:" << state->fileId << "недоступна, скачиваем заново.";
+        state->cached = DownloadCache::Entry();
+        state->cacheHit = false;
+        sendDownloadRequest(state);
+        return;
+    }
+    qDebug() << "ApiClient: Файл ID:" << state->fileId << "не изменился, отдан из локального кэша ("
+             << fileData.size() << "байт) через" << state->timer.elapsed() << "мс.";
+    TransferStats stats;
+    stats.fileName = state->originalFileName;
+    stats.direction = "download";
+    stats.encoding = "cache";
+    stats.wireBytes = state->wireBytes;
+    stats.logicalBytes = fileData.size();
+    stats.elapsedMs = state->timer.elapsed();
+    emit transferStats(stats);
+    if (state->handle) {
+        state->handle->reportProgress(fileData.size(), fileData.size());
+        state->handle->finishWithData(fileData, state->originalFileName);
+    }
 }
 
 // Метод для удаления файла
@@ -557,6 +1595,7 @@ void ApiClient::deleteFile(const QString &token, const QString &fileId)
     // --- Отправка запроса POST ---
     qDebug() << "ApiClient: Запрос POST на удаление файла ID:" << fileId << "на" << deleteUrl.toString();
     QNetworkReply *reply = networkManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8());
+    Tracer::traceReply(reply, "delete_file.php");
 
     // --- Обработка ответа ---
     connect(reply, &QNetworkReply::finished, this, [this, reply, fileId]() { // Захватываем fileId
@@ -570,6 +1609,7 @@ void ApiClient::deleteFile(const QString &token, const QString &fileId)
 
             if (statusCode == 200) {
                 qDebug() << "ApiClient: Файл ID:" << fileId << "успешно удален.";
+                fileInfoCache.clear(); // ID удаленного файла не сопоставить с URL-идентификатором - сбрасываем все
                 emit deleteSuccess(fileId);
 
             } else {
@@ -609,54 +1649,99 @@ void ApiClient::deleteFile(const QString &token, const QString &fileId)
     });
 }
 
-void ApiClient::getUserList(const QString &token)
+RequestHandle *ApiClient::getUserPage(const QString &token, const QString &prefix, int offset, int limit)
 {
+    // Первая страница уже запрошена при входе: окно получает тот же ответ через свой дескриптор
+    if (initialUserPage && !initialUserPage->isFinished() && initialUserPageToken == token
+        && prefix.isEmpty() && offset == 0 && limit == kUserPageSize) {
+        qDebug() << "ApiClient: Первая страница пользователей уже запрашивается с момента входа, ждем этот ответ.";
+        RequestHandle *handle = new RequestHandle(this);
+        connect(initialUserPage, &RequestHandle::jsonReady, handle, &RequestHandle::finishWithJson);
+        connect(initialUserPage, &RequestHandle::failed, handle, &RequestHandle::fail);
+        initialUserPage.clear();
+        return handle;
+    }
+    initialUserPage.clear();
+    return sendUserPageRequest(token, prefix, offset, limit);
+}
+
+RequestHandle *ApiClient::sendUserPageRequest(const QString &token, const QString &prefix, int offset, int limit)
+{
+    RequestHandle *handle = new RequestHandle(this);
     if (token.isEmpty()) {
-        qWarning() << "ApiClient::getUserList: Пустой токен.";
-        emit userListFailed("Внутренняя ошибка: отсутствует токен.", 0);
-        return;
+        qWarning() << "ApiClient::getUserPage: Пустой токен.";
+        handle->failLater("Внутренняя ошибка: отсутствует токен.", 0);
+        return handle;
     }
     QUrl listUrl = buildUrl("user_list.php");
     QNetworkRequest request(listUrl);
     request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
     QUrlQuery postData;
     postData.addQueryItem("token_api", token);
+    postData.addQueryItem("offset", QString::number(offset));
+    postData.addQueryItem("limit", QString::number(limit));
+    if (!prefix.isEmpty()) postData.addQueryItem("q", prefix);
 
-    qDebug() << "ApiClient: Запрос POST списка пользователей на" << listUrl.toString();
+    qDebug() << "ApiClient: Запрос страницы пользователей" << offset << "+" << limit << "фильтр:" << prefix;
     QNetworkReply *reply = networkManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8());
+    Tracer::traceReply(reply, "user_list.php");
+    connect(handle, &RequestHandle::abortRequested, reply, &QNetworkReply::abort);
+    QPointer<RequestHandle> waiter(handle);
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+    connect(reply, &QNetworkReply::finished, this, [this, reply, waiter, prefix, offset, limit]() {
         if (reply->error() == QNetworkReply::NoError) {
+            TRACE_SCOPE("parse", "user_list.php");
             int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
             QByteArray responseData = reply->readAll();
-            if (statusCode == 200) {
-                QJsonDocument doc = QJsonDocument::fromJson(responseData);
-                if (!doc.isNull() && doc.isObject()) {
-                    QJsonObject obj = doc.object();
-                    if (obj.value("status").toString() == "success" && obj.contains("users") && obj["users"].isArray()) {
-                        QList<UserData> userList;
-                        QJsonArray usersArray = obj["users"].toArray();
-                        for (const QJsonValue &val : usersArray) {
-                            if (val.isObject()) {
-                                QJsonObject userObj = val.toObject();
-                                UserData user;
-                                user.id = userObj.value("id").toString();
-                                user.username = userObj.value("username").toString();
-                                if (!user.id.isEmpty()) { // Простая валидация
-                                    userList.append(user);
-                                }
-                            }
+            QJsonDocument doc = QJsonDocument::fromJson(responseData);
+            QJsonObject obj = doc.object();
+            if (statusCode != 200) {
+                if (waiter) waiter->fail(parseErrorMessage(responseData, "Ошибка сервера"), statusCode);
+            } else if (obj.value("status").toString() != "success" || !obj.value("users").isArray()) {
+                if (waiter) waiter->fail("Неверный формат ответа от сервера.", statusCode);
+            } else {
+                QJsonArray usersArray = obj.value("users").toArray();
+                if (!obj.contains("total")) {
+                    // Старый сервер без постраничной выдачи прислал всех: фильтруем и режем здесь
+                    QJsonArray filtered;
+                    for (const QJsonValue &val : usersArray) {
+                        if (prefix.isEmpty() || val.toObject().value("username").toString().startsWith(prefix, Qt::CaseInsensitive)) {
+                            filtered.append(val);
                         }
-                        emit userListSuccess(userList);
-                    } else {
-                        emit userListFailed("Неверный формат ответа от сервера.", statusCode);
                     }
-                } else { /* Ошибка парсинга JSON */ emit userListFailed("Ошибка парсинга JSON.", statusCode); }
-            } else { /* Ошибка HTTP */ emit userListFailed("Ошибка сервера: " + QString::fromUtf8(responseData), statusCode); }
-        } else { /* Ошибка сети */ emit userListFailed(reply->errorString(), 0); }
+                    obj.insert("total", filtered.size());
+                    QJsonArray pageArray;
+                    for (int i = offset; i < qMin<qsizetype>(offset + limit, filtered.size()); ++i) {
+                        pageArray.append(filtered.at(i));
+                    }
+                    usersArray = pageArray;
+                }
+                obj.insert("users", usersArray);
+                obj.insert("offset", offset);
+
+                if (offset == 0 && prefix.isEmpty()) {
+                    // Первая страница без фильтра - то, что админка покажет при следующем запуске
+                    QList<UserData> firstPage;
+                    for (const QJsonValue &val : usersArray) {
+                        UserData user;
+                        user.id = val.toObject().value("id").toString();
+                        user.username = val.toObject().value("username").toString();
+                        if (!user.id.isEmpty()) firstPage.append(user);
+                    }
+                    metadata.saveUsers(firstPage);
+                }
+                if (waiter) waiter->finishWithJson(obj);
+            }
+        }
+        // Сетевая ошибка обработается в errorOccurred
         reply->deleteLater();
     });
-    connect(reply, &QNetworkReply::errorOccurred, this, [this, reply](QNetworkReply::NetworkError code){/*...*/});
+    connect(reply, &QNetworkReply::errorOccurred, this, [reply, waiter](QNetworkReply::NetworkError code) {
+        if (code == QNetworkReply::NoError) return;
+        qWarning() << "ApiClient: Ошибка сети при запросе страницы пользователей:" << reply->errorString();
+        if (waiter) waiter->fail(QString("Ошибка сети: %1").arg(reply->errorString()), 0);
+    });
+    return handle;
 }
 
 void ApiClient::deleteUser(const QString &token, const QString &userId)
@@ -675,6 +1760,7 @@ void ApiClient::deleteUser(const QString &token, const QString &userId)
 
     qDebug() << "ApiClient: Запрос POST на удаление пользователя ID:" << userId;
     QNetworkReply *reply = networkManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8());
+    Tracer::traceReply(reply, "delete_user.php");
 
     connect(reply, &QNetworkReply::finished, this, [this, reply, userId]() {
         qDebug() << "ApiClient: Ответ на удаление пользователя ID:" << userId << "получен.";
@@ -718,6 +1804,7 @@ void ApiClient::changeUserPassword(const QString &token, const QString &userId,
 
     qDebug() << "ApiClient: Запрос POST на смену пароля для пользователя ID:" << userId;
     QNetworkReply *reply = networkManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8());
+    Tracer::traceReply(reply, "change_password.php");
 
     connect(reply, &QNetworkReply::finished, this, [this, reply, userId]() {
         qDebug() << "ApiClient: Ответ на смену пароля для ID:" << userId << "получен.";
@@ -746,10 +1833,26 @@ void ApiClient::changeUserPassword(const QString &token, const QString &userId,
 
 void ApiClient::createNewUser(const QString &token, const QString &username, const QString &password)
 {
+    // Обертка для одиночного создания из диалога: результат рассылается сигналами
+    RequestHandle *handle = createUser(token, username, password);
+    connect(handle, &RequestHandle::jsonReady, this, [this, username](const QJsonObject &userObj) {
+        UserData newUser;
+        newUser.id = userObj.value("id").toString();
+        newUser.username = username;
+        emit createUserSuccess(newUser);
+    });
+    connect(handle, &RequestHandle::failed, this, [this, username](const QString &errorString, int statusCode) {
+        emit createUserFailed(username, errorString, statusCode);
+    });
+}
+
+RequestHandle *ApiClient::createUser(const QString &token, const QString &username, const QString &password)
+{
+    RequestHandle *handle = new RequestHandle(this);
     if (token.isEmpty() || username.isEmpty() || password.isEmpty()) {
-        qWarning() << "ApiClient::createNewUser: Пустой токен, имя пользователя или пароль.";
-        emit createUserFailed(username, "Внутренняя ошибка: не все данные предоставлены.", 0);
-        return;
+        qWarning() << "ApiClient::createUser: Пустой токен, имя пользователя или пароль.";
+        handle->failLater("Внутренняя ошибка: не все данные предоставлены.", 0);
+        return handle;
     }
     QUrl createUserUrl = buildUrl("new_user.php");
     QNetworkRequest request(createUserUrl);
@@ -761,9 +1864,10 @@ void ApiClient::createNewUser(const QString &token, const QString &username, con
 
     qDebug() << "ApiClient: Запрос POST на создание пользователя:" << username;
     QNetworkReply *reply = networkManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8());
+    Tracer::traceReply(reply, "new_user.php");
+    QPointer<RequestHandle> waiter(handle);
 
-    connect(reply, &QNetworkReply::finished, this, [this, reply, username, token]() {
-        // -----------------------------------------------------------------
+    connect(reply, &QNetworkReply::finished, this, [reply, username, waiter]() {
         qDebug() << "ApiClient: Ответ на создание пользователя" << username << "получен.";
         if (reply->error() == QNetworkReply::NoError) {
             int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
@@ -776,32 +1880,35 @@ void ApiClient::createNewUser(const QString &token, const QString &username, con
                     QJsonObject obj = doc.object();
                     // Проверяем статус успеха от API
                     if (obj.value("status").toString() == "success") {
-                        qDebug() << "ApiClient: Пользователь" << username << "успешно создан. Запрашиваем обновленный список.";
-                        this->getUserList(token); // Теперь 'token' доступен здесь
+                        qDebug() << "ApiClient: Пользователь" << username << "успешно создан.";
+                        // Список целиком не перезапрашиваем: окно обновит только свои видимые страницы
+                        QJsonObject userObj;
+                        userObj.insert("id", obj.value("id").toVariant().toString());
+                        userObj.insert("username", username);
+                        if (waiter) waiter->finishWithJson(userObj);
                     } else {
                         QString errMsg = parseErrorMessage(responseData, "Ошибка создания пользователя"); // Используем парсер
-                        emit createUserFailed(username, errMsg, statusCode);
+                        if (waiter) waiter->fail(errMsg, statusCode);
                     }
                 } else { /* Ошибка парсинга JSON */
-                    emit createUserFailed(username, "Ошибка парсинга JSON ответа.", statusCode);
+                    if (waiter) waiter->fail("Ошибка парсинга JSON ответа.", statusCode);
                 }
             } else { /* Ошибка HTTP (не 200) */
                 QString errorMsg = parseErrorMessage(responseData, "Ошибка создания пользователя");
-                emit createUserFailed(username, errorMsg, statusCode);
+                if (waiter) waiter->fail(errorMsg, statusCode);
             }
-        } else { /* Сетевая ошибка */
-            emit createUserFailed(username, reply->errorString(), 0);
         }
+        // Сетевая ошибка обработается в errorOccurred
         reply->deleteLater();
     });
 
-    connect(reply, &QNetworkReply::errorOccurred, this, [this, reply, username](QNetworkReply::NetworkError code) {
+    connect(reply, &QNetworkReply::errorOccurred, this, [reply, username, waiter](QNetworkReply::NetworkError code) {
         if(code == QNetworkReply::NoError) return;
         qWarning() << "ApiClient: Сетевая ошибка при создании пользователя" << username << code << reply->errorString();
-        if (!reply) return;
-        emit createUserFailed(username, reply->errorString(), 0);
-        reply->deleteLater();
+        const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (waiter) waiter->fail(parseErrorMessage(reply->readAll(), reply->errorString()), statusCode);
     });
+    return handle;
 }
 
 
@@ -820,6 +1927,7 @@ void ApiClient::triggerBackup(const QString &token)
 
     qDebug() << "ApiClient: Запрос POST на запуск бэкапа.";
     QNetworkReply *reply = networkManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8());
+    Tracer::traceReply(reply, "make_backup.php");
 
     connect(reply, &QNetworkReply::finished, this, [this, reply]() {
         qDebug() << "ApiClient: Ответ на запуск бэкапа получен.";
@@ -857,3 +1965,316 @@ void ApiClient::triggerBackup(const QString &token)
         reply->deleteLater();
     });
 }
+
+RequestHandle *ApiClient::postForJson(const QString &endpoint, const QUrlQuery &postData, const QString &errorPrefix)
+{
+    RequestHandle *handle = new RequestHandle(this);
+    QNetworkRequest request(buildUrl(endpoint));
+    request.setHeader(QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded");
+    QNetworkReply *reply = networkManager->post(request, postData.toString(QUrl::FullyEncoded).toUtf8());
+    Tracer::traceReply(reply, endpoint);
+    watchJsonReply(handle, reply, endpoint, errorPrefix);
+    return handle;
+}
+
+void ApiClient::watchJsonReply(RequestHandle *handle, QNetworkReply *reply, const QString &endpoint, const QString &errorPrefix)
+{
+    connect(handle, &RequestHandle::abortRequested, reply, &QNetworkReply::abort);
+    QPointer<RequestHandle> waiter(handle);
+
+    connect(reply, &QNetworkReply::finished, reply, [reply, waiter, endpoint, errorPrefix]() {
+        if (reply->error() == QNetworkReply::NoError) {
+            TRACE_SCOPE_ARG("parse", "watchJsonReply", "endpoint", endpoint);
+            int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            QByteArray responseData = reply->readAll();
+            QJsonDocument doc = QJsonDocument::fromJson(responseData);
+            if (statusCode == 200 && doc.isObject() && doc.object().value("status").toString() != "error") {
+                if (waiter) waiter->finishWithJson(doc.object());
+            } else {
+                qWarning() << "ApiClient:" << endpoint << "вернул ошибку:" << statusCode << responseData;
+                if (waiter) waiter->fail(parseErrorMessage(responseData, errorPrefix), statusCode);
+            }
+        }
+        // Сетевая ошибка обработается в errorOccurred
+        reply->deleteLater();
+    });
+    connect(reply, &QNetworkReply::errorOccurred, reply, [reply, waiter, endpoint, errorPrefix](QNetworkReply::NetworkError code) {
+        if (code == QNetworkReply::NoError) return;
+        qWarning() << "ApiClient: Сетевая ошибка" << code << "при запросе" << endpoint << ":" << reply->errorString();
+        const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        if (waiter) waiter->fail(parseErrorMessage(reply->readAll(), QString("%1: %2").arg(errorPrefix, reply->errorString())), statusCode);
+    });
+}
+
+RequestHandle *ApiClient::startBackupJob(const QString &token)
+{
+    QUrlQuery postData;
+    postData.addQueryItem("token_api", token);
+    qDebug() << "ApiClient: Запуск фонового задания бэкапа.";
+    return postForJson("backup_start.php", postData, "Ошибка запуска резервного копирования");
+}
+
+RequestHandle *ApiClient::getBackupStatus(const QString &token, const QString &jobId)
+{
+    QUrlQuery postData;
+    postData.addQueryItem("token_api", token);
+    postData.addQueryItem("job_id", jobId);
+    return postForJson("backup_status.php", postData, "Ошибка получения состояния бэкапа");
+}
+
+RequestHandle *ApiClient::downloadBackupArchive(const QString &token, const QString &jobId, const QString &partPath, qint64 archiveSize)
+{
+    RequestHandle *handle = new RequestHandle(this);
+    std::shared_ptr<ArchiveDownload> state = std::make_shared<ArchiveDownload>();
+    state->file.setFileName(partPath);
+    if (!state->file.open(QIODevice::ReadWrite)) {
+        handle->failLater(QString("Не удалось открыть файл для записи: %1").arg(state->file.errorString()), 0);
+        return handle;
+    }
+    // Уже скачанная часть остается на диске - просим только хвост
+    const qint64 resumeOffset = state->file.size();
+    state->file.seek(resumeOffset);
+    state->baseOffset = resumeOffset;
+
+    QUrl downloadUrl = buildUrl("backup_download.php");
+    QUrlQuery query;
+    query.addQueryItem("token_api", token);
+    query.addQueryItem("job_id", jobId);
+    downloadUrl.setQuery(query);
+    QNetworkRequest request(downloadUrl);
+    request.setRawHeader("Accept-Encoding", "identity"); // Архив уже сжат, смещения Range - по файлу
+    if (resumeOffset > 0) {
+        request.setRawHeader("Range", "bytes=" + QByteArray::number(resumeOffset) + "-");
+    }
+
+    qDebug() << "ApiClient: Скачивание архива бэкапа" << jobId << (resumeOffset > 0 ? QString("с байта %1").arg(resumeOffset) : QString());
+    // Архив скачивается в потоке передач, как и остальные тела файлов
+    QPointer<RequestHandle> waiter(scheduler->transferWorker()->createRelay(handle));
+    scheduler->schedule(RequestScheduler::Bulk, "backup " + jobId, [this, waiter, state, request]() -> QNetworkReply * {
+        if (!waiter || waiter->isFinished()) return nullptr; // Отменили, пока ждали очереди
+        QNetworkReply *reply = scheduler->manager(RequestScheduler::Bulk)->get(request);
+        connect(waiter, &RequestHandle::abortRequested, reply, &QNetworkReply::abort);
+
+        reply->setReadBufferSize(kDownloadReadBufferSize);
+        connect(reply, &QNetworkReply::readyRead, reply, [this, reply, state]() {
+            pullThrottled(reply, &state->throttle, &state->pullScheduled, [reply, state](qint64 maxBytes) {
+                consumeArchiveChunk(reply, *state, maxBytes);
+            });
+        });
+        connect(reply, &QNetworkReply::downloadProgress, reply, [waiter, state](qint64 bytesReceived, qint64 bytesTotal) {
+            if (waiter) waiter->reportProgress(state->baseOffset + bytesReceived, bytesTotal > 0 ? state->baseOffset + bytesTotal : -1);
+        });
+        connect(reply, &QNetworkReply::finished, reply, [reply, waiter, state]() {
+            const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            consumeArchiveChunk(reply, *state); // Остаток, который ограничитель еще не отдал
+            state->file.flush();
+            const qint64 fileSize = state->file.size();
+            state->file.close();
+            if (reply->error() == QNetworkReply::NoError) {
+                if (statusCode == 200 || statusCode == 206) {
+                    qDebug() << "ApiClient: Архив бэкапа скачан," << fileSize << "байт.";
+                    QJsonObject result;
+                    result.insert("path", state->file.fileName());
+                    result.insert("size", fileSize);
+                    if (waiter) waiter->finishWithJson(result);
+                } else if (waiter) {
+                    waiter->fail(parseErrorMessage(state->errorBody, "Ошибка скачивания архива"), statusCode);
+                }
+            }
+            // Сетевая ошибка обработается в errorOccurred
+            reply->deleteLater();
+        });
+        connect(reply, &QNetworkReply::errorOccurred, reply, [reply, waiter, state, archiveSize](QNetworkReply::NetworkError code) {
+            if (code == QNetworkReply::NoError) return;
+            const int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            if (statusCode == 416) {
+                // Диапазон за концом файла: на диске весь архив, только если размер .part совпадает
+                // с полным размером (из прошлой попытки или из Content-Range: bytes */N этого ответа)
+                qint64 total = archiveSize;
+                const QByteArray contentRange = reply->rawHeader("Content-Range");
+                const qsizetype slash = contentRange.indexOf('/');
+                if (slash >= 0) {
+                    bool ok = false;
+                    const qint64 reported = contentRange.mid(slash + 1).trimmed().toLongLong(&ok);
+                    if (ok) total = reported;
+                }
+                const qint64 partSize = state->file.size();
+                if (total > 0 && partSize == total) {
+                    QJsonObject result;
+                    result.insert("path", state->file.fileName());
+                    result.insert("size", partSize);
+                    if (waiter) waiter->finishWithJson(result);
+                    return;
+                }
+                // Размер не сходится или неизвестен: .part не от этого архива - докачивать не к чему
+                qWarning() << "ApiClient: 416 для архива, .part" << partSize << "байт при полном размере" << total << ", скачивание заново.";
+                state->file.resize(0);
+                if (waiter) waiter->fail("Частично скачанный архив не совпадает с архивом на сервере.", 0);
+                return;
+            }
+            qWarning() << "ApiClient: Обрыв скачивания архива (" << code << "):" << reply->errorString();
+            // Обрыв посреди тела - сетевая ошибка (0), а не ответ сервера: BackupJob дозапросит хвост
+            const int failCode = (statusCode == 200 || statusCode == 206 || state->rangeMismatch) ? 0 : statusCode;
+            if (waiter) waiter->fail(QString("Ошибка сети: %1").arg(reply->errorString()), failCode);
+        });
+        return reply;
+    });
+    return handle;
+}
+
+RequestHandle *ApiClient::queryChunks(const QString &token, const QList<QByteArray> &chunkHashes)
+{
+    QUrlQuery postData;
+    postData.addQueryItem("token_api", token);
+    postData.addQueryItem("chunks", QString::fromLatin1(chunkHashes.join(',')));
+    return postForJson("chunk_query.php", postData, "Ошибка проверки частей файла");
+}
+
+RequestHandle *ApiClient::uploadChunk(const QString &token, const QByteArray &chunkHash, const QByteArray &data)
+{
+    RequestHandle *handle = new RequestHandle(this);
+    QPointer<RequestHandle> waiter(scheduler->transferWorker()->createRelay(handle));
+    scheduler->schedule(RequestScheduler::Bulk, QString::fromLatin1(chunkHash.left(12)), [this, waiter, token, chunkHash, data]()
+                            -> QNetworkReply * {
+        if (!waiter || waiter->isFinished()) return nullptr;
+        QBuffer *body = new QBuffer;
+        body->setData(data);
+        body->open(QIODevice::ReadOnly);
+
+        // Сервер сверяет хэш тела с заявленным и сохраняет кусок под этим именем
+        QList<QPair<QByteArray, QByteArray>> fields;
+        fields.append({"token_api", token.toUtf8()});
+        fields.append({"sha256", chunkHash});
+        QNetworkReply *reply = postMultipart(QNetworkRequest(buildUrl("chunk_upload.php")), fields,
+                                             QString::fromLatin1(chunkHash), "application/octet-stream", body, "chunk");
+        connect(reply, &QNetworkReply::uploadProgress, reply, [waiter](qint64 bytesSent, qint64 bytesTotal) {
+            if (bytesTotal > 0 && waiter) waiter->reportProgress(bytesSent, bytesTotal);
+        });
+        watchJsonReply(waiter, reply, "chunk_upload.php", "Ошибка отправки части файла");
+        return reply;
+    });
+    return handle;
+}
+
+// Тело multipart/form-data собирается вручную, чтобы отдавать его сети через ограничитель скорости
+QNetworkReply *ApiClient::postMultipart(QNetworkRequest request, const QList<QPair<QByteArray, QByteArray>> &fields,
+                                        const QString &fileName, const QByteArray &contentType, QIODevice *body,
+                                        const QByteArray &fileField)
+{
+    const QByteArray boundary = "FilesExchangeBoundary" + QByteArray::number(QRandomGenerator::global()->generate64(), 16);
+    QByteArray head;
+    for (const QPair<QByteArray, QByteArray> &field : fields) {
+        head += "--" + boundary + "\r\nContent-Disposition: form-data; name=\"" + field.first + "\"\r\n\r\n"
+                + field.second + "\r\n";
+    }
+    head += "--" + boundary + "\r\nContent-Disposition: form-data; name=\"" + fileField + "\"; filename=\""
+            + fileName.toUtf8() + "\"\r\nContent-Type: " + contentType + "\r\n\r\n";
+    const QByteArray tail = "\r\n--" + boundary + "--\r\n";
+
+    request.setHeader(QNetworkRequest::ContentTypeHeader, QByteArray("multipart/form-data; boundary=" + boundary));
+    ThrottledUploadDevice *device = new ThrottledUploadDevice(head, body, tail, limiter);
+    QNetworkReply *reply = scheduler->manager(RequestScheduler::Bulk)->post(request, device);
+    device->setParent(reply);
+    return reply;
+}
+
+RequestHandle *ApiClient::commitChunkedFile(const QString &token, const QString &fileName, qint64 fileSize, const QByteArray &sha256,
+                                            const QString &mimeType, const QList<QByteArray> &chunkHashes)
+{
+    QUrlQuery postData;
+    postData.addQueryItem("token_api", token);
+    postData.addQueryItem("file_name", fileName);
+    postData.addQueryItem("file_size", QString::number(fileSize));
+    postData.addQueryItem("sha256", QString::fromLatin1(sha256));
+    postData.addQueryItem("mime_type", mimeType);
+    postData.addQueryItem("chunks", QString::fromLatin1(chunkHashes.join(',')));
+    qDebug() << "ApiClient: Сборка файла" << fileName << "из" << chunkHashes.count() << "кусков.";
+    return postForJson("chunk_commit.php", postData, QString("Ошибка сборки файла '%1'").arg(fileName));
+}
+
+
+// Запрос миниатюры файла
+void ApiClient::fetchPreview(const QString &token, const QString &fileId, bool allowPrefixFallback)
+{
+    if (token.isEmpty() || fileId.isEmpty()) {
+        emit previewFailed(fileId, "Внутренняя ошибка: отсутствует токен или ID файла.", 0);
+        return;
+    }
+    QUrl thumbUrl = buildUrl("thumbnail.php");
+    QUrlQuery query;
+    query.addQueryItem("token_api", token);
+    query.addQueryItem("file_id", fileId);
+    query.addQueryItem("size", QString::number(PreviewService::kThumbnailSize));
+    thumbUrl.setQuery(query);
+
+    QNetworkRequest request(thumbUrl);
+    request.setPriority(QNetworkRequest::LowPriority);
+    // Миниатюры - фоновые запросы: не больше пары разом, остальные соединения остаются кликам
+    scheduler->schedule(RequestScheduler::Background, "thumbnail " + fileId, [this, request, token, fileId, allowPrefixFallback]()
+                            -> QNetworkReply * {
+        if (!serverThumbnails) {
+            // Пока запрос ждал очереди, выяснилось, что миниатюр на сервере нет
+            if (allowPrefixFallback) {
+                fetchPreviewPrefix(token, fileId);
+            } else {
+                emit previewFailed(fileId, "Сервер не отдает миниатюры.", 404);
+            }
+            return nullptr;
+        }
+        QNetworkReply *reply = networkManager->get(request);
+        connect(reply, &QNetworkReply::finished, this, [this, reply, token, fileId, allowPrefixFallback]() {
+            int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            QString contentType = reply->header(QNetworkRequest::ContentTypeHeader).toString();
+            if (statusCode == 404 && serverThumbnails) {
+                qDebug() << "ApiClient: Сервер не отдает миниатюры (thumbnail.php - 404), больше не спрашиваем.";
+                serverThumbnails = false;
+            }
+            if (reply->error() == QNetworkReply::NoError && statusCode == 200 && contentType.startsWith("image/")) {
+                emit previewDataReady(fileId, reply->readAll());
+            } else if (allowPrefixFallback && (reply->error() == QNetworkReply::NoError || statusCode == 404)) {
+                // Серверных миниатюр нет - декодируем начало самого файла
+                fetchPreviewPrefix(token, fileId);
+            } else {
+                emit previewFailed(fileId, reply->errorString(), statusCode);
+            }
+            reply->deleteLater();
+        });
+        return reply;
+    });
+}
+
+void ApiClient::fetchPreviewPrefix(const QString &token, const QString &fileId)
+{
+    QUrl downloadUrl = buildUrl("download_file.php");
+    QUrlQuery query;
+    query.addQueryItem("token_api", token);
+    query.addQueryItem("file_id", fileId);
+    downloadUrl.setQuery(query);
+
+    QNetworkRequest request(downloadUrl);
+    request.setRawHeader("Range", "bytes=0-" + QByteArray::number(kPreviewPrefixBytes - 1));
+    request.setRawHeader("Accept-Encoding", "identity");
+    request.setPriority(QNetworkRequest::LowPriority);
+    scheduler->schedule(RequestScheduler::Background, "preview prefix " + fileId, [this, request, fileId]() {
+        QNetworkReply *reply = networkManager->get(request);
+
+        std::shared_ptr<QByteArray> data = std::make_shared<QByteArray>();
+        connect(reply, &QNetworkReply::readyRead, this, [reply, data]() {
+            data->append(reply->readAll());
+            // Сервер проигнорировал Range - не тянем большой файл целиком
+            if (data->size() >= kPreviewPrefixBytes) reply->abort();
+        });
+        connect(reply, &QNetworkReply::finished, this, [this, reply, fileId, data]() {
+            int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+            data->append(reply->readAll());
+            const bool aborted = reply->error() == QNetworkReply::OperationCanceledError;
+            if ((reply->error() == QNetworkReply::NoError || aborted) && (statusCode == 200 || statusCode == 206) && !data->isEmpty()) {
+                emit previewDataReady(fileId, *data);
+            } else {
+                emit previewFailed(fileId, reply->errorString(), statusCode);
+            }
+            reply->deleteLater();
+        });
+        return reply;
+    });
+}
@@ -9,32 +9,119 @@
 #include <QUrl>
 #include <QJsonObject>
 #include <QHttpMultiPart>
-#include <QMimeDatabase>
+#include <QMimeType>
 #include <QFileInfo>
 #include <QList>
 #include "datatypes.h"
+#include "batcharchive.h"
+#include "compression.h"
+#include "metadatacache.h"
+#include "fileinfocache.h"
+#include "downloadcache.h"
+#include "requesthandle.h"
+#include <QPointer>
+#include <QHash>
+#include <QPair>
+#include <QSet>
 #include <QFile>
+#include <QElapsedTimer>
+#include <memory>
+#include <functional>
+
+struct DownloadState;
+class PreviewService;
+class BandwidthLimiter;
+class TokenBucket;
+class RequestScheduler;
+class TransferWorker;
 
 class ApiClient : public QObject
 {
     Q_OBJECT
 
 public:
-    explicit ApiClient(const QString &baseUrl, QObject *parent = nullptr);
+    // sharedWorker - общий поток передач для множества клиентов в одном процессе (--loadgen);
+    // по умолчанию у клиента свой
+    explicit ApiClient(const QString &baseUrl, QObject *parent = nullptr, TransferWorker *sharedWorker = nullptr);
     ~ApiClient();
 
+    static QString defaultBaseUrl(); // Адрес API по умолчанию (GUI и режимы командной строки); переопределяется FX_SERVER
+
     // --- Методы API ---
     void login(const QString &username, const QString &password);
+    // Вход по сохраненному токену (SessionStore): область кэшей как после login, без запроса к auth.php
+    void resumeSession(const QString &username);
+    // Дешевая проверка токена (session_check.php): {"role"} и, если сервер выдал новый, {"token_api"}
+    RequestHandle *validateSession(const QString &token);
+    // Начальные данные роли (список файлов, для админа - первая страница пользователей) запрашиваются
+    // сразу после получения токена, параллельно с постройкой окна. Такие же запросы окна
+    // присоединяются к уже идущим, а не отправляются повторно
+    void prefetchSessionData(const QString &token, const QString &role);
+    qint64 sessionElapsedMs() const; // С начала сессии (prefetchSessionData), -1 - сессия не начата
     void getUserFiles(const QString &token);
     void uploadFile(const QString &token, const QString &filePath);
-    void getFileInfo(const QString &token, const QString &fileUrlIdentifier);
-    void downloadFile(const QString &token, const QString &fileId, const QString &originalFileName);
+    // То же без рассылки сигналов - для очереди передач (результат: ответ сервера + "file_name")
+    RequestHandle *upload(const QString &token, const QString &filePath);
+    // Мелкие файлы одним запросом (см. BatchArchive). Результат: {"files": [{"path", "file_name",
+    // "status", "file_id", "sha256", "message"}, ...]} - по объекту на каждый путь; 404 - сервер пакетов не знает.
+    // Статус "not_batched" - файл вырос после постановки в очередь, его нужно загрузить через upload()
+    RequestHandle *uploadBatch(const QString &token, const QStringList &filePaths);
+    bool batchUploadsEnabled() const; // Выключается до конца сессии, если сервер не принимает пакеты
+    void setBatchUploads(bool enabled);
+    // Источник тела загрузки (MappedFileDevice или QFile) и загрузка по кускам - для замеров (--mapped-bench)
+    void setMappedUploads(bool enabled);
+    void setDeltaUploads(bool enabled);
+    // Результат получает только инициатор через возвращенный дескриптор
+    RequestHandle *getFileInfo(const QString &token, const QString &fileUrlIdentifier);
+    // Предзагрузка деталей в кэш без рассылки сигналов (ограничена по параллельности)
+    void prefetchFileInfo(const QString &token, const QString &fileUrlIdentifier);
+    bool cachedFileInfo(const QString &fileUrlIdentifier, QJsonObject *fileData);
+    RequestHandle *downloadFile(const QString &token, const QString &fileId, const QString &originalFileName);
+    // Скачивание сразу в файл targetPath (через QSaveFile, заменяется только проверенным файлом):
+    // тело не копится в памяти. Результат - jsonReady с {"path", "size", "sha256" (hex)}
+    RequestHandle *downloadFileTo(const QString &token, const QString &fileId, const QString &originalFileName,
+                                  const QString &targetPath);
     void deleteFile(const QString &token, const QString &fileId);
-    void getUserList(const QString &token);
+    // Страница списка пользователей с фильтром по префиксу имени.
+    // Результат (jsonReady): {"users": [...], "total": N, "offset": M}
+    RequestHandle *getUserPage(const QString &token, const QString &prefix, int offset, int limit);
+    static const int kUserPageSize = 200; // Страница списка пользователей в админке
     void deleteUser(const QString &token, const QString &userId);
     void changeUserPassword(const QString &token, const QString &userId, const QString &newPassword);
     void createNewUser(const QString &token, const QString &username, const QString &password);
-    void triggerBackup(const QString &token);
+    // То же без рассылки сигналов - для массового импорта (результат: {"id", "username"})
+    RequestHandle *createUser(const QString &token, const QString &username, const QString &password);
+    void triggerBackup(const QString &token); // Старый синхронный make_backup.php
+    // Фоновое задание бэкапа на сервере: запуск ({"job_id"}), опрос состояния и потоковое
+    // скачивание архива в partPath (дописывается через Range, если файл уже частично скачан)
+    RequestHandle *startBackupJob(const QString &token);
+    RequestHandle *getBackupStatus(const QString &token, const QString &jobId);
+    // archiveSize - полный размер архива, если известен (-1): по нему проверяется уже скачанный .part
+    RequestHandle *downloadBackupArchive(const QString &token, const QString &jobId, const QString &partPath, qint64 archiveSize = -1);
+    // Загрузка по кускам (см. DeltaUpload): какие куски нужны серверу ({"missing": [...]}),
+    // отправка одного куска и сборка файла из кусков по порядку
+    RequestHandle *queryChunks(const QString &token, const QList<QByteArray> &chunkHashes);
+    RequestHandle *uploadChunk(const QString &token, const QByteArray &chunkHash, const QByteArray &data);
+    RequestHandle *commitChunkedFile(const QString &token, const QString &fileName, qint64 fileSize, const QByteArray &sha256,
+                                     const QString &mimeType, const QList<QByteArray> &chunkHashes);
+    // Миниатюра: серверная (thumbnail.php) или, если разрешено, ограниченный префикс файла.
+    // После первого 404 от thumbnail.php сервер до конца сессии считается без миниатюр
+    void fetchPreview(const QString &token, const QString &fileId, bool allowPrefixFallback);
+
+    QString baseUrl() const;
+
+    // --- Настройки передач ---
+    void setUploadCompression(Compression::Method method);
+    Compression::Method uploadCompressionMethod() const;
+    // Ограничение скорости загрузок и скачиваний (можно менять на ходу)
+    BandwidthLimiter *bandwidthLimiter();
+    // Очереди запросов по приоритету и время ожидания в них
+    RequestScheduler *requestScheduler();
+
+    // Кэш списков файлов/пользователей текущей сессии (область задается при входе)
+    MetadataCache *metadataCache();
+    DownloadCache *downloadCache(); // Бюджет на диске: cache/downloadBudgetMB или setBudget
+    PreviewService *previewService();
 
 signals:
     // --- Сигналы результата ---
@@ -50,22 +137,10 @@ signals:
     void uploadProgress(qint64 bytesSent, qint64 bytesTotal); // Сигнал для прогресса
     void uploadFailed(const QString &errorString, int statusCode = 0); // Сигнал при ошибке
 
-    // сигналы для получения информации о файле
-    void fileInfoSuccess(const QJsonObject &fileData);
-    void fileInfoFailed(const QString &errorString, int statusCode = 0);
-
-    // сигналы для скачивания файла
-    void downloadSuccess(const QString &requestedFileId, const QByteArray &fileData, const QString &originalFileName);
-    void downloadProgress(const QString &requestedFileId, qint64 bytesReceived, qint64 bytesTotal);
-    void downloadFailed(const QString &requestedFileId, const QString &errorString, int statusCode = 0);
-
     // сигналы для удаления файла
     void deleteSuccess(const QString &deletedFileId);
     void deleteFailed(const QString &failedFileId, const QString &errorString, int statusCode = 0);
 
-    void userListSuccess(const QList<UserData> &users);
-    void userListFailed(const QString &errorString, int statusCode = 0);
-
     void deleteUserSuccess(const QString &deletedUserId);
     void deleteUserFailed(const QString &failedUserId, const QString &errorString, int statusCode = 0);
 
@@ -78,12 +153,69 @@ signals:
     void backupSuccess(const QString &message); // Сервер может вернуть сообщение
     void backupFailed(const QString &errorString, int statusCode = 0);
 
+    void previewDataReady(const QString &fileId, const QByteArray &data);
+    void previewFailed(const QString &fileId, const QString &errorString, int statusCode = 0);
+
+    // Метрики передач (байты на проводе против логических байтов)
+    void transferStats(const TransferStats &stats);
 
 private:
-    QNetworkAccessManager *networkManager;
+    RequestScheduler *scheduler;
+    QNetworkAccessManager *networkManager; // Интерактивный менеджер планировщика
     QString apiBaseUrl;
+    Compression::Method uploadCompression;
+    bool mappedUploads; // Тело загрузки через MappedFileDevice вместо QFile
+    bool deltaUploads;  // Большие файлы - по кускам (выключается, если сервер их не поддерживает)
+    bool batchUploads;  // Мелкие файлы - пакетами (выключается, если сервер их не поддерживает)
+    bool serverThumbnails; // thumbnail.php есть (выключается после первого 404)
+    MetadataCache metadata;
+    FileInfoCache fileInfoCache;                    // Ответы file_info.php (LRU + TTL)
+    DownloadCache downloads;                        // Скачанные файлы по содержимому (с проверкой на сервере)
+    QHash<QString, QList<QPointer<RequestHandle>>> fileInfoInFlight; // URL ID -> ждущие результата (пусто у предзагрузки)
+    QList<QPair<QString, QString>> prefetchQueue;   // (токен, URL ID), свежие - в конце, не длиннее kMaxQueuedPrefetches
+    QSet<QString> prefetchQueued;                   // URL ID из prefetchQueue - проверка повтора без обхода очереди
+    int activePrefetches;                           // Отданы планировщику (очередь Background) или уже идут
+    PreviewService *previews;
+    BandwidthLimiter *limiter;
+    QElapsedTimer sessionTimer;
+    // Начальные запросы сессии, к которым может присоединиться открывающееся окно (один раз)
+    QPointer<QNetworkReply> initialFilesReply;
+    QString initialFilesToken;
+    QPointer<RequestHandle> initialUserPage;
+    QString initialUserPageToken;
 
     QUrl buildUrl(const QString &endpoint) const;
+    QNetworkReply *sendUserFilesRequest(const QString &token);
+    RequestHandle *sendUserPageRequest(const QString &token, const QString &prefix, int offset, int limit);
+    // POST с JSON-ответом, результат через дескриптор
+    RequestHandle *postForJson(const QString &endpoint, const QUrlQuery &postData, const QString &errorPrefix);
+    void watchJsonReply(RequestHandle *handle, QNetworkReply *reply, const QString &endpoint, const QString &errorPrefix);
+    QNetworkReply *postMultipart(QNetworkRequest request, const QList<QPair<QByteArray, QByteArray>> &fields,
+                                 const QString &fileName, const QByteArray &contentType, QIODevice *body,
+                                 const QByteArray &fileField = "file");
+    // Обычная загрузка файла одним запросом (со сжатием, если включено)
+    void startFullUpload(RequestHandle *handle, const QString &token, const QString &filePath);
+    // Отправка уже подготовленного (возможно, сжатого) тела загрузки: постановка в очередь и сам запрос
+    void startUpload(RequestHandle *handle, const QString &token, const QString &filePath, const QMimeType &mimeType,
+                     const QString &bodyPath, const QByteArray &contentEncoding,
+                     qint64 logicalBytes, const QByteArray &logicalSha256, QObject *bodyOwner);
+    QNetworkReply *sendUpload(RequestHandle *handle, const QString &token, const QString &filePath, const QMimeType &mimeType,
+                              const QString &bodyPath, const QByteArray &contentEncoding,
+                              qint64 logicalBytes, const QByteArray &logicalSha256, QObject *bodyOwner);
+    // Отправка собранного пакета; result получает ответ сервера, дополненный непрочитанными файлами
+    void sendBatch(RequestHandle *handle, const QString &token, const BatchArchive::Packed &packed);
+    // Скачивание: первый запрос или дозапрос недостающей части через Range
+    void sendDownloadRequest(std::shared_ptr<DownloadState> state);
+    QNetworkReply *startDownloadReply(std::shared_ptr<DownloadState> state);
+    void finishDownload(std::shared_ptr<DownloadState> state, int statusCode);
+    void restartDownload(std::shared_ptr<DownloadState> state);
+    void finishFromCache(std::shared_ptr<DownloadState> state);
+    // Забирает из ответа столько данных, сколько разрешает ограничитель скорости (consume(maxBytes))
+    void pullThrottled(QPointer<QNetworkReply> reply, TokenBucket *bucket, bool *pullScheduled,
+                       const std::function<void(qint64)> &consume);
+    void fetchPreviewPrefix(const QString &token, const QString &fileId);
+    QNetworkReply *sendFileInfoRequest(const QString &token, const QString &fileUrlIdentifier, RequestHandle *handle);
+    void startFileInfoPrefetches();
 };
 
 #endif // APICLIENT_H
@@ -0,0 +1,165 @@
+#include "backupjob.h"
+#include "apiclient.h"
+#include "requesthandle.h"
+
+#include <QFile>
+#include <QJsonObject>
+#include <QLocale>
+#include <QTimer>
+#include <QDebug>
+
+BackupJob::BackupJob(ApiClient *client, const QString &token, const QString &targetPath, QObject *parent)
+    : QObject(parent),
+      apiClient(client),
+      apiToken(token),
+      targetPath(targetPath),
+      pollTimer(new QTimer(this)),
+      pollIntervalMs(kMinPollIntervalMs),
+      lastPercent(-1),
+      downloadAttempts(0),
+      archiveSize(-1),
+      stopped(false)
+{
+    pollTimer->setSingleShot(true);
+    connect(pollTimer, &QTimer::timeout, this, &BackupJob::pollStatus);
+}
+
+void BackupJob::start()
+{
+    emit statusChanged("Запуск резервного копирования...");
+    activeRequest = apiClient->startBackupJob(apiToken);
+    connect(activeRequest, &RequestHandle::jsonReady, this, [this](const QJsonObject &response) {
+        jobId = response.value("job_id").toVariant().toString();
+        if (jobId.isEmpty()) {
+            fail("Сервер не вернул идентификатор задания бэкапа.", 200);
+            return;
+        }
+        qDebug() << "BackupJob: Задание бэкапа запущено, ID:" << jobId;
+        emit statusChanged("Подготовка архива на сервере...");
+        scheduleNextPoll(true);
+    });
+    connect(activeRequest, &RequestHandle::failed, this, [this](const QString &errorString, int statusCode) {
+        if (statusCode == 404) {
+            qDebug() << "BackupJob: Сервер не поддерживает задания бэкапа, используется make_backup.php";
+            runLegacyBackup();
+            return;
+        }
+        fail(errorString, statusCode);
+    });
+}
+
+void BackupJob::cancel()
+{
+    if (stopped) return;
+    stopped = true;
+    pollTimer->stop();
+    if (activeRequest) activeRequest->abort();
+    qDebug() << "BackupJob: Отменено пользователем. Частично скачанный архив сохранен в" << partPath();
+}
+
+void BackupJob::pollStatus()
+{
+    if (stopped) return;
+    activeRequest = apiClient->getBackupStatus(apiToken, jobId);
+    connect(activeRequest, &RequestHandle::jsonReady, this, &BackupJob::handleStatus);
+    connect(activeRequest, &RequestHandle::failed, this, [this](const QString &errorString, int statusCode) {
+        if (statusCode == 0) {
+            // Сетевая ошибка опроса не означает ошибку бэкапа - пробуем позже
+            qWarning() << "BackupJob: Ошибка опроса состояния:" << errorString;
+            scheduleNextPoll(false);
+            return;
+        }
+        fail(errorString, statusCode);
+    });
+}
+
+void BackupJob::handleStatus(const QJsonObject &status)
+{
+    if (stopped) return;
+    const QString state = status.value("state").toString();
+    const int percent = status.value("progress").toInt(-1);
+    const bool progressed = percent != lastPercent;
+    if (percent >= 0 && progressed) {
+        lastPercent = percent;
+        emit serverProgress(percent);
+    }
+    if (status.contains("message")) emit statusChanged(status.value("message").toString());
+
+    if (state == "done") {
+        if (status.contains("size")) archiveSize = status.value("size").toInteger(-1);
+        startDownload();
+    } else if (state == "failed") {
+        fail(status.value("message").toString("Сервер не смог создать резервную копию."), 200);
+    } else {
+        scheduleNextPoll(progressed);
+    }
+}
+
+void BackupJob::scheduleNextPoll(bool progressed)
+{
+    // Пока прогресс движется - опрашиваем часто, при застое интервал растет
+    pollIntervalMs = progressed ? kMinPollIntervalMs : qMin(pollIntervalMs * 3 / 2, kMaxPollIntervalMs);
+    pollTimer->start(pollIntervalMs);
+}
+
+void BackupJob::startDownload()
+{
+    if (stopped) return;
+    downloadAttempts++;
+    if (downloadAttempts == 1) QFile::remove(partPath()); // Остаток чужого задания не дописываем
+    emit statusChanged(downloadAttempts > 1 ? QString("Докачивание архива (попытка %1)...").arg(downloadAttempts)
+                                            : QString("Скачивание архива..."));
+    activeRequest = apiClient->downloadBackupArchive(apiToken, jobId, partPath(), archiveSize);
+    connect(activeRequest, &RequestHandle::progress, this, [this](qint64 bytesReceived, qint64 bytesTotal) {
+        if (bytesTotal > 0) archiveSize = bytesTotal; // Полный размер для проверки .part при следующей попытке
+        emit downloadProgress(bytesReceived, bytesTotal);
+    });
+    connect(activeRequest, &RequestHandle::jsonReady, this, [this](const QJsonObject &result) {
+        QFile::remove(targetPath);
+        if (!QFile::rename(partPath(), targetPath)) {
+            fail(QString("Архив скачан, но не удалось переименовать его в %1").arg(targetPath), 0);
+            return;
+        }
+        const qint64 size = result.value("size").toInteger();
+        qDebug() << "BackupJob: Архив сохранен:" << targetPath << size << "байт";
+        emit finished(QString("Резервная копия сохранена: %1 (%2)")
+                          .arg(targetPath, QLocale::system().formattedDataSize(size)));
+    });
+    connect(activeRequest, &RequestHandle::failed, this, [this](const QString &errorString, int statusCode) {
+        if (stopped) return;
+        if (statusCode == 0 && downloadAttempts < kMaxDownloadAttempts) {
+            // Обрыв соединения: уже скачанная часть остается в .part, запрашиваем хвост
+            QTimer::singleShot(1000 * downloadAttempts, this, &BackupJob::startDownload);
+            return;
+        }
+        fail(errorString, statusCode);
+    });
+}
+
+void BackupJob::runLegacyBackup()
+{
+    emit statusChanged("Создание резервной копии (старый режим сервера)...");
+    connect(apiClient, &ApiClient::backupSuccess, this, [this](const QString &message) {
+        if (!stopped) emit finished(message);
+        stopped = true;
+    });
+    connect(apiClient, &ApiClient::backupFailed, this, [this](const QString &errorString, int statusCode) {
+        if (!stopped) emit failed(errorString, statusCode);
+        stopped = true;
+    });
+    apiClient->triggerBackup(apiToken);
+}
+
+void BackupJob::fail(const QString &errorString, int statusCode)
+{
+    if (stopped) return;
+    stopped = true;
+    pollTimer->stop();
+    qWarning() << "BackupJob: Ошибка:" << errorString << "код:" << statusCode;
+    emit failed(errorString, statusCode);
+}
+
+QString BackupJob::partPath() const
+{
+    return targetPath + ".part";
+}
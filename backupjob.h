@@ -0,0 +1,59 @@
+#ifndef BACKUPJOB_H
+#define BACKUPJOB_H
+
+#include <QObject>
+#include <QPointer>
+#include <QString>
+
+class ApiClient;
+class RequestHandle;
+class QTimer;
+
+// Резервное копирование как задание на сервере: backup_start.php возвращает job_id,
+// состояние опрашивается через backup_status.php с нарастающим интервалом, готовый
+// архив скачивается потоком в файл (.part) и дописывается через Range после обрывов.
+// Если сервер не знает о заданиях (404), используется старый make_backup.php
+class BackupJob : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int kMinPollIntervalMs = 1000;
+    static const int kMaxPollIntervalMs = 10000;
+    static const int kMaxDownloadAttempts = 5;
+
+    explicit BackupJob(ApiClient *client, const QString &token, const QString &targetPath, QObject *parent = nullptr);
+
+    void start();
+    void cancel(); // Прекращает опрос и скачивание (задание на сервере не трогается)
+
+signals:
+    void statusChanged(const QString &text);
+    void serverProgress(int percent);                     // Подготовка архива на сервере, 0..100
+    void downloadProgress(qint64 bytesReceived, qint64 bytesTotal);
+    void finished(const QString &message);
+    void failed(const QString &errorString, int statusCode);
+
+private:
+    ApiClient *apiClient;
+    QString apiToken;
+    QString targetPath;
+    QString jobId;
+    QTimer *pollTimer;
+    int pollIntervalMs;
+    int lastPercent;
+    int downloadAttempts;
+    qint64 archiveSize; // Полный размер архива: из backup_status или из ответа прошлой попытки
+    bool stopped;
+    QPointer<RequestHandle> activeRequest;
+
+    void pollStatus();
+    void handleStatus(const QJsonObject &status);
+    void scheduleNextPoll(bool progressed);
+    void startDownload();
+    void runLegacyBackup();
+    void fail(const QString &errorString, int statusCode);
+    QString partPath() const;
+};
+
+#endif // BACKUPJOB_H
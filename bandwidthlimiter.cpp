@@ -0,0 +1,194 @@
+#include "bandwidthlimiter.h"
+
+#include <QSettings>
+#include <limits>
+#include <QDebug>
+
+namespace {
+
+// Ведро вмещает четверть секунды трафика, но не меньше 16 КиБ: сглаживает всплески,
+// не давая после простоя отправить залпом много данных
+const qint64 kMinBurstBytes = 16 * 1024;
+
+// Не будим передачу ради пары байт: ждем, пока наберется порция
+const qint64 kMinGrantBytes = 4 * 1024;
+const int kMinRetryDelayMs = 5;
+const int kMaxRetryDelayMs = 1000;
+
+}
+
+void TokenBucket::setRate(qint64 rate)
+{
+    if (rate == bytesPerSecond) return;
+    bytesPerSecond = qMax<qint64>(0, rate);
+    burst = qMax(kMinBurstBytes, bytesPerSecond / 4);
+    tokens = qMin<double>(tokens, burst);
+    clock.start();
+}
+
+qint64 TokenBucket::rate() const
+{
+    return bytesPerSecond;
+}
+
+bool TokenBucket::isLimited() const
+{
+    return bytesPerSecond > 0;
+}
+
+void TokenBucket::refill()
+{
+    if (!clock.isValid()) {
+        clock.start();
+        return;
+    }
+    const qint64 elapsedNs = clock.nsecsElapsed();
+    clock.start();
+    tokens = qMin<double>(burst, tokens + static_cast<double>(bytesPerSecond) * elapsedNs / 1e9);
+}
+
+qint64 TokenBucket::available()
+{
+    if (!isLimited()) return std::numeric_limits<qint64>::max();
+    refill();
+    return static_cast<qint64>(tokens);
+}
+
+void TokenBucket::consume(qint64 bytes)
+{
+    if (!isLimited()) return;
+    tokens -= bytes;
+}
+
+int TokenBucket::msUntil(qint64 bytes)
+{
+    if (!isLimited()) return 0;
+    refill();
+    const double missing = qMin<double>(bytes, burst) - tokens;
+    if (missing <= 0) return 0;
+    return static_cast<int>(missing * 1000.0 / bytesPerSecond) + 1;
+}
+
+BandwidthLimiter::BandwidthLimiter(QObject *parent)
+    : QObject(parent)
+{
+    transferLimits[Upload] = 0;
+    transferLimits[Download] = 0;
+}
+
+void BandwidthLimiter::setGlobalLimit(Direction direction, qint64 bytesPerSecond)
+{
+    {
+        QMutexLocker locker(&mutex);
+        globalBuckets[direction].setRate(bytesPerSecond);
+    }
+    emit limitsChanged();
+}
+
+qint64 BandwidthLimiter::globalLimit(Direction direction) const
+{
+    QMutexLocker locker(&mutex);
+    return globalBuckets[direction].rate();
+}
+
+void BandwidthLimiter::setPerTransferLimit(Direction direction, qint64 bytesPerSecond)
+{
+    {
+        QMutexLocker locker(&mutex);
+        transferLimits[direction] = qMax<qint64>(0, bytesPerSecond);
+    }
+    emit limitsChanged();
+}
+
+qint64 BandwidthLimiter::perTransferLimit(Direction direction) const
+{
+    QMutexLocker locker(&mutex);
+    return transferLimits[direction];
+}
+
+void BandwidthLimiter::setUnthrottledWindow(const QTime &from, const QTime &to)
+{
+    {
+        QMutexLocker locker(&mutex);
+        freeFrom = from;
+        freeTo = to;
+    }
+    emit limitsChanged();
+}
+
+void BandwidthLimiter::clearUnthrottledWindow()
+{
+    setUnthrottledWindow(QTime(), QTime());
+}
+
+bool BandwidthLimiter::inUnthrottledWindow() const
+{
+    if (!freeFrom.isValid() || !freeTo.isValid() || freeFrom == freeTo) return false;
+    const QTime now = QTime::currentTime();
+    if (freeFrom < freeTo) return now >= freeFrom && now < freeTo;
+    return now >= freeFrom || now < freeTo; // Через полночь
+}
+
+bool BandwidthLimiter::isLimited(Direction direction) const
+{
+    QMutexLocker locker(&mutex);
+    if (!globalBuckets[direction].isLimited() && transferLimits[direction] == 0) return false;
+    return !inUnthrottledWindow();
+}
+
+qint64 BandwidthLimiter::take(Direction direction, qint64 wanted, TokenBucket *transferBucket)
+{
+    QMutexLocker locker(&mutex);
+    if (wanted <= 0 || !isLimited(direction)) return wanted;
+    // Лимит на передачу мог поменяться на ходу
+    if (transferBucket) transferBucket->setRate(transferLimits[direction]);
+
+    TokenBucket &global = globalBuckets[direction];
+    qint64 granted = qMin(wanted, global.available());
+    if (transferBucket) granted = qMin(granted, transferBucket->available());
+    // Мелкие порции не выдаем (кроме хвоста передачи): иначе сеть дергается на каждый байт
+    if (granted < qMin(wanted, kMinGrantBytes)) return 0;
+    global.consume(granted);
+    if (transferBucket) transferBucket->consume(granted);
+    return granted;
+}
+
+int BandwidthLimiter::retryDelayMs(Direction direction, TokenBucket *transferBucket)
+{
+    QMutexLocker locker(&mutex);
+    int delay = globalBuckets[direction].msUntil(kMinGrantBytes);
+    if (transferBucket) delay = qMax(delay, transferBucket->msUntil(kMinGrantBytes));
+    return qBound(kMinRetryDelayMs, delay, kMaxRetryDelayMs);
+}
+
+void BandwidthLimiter::loadSettings()
+{
+    QSettings settings;
+    QMutexLocker locker(&mutex);
+    globalBuckets[Upload].setRate(settings.value("transfer/uploadLimitKBps", 0).toLongLong() * 1024);
+    globalBuckets[Download].setRate(settings.value("transfer/downloadLimitKBps", 0).toLongLong() * 1024);
+    transferLimits[Upload] = settings.value("transfer/perTransferUploadLimitKBps", 0).toLongLong() * 1024;
+    transferLimits[Download] = settings.value("transfer/perTransferDownloadLimitKBps", 0).toLongLong() * 1024;
+    freeFrom = QTime::fromString(settings.value("transfer/unthrottledFrom").toString(), "hh:mm");
+    freeTo = QTime::fromString(settings.value("transfer/unthrottledTo").toString(), "hh:mm");
+    if (isLimited(Upload) || isLimited(Download) || freeFrom.isValid()) {
+        qDebug() << "BandwidthLimiter: Ограничения загрузки/скачивания (КиБ/с): общее" << globalLimit(Upload) / 1024 << "/"
+                 << globalLimit(Download) / 1024 << ", на передачу" << transferLimits[Upload] / 1024 << "/"
+                 << transferLimits[Download] / 1024 << ", без ограничений с" << freeFrom.toString("hh:mm")
+                 << "до" << freeTo.toString("hh:mm");
+    }
+    locker.unlock();
+    emit limitsChanged();
+}
+
+void BandwidthLimiter::saveSettings() const
+{
+    QSettings settings;
+    QMutexLocker locker(&mutex);
+    settings.setValue("transfer/uploadLimitKBps", globalLimit(Upload) / 1024);
+    settings.setValue("transfer/downloadLimitKBps", globalLimit(Download) / 1024);
+    settings.setValue("transfer/perTransferUploadLimitKBps", transferLimits[Upload] / 1024);
+    settings.setValue("transfer/perTransferDownloadLimitKBps", transferLimits[Download] / 1024);
+    settings.setValue("transfer/unthrottledFrom", freeFrom.isValid() ? freeFrom.toString("hh:mm") : QString());
+    settings.setValue("transfer/unthrottledTo", freeTo.isValid() ? freeTo.toString("hh:mm") : QString());
+}
@@ -0,0 +1,80 @@
+#ifndef BANDWIDTHLIMITER_H
+#define BANDWIDTHLIMITER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QTime>
+
+// Ведро токенов: пополняется со скоростью rate байт/с, вмещает не больше burst байт.
+// rate = 0 - без ограничения
+class TokenBucket
+{
+public:
+    void setRate(qint64 bytesPerSecond);
+    qint64 rate() const;
+    bool isLimited() const;
+
+    qint64 available();           // Пополняет ведро и возвращает доступные байты
+    void consume(qint64 bytes);
+    int msUntil(qint64 bytes);    // Через сколько мс в ведре наберется bytes
+
+private:
+    qint64 bytesPerSecond = 0;
+    qint64 burst = 0;
+    double tokens = 0;
+    QElapsedTimer clock;
+
+    void refill();
+};
+
+// Ограничение скорости передач: общее на все загрузки (скачивания) и отдельное на каждую передачу.
+// Тело загрузки отдается сети не быстрее, чем разрешает ведро (ThrottledUploadDevice),
+// а скачанные данные забираются из ответа порциями (буфер ответа ограничен, поэтому TCP
+// притормаживает отправителя). Лимиты можно менять на ходу - они сразу действуют и на
+// уже идущие передачи. В окне расписания (например, ночью) ограничения не действуют.
+// take() вызывается из потока передач, настройки меняются из GUI - состояние под мьютексом
+class BandwidthLimiter : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Direction { Upload, Download };
+
+    explicit BandwidthLimiter(QObject *parent = nullptr);
+
+    // Байт/с, 0 - без ограничения
+    void setGlobalLimit(Direction direction, qint64 bytesPerSecond);
+    qint64 globalLimit(Direction direction) const;
+    void setPerTransferLimit(Direction direction, qint64 bytesPerSecond);
+    qint64 perTransferLimit(Direction direction) const;
+
+    // Окно без ограничений [from, to); from > to - окно через полночь
+    void setUnthrottledWindow(const QTime &from, const QTime &to);
+    void clearUnthrottledWindow();
+
+    bool isLimited(Direction direction) const;
+
+    // Сколько из wanted байт можно передать сейчас (с учетом ведра самой передачи)
+    qint64 take(Direction direction, qint64 wanted, TokenBucket *transferBucket);
+    // Когда стоит спросить снова, если take вернул 0
+    int retryDelayMs(Direction direction, TokenBucket *transferBucket);
+
+    // Ключи transfer/* в QSettings (КиБ/с и "чч:мм")
+    void loadSettings();
+    void saveSettings() const;
+
+signals:
+    void limitsChanged();
+
+private:
+    mutable QRecursiveMutex mutex;
+    TokenBucket globalBuckets[2];
+    qint64 transferLimits[2];
+    QTime freeFrom;
+    QTime freeTo;
+
+    bool inUnthrottledWindow() const;
+};
+
+#endif // BANDWIDTHLIMITER_H
@@ -0,0 +1,94 @@
+#include "batcharchive.h"
+#include "mimeservice.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
+
+namespace {
+
+const QByteArray kMagic = "FXBATCH1\n";
+
+}
+
+namespace BatchArchive {
+
+bool isBatchable(qint64 fileSize)
+{
+    return fileSize >= 0 && fileSize <= kMaxFileSize;
+}
+
+Packed pack(const QStringList &filePaths)
+{
+    Packed result;
+    result.body.reserve(qMin<qint64>(kMaxBatchBytes, filePaths.count() * (kMaxFileSize / 4)) + kMagic.size());
+    result.body += kMagic;
+    for (const QString &path : filePaths) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            result.unreadable.append({path, file.errorString()});
+            continue;
+        }
+        // Размер берется по прочитанному: файл мог измениться после постановки в очередь.
+        // Читается не больше kMaxFileSize + 1 байт - выросший файл целиком в память не попадает
+        const QByteArray data = file.read(kMaxFileSize + 1);
+        if (file.error() != QFileDevice::NoError) {
+            result.unreadable.append({path, file.errorString()});
+            continue;
+        }
+        if (!isBatchable(data.size()) || result.body.size() + data.size() > kMaxBatchBytes) {
+            result.notBatched.append(path);
+            continue;
+        }
+
+        Entry entry;
+        entry.sourcePath = path;
+        entry.name = QFileInfo(path).fileName();
+        entry.mimeType = MimeService::mimeTypeForFile(path).name();
+        if (entry.mimeType.isEmpty()) entry.mimeType = "application/octet-stream";
+        entry.sha256 = QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+        entry.size = data.size();
+
+        result.body += QByteArray::number(entry.size) + ' ' + entry.sha256 + ' ' + entry.mimeType.toLatin1() + '\t'
+                       + QUrl::toPercentEncoding(entry.name) + '\n';
+        result.body += data;
+        result.entries.append(entry);
+    }
+    return result;
+}
+
+bool unpack(const QByteArray &body, QList<Entry> *entries, QString *errorString)
+{
+    if (!body.startsWith(kMagic)) {
+        *errorString = "Неизвестный формат пакета";
+        return false;
+    }
+    qsizetype pos = kMagic.size();
+    while (pos < body.size()) {
+        const qsizetype lineEnd = body.indexOf('\n', pos);
+        if (lineEnd < 0) {
+            *errorString = QString("Оборван заголовок файла %1").arg(entries->count() + 1);
+            return false;
+        }
+        const QByteArray line = body.mid(pos, lineEnd - pos);
+        const qsizetype tab = line.indexOf('\t');
+        const QList<QByteArray> fields = line.left(qMax<qsizetype>(tab, 0)).split(' ');
+        bool sizeOk = false;
+        Entry entry;
+        if (tab > 0 && fields.count() == 3) entry.size = fields[0].toLongLong(&sizeOk);
+        if (!sizeOk || entry.size < 0 || entry.size > body.size() - lineEnd - 1) {
+            *errorString = QString("Неверный заголовок файла %1").arg(entries->count() + 1);
+            return false;
+        }
+        entry.sha256 = fields[1].toLower();
+        entry.mimeType = QString::fromLatin1(fields[2]);
+        entry.name = QUrl::fromPercentEncoding(line.mid(tab + 1));
+        entry.data = body.mid(lineEnd + 1, entry.size);
+        entries->append(entry);
+        pos = lineEnd + 1 + entry.size;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,59 @@
+#ifndef BATCHARCHIVE_H
+#define BATCHARCHIVE_H
+
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+
+// Пакет мелких файлов для upload_batch.php: один запрос вместо запроса на каждый файл
+// (у файла в несколько килобайт заголовки, поле токена и запуск обработчика на сервере
+// стоят дороже самих данных).
+// Протокол:
+//   upload_batch.php (multipart: token_api, count, batch) -> {"status": "success", "files": [...]}
+//   Часть batch (application/x-filesexchange-batch):
+//     "FXBATCH1\n"
+//     для каждого файла строка "<размер> <sha256 hex> <mime>\t<имя в percent-encoding>\n" и <размер> байт
+//   В "files" - по объекту на файл в порядке пакета: {"file_name", "status": "success"|"error",
+//   "file_id", "sha256", "message"}; ошибка одного файла не отменяет остальные.
+// 404 на upload_batch.php значит, что сервер пакетов не знает - нужны обычные загрузки
+namespace BatchArchive {
+
+const char *const kContentType = "application/x-filesexchange-batch";
+
+const qint64 kMaxFileSize = 64 * 1024;          // Файлы больше - обычной загрузкой
+const qint64 kMaxBatchBytes = 4 * 1024 * 1024;  // Тело пакета держится в памяти целиком
+const int kMaxBatchFiles = 1000;
+const int kMinBatchFiles = 2;                   // Пакет из одного файла ничего не экономит
+
+struct Entry {
+    QString sourcePath; // Только при упаковке
+    QString name;
+    QString mimeType;
+    QByteArray sha256;  // hex
+    qint64 size = 0;
+    QByteArray data;    // Только при распаковке
+};
+
+struct Packed {
+    QByteArray body;
+    QList<Entry> entries;                      // Упакованные файлы по порядку (без data)
+    QList<QPair<QString, QString>> unreadable; // (путь, ошибка) - в пакет не попали
+    QStringList notBatched;                    // Выросли после постановки в очередь - нужна обычная загрузка
+};
+
+// Подходит ли файл такого размера для пакета
+bool isBatchable(qint64 fileSize);
+
+// Читает файлы и собирает тело пакета. Вызывается на рабочем потоке (не трогает GUI).
+// Размер проверяется заново по прочитанному: файл больше kMaxFileSize или не влезающий
+// в kMaxBatchBytes попадает в notBatched, а не в пакет
+Packed pack(const QStringList &filePaths);
+
+// Разбор тела пакета (для сервера); контрольные суммы файлов сверяет вызывающий
+bool unpack(const QByteArray &body, QList<Entry> *entries, QString *errorString);
+
+}
+
+#endif // BATCHARCHIVE_H
@@ -0,0 +1,257 @@
+#include "bulkuserimporter.h"
+#include "apiclient.h"
+#include "requesthandle.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QSet>
+#include <QTextStream>
+#include <QTimer>
+#include <QRandomGenerator>
+#include <QDebug>
+
+BulkUserImporter::BulkUserImporter(ApiClient *client, const QString &token, QObject *parent)
+    : QObject(parent),
+      apiClient(client),
+      apiToken(token),
+      inFlight(0),
+      doneCount(0),
+      concurrency(kDefaultConcurrency),
+      cancelled(false),
+      running(false)
+{
+}
+
+bool BulkUserImporter::loadCsv(const QString &filePath, QString *errorString)
+{
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+
+    QTextStream in(&file);
+    rows.clear();
+    QSet<QString> seen;
+    QChar separator;
+    int lineNumber = 0;
+    while (!in.atEnd()) {
+        const QString line = in.readLine();
+        lineNumber++;
+        if (line.trimmed().isEmpty()) continue;
+
+        if (separator.isNull()) {
+            // Excel с русской локалью сохраняет CSV через точку с запятой
+            separator = (line.contains(';') && !line.contains(',')) ? QChar(';') : QChar(',');
+        }
+        const QStringList cells = parseCsvLine(line, separator);
+
+        Row row;
+        row.line = lineNumber;
+        row.username = cells.value(0).trimmed();
+        row.password = cells.value(1);
+
+        if (rows.isEmpty() && seen.isEmpty()) {
+            // Необязательная строка заголовка
+            static const QStringList headerNames = {"username", "login", "user", "имя", "логин", "имя пользователя"};
+            if (headerNames.contains(row.username.toLower())) continue;
+        }
+
+        if (row.username.isEmpty()) {
+            row.message = "Пустое имя пользователя.";
+        } else if (seen.contains(row.username.toLower())) {
+            row.message = "Пользователь уже встречается выше в файле.";
+        } else {
+            seen.insert(row.username.toLower());
+            if (row.password.isEmpty()) {
+                row.password = generatePassword();
+                row.generatedPassword = true;
+            }
+        }
+        rows.append(row);
+    }
+
+    if (rows.isEmpty()) {
+        if (errorString) *errorString = "Файл не содержит пользователей.";
+        return false;
+    }
+    qDebug() << "BulkUserImporter: Прочитано строк:" << rows.count() << "из" << filePath;
+    return true;
+}
+
+int BulkUserImporter::rowCount() const
+{
+    return rows.count();
+}
+
+void BulkUserImporter::setConcurrency(int maxInFlight)
+{
+    concurrency = qMax(1, maxInFlight);
+}
+
+void BulkUserImporter::start()
+{
+    if (running) return;
+    running = true;
+    cancelled = false;
+    doneCount = 0;
+    pending.clear();
+    for (int i = 0; i < rows.count(); ++i) {
+        if (rows.at(i).message.isEmpty()) {
+            pending.enqueue(i);
+        } else {
+            doneCount++; // Ошибки разбора сразу идут в отчет
+        }
+    }
+    qDebug() << "BulkUserImporter: Старт импорта," << pending.count() << "запросов, параллельно до" << concurrency;
+    emit progress(doneCount, rows.count());
+    dispatch();
+}
+
+void BulkUserImporter::cancel()
+{
+    if (!running || cancelled) return;
+    cancelled = true;
+    while (!pending.isEmpty()) {
+        Row &row = rows[pending.dequeue()];
+        row.message = "Отменено.";
+        doneCount++;
+    }
+    emit progress(doneCount, rows.count());
+    dispatch(); // Завершит импорт, если в полете ничего не осталось
+}
+
+void BulkUserImporter::dispatch()
+{
+    while (!cancelled && inFlight < concurrency && !pending.isEmpty()) {
+        inFlight++;
+        sendRow(pending.dequeue());
+    }
+    if (running && inFlight == 0 && pending.isEmpty()) {
+        running = false;
+        qDebug() << "BulkUserImporter: Импорт завершен. Успешно:" << succeededCount() << "Ошибок:" << failedCount();
+        emit finished();
+    }
+}
+
+void BulkUserImporter::sendRow(int index)
+{
+    Row &row = rows[index];
+    row.attempts++;
+    RequestHandle *handle = apiClient->createUser(apiToken, row.username, row.password);
+    connect(handle, &RequestHandle::jsonReady, this, [this, index](const QJsonObject &) {
+        rows[index].ok = true;
+        rows[index].message = "Создан.";
+        rowFinished(index);
+    });
+    connect(handle, &RequestHandle::failed, this, [this, index](const QString &errorString, int statusCode) {
+        Row &failedRow = rows[index];
+        // Сервер просит притормозить - повторяем ту же строку, слот конвейера остается занятым
+        if ((statusCode == 429 || statusCode == 503) && failedRow.attempts < kMaxAttempts && !cancelled) {
+            const int delayMs = 1000 * (1 << (failedRow.attempts - 1));
+            qDebug() << "BulkUserImporter: Сервер перегружен (" << statusCode << "), повтор" << failedRow.username << "через" << delayMs << "мс";
+            QTimer::singleShot(delayMs, this, [this, index]() { sendRow(index); });
+            return;
+        }
+        failedRow.message = errorString;
+        rowFinished(index);
+    });
+}
+
+void BulkUserImporter::rowFinished(int index)
+{
+    Q_UNUSED(index);
+    inFlight--;
+    doneCount++;
+    emit progress(doneCount, rows.count());
+    dispatch();
+}
+
+QList<BulkUserImporter::Row> BulkUserImporter::results() const
+{
+    return rows;
+}
+
+int BulkUserImporter::succeededCount() const
+{
+    int count = 0;
+    for (const Row &row : rows) {
+        if (row.ok) count++;
+    }
+    return count;
+}
+
+int BulkUserImporter::failedCount() const
+{
+    return rows.count() - succeededCount();
+}
+
+bool BulkUserImporter::writeReport(const QString &filePath, QString *errorString) const
+{
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    // В отчете сгенерированные пароли: права ставятся на временный файл до переименования
+    file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+    auto quoted = [](QString value) {
+        value.replace('"', "\"\"");
+        return '"' + value + '"';
+    };
+    QTextStream out(&file);
+    out << "line;username;password;result;message\n";
+    for (const Row &row : rows) {
+        // Пароль в отчет попадает только сгенерированный: его нужно передать пользователю
+        out << row.line << ';' << quoted(row.username) << ';'
+            << quoted(row.generatedPassword && row.ok ? row.password : QString()) << ';'
+            << (row.ok ? "ok" : "error") << ';' << quoted(row.message) << '\n';
+    }
+    out.flush();
+    if (!file.commit()) {
+        if (errorString) *errorString = file.errorString();
+        return false;
+    }
+    return true;
+}
+
+QStringList BulkUserImporter::parseCsvLine(const QString &line, QChar separator)
+{
+    QStringList cells;
+    QString current;
+    bool inQuotes = false;
+    for (int i = 0; i < line.size(); ++i) {
+        const QChar ch = line.at(i);
+        if (inQuotes) {
+            if (ch == '"') {
+                if (i + 1 < line.size() && line.at(i + 1) == '"') {
+                    current.append('"'); // Экранированная кавычка
+                    ++i;
+                } else {
+                    inQuotes = false;
+                }
+            } else {
+                current.append(ch);
+            }
+        } else if (ch == '"') {
+            inQuotes = true;
+        } else if (ch == separator) {
+            cells.append(current);
+            current.clear();
+        } else {
+            current.append(ch);
+        }
+    }
+    cells.append(current);
+    return cells;
+}
+
+QString BulkUserImporter::generatePassword()
+{
+    static const QString alphabet = "ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnpqrstuvwxyz23456789";
+    QString password;
+    for (int i = 0; i < 12; ++i) {
+        password.append(alphabet.at(QRandomGenerator::system()->bounded(alphabet.size())));
+    }
+    return password;
+}
@@ -0,0 +1,69 @@
+#ifndef BULKUSERIMPORTER_H
+#define BULKUSERIMPORTER_H
+
+#include <QObject>
+#include <QList>
+#include <QQueue>
+#include <QString>
+
+class ApiClient;
+
+// Массовое создание пользователей из CSV (колонки: имя, пароль).
+// Запросы new_user.php идут конвейером с ограничением параллельности; при 429/503
+// строка повторяется с нарастающей паузой. Итог по каждой строке собирается в отчет
+class BulkUserImporter : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Row {
+        int line = 0;          // Номер строки в CSV (для отчета)
+        QString username;
+        QString password;
+        bool generatedPassword = false; // Пароль не задан в файле и сгенерирован
+        int attempts = 0;
+        bool ok = false;
+        QString message;
+    };
+
+    static const int kDefaultConcurrency = 4;
+    static const int kMaxAttempts = 3;
+
+    explicit BulkUserImporter(ApiClient *client, const QString &token, QObject *parent = nullptr);
+
+    // Разбор CSV; ошибки формата попадают в отчет как неуспешные строки
+    bool loadCsv(const QString &filePath, QString *errorString);
+    int rowCount() const;
+
+    void setConcurrency(int maxInFlight);
+    void start();
+    void cancel(); // Новые запросы не отправляются, уже отправленные дожидаются ответа
+
+    QList<Row> results() const;
+    int succeededCount() const;
+    int failedCount() const;
+    bool writeReport(const QString &filePath, QString *errorString) const;
+
+signals:
+    void progress(int done, int total);
+    void finished();
+
+private:
+    ApiClient *apiClient;
+    QString apiToken;
+    QList<Row> rows;
+    QQueue<int> pending; // Индексы строк, ожидающих отправки
+    int inFlight;
+    int doneCount;
+    int concurrency;
+    bool cancelled;
+    bool running;
+
+    void dispatch();
+    void sendRow(int index);
+    void rowFinished(int index);
+    static QStringList parseCsvLine(const QString &line, QChar separator);
+    static QString generatePassword();
+};
+
+#endif // BULKUSERIMPORTER_H
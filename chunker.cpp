@@ -0,0 +1,114 @@
+#include "chunker.h"
+
+#include <QCryptographicHash>
+#include <QFile>
+
+namespace {
+
+// Маски проверяют старшие биты: в gear-хэше они зависят от последних ~64 байт.
+// До среднего размера граница ищется по "строгой" маске (реже), после - по "мягкой" (чаще),
+// так размеры кусков собираются около kAvgChunkSize
+const quint64 kMaskStrict = 0xFFFFC00000000000ULL; // 18 бит
+const quint64 kMaskLoose = 0xFFFC000000000000ULL;  // 14 бит
+
+const int kReadBlockSize = 4 * 1024 * 1024;
+
+struct GearTable {
+    quint64 values[256];
+
+    GearTable()
+    {
+        // Таблица должна быть одинаковой у всех клиентов, иначе куски одного файла
+        // не совпадут между версиями: заполняем детерминированно (splitmix64)
+        quint64 state = 0x46455843444331ULL;
+        for (quint64 &value : values) {
+            state += 0x9E3779B97F4A7C15ULL;
+            quint64 z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            value = z ^ (z >> 31);
+        }
+    }
+};
+
+const GearTable &gearTable()
+{
+    static const GearTable table;
+    return table;
+}
+
+}
+
+namespace Chunker {
+
+int findBoundary(const uchar *data, int size)
+{
+    if (size <= kMinChunkSize) return size;
+    const quint64 *gear = gearTable().values;
+    const int normalEnd = qMin(size, kAvgChunkSize);
+    const int end = qMin(size, kMaxChunkSize);
+    quint64 fingerprint = 0;
+    int i = kMinChunkSize; // Внутри минимального размера границу не ищем
+    for (; i < normalEnd; ++i) {
+        fingerprint = (fingerprint << 1) + gear[data[i]];
+        if (!(fingerprint & kMaskStrict)) return i + 1;
+    }
+    for (; i < end; ++i) {
+        fingerprint = (fingerprint << 1) + gear[data[i]];
+        if (!(fingerprint & kMaskLoose)) return i + 1;
+    }
+    return end;
+}
+
+FileChunks chunkFile(const QString &filePath)
+{
+    FileChunks result;
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        result.errorString = file.errorString();
+        return result;
+    }
+
+    QCryptographicHash fileHash(QCryptographicHash::Sha256);
+    QByteArray buffer;
+    qsizetype consumed = 0; // Начало необработанных данных в buffer
+    qint64 offset = 0;
+    bool eof = false;
+    while (true) {
+        // Держим в буфере хотя бы один максимальный кусок, пока файл не кончился
+        if (!eof && buffer.size() - consumed < kMaxChunkSize) {
+            buffer.remove(0, consumed);
+            consumed = 0;
+            const QByteArray block = file.read(kReadBlockSize);
+            if (block.isEmpty()) {
+                if (file.error() != QFileDevice::NoError) {
+                    result.errorString = file.errorString();
+                    return result;
+                }
+                eof = true;
+            } else {
+                fileHash.addData(block);
+                buffer.append(block);
+            }
+            continue;
+        }
+        const int available = static_cast<int>(qMin<qsizetype>(buffer.size() - consumed, kMaxChunkSize));
+        if (available == 0) break;
+
+        const uchar *data = reinterpret_cast<const uchar *>(buffer.constData()) + consumed;
+        Chunk chunk;
+        chunk.offset = offset;
+        chunk.length = findBoundary(data, available);
+        chunk.sha256 = QCryptographicHash::hash(QByteArrayView(data, chunk.length), QCryptographicHash::Sha256).toHex();
+        result.chunks.append(chunk);
+        offset += chunk.length;
+        consumed += chunk.length;
+    }
+
+    result.ok = true;
+    result.size = offset;
+    result.sha256 = fileHash.result().toHex();
+    return result;
+}
+
+}
@@ -0,0 +1,39 @@
+#ifndef CHUNKER_H
+#define CHUNKER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+
+// Разбиение файла на куски по содержимому (FastCDC: gear-хэш с нормализацией размера).
+// Границы кусков зависят только от данных рядом с ними, поэтому вставка или правка
+// в середине файла меняет один-два куска, а не все последующие
+namespace Chunker {
+
+const int kMinChunkSize = 16 * 1024;
+const int kAvgChunkSize = 64 * 1024;
+const int kMaxChunkSize = 256 * 1024;
+
+struct Chunk {
+    qint64 offset = 0;
+    int length = 0;
+    QByteArray sha256; // hex
+};
+
+struct FileChunks {
+    bool ok = false;
+    QString errorString;
+    qint64 size = 0;
+    QByteArray sha256; // hex, хэш всего файла
+    QList<Chunk> chunks;
+};
+
+// Длина первого куска в data[0..size). Вызывается с size < kMaxChunkSize только для хвоста файла
+int findBoundary(const uchar *data, int size);
+
+// Читает файл потоком и режет на куски. Вызывается на рабочем потоке (не трогает GUI)
+FileChunks chunkFile(const QString &filePath);
+
+}
+
+#endif // CHUNKER_H
@@ -0,0 +1,382 @@
+#include "compression.h"
+
+#include <QFile>
+#include <QDebug>
+#include <QCryptographicHash>
+#include <zlib.h>
+#ifdef FX_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+const qint64 kReadBlockSize = 256 * 1024;
+
+// Типы, которые сжимать бессмысленно: они уже сжаты внутри
+bool isAlreadyCompressed(const QString &name)
+{
+    static const QStringList compressedPrefixes = {
+        "image/", "video/", "audio/", "font/woff"
+    };
+    static const QStringList compressedTypes = {
+        "application/zip", "application/gzip", "application/x-gzip",
+        "application/x-bzip2", "application/x-xz", "application/zstd",
+        "application/x-7z-compressed", "application/vnd.rar", "application/x-rar-compressed",
+        "application/java-archive", "application/vnd.android.package-archive",
+        "application/pdf", "application/epub+zip", "application/x-lzma",
+        "application/vnd.openxmlformats-officedocument.wordprocessingml.document",
+        "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet",
+        "application/vnd.openxmlformats-officedocument.presentationml.presentation",
+        "application/vnd.oasis.opendocument.text",
+        "application/vnd.oasis.opendocument.spreadsheet"
+    };
+    // Несжатые растровые форматы все-таки хорошо жмутся
+    if (name == "image/bmp" || name == "image/x-portable-pixmap" || name == "image/svg+xml" || name == "image/tiff") {
+        return false;
+    }
+    for (const QString &prefix : compressedPrefixes) {
+        if (name.startsWith(prefix)) return true;
+    }
+    return compressedTypes.contains(name);
+}
+
+bool compressDeflate(QFile &src, QFile &dst, qint64 *wireBytes, QString *errorString, QCryptographicHash *hash)
+{
+    z_stream zs = {};
+    // 15 + 16: gzip-формат, чтобы сервер мог распаковать через gzdecode()
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        if (errorString) *errorString = "Не удалось инициализировать zlib.";
+        return false;
+    }
+
+    QByteArray outBuffer(kReadBlockSize, Qt::Uninitialized);
+    bool ok = true;
+    int flush = Z_NO_FLUSH;
+    while (ok && flush != Z_FINISH) {
+        QByteArray inBuffer = src.read(kReadBlockSize);
+        if (hash) hash->addData(inBuffer);
+        flush = src.atEnd() ? Z_FINISH : Z_NO_FLUSH;
+        zs.next_in = reinterpret_cast<Bytef*>(inBuffer.data());
+        zs.avail_in = static_cast<uInt>(inBuffer.size());
+        do {
+            zs.next_out = reinterpret_cast<Bytef*>(outBuffer.data());
+            zs.avail_out = static_cast<uInt>(outBuffer.size());
+            if (deflate(&zs, flush) == Z_STREAM_ERROR) {
+                if (errorString) *errorString = "Ошибка сжатия zlib.";
+                ok = false;
+                break;
+            }
+            qint64 produced = outBuffer.size() - zs.avail_out;
+            if (produced > 0 && dst.write(outBuffer.constData(), produced) != produced) {
+                if (errorString) *errorString = dst.errorString();
+                ok = false;
+                break;
+            }
+            *wireBytes += produced;
+        } while (zs.avail_out == 0);
+    }
+    deflateEnd(&zs);
+    return ok;
+}
+
+#ifdef FX_HAVE_ZSTD
+bool compressZstd(QFile &src, QFile &dst, qint64 *wireBytes, QString *errorString, QCryptographicHash *hash)
+{
+    ZSTD_CCtx *cctx = ZSTD_createCCtx();
+    if (!cctx) {
+        if (errorString) *errorString = "Не удалось инициализировать zstd.";
+        return false;
+    }
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, 3);
+
+    QByteArray outBuffer(static_cast<int>(ZSTD_CStreamOutSize()), Qt::Uninitialized);
+    bool ok = true;
+    bool lastChunk = false;
+    while (ok && !lastChunk) {
+        QByteArray inBuffer = src.read(kReadBlockSize);
+        if (hash) hash->addData(inBuffer);
+        lastChunk = src.atEnd();
+        ZSTD_EndDirective mode = lastChunk ? ZSTD_e_end : ZSTD_e_continue;
+        ZSTD_inBuffer input = { inBuffer.constData(), static_cast<size_t>(inBuffer.size()), 0 };
+        bool chunkDone = false;
+        while (!chunkDone) {
+            ZSTD_outBuffer output = { outBuffer.data(), static_cast<size_t>(outBuffer.size()), 0 };
+            size_t remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+            if (ZSTD_isError(remaining)) {
+                if (errorString) *errorString = QString("Ошибка сжатия zstd: %1").arg(ZSTD_getErrorName(remaining));
+                ok = false;
+                break;
+            }
+            qint64 produced = static_cast<qint64>(output.pos);
+            if (produced > 0 && dst.write(outBuffer.constData(), produced) != produced) {
+                if (errorString) *errorString = dst.errorString();
+                ok = false;
+                break;
+            }
+            *wireBytes += produced;
+            chunkDone = lastChunk ? (remaining == 0) : (input.pos == input.size);
+        }
+    }
+    ZSTD_freeCCtx(cctx);
+    return ok;
+}
+#endif
+
+}
+
+namespace Compression {
+
+bool isZstdAvailable()
+{
+#ifdef FX_HAVE_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+QByteArray encodingName(Method method)
+{
+    switch (method) {
+    case Method::Deflate: return "gzip";
+    case Method::Zstd: return "zstd";
+    case Method::None: break;
+    }
+    return "identity";
+}
+
+QByteArray acceptEncodingHeader()
+{
+    return isZstdAvailable() ? "zstd, gzip, deflate" : "gzip, deflate";
+}
+
+bool isCompressibleMimeType(const QMimeType &mimeType)
+{
+    if (!mimeType.isValid()) return false;
+    if (isAlreadyCompressed(mimeType.name())) return false;
+    for (const QString &parent : mimeType.allAncestors()) {
+        if (isAlreadyCompressed(parent)) return false;
+    }
+    // Текст, логи, CSV, JSON, XML и бинарные форматы без явного признака сжатия.
+    // Если выигрыш окажется мал, ApiClient отправит файл как есть
+    return true;
+}
+
+bool compressFile(const QString &srcPath, const QString &dstPath, Method method,
+                  qint64 *logicalBytes, qint64 *wireBytes, QString *errorString,
+                  QByteArray *logicalSha256)
+{
+    *logicalBytes = 0;
+    *wireBytes = 0;
+
+    QFile src(srcPath);
+    if (!src.open(QIODevice::ReadOnly)) {
+        if (errorString) *errorString = src.errorString();
+        return false;
+    }
+    QFile dst(dstPath);
+    if (!dst.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (errorString) *errorString = dst.errorString();
+        return false;
+    }
+    *logicalBytes = src.size();
+
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    QCryptographicHash *hashPtr = logicalSha256 ? &hash : nullptr;
+    bool ok = false;
+    switch (method) {
+    case Method::Deflate:
+        ok = compressDeflate(src, dst, wireBytes, errorString, hashPtr);
+        if (ok && logicalSha256) *logicalSha256 = hash.result();
+        return ok;
+    case Method::Zstd:
+#ifdef FX_HAVE_ZSTD
+        ok = compressZstd(src, dst, wireBytes, errorString, hashPtr);
+        if (ok && logicalSha256) *logicalSha256 = hash.result();
+        return ok;
+#else
+        break;
+#endif
+    case Method::None:
+        break;
+    }
+    if (errorString) *errorString = "Метод сжатия не поддерживается этой сборкой.";
+    return false;
+}
+
+}
+
+// --- StreamDecoder ---
+
+struct StreamDecoder::Private
+{
+    enum class Kind { Identity, Zlib, Zstd, Unsupported };
+
+    Kind kind = Kind::Identity;
+    QByteArray encoding;
+    QString error;
+    z_stream zs = {};
+    bool zlibInitialized = false;
+    bool rawDeflateRetried = false;
+    bool producedOutput = false;
+    bool receivedInput = false;
+    bool streamEnded = false; // Последний поток (gzip-член, zstd-кадр) дочитан до конца
+#ifdef FX_HAVE_ZSTD
+    ZSTD_DStream *zstd = nullptr;
+#endif
+
+    bool initZlib(int windowBits)
+    {
+        if (zlibInitialized) inflateEnd(&zs);
+        zs = {};
+        zlibInitialized = (inflateInit2(&zs, windowBits) == Z_OK);
+        return zlibInitialized;
+    }
+};
+
+StreamDecoder::StreamDecoder(const QByteArray &contentEncoding)
+    : d(new Private)
+{
+    d->encoding = contentEncoding.trimmed().toLower();
+    if (d->encoding.isEmpty() || d->encoding == "identity") {
+        d->kind = Private::Kind::Identity;
+    } else if (d->encoding == "gzip" || d->encoding == "x-gzip" || d->encoding == "deflate") {
+        d->kind = Private::Kind::Zlib;
+        // 15 + 32: автоопределение заголовка gzip/zlib
+        if (!d->initZlib(15 + 32)) {
+            d->kind = Private::Kind::Unsupported;
+            d->error = "Не удалось инициализировать zlib.";
+        }
+#ifdef FX_HAVE_ZSTD
+    } else if (d->encoding == "zstd") {
+        d->kind = Private::Kind::Zstd;
+        d->zstd = ZSTD_createDStream();
+        if (!d->zstd) {
+            d->kind = Private::Kind::Unsupported;
+            d->error = "Не удалось инициализировать zstd.";
+        }
+#endif
+    } else {
+        d->kind = Private::Kind::Unsupported;
+        d->error = QString("Неподдерживаемое кодирование ответа: %1").arg(QString::fromLatin1(d->encoding));
+    }
+}
+
+StreamDecoder::~StreamDecoder()
+{
+    if (d->zlibInitialized) inflateEnd(&d->zs);
+#ifdef FX_HAVE_ZSTD
+    if (d->zstd) ZSTD_freeDStream(d->zstd);
+#endif
+}
+
+bool StreamDecoder::isSupported() const
+{
+    return d->kind != Private::Kind::Unsupported;
+}
+
+QByteArray StreamDecoder::encoding() const
+{
+    return d->encoding.isEmpty() ? QByteArray("identity") : d->encoding;
+}
+
+QString StreamDecoder::errorString() const
+{
+    return d->error;
+}
+
+bool StreamDecoder::decode(const QByteArray &input, QByteArray *output)
+{
+    if (input.isEmpty()) return true;
+    d->receivedInput = true;
+
+    switch (d->kind) {
+    case Private::Kind::Identity:
+        output->append(input);
+        return true;
+
+    case Private::Kind::Zlib: {
+        QByteArray chunk(kReadBlockSize, Qt::Uninitialized);
+        if (d->streamEnded) {
+            // Следующий gzip-член пришел в новом куске
+            inflateReset(&d->zs);
+            d->streamEnded = false;
+        }
+        d->zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.constData()));
+        d->zs.avail_in = static_cast<uInt>(input.size());
+        // Вход может закончиться раньше выхода: inflate вызывается, пока заполняет буфер целиком
+        for (;;) {
+            d->zs.next_out = reinterpret_cast<Bytef*>(chunk.data());
+            d->zs.avail_out = static_cast<uInt>(chunk.size());
+            int rc = inflate(&d->zs, Z_NO_FLUSH);
+            if (rc == Z_DATA_ERROR && d->encoding == "deflate" && !d->producedOutput && !d->rawDeflateRetried) {
+                // Некоторые серверы отдают "deflate" без zlib-заголовка - пробуем raw deflate
+                d->rawDeflateRetried = true;
+                if (!d->initZlib(-15)) {
+                    d->error = "Не удалось инициализировать zlib.";
+                    return false;
+                }
+                return decode(input, output);
+            }
+            if (rc != Z_OK && rc != Z_STREAM_END && rc != Z_BUF_ERROR) {
+                d->error = QString("Ошибка распаковки ответа (zlib %1).").arg(rc);
+                return false;
+            }
+            qint64 produced = chunk.size() - d->zs.avail_out;
+            if (produced > 0) {
+                output->append(chunk.constData(), produced);
+                d->producedOutput = true;
+            }
+            if (rc == Z_STREAM_END) {
+                // Конкатенированные gzip-члены: продолжаем со следующего
+                if (d->zs.avail_in == 0) {
+                    d->streamEnded = true;
+                    break;
+                }
+                inflateReset(&d->zs);
+            } else if (d->zs.avail_out > 0 || produced == 0) {
+                break; // Вход исчерпан, а выход не упирается в буфер - все отдано
+            }
+        }
+        return true;
+    }
+
+#ifdef FX_HAVE_ZSTD
+    case Private::Kind::Zstd: {
+        QByteArray chunk(static_cast<int>(ZSTD_DStreamOutSize()), Qt::Uninitialized);
+        ZSTD_inBuffer in = { input.constData(), static_cast<size_t>(input.size()), 0 };
+        bool outputFull = false;
+        // Как и для zlib: после исчерпания входа в декодере могут оставаться данные для выхода
+        while (in.pos < in.size || outputFull) {
+            ZSTD_outBuffer out = { chunk.data(), static_cast<size_t>(chunk.size()), 0 };
+            size_t rc = ZSTD_decompressStream(d->zstd, &out, &in);
+            if (ZSTD_isError(rc)) {
+                d->error = QString("Ошибка распаковки ответа (zstd: %1).").arg(ZSTD_getErrorName(rc));
+                return false;
+            }
+            if (out.pos > 0) output->append(chunk.constData(), static_cast<qsizetype>(out.pos));
+            d->streamEnded = (rc == 0); // 0 - кадр закончен и полностью выдан
+            outputFull = out.pos == out.size;
+        }
+        return true;
+    }
+#else
+    case Private::Kind::Zstd:
+        break;
+#endif
+
+    case Private::Kind::Unsupported:
+        break;
+    }
+    return false;
+}
+
+bool StreamDecoder::finish()
+{
+    // Пустое тело или несжатый ответ проверять нечего; сжатый должен дойти до конца потока
+    if (d->kind == Private::Kind::Identity || !d->receivedInput) return true;
+    if (d->kind == Private::Kind::Zlib && d->streamEnded) return true;
+    if (d->kind == Private::Kind::Zstd && d->streamEnded) return true;
+    d->error = "Ответ оборван: сжатые данные не завершены.";
+    return false;
+}
@@ -0,0 +1,59 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <QByteArray>
+#include <QString>
+#include <QMimeType>
+#include <memory>
+
+// Вспомогательные функции для прозрачного сжатия загрузок и распаковки скачиваний
+namespace Compression {
+
+enum class Method {
+    None,
+    Deflate, // gzip-обертка над deflate (zlib)
+    Zstd     // Доступно только при сборке с CONFIG+=zstd
+};
+
+bool isZstdAvailable();
+
+// Имя метода для заголовков/полей формы ("gzip", "zstd")
+QByteArray encodingName(Method method);
+
+// Значение заголовка Accept-Encoding для скачиваний
+QByteArray acceptEncodingHeader();
+
+// Эвристика: уже сжатые форматы (архивы, медиа, офисные zip-контейнеры) не сжимаем повторно
+bool isCompressibleMimeType(const QMimeType &mimeType);
+
+// Сжимает файл srcPath в dstPath. Вызывается на рабочем потоке (не трогает GUI).
+// Если logicalSha256 не nullptr, попутно считает SHA-256 исходных данных
+bool compressFile(const QString &srcPath, const QString &dstPath, Method method,
+                  qint64 *logicalBytes, qint64 *wireBytes, QString *errorString,
+                  QByteArray *logicalSha256 = nullptr);
+
+}
+
+// Потоковый декодер тела ответа по значению Content-Encoding
+class StreamDecoder
+{
+public:
+    explicit StreamDecoder(const QByteArray &contentEncoding);
+    ~StreamDecoder();
+
+    bool isSupported() const;
+    QByteArray encoding() const;
+
+    // Декодирует очередной кусок и дописывает результат в output. false - ошибка данных
+    bool decode(const QByteArray &input, QByteArray *output);
+    // Вызывается после последнего куска. false - поток оборван (нет конца gzip-члена или zstd-кадра)
+    bool finish();
+    QString errorString() const;
+
+private:
+    Q_DISABLE_COPY(StreamDecoder)
+    struct Private;
+    std::unique_ptr<Private> d;
+};
+
+#endif // COMPRESSION_H
@@ -26,4 +26,26 @@ struct UserData {
 };
 Q_DECLARE_METATYPE(UserData) // Регистрируем тип
 
+// Статистика завершенной передачи: байты "на проводе" и логические байты файла
+struct TransferStats {
+    QString fileName;
+    QString direction;   // "upload" или "download"
+    QString encoding;    // identity, gzip, zstd...
+    qint64 wireBytes = 0;
+    qint64 logicalBytes = 0;
+    qint64 elapsedMs = 0;
+};
+Q_DECLARE_METATYPE(TransferStats)
+
+// Снимок идущей передачи для отображения (см. ProgressAggregator)
+struct TransferProgress {
+    qint64 bytesDone = 0;
+    qint64 bytesTotal = -1;      // -1 - размер неизвестен
+    int percent = -1;            // -1 - размер неизвестен
+    double bytesPerSecond = 0;   // Сглаженная скорость
+    qint64 etaMs = -1;           // -1 - оценить пока нельзя
+    bool finished = false;       // Переданы все байты
+};
+Q_DECLARE_METATYPE(TransferProgress)
+
 #endif // DATATYPES_H
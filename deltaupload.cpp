@@ -0,0 +1,220 @@
+#include "deltaupload.h"
+#include "apiclient.h"
+#include "requesthandle.h"
+
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSet>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
+
+DeltaUpload::DeltaUpload(ApiClient *client, RequestHandle *handle, const QString &token, const QString &filePath,
+                         const QString &mimeType, QObject *parent)
+    : QObject(parent),
+      apiClient(client),
+      handle(handle),
+      apiToken(token),
+      filePath(filePath),
+      fileName(QFileInfo(filePath).fileName()),
+      mimeType(mimeType),
+      missingBytes(0),
+      sentBytes(0),
+      wireBytes(0),
+      recommitted(false),
+      stopped(false)
+{
+    connect(handle, &RequestHandle::abortRequested, this, &DeltaUpload::cancel);
+}
+
+void DeltaUpload::start()
+{
+    timer.start();
+    // Разбиение и хэширование - на рабочем потоке, файл может быть на гигабайты
+    QFutureWatcher<Chunker::FileChunks> *watcher = new QFutureWatcher<Chunker::FileChunks>(this);
+    connect(watcher, &QFutureWatcher<Chunker::FileChunks>::finished, this, [this, watcher]() {
+        layout = watcher->result();
+        watcher->deleteLater();
+        if (stopped) return;
+        if (!layout.ok) {
+            fail(QString("Ошибка чтения файла '%1': %2").arg(fileName, layout.errorString), 0);
+            return;
+        }
+        qDebug() << "DeltaUpload:" << fileName << "разбит на" << layout.chunks.count() << "кусков за" << timer.elapsed() << "мс";
+        source.setFileName(filePath);
+        if (!source.open(QIODevice::ReadOnly)) {
+            fail(QString("Ошибка: Не удалось открыть файл '%1' для чтения.").arg(fileName), 0);
+            return;
+        }
+        queryMissing();
+    });
+    watcher->setFuture(QtConcurrent::run(Chunker::chunkFile, filePath));
+}
+
+void DeltaUpload::queryMissing()
+{
+    QList<QByteArray> hashes;
+    QSet<QByteArray> seen;
+    for (const Chunker::Chunk &chunk : std::as_const(layout.chunks)) {
+        if (!seen.contains(chunk.sha256)) {
+            seen.insert(chunk.sha256);
+            hashes.append(chunk.sha256);
+        }
+    }
+
+    RequestHandle *request = apiClient->queryChunks(apiToken, hashes);
+    activeRequests.append(request);
+    connect(request, &RequestHandle::jsonReady, this, [this](const QJsonObject &response) {
+        QSet<QByteArray> missing;
+        for (const QJsonValue &value : response.value("missing").toArray()) {
+            missing.insert(value.toString().toLatin1().toLower());
+        }
+        // Повторяющиеся куски файла отправляем один раз
+        sendQueue.clear();
+        missingBytes = 0;
+        sentBytes = 0;
+        for (const Chunker::Chunk &chunk : std::as_const(layout.chunks)) {
+            if (missing.remove(chunk.sha256)) {
+                sendQueue.enqueue(chunk);
+                missingBytes += chunk.length;
+            }
+        }
+        qDebug() << "DeltaUpload:" << fileName << "- на сервере нет" << sendQueue.count() << "из" << layout.chunks.count()
+                 << "кусков (" << missingBytes << "из" << layout.size << "байт)";
+        if (handle) handle->reportProgress(layout.size - missingBytes, layout.size);
+        if (sendQueue.isEmpty()) {
+            commit();
+        } else {
+            pump();
+        }
+    });
+    connect(request, &RequestHandle::failed, this, [this](const QString &errorString, int statusCode) {
+        if (stopped) return;
+        if (statusCode == 404) {
+            qDebug() << "DeltaUpload: Сервер не поддерживает загрузку по кускам, файл" << fileName << "будет отправлен целиком.";
+            stop();
+            emit unsupported();
+            return;
+        }
+        fail(errorString, statusCode);
+    });
+}
+
+void DeltaUpload::pump()
+{
+    if (stopped) return;
+    while (runningRequests() < kMaxParallelChunks && !sendQueue.isEmpty()) {
+        const Chunker::Chunk chunk = sendQueue.dequeue();
+        // Читаем кусок непосредственно перед отправкой: в памяти не больше kMaxParallelChunks кусков
+        QByteArray data;
+        if (source.seek(chunk.offset)) data = source.read(chunk.length);
+        if (data.size() != chunk.length) {
+            fail(QString("Ошибка чтения файла '%1' при отправке: %2").arg(fileName, source.errorString()), 0);
+            return;
+        }
+
+        RequestHandle *request = apiClient->uploadChunk(apiToken, chunk.sha256, data);
+        activeRequests.append(request);
+        connect(request, &RequestHandle::jsonReady, this, [this, chunk](const QJsonObject &) {
+            sentBytes += chunk.length;
+            wireBytes += chunk.length;
+            if (handle) handle->reportProgress(layout.size - missingBytes + sentBytes, layout.size);
+            if (sendQueue.isEmpty() && runningRequests() == 0) {
+                commit();
+            } else {
+                pump();
+            }
+        });
+        connect(request, &RequestHandle::failed, this, [this, chunk](const QString &errorString, int statusCode) {
+            if (stopped) return;
+            if (++attempts[chunk.sha256] >= kMaxChunkAttempts) {
+                fail(errorString, statusCode);
+                return;
+            }
+            qWarning() << "DeltaUpload: Кусок" << chunk.sha256.left(12) << "не отправлен (" << errorString << "), повтор.";
+            sendQueue.enqueue(chunk);
+            pump();
+        });
+    }
+}
+
+void DeltaUpload::commit()
+{
+    QList<QByteArray> order;
+    order.reserve(layout.chunks.count());
+    for (const Chunker::Chunk &chunk : std::as_const(layout.chunks)) order.append(chunk.sha256);
+
+    RequestHandle *request = apiClient->commitChunkedFile(apiToken, fileName, layout.size, layout.sha256, mimeType, order);
+    activeRequests.append(request);
+    connect(request, &RequestHandle::jsonReady, this, [this](const QJsonObject &response) {
+        const QByteArray serverHash = response.value("sha256").toString().toLatin1().toLower();
+        if (!serverHash.isEmpty() && serverHash != layout.sha256) {
+            qWarning() << "DeltaUpload: Контрольная сумма собранного файла" << fileName << "не совпадает! Локально:"
+                       << layout.sha256 << "Сервер:" << serverHash;
+            fail(QString("Файл '%1' поврежден при сборке на сервере: контрольная сумма не совпадает с локальной. "
+                         "Загрузите файл повторно.").arg(fileName), 200);
+            return;
+        }
+        TransferStats stats;
+        stats.fileName = fileName;
+        stats.direction = "upload";
+        stats.encoding = "delta";
+        stats.wireBytes = wireBytes;
+        stats.logicalBytes = layout.size;
+        stats.elapsedMs = timer.elapsed();
+        qDebug() << "DeltaUpload: Файл" << fileName << "собран на сервере, отправлено" << wireBytes << "из" << layout.size
+                 << "байт за" << stats.elapsedMs << "мс";
+        emit completed(stats);
+
+        QJsonObject result = response;
+        result.insert("file_name", fileName);
+        stop();
+        if (handle) handle->finishWithJson(result);
+    });
+    connect(request, &RequestHandle::failed, this, [this](const QString &errorString, int statusCode) {
+        if (stopped) return;
+        if (statusCode == 409 && !recommitted) {
+            // Сервер успел удалить часть кусков между проверкой и сборкой - дошлем их один раз
+            recommitted = true;
+            qDebug() << "DeltaUpload: Сервер не нашел часть кусков при сборке" << fileName << ", повторная проверка.";
+            queryMissing();
+            return;
+        }
+        fail(errorString, statusCode);
+    });
+}
+
+// Запросы, которые еще идут (дескриптор завершенного помечен, даже пока он не удален)
+int DeltaUpload::runningRequests()
+{
+    activeRequests.removeIf([](const QPointer<RequestHandle> &request) { return !request || request->isFinished(); });
+    return activeRequests.count();
+}
+
+void DeltaUpload::cancel()
+{
+    if (stopped) return;
+    qDebug() << "DeltaUpload: Загрузка" << fileName << "отменена.";
+    stop();
+}
+
+void DeltaUpload::fail(const QString &errorString, int statusCode)
+{
+    if (stopped) return;
+    qWarning() << "DeltaUpload: Загрузка" << fileName << "не удалась:" << errorString;
+    stop();
+    if (handle) handle->fail(errorString, statusCode);
+}
+
+void DeltaUpload::stop()
+{
+    stopped = true;
+    const QList<QPointer<RequestHandle>> requests = activeRequests;
+    activeRequests.clear();
+    for (const QPointer<RequestHandle> &request : requests) {
+        if (request && !request->isFinished()) request->abort();
+    }
+    source.close();
+    deleteLater();
+}
@@ -0,0 +1,69 @@
+#ifndef DELTAUPLOAD_H
+#define DELTAUPLOAD_H
+
+#include <QObject>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QQueue>
+#include <QElapsedTimer>
+#include "chunker.h"
+#include "datatypes.h"
+
+class ApiClient;
+class RequestHandle;
+
+// Загрузка большого файла по кускам: отправляются только куски, которых еще нет на сервере.
+// Протокол:
+//   chunk_query.php  (token_api, chunks = hex SHA-256 через запятую) -> {"missing": [hash, ...]}
+//   chunk_upload.php (multipart: token_api, sha256, chunk)            -> {"status": "success"}
+//   chunk_commit.php (token_api, file_name, file_size, sha256, mime_type, chunks по порядку)
+//                    -> ответ как у upload_file.php; 409 - часть кусков успела пропасть на сервере
+// 404 на chunk_query.php значит, что сервер кусков не знает - нужна обычная загрузка
+class DeltaUpload : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int kMaxParallelChunks = 4;
+    static const int kMaxChunkAttempts = 3;
+
+    DeltaUpload(ApiClient *client, RequestHandle *handle, const QString &token, const QString &filePath,
+                const QString &mimeType, QObject *parent = nullptr);
+
+    void start();
+
+signals:
+    void unsupported(); // Сервер без chunk_*.php: инициатор отправляет файл целиком в тот же дескриптор
+    void completed(const TransferStats &stats);
+
+private:
+    ApiClient *apiClient;
+    QPointer<RequestHandle> handle;
+    QString apiToken;
+    QString filePath;
+    QString fileName;
+    QString mimeType;
+    Chunker::FileChunks layout;
+    QFile source;
+    QQueue<Chunker::Chunk> sendQueue;
+    QHash<QByteArray, int> attempts;          // hash -> сколько раз уже пробовали
+    QList<QPointer<RequestHandle>> activeRequests;
+    qint64 missingBytes;  // Сколько нужно отправить в этом проходе
+    qint64 sentBytes;
+    qint64 wireBytes;     // Всего отправлено кусками (для статистики)
+    bool recommitted;
+    bool stopped;
+    QElapsedTimer timer;
+
+    void queryMissing();
+    void pump();
+    int runningRequests();
+    void commit();
+    void cancel();
+    void fail(const QString &errorString, int statusCode);
+    void stop();
+};
+
+#endif // DELTAUPLOAD_H
@@ -0,0 +1,282 @@
+#include "downloadcache.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDateTime>
+#include <QSettings>
+#include <QDebug>
+#include <algorithm>
+
+DownloadCache::DownloadCache()
+    : blobsSize(0),
+      diskBudget(kDefaultBudget),
+      indexRevision(0),
+      savedRevision(0)
+{
+    QSettings settings;
+    diskBudget = settings.value("cache/downloadBudgetMB", kDefaultBudget / (1024 * 1024)).toLongLong() * 1024 * 1024;
+}
+
+void DownloadCache::setScope(const QString &serverUrl)
+{
+    QMutexLocker locker(&mutex);
+    const QByteArray serverKey = QCryptographicHash::hash(serverUrl.toUtf8(), QCryptographicHash::Sha1).toHex().left(16);
+    cacheDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/downloads/" + QString::fromLatin1(serverKey);
+    // Единственный обход каталога - при входе; дальше размеры и время использования ведутся в памяти
+    loadIndex();
+    scanBlobs();
+}
+
+void DownloadCache::setBudget(qint64 bytes)
+{
+    QStringList removed;
+    IndexSnapshot snapshot;
+    {
+        QMutexLocker locker(&mutex);
+        diskBudget = qMax<qint64>(0, bytes);
+        removed = evict();
+        snapshot = snapshotIndex();
+    }
+    removeFiles(removed);
+    writeIndex(snapshot);
+}
+
+qint64 DownloadCache::budget() const
+{
+    QMutexLocker locker(&mutex);
+    return diskBudget;
+}
+
+QString DownloadCache::blobPath(const QByteArray &sha256Hex) const
+{
+    // Две первые цифры хэша - подкаталог, чтобы не держать тысячи файлов в одном
+    return cacheDir + "/blobs/" + QString::fromLatin1(sha256Hex.left(2)) + "/" + QString::fromLatin1(sha256Hex);
+}
+
+bool DownloadCache::lookup(const QString &fileId, Entry *entry) const
+{
+    // Вызывается из окна: только память, без обращения к диску
+    QMutexLocker locker(&mutex);
+    if (cacheDir.isEmpty() || diskBudget == 0) return false;
+    auto it = index.constFind(fileId);
+    if (it == index.constEnd()) return false;
+    // Тело могло быть вытеснено ради другого файла
+    auto blob = blobs.constFind(it->sha256);
+    if (blob == blobs.constEnd() || blob->size != it->size) return false;
+    *entry = it.value();
+    return true;
+}
+
+bool DownloadCache::read(const Entry &entry, QByteArray *data)
+{
+    QString path;
+    {
+        QMutexLocker locker(&mutex);
+        if (cacheDir.isEmpty() || !entry.isValid() || !blobs.contains(entry.sha256)) return false;
+        path = blobPath(entry.sha256);
+    }
+    QFile file(path);
+    if (!file.open(QIODevice::ReadWrite)) {
+        QMutexLocker locker(&mutex);
+        dropBlob(entry.sha256); // Удалено в обход кэша
+        return false;
+    }
+    QByteArray content = file.readAll();
+    if (content.size() != entry.size
+        || QCryptographicHash::hash(content, QCryptographicHash::Sha256).toHex() != entry.sha256) {
+        qWarning() << "DownloadCache: Копия" << entry.sha256 << "повреждена, удаляем.";
+        file.remove();
+        QMutexLocker locker(&mutex);
+        dropBlob(entry.sha256);
+        return false;
+    }
+    // Время изменения - метка последнего использования после перезапуска
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    {
+        QMutexLocker locker(&mutex);
+        auto blob = blobs.find(entry.sha256);
+        if (blob != blobs.end()) blob->lastUsed = QDateTime::currentMSecsSinceEpoch();
+    }
+    *data = content;
+    return true;
+}
+
+void DownloadCache::store(const QString &fileId, const QByteArray &data, const QByteArray &sha256Hex)
+{
+    Entry entry;
+    entry.sha256 = sha256Hex;
+    entry.size = data.size();
+    QString dir;
+    QString path;
+    bool exists = false;
+    {
+        QMutexLocker locker(&mutex);
+        // Файлы больше четверти бюджета вытеснили бы почти все остальное
+        if (cacheDir.isEmpty() || sha256Hex.isEmpty() || data.size() > diskBudget / 4) return;
+        dir = cacheDir;
+        path = blobPath(sha256Hex);
+        auto blob = blobs.find(sha256Hex);
+        exists = blob != blobs.end() && blob->size == entry.size;
+        if (exists) {
+            blob->lastUsed = QDateTime::currentMSecsSinceEpoch();
+        } else if (writing.contains(sha256Hex)) {
+            // То же содержимое уже пишет другой поток - достаточно записи в индексе
+            index.insert(fileId, entry);
+            return;
+        } else {
+            writing.insert(sha256Hex);
+        }
+    }
+
+    if (exists) {
+        // Такое содержимое уже есть (другой ID) - только отмечаем использование
+        QFile existing(path);
+        if (existing.open(QIODevice::ReadWrite)) existing.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    } else {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile file(path);
+        const bool written = file.open(QIODevice::WriteOnly) && file.write(data) == data.size() && file.commit();
+        QMutexLocker locker(&mutex);
+        writing.remove(sha256Hex);
+        if (!written) {
+            qWarning() << "DownloadCache: Не удалось сохранить копию файла ID:" << fileId << file.errorString();
+            return;
+        }
+        if (cacheDir != dir) return; // Сменился сервер, пока писали
+        if (!blobs.contains(sha256Hex)) {
+            Blob blob;
+            blob.size = entry.size;
+            blob.lastUsed = QDateTime::currentMSecsSinceEpoch();
+            blobs.insert(sha256Hex, blob);
+            blobsSize += blob.size;
+        }
+    }
+
+    QStringList removed;
+    IndexSnapshot snapshot;
+    {
+        QMutexLocker locker(&mutex);
+        if (cacheDir != dir) return;
+        index.insert(fileId, entry);
+        removed = evict();
+        snapshot = snapshotIndex();
+    }
+    removeFiles(removed);
+    writeIndex(snapshot);
+}
+
+void DownloadCache::scanBlobs()
+{
+    blobs.clear();
+    blobsSize = 0;
+    if (cacheDir.isEmpty()) return;
+    QDirIterator it(cacheDir + "/blobs", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        const QByteArray sha256Hex = info.fileName().toLatin1();
+        if (sha256Hex.size() != 64) continue; // Временный файл QSaveFile, оставшийся после сбоя
+        Blob blob;
+        blob.size = info.size();
+        blob.lastUsed = info.lastModified().toMSecsSinceEpoch();
+        blobs.insert(sha256Hex, blob);
+        blobsSize += blob.size;
+    }
+    // Записи без тела больше не нужны
+    for (auto entry = index.begin(); entry != index.end();) {
+        if (!blobs.contains(entry->sha256)) entry = index.erase(entry);
+        else ++entry;
+    }
+}
+
+void DownloadCache::dropBlob(const QByteArray &sha256Hex)
+{
+    auto blob = blobs.find(sha256Hex);
+    if (blob == blobs.end()) return;
+    blobsSize -= blob->size;
+    blobs.erase(blob);
+}
+
+QStringList DownloadCache::evict()
+{
+    QStringList removed;
+    if (cacheDir.isEmpty() || blobsSize <= diskBudget) return removed;
+
+    // Самые давно использованные - первыми
+    QList<std::pair<qint64, QByteArray>> order;
+    order.reserve(blobs.size());
+    for (auto it = blobs.constBegin(); it != blobs.constEnd(); ++it) order.append({it->lastUsed, it.key()});
+    std::sort(order.begin(), order.end());
+    for (const auto &blob : std::as_const(order)) {
+        if (blobsSize <= diskBudget) break;
+        removed.append(blobPath(blob.second));
+        dropBlob(blob.second);
+    }
+    for (auto entry = index.begin(); entry != index.end();) {
+        if (!blobs.contains(entry->sha256) && !writing.contains(entry->sha256)) entry = index.erase(entry);
+        else ++entry;
+    }
+    return removed;
+}
+
+void DownloadCache::removeFiles(const QStringList &paths)
+{
+    for (const QString &path : paths) QFile::remove(path);
+}
+
+void DownloadCache::loadIndex()
+{
+    index.clear();
+    QFile file(cacheDir + "/index.json");
+    if (!file.open(QIODevice::ReadOnly)) return;
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
+        const QJsonObject obj = it.value().toObject();
+        Entry entry;
+        entry.sha256 = obj.value("sha256").toString().toLatin1();
+        entry.size = obj.value("size").toInteger(-1);
+        if (entry.isValid()) index.insert(it.key(), entry);
+    }
+    qDebug() << "DownloadCache: В кэше скачиваний" << index.size() << "файлов.";
+}
+
+DownloadCache::IndexSnapshot DownloadCache::snapshotIndex()
+{
+    IndexSnapshot snapshot;
+    if (cacheDir.isEmpty()) return snapshot;
+    QJsonObject root;
+    for (auto it = index.constBegin(); it != index.constEnd(); ++it) {
+        QJsonObject obj;
+        obj.insert("sha256", QString::fromLatin1(it->sha256));
+        obj.insert("size", it->size);
+        root.insert(it.key(), obj);
+    }
+    snapshot.dir = cacheDir;
+    snapshot.json = QJsonDocument(root).toJson(QJsonDocument::Compact);
+    snapshot.revision = ++indexRevision;
+    return snapshot;
+}
+
+void DownloadCache::writeIndex(const IndexSnapshot &snapshot)
+{
+    if (snapshot.dir.isEmpty()) return;
+    // Снимки пишутся без основного мьютекса, поэтому более старый не должен лечь поверх нового
+    QMutexLocker locker(&saveMutex);
+    if (snapshot.revision <= savedRevision) return;
+    QDir().mkpath(snapshot.dir);
+    QSaveFile file(snapshot.dir + "/index.json");
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(snapshot.json);
+    if (!file.commit()) {
+        qWarning() << "DownloadCache: Не удалось сохранить индекс:" << file.errorString();
+        return;
+    }
+    savedRevision = snapshot.revision;
+}
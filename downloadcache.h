@@ -0,0 +1,76 @@
+#ifndef DOWNLOADCACHE_H
+#define DOWNLOADCACHE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QStringList>
+#include <QMutex>
+
+// Локальный кэш скачанных файлов, адресуемый по содержимому: тело хранится под своим SHA-256,
+// индекс связывает ID файла на сервере с хэшем и размером. Одинаковые файлы с разными ID
+// занимают место один раз. Копия отдается только после проверки на сервере (If-None-Match или
+// совпадение X-Content-SHA256 и размера в заголовках ответа), поэтому права доступа по-прежнему
+// проверяет сервер. Объем на диске ограничен, вытесняются давно не использованные тела.
+// Используется и из потока передач. Размеры и время использования тел держатся в памяти,
+// под мьютексом только они: чтение, запись и хэширование тел идут без блокировки
+class DownloadCache
+{
+public:
+    struct Entry {
+        QByteArray sha256; // hex
+        qint64 size = -1;
+        bool isValid() const { return !sha256.isEmpty() && size >= 0; }
+    };
+
+    static const qint64 kDefaultBudget = 512LL * 1024 * 1024;
+
+    DownloadCache();
+
+    // Отдельный каталог для каждого сервера: ID файлов у разных серверов не пересекаются
+    void setScope(const QString &serverUrl);
+    void setBudget(qint64 bytes); // 0 - кэш выключен
+    qint64 budget() const;
+
+    // Есть ли на диске копия файла fileId (хэш и размер для проверки на сервере)
+    bool lookup(const QString &fileId, Entry *entry) const;
+    // Читает копию и сверяет хэш. false - копии нет или она повреждена (тогда она удаляется)
+    bool read(const Entry &entry, QByteArray *data);
+    void store(const QString &fileId, const QByteArray &data, const QByteArray &sha256Hex);
+
+private:
+    struct Blob {
+        qint64 size = 0;
+        qint64 lastUsed = 0; // мс от эпохи
+    };
+
+    mutable QMutex mutex;
+    QString cacheDir;
+    QHash<QString, Entry> index; // ID файла -> содержимое
+    QHash<QByteArray, Blob> blobs; // Тела на диске; заполняется одним обходом каталога в setScope
+    QSet<QByteArray> writing;    // Тела, которые сейчас записываются
+    qint64 blobsSize;
+    qint64 diskBudget;
+    quint64 indexRevision;
+
+    QMutex saveMutex;            // Порядок записи index.json
+    quint64 savedRevision;
+
+    QString blobPath(const QByteArray &sha256Hex) const;
+    void loadIndex();
+    void scanBlobs();
+    void dropBlob(const QByteArray &sha256Hex);
+    // Выбирает тела для удаления по памяти; сами файлы удаляет вызывающий уже без мьютекса
+    QStringList evict();
+    struct IndexSnapshot {
+        QString dir;
+        QByteArray json;
+        quint64 revision = 0;
+    };
+    IndexSnapshot snapshotIndex();
+    void writeIndex(const IndexSnapshot &snapshot);
+    void removeFiles(const QStringList &paths);
+};
+
+#endif // DOWNLOADCACHE_H
@@ -1,6 +1,9 @@
 #include "filedetailswindow.h"
 #include "ui_filedetailswindow.h"
 #include "apiclient.h"
+#include "previewservice.h"
+#include "requesthandle.h"
+#include "progressaggregator.h"
 
 #include <QJsonObject>
 #include <QMessageBox>
@@ -8,6 +11,7 @@
 #include <QFileDialog>
 #include <QFile>
 #include <QProgressBar>
+#include <QPixmap>
 
 FileDetailsWindow::FileDetailsWindow(const QString &token, const QString &urlIdentifier, const QString &fileId, ApiClient *client, QWidget *parent) :
     QDialog(parent),
@@ -17,7 +21,8 @@ FileDetailsWindow::FileDetailsWindow(const QString &token, const QString &urlIde
     currentFileId(fileId),
     currentFileName(""),
     apiClient(client),
-    downloadProgressBar(nullptr)
+    downloadProgressBar(nullptr),
+    downloadProgress(new ProgressAggregator(this))
 {
     ui->setupUi(this);
 
@@ -29,6 +34,7 @@ FileDetailsWindow::FileDetailsWindow(const QString &token, const QString &urlIde
         downloadProgressBar->setTextVisible(true);
         downloadProgressBar->setFormat("Скачивание: %p%");
     }
+    connect(downloadProgress, &ProgressAggregator::progressChanged, this, &FileDetailsWindow::handleDownloadProgress);
     // ---------------------------------------
 
     if (!apiClient) {
@@ -42,13 +48,14 @@ FileDetailsWindow::FileDetailsWindow(const QString &token, const QString &urlIde
     setAttribute(Qt::WA_DeleteOnClose);
 
     // --- Подключаем сигналы ---
-    // getFileInfo
-    connect(apiClient, &ApiClient::fileInfoSuccess, this, &FileDetailsWindow::handleInfoSuccess);
-    connect(apiClient, &ApiClient::fileInfoFailed, this, &FileDetailsWindow::handleInfoFailed);
-    // downloadFile
-    connect(apiClient, &ApiClient::downloadSuccess, this, &FileDetailsWindow::handleDownloadSuccess);
-    connect(apiClient, &ApiClient::downloadProgress, this, &FileDetailsWindow::handleDownloadProgress);
-    connect(apiClient, &ApiClient::downloadFailed, this, &FileDetailsWindow::handleDownloadFailed);
+    // Информация о файле и скачивание приходят через дескрипторы своих запросов
+    // миниатюра - подписка только на свой файл, а не на миниатюры всех окон и списков
+    QImage cachedPreview = apiClient->previewService()->cachedPreview(currentFileId);
+    if (!cachedPreview.isNull()) {
+        handlePreviewReady(cachedPreview);
+    } else {
+        apiClient->previewService()->watchPreview(currentFileId, this, [this](const QImage &image) { handlePreviewReady(image); });
+    }
     // ------------------------
 
     setFieldsEnabled(false); // Блокируем поля на время загрузки инфо
@@ -57,13 +64,8 @@ FileDetailsWindow::FileDetailsWindow(const QString &token, const QString &urlIde
 
 FileDetailsWindow::~FileDetailsWindow()
 {
-    if (apiClient) {
-        disconnect(apiClient, &ApiClient::fileInfoSuccess, this, &FileDetailsWindow::handleInfoSuccess);
-        disconnect(apiClient, &ApiClient::fileInfoFailed, this, &FileDetailsWindow::handleInfoFailed);
-        disconnect(apiClient, &ApiClient::downloadSuccess, this, &FileDetailsWindow::handleDownloadSuccess);
-        disconnect(apiClient, &ApiClient::downloadProgress, this, &FileDetailsWindow::handleDownloadProgress);
-        disconnect(apiClient, &ApiClient::downloadFailed, this, &FileDetailsWindow::handleDownloadFailed);
-    }
+    // Окно закрыто посреди скачивания - данные больше никому не нужны
+    if (downloadRequest) downloadRequest->abort();
     delete ui;
     qDebug() << "FileDetailsWindow уничтожен.";
 }
@@ -95,11 +97,20 @@ void FileDetailsWindow::setDownloadingState(bool downloading)
 // Запрос информации о файле
 void FileDetailsWindow::requestFileInfo()
 {
+    QJsonObject cachedData;
+    if (apiClient && apiClient->cachedFileInfo(fileUrlIdentifier, &cachedData)) {
+        // Детали уже предзагружены (наведение/простой) - окно открывается заполненным
+        qDebug() << "FileDetailsWindow: Информация для URL ID:" << fileUrlIdentifier << "взята из кэша.";
+        handleInfoSuccess(cachedData);
+        return;
+    }
     if (apiClient && !apiToken.isEmpty() && !fileUrlIdentifier.isEmpty()) {
         qDebug() << "FileDetailsWindow: Запрос информации для URL ID:" << fileUrlIdentifier; // Исправлен лог
         ui->fileNameLabel->setText("Загрузка данных...");
         // Передаем идентификатор URL в getFileInfo
-        apiClient->getFileInfo(apiToken, fileUrlIdentifier);
+        infoRequest = apiClient->getFileInfo(apiToken, fileUrlIdentifier);
+        connect(infoRequest, &RequestHandle::jsonReady, this, &FileDetailsWindow::handleInfoSuccess);
+        connect(infoRequest, &RequestHandle::failed, this, &FileDetailsWindow::handleInfoFailed);
     } else {
         qDebug() << "FileDetailsWindow: Недостаточно данных для запроса информации.";
         handleInfoFailed("Внутренняя ошибка: нет токена или идентификатора URL файла.", 0);
@@ -110,15 +121,6 @@ void FileDetailsWindow::requestFileInfo()
 // Обработка успешного ответа с информацией о файле
 void FileDetailsWindow::handleInfoSuccess(const QJsonObject &fileData)
 {
-    QString responseFileId = fileData.value("id").toString(); // Предполагаем, что API возвращает 'id'
-    if (!responseFileId.isEmpty() && responseFileId != currentFileId) {
-        qWarning() << "FileDetailsWindow: Получен ответ fileInfoSuccess для другого файла!"
-                   << "Ожидали ID:" << currentFileId << ", получили ID:" << responseFileId
-                   << "для URL ID:" << fileUrlIdentifier << ". Игнорируем.";
-        return; // Просто игнорируем этот ответ
-    }
-    // ----------------------------------------------------------------------------------
-
     qDebug() << "FileDetailsWindow: Получена информация о файле ID:" << currentFileId << "(запрошено по URL ID:" << fileUrlIdentifier << ")" << fileData;
 
     currentFileName = fileData.value("file_name").toString("Неизвестное имя");
@@ -132,6 +134,17 @@ void FileDetailsWindow::handleInfoSuccess(const QJsonObject &fileData)
     this->setWindowTitle(QString("Информация: %1").arg(currentFileName));
 
     setFieldsEnabled(true);
+
+    // Имя файла известно - можно запросить миниатюру (если ее еще нет в кэше)
+    apiClient->previewService()->requestPreview(apiToken, currentFileId, currentFileName, true);
+}
+
+// Показ миниатюры над деталями файла
+void FileDetailsWindow::handlePreviewReady(const QImage &image)
+{
+    if (image.isNull()) return;
+    ui->previewLabel->setPixmap(QPixmap::fromImage(image));
+    ui->previewLabel->setVisible(true);
 }
 
 // Обработка ошибки при получении информации
@@ -155,20 +168,16 @@ void FileDetailsWindow::on_downloadButton_clicked()
     setDownloadingState(true);
     if(downloadProgressBar) downloadProgressBar->setFormat("Скачивание: %p%");
     // Передаем ID файла в downloadFile
-    apiClient->downloadFile(apiToken, currentFileId, currentFileName);
+    downloadRequest = apiClient->downloadFile(apiToken, currentFileId, currentFileName);
+    connect(downloadRequest, &RequestHandle::dataReady, this, &FileDetailsWindow::handleDownloadSuccess);
+    downloadProgress->track(downloadRequest);
+    connect(downloadRequest, &RequestHandle::failed, this, &FileDetailsWindow::handleDownloadFailed);
 }
 
 
 // Обработка успешного скачивания
-void FileDetailsWindow::handleDownloadSuccess(const QString &requestedFileId, const QByteArray &fileData, const QString &originalFileName)
+void FileDetailsWindow::handleDownloadSuccess(const QByteArray &fileData, const QString &originalFileName)
 {
-    // --- Проверка, для того ли файла пришел ответ ---
-    if (requestedFileId != currentFileId) {
-        qDebug() << "FileDetailsWindow: Получен ответ downloadSuccess для другого файла (" << requestedFileId << "), игнорируем.";
-        return;
-    }
-    // ----------------------------------------------
-
     qDebug() << "FileDetailsWindow: Скачивание для ID:" << currentFileId << "завершено успешно.";
     setDownloadingState(false); // Разблокируем кнопку, скрываем прогресс
 
@@ -207,38 +216,23 @@ void FileDetailsWindow::handleDownloadSuccess(const QString &requestedFileId, co
 }
 
 // Обработка ошибки скачивания
-void FileDetailsWindow::handleDownloadFailed(const QString &requestedFileId, const QString &errorString, int statusCode)
+void FileDetailsWindow::handleDownloadFailed(const QString &errorString, int statusCode)
 {
-    // --- Проверка, для того ли файла пришел ответ ---
-    if (requestedFileId != currentFileId) {
-        qDebug() << "FileDetailsWindow: Получен ответ downloadFailed для другого файла (" << requestedFileId << "), игнорируем.";
-        return;
-    }
-    // ----------------------------------------------
-
     qWarning() << "FileDetailsWindow: Ошибка скачивания файла ID:" << currentFileId << "Статус:" << statusCode << "Ошибка:" << errorString;
     setDownloadingState(false); // Разблокируем кнопку, скрываем прогресс
     QMessageBox::critical(this, "Ошибка скачивания", errorString);
 }
 
 // Обновление прогресс-бара скачивания
-void FileDetailsWindow::handleDownloadProgress(const QString &requestedFileId, qint64 bytesReceived, qint64 bytesTotal)
+void FileDetailsWindow::handleDownloadProgress(const TransferProgress &progress)
 {
-    // --- Проверка, для того ли файла пришел ответ ---
-    if (requestedFileId != currentFileId) {
-        return;
-    }
-    // ----------------------------------------------
-
-    if (downloadProgressBar && bytesTotal > 0) {
-        int percent = static_cast<int>((static_cast<double>(bytesReceived) / static_cast<double>(bytesTotal)) * 100.0);
-        downloadProgressBar->setValue(percent);
-        downloadProgressBar->setFormat(QString("Скачивание: %1 / %2 (%p%)")
-                                           .arg(QLocale::system().formattedDataSize(bytesReceived)) // Форматирование байт
-                                           .arg(QLocale::system().formattedDataSize(bytesTotal)));
-    } else if (downloadProgressBar) {
-        downloadProgressBar->setFormat(QString("Скачивание: %1").arg(QLocale::system().formattedDataSize(bytesReceived)));
-        downloadProgressBar->setMaximum(0);
-        downloadProgressBar->setMinimum(0);
+    if (!downloadProgressBar) return;
+    if (progress.percent >= 0) {
+        downloadProgressBar->setRange(0, 100);
+        downloadProgressBar->setValue(progress.percent);
+        downloadProgressBar->setFormat("Скачивание: " + ProgressAggregator::describe(progress) + " (%p%)");
+    } else {
+        downloadProgressBar->setRange(0, 0);
+        downloadProgressBar->setFormat("Скачивание: " + ProgressAggregator::describe(progress));
     }
 }
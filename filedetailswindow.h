@@ -3,11 +3,16 @@
 
 #include <QDialog>
 #include <QString>
+#include <QPointer>
+#include "datatypes.h"
 
 namespace Ui { class FileDetailsWindow; }
 class ApiClient;
 class QJsonObject;
 class QProgressBar;
+class QImage;
+class RequestHandle;
+class ProgressAggregator;
 
 class FileDetailsWindow : public QDialog
 {
@@ -21,6 +26,7 @@ public:
                                ApiClient *client,
                                QWidget *parent = nullptr);
     ~FileDetailsWindow();
+    void setToken(const QString &token) { apiToken = token; }
 
 private slots:
     // Слоты для обработки ответа от ApiClient
@@ -31,9 +37,12 @@ private slots:
     void on_downloadButton_clicked();
 
     // Слоты для обработки скачивания
-    void handleDownloadSuccess(const QString &requestedFileId, const QByteArray &fileData, const QString &originalFileName);
-    void handleDownloadFailed(const QString &requestedFileId, const QString &errorString, int statusCode);
-    void handleDownloadProgress(const QString &requestedFileId, qint64 bytesReceived, qint64 bytesTotal);
+    void handleDownloadSuccess(const QByteArray &fileData, const QString &originalFileName);
+    void handleDownloadFailed(const QString &errorString, int statusCode);
+    void handleDownloadProgress(const TransferProgress &progress);
+
+    // Миниатюра файла (декодируется в фоне сервисом превью)
+    void handlePreviewReady(const QImage &image);
 
 private:
     Ui::FileDetailsWindow *ui;
@@ -43,6 +52,9 @@ private:
     QString currentFileName;    // Имя файла, полученное из getFileInfo
     ApiClient *apiClient;
     QProgressBar *downloadProgressBar; // Указатель на прогресс бар
+    ProgressAggregator *downloadProgress; // Прогресс скачивания не чаще ~20 раз в секунду, со скоростью
+    QPointer<RequestHandle> infoRequest;     // Текущий запрос информации о файле
+    QPointer<RequestHandle> downloadRequest; // Текущее скачивание
 
     void requestFileInfo(); // Запрос информации при открытии
     void setFieldsEnabled(bool enabled); // Вкл/выкл полей ввода
@@ -0,0 +1,42 @@
+#include "fileinfocache.h"
+
+FileInfoCache::FileInfoCache(int capacity, int ttlSeconds)
+    : entries(capacity),
+      ttlMs(ttlSeconds * 1000)
+{
+}
+
+bool FileInfoCache::lookup(const QString &urlIdentifier, QJsonObject *fileData)
+{
+    Entry *entry = entries.object(urlIdentifier); // Заодно поднимает запись в LRU
+    if (!entry) return false;
+    if (entry->expires.hasExpired()) {
+        entries.remove(urlIdentifier);
+        return false;
+    }
+    if (fileData) *fileData = entry->data;
+    return true;
+}
+
+bool FileInfoCache::contains(const QString &urlIdentifier)
+{
+    return lookup(urlIdentifier, nullptr);
+}
+
+void FileInfoCache::insert(const QString &urlIdentifier, const QJsonObject &fileData)
+{
+    Entry *entry = new Entry;
+    entry->data = fileData;
+    entry->expires = QDeadlineTimer(ttlMs);
+    entries.insert(urlIdentifier, entry); // Самая давно использованная запись вытесняется сама
+}
+
+void FileInfoCache::remove(const QString &urlIdentifier)
+{
+    entries.remove(urlIdentifier);
+}
+
+void FileInfoCache::clear()
+{
+    entries.clear();
+}
@@ -0,0 +1,32 @@
+#ifndef FILEINFOCACHE_H
+#define FILEINFOCACHE_H
+
+#include <QCache>
+#include <QDeadlineTimer>
+#include <QJsonObject>
+#include <QString>
+
+// Ограниченный по размеру (LRU) кэш ответов file_info.php с временем жизни записей.
+// Ключ - идентификатор файла из URL, как в запросе getFileInfo
+class FileInfoCache
+{
+public:
+    explicit FileInfoCache(int capacity = 500, int ttlSeconds = 60);
+
+    bool lookup(const QString &urlIdentifier, QJsonObject *fileData);
+    bool contains(const QString &urlIdentifier);
+    void insert(const QString &urlIdentifier, const QJsonObject &fileData);
+    void remove(const QString &urlIdentifier);
+    void clear();
+
+private:
+    struct Entry {
+        QJsonObject data;
+        QDeadlineTimer expires;
+    };
+
+    QCache<QString, Entry> entries;
+    int ttlMs;
+};
+
+#endif // FILEINFOCACHE_H
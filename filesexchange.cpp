@@ -4,6 +4,7 @@
 #include "adminwindow.h"
 
 #include <QMessageBox>
+#include <QSettings>
 #include <QDebug>
 
 FileseXchange::FileseXchange(QWidget *parent)
@@ -16,10 +17,12 @@ FileseXchange::FileseXchange(QWidget *parent)
     ui->setupUi(this);
 
     // Создаем ApiClient
-    apiClient = new ApiClient("https://filesexchange.ru.tuna.am/api/", this); // Укажите ваш базовый URL
+    apiClient = new ApiClient(ApiClient::defaultBaseUrl(), this); // Базовый URL задается в ApiClient::defaultBaseUrl
 
     connect(apiClient, &ApiClient::loginSuccess, this, &FileseXchange::handleLoginSuccess);
     connect(apiClient, &ApiClient::loginFailed, this, &FileseXchange::handleLoginFailure);
+
+    ui->checkBox_remember->setChecked(QSettings().value("session/remember", false).toBool());
 }
 
 FileseXchange::~FileseXchange()
@@ -42,10 +45,98 @@ void FileseXchange::on_button_enter_clicked()
     apiClient->login(login, password);
 }
 
+bool FileseXchange::resumeSavedSession()
+{
+    SessionStore::Session session;
+    if (!sessionStore.load(&session)) return false;
+    if (session.serverUrl != apiClient->baseUrl()) {
+        qDebug() << "FileseXchange: Сохраненная сессия относится к другому серверу:" << session.serverUrl;
+        return false;
+    }
+    ui->lineEdit_login->setText(session.username);
+    currentUserToken = session.token;
+    currentUserRole = session.role;
+
+    // Проверка токена идет по сети, пока окно строится из локального кэша
+    RequestHandle *check = apiClient->validateSession(currentUserToken);
+    connect(check, &RequestHandle::jsonReady, this, [this, session](const QJsonObject &result) mutable {
+        // Сервер может выдать новый токен: старый после этого не обязан работать, поэтому он
+        // сразу передается открытому окну (и его очередям), а не только следующему запуску
+        const QString freshToken = result.value("token_api").toString();
+        if (!freshToken.isEmpty() && freshToken != session.token) {
+            qDebug() << "FileseXchange: Сервер обновил токен сохраненной сессии.";
+            session.token = freshToken;
+            currentUserToken = freshToken;
+            if (UserWindow *window = qobject_cast<UserWindow *>(appWindow.data())) window->setToken(freshToken);
+        }
+        session.role = result.value("role").toString(session.role);
+        session.lastUsed = QDateTime::currentDateTimeUtc();
+        sessionStore.save(session);
+    });
+    connect(check, &RequestHandle::failed, this, &FileseXchange::handleSessionCheckFailed);
+
+    apiClient->resumeSession(session.username);
+    apiClient->prefetchSessionData(currentUserToken, currentUserRole);
+    if (!proceedToAppInterface()) {
+        check->abort();
+        sessionStore.clear();
+        return false;
+    }
+    return true;
+}
+
+void FileseXchange::handleSessionCheckFailed(const QString &errorString, int statusCode)
+{
+    if (statusCode == 404) {
+        // Сервер без session_check.php: продлеваем сессию, ошибки токена покажут запросы окна
+        qDebug() << "FileseXchange: Сервер не поддерживает проверку сессии.";
+        sessionStore.touch();
+        return;
+    }
+    if (statusCode != 401 && statusCode != 403) {
+        // Нет сети, сбой или перегрузка сервера (5xx): это не ответ о токене - работаем с кэшем,
+        // токен проверят запросы окна. Сессию сбрасывает только явный отказ сервера
+        qWarning() << "FileseXchange: Не удалось проверить сохраненную сессию. Статус:" << statusCode << "Ошибка:" << errorString;
+        return;
+    }
+    qWarning() << "FileseXchange: Сохраненная сессия недействительна. Статус:" << statusCode << "Ошибка:" << errorString;
+    sessionStore.clear();
+    currentUserToken = "";
+    currentUserRole = "";
+    // Сначала форма входа, потом закрытие рабочего окна - иначе приложение завершится вместе с ним
+    ui->button_enter->setEnabled(true);
+    ui->statusbar->showMessage("Сессия истекла, войдите снова.");
+    show();
+    if (appWindow) appWindow->close();
+    QMessageBox::information(this, "Сессия истекла", "Сохраненная сессия больше не действительна. Войдите снова.");
+}
+
 void FileseXchange::handleLoginSuccess(const QString &token, const QString &role)
 {
     currentUserToken = token;
     currentUserRole = role;
+    const bool remember = ui->checkBox_remember->isChecked();
+    // Данные для окна запрашиваются сразу, пока оно строится
+    apiClient->prefetchSessionData(token, role);
+    if (!proceedToAppInterface()) return;
+
+    QSettings().setValue("session/remember", remember);
+    if (remember) {
+        SessionStore::Session session;
+        session.serverUrl = apiClient->baseUrl();
+        session.username = ui->lineEdit_login->text();
+        session.token = token;
+        session.role = role;
+        session.lastUsed = QDateTime::currentDateTimeUtc();
+        sessionStore.save(session);
+    } else {
+        sessionStore.clear();
+    }
+    ui->lineEdit_password->clear();
+}
+
+bool FileseXchange::proceedToAppInterface()
+{
     // --- Логика перехода в зависимости от роли ---
     if (currentUserRole == "user") {
         // Передаем apiClient, чтобы UserWindow мог делать свои запросы
@@ -54,12 +145,14 @@ void FileseXchange::handleLoginSuccess(const QString &token, const QString &role
         // Устанавливаем флаг, чтобы окно удалилось само при закрытии
         userWin->setAttribute(Qt::WA_DeleteOnClose);
         userWin->show(); // Показываем новое окно
+        appWindow = userWin;
         // Закрываем окно логина
         this->close();
     } else if (currentUserRole == "admin") {
         AdminWindow *adminWin = new AdminWindow(currentUserToken, apiClient, nullptr);
         adminWin->setAttribute(Qt::WA_DeleteOnClose);
         adminWin->show();
+        appWindow = adminWin;
         this->close(); // Закрываем окно логина
     } else {
         qDebug() << "FileseXchange: Неизвестная роль:" << currentUserRole;
@@ -69,7 +162,9 @@ void FileseXchange::handleLoginSuccess(const QString &token, const QString &role
         ui->statusbar->clearMessage();
         currentUserToken = ""; // Сбрасываем данные
         currentUserRole = "";
+        return false;
     }
+    return true;
 }
 
 void FileseXchange::handleLoginFailure(const QString &errorString, int statusCode)
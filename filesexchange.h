@@ -2,7 +2,9 @@
 #define FILESEXCHANGE_H
 
 #include <QMainWindow>
+#include <QPointer>
 #include "apiclient.h"
+#include "sessionstore.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class FileseXchange; }
@@ -16,12 +18,17 @@ public:
     FileseXchange(QWidget *parent = nullptr);
     ~FileseXchange();
 
+    // Открывает рабочее окно по сохраненной сессии (токен проверяется параллельно).
+    // false - сохраненной сессии нет, нужно показать форму входа
+    bool resumeSavedSession();
+
 private slots:
     void on_button_enter_clicked();
 
     // Сигнатура слота для соответствия сигналу ApiClient
     void handleLoginSuccess(const QString &token, const QString &role);
     void handleLoginFailure(const QString &errorString, int statusCode);
+    void handleSessionCheckFailed(const QString &errorString, int statusCode);
 
 private:
     Ui::FileseXchange *ui;
@@ -30,8 +37,10 @@ private:
     // Добавляем переменные для хранения состояния сессии
     QString currentUserToken;
     QString currentUserRole;
+    SessionStore sessionStore;
+    QPointer<QWidget> appWindow; // Окно пользователя или администратора после входа
 
-    // Метод для перехода к следующему этапу
-    void proceedToAppInterface();
+    // Метод для перехода к следующему этапу. false - неизвестная роль
+    bool proceedToAppInterface();
 };
 #endif // FILESEXCHANGE_H
@@ -0,0 +1,266 @@
+#include "folderwatcher.h"
+#include "transferqueue.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+
+struct HashedFile {
+    QString path;
+    qint64 size = -1;
+    QDateTime modified;
+    QByteArray sha256;
+};
+
+}
+
+FolderWatcher::FolderWatcher(TransferQueue *queue, QObject *parent)
+    : QObject(parent),
+      transferQueue(queue)
+{
+    debounceTimer.setSingleShot(true);
+    debounceTimer.setInterval(kDebounceMs);
+    stableTimer.setSingleShot(true);
+    stableTimer.setInterval(kStableCheckMs);
+    rescanTimer.setInterval(kSafetyRescanMs);
+
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, &debounceTimer, qOverload<>(&QTimer::start));
+    // Файлы-кандидаты наблюдаются по отдельности, пока их дописывают
+    connect(&watcher, &QFileSystemWatcher::fileChanged, &stableTimer, qOverload<>(&QTimer::start));
+    connect(&debounceTimer, &QTimer::timeout, this, &FolderWatcher::scanDirectory);
+    connect(&stableTimer, &QTimer::timeout, this, &FolderWatcher::checkCandidates);
+    connect(&rescanTimer, &QTimer::timeout, this, &FolderWatcher::scanDirectory);
+    connect(transferQueue, &TransferQueue::uploadFinished, this, &FolderWatcher::handleUploadFinished);
+}
+
+bool FolderWatcher::start(const QString &directory)
+{
+    stop();
+    if (!QFileInfo(directory).isDir()) return false;
+    watchedDir = QDir(directory).absolutePath();
+    if (!watcher.addPath(watchedDir)) {
+        qWarning() << "FolderWatcher: Не удалось подписаться на изменения папки" << watchedDir;
+        watchedDir.clear();
+        return false;
+    }
+    loadState();
+    rescanTimer.start();
+    qDebug() << "FolderWatcher: Наблюдение за" << watchedDir << ", известно отправленных файлов:" << uploaded.count();
+    scanDirectory(); // Файлы, появившиеся пока приложение было закрыто
+    return true;
+}
+
+void FolderWatcher::stop()
+{
+    if (watchedDir.isEmpty()) return;
+    const QStringList paths = watcher.files() + watcher.directories();
+    if (!paths.isEmpty()) watcher.removePaths(paths);
+    debounceTimer.stop();
+    stableTimer.stop();
+    rescanTimer.stop();
+    saveState();
+    candidates.clear();
+    qDebug() << "FolderWatcher: Наблюдение за" << watchedDir << "остановлено.";
+    watchedDir.clear();
+}
+
+bool FolderWatcher::isActive() const
+{
+    return !watchedDir.isEmpty();
+}
+
+QString FolderWatcher::directory() const
+{
+    return watchedDir;
+}
+
+void FolderWatcher::scanDirectory()
+{
+    if (watchedDir.isEmpty()) return;
+    // Только stat по записям папки: содержимое читается лишь у изменившихся файлов
+    const QFileInfoList entries = QDir(watchedDir).entryInfoList(QDir::Files | QDir::Readable | QDir::NoDotAndDotDot);
+    QSet<QString> present;
+    for (const QFileInfo &info : entries) {
+        if (isIgnored(info.fileName())) continue;
+        const QString path = info.absoluteFilePath();
+        present.insert(path);
+        if (candidates.contains(path) || hashing.contains(path) || pending.contains(path)) continue;
+
+        auto known = uploaded.constFind(path);
+        if (known != uploaded.constEnd() && known->size == info.size() && known->modified == info.lastModified()) continue;
+
+        FileState state;
+        state.size = info.size();
+        state.modified = info.lastModified();
+        candidates.insert(path, state);
+        watcher.addPath(path);
+    }
+
+    // Удаленные из папки файлы забываем
+    bool stateChanged = false;
+    for (auto it = uploaded.begin(); it != uploaded.end();) {
+        if (!present.contains(it.key())) {
+            it = uploaded.erase(it);
+            stateChanged = true;
+        } else {
+            ++it;
+        }
+    }
+    if (stateChanged) saveState();
+    if (!candidates.isEmpty()) stableTimer.start();
+}
+
+void FolderWatcher::checkCandidates()
+{
+    QList<QString> stable;
+    for (auto it = candidates.begin(); it != candidates.end();) {
+        const QFileInfo info(it.key());
+        if (!info.exists()) {
+            watcher.removePath(it.key());
+            it = candidates.erase(it);
+            continue;
+        }
+        if (info.size() == it->size && info.lastModified() == it->modified) {
+            // За интервал проверки файл не менялся - считаем его дописанным
+            stable.append(it.key());
+            hashing.insert(it.key(), it.value());
+            watcher.removePath(it.key());
+            it = candidates.erase(it);
+        } else {
+            it->size = info.size();
+            it->modified = info.lastModified();
+            ++it;
+        }
+    }
+    if (!candidates.isEmpty()) stableTimer.start();
+    if (!stable.isEmpty()) hashStableFiles(stable);
+}
+
+void FolderWatcher::hashStableFiles(const QList<QString> &paths)
+{
+    QList<HashedFile> files;
+    for (const QString &path : paths) {
+        HashedFile file;
+        file.path = path;
+        file.size = hashing.value(path).size;
+        file.modified = hashing.value(path).modified;
+        files.append(file);
+    }
+
+    // Хэширование всей пачки в пуле потоков
+    QFutureWatcher<QList<HashedFile>> *futureWatcher = new QFutureWatcher<QList<HashedFile>>(this);
+    connect(futureWatcher, &QFutureWatcher<QList<HashedFile>>::finished, this, [this, futureWatcher]() {
+        const QList<HashedFile> results = futureWatcher->result();
+        futureWatcher->deleteLater();
+        bool stateChanged = false;
+        for (const HashedFile &file : results) {
+            hashing.remove(file.path);
+            if (watchedDir.isEmpty() || file.sha256.isEmpty()) continue;
+            FileState state;
+            state.size = file.size;
+            state.modified = file.modified;
+            state.sha256 = file.sha256;
+
+            auto known = uploaded.find(file.path);
+            if (known != uploaded.end() && known->sha256 == file.sha256) {
+                // Файл "потрогали", но содержимое то же - только запоминаем новое время
+                *known = state;
+                stateChanged = true;
+                emit fileSkipped(file.path);
+                continue;
+            }
+            pending.insert(file.path, state);
+            transferQueue->enqueueUpload(file.path);
+            emit fileQueued(file.path);
+        }
+        if (stateChanged) saveState();
+    });
+    futureWatcher->setFuture(QtConcurrent::run([files]() {
+        QList<HashedFile> results = files;
+        for (HashedFile &file : results) {
+            QFile source(file.path);
+            if (!source.open(QIODevice::ReadOnly)) continue;
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            hash.addData(&source);
+            file.sha256 = hash.result().toHex();
+        }
+        return results;
+    }));
+}
+
+void FolderWatcher::handleUploadFinished(const QString &filePath, bool ok, const QString &errorString)
+{
+    if (!pending.contains(filePath)) return; // Загрузка не из этой папки
+    const FileState state = pending.take(filePath);
+    if (!ok) {
+        // Состояние не обновляем: файл будет отправлен снова при следующем обходе
+        qWarning() << "FolderWatcher: Автозагрузка" << filePath << "не удалась:" << errorString;
+        return;
+    }
+    uploaded.insert(filePath, state);
+    saveState();
+}
+
+bool FolderWatcher::isIgnored(const QString &fileName)
+{
+    // Временные и служебные файлы редакторов и загрузчиков
+    return fileName.startsWith('.') || fileName.startsWith("~$") || fileName.endsWith('~')
+           || fileName.endsWith(".tmp", Qt::CaseInsensitive) || fileName.endsWith(".part", Qt::CaseInsensitive)
+           || fileName.endsWith(".crdownload", Qt::CaseInsensitive);
+}
+
+QString FolderWatcher::statePath() const
+{
+    const QByteArray key = QCryptographicHash::hash(watchedDir.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/watch/" + QString::fromLatin1(key) + ".json";
+}
+
+void FolderWatcher::loadState()
+{
+    uploaded.clear();
+    QFile file(statePath());
+    if (!file.open(QIODevice::ReadOnly)) return;
+    const QJsonObject files = QJsonDocument::fromJson(file.readAll()).object().value("files").toObject();
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        const QJsonObject obj = it.value().toObject();
+        FileState state;
+        state.size = obj.value("size").toInteger(-1);
+        state.modified = QDateTime::fromMSecsSinceEpoch(obj.value("mtime").toInteger());
+        state.sha256 = obj.value("sha256").toString().toLatin1();
+        uploaded.insert(QDir(watchedDir).absoluteFilePath(it.key()), state);
+    }
+}
+
+void FolderWatcher::saveState() const
+{
+    if (watchedDir.isEmpty()) return;
+    QJsonObject files;
+    const QDir dir(watchedDir);
+    for (auto it = uploaded.constBegin(); it != uploaded.constEnd(); ++it) {
+        QJsonObject obj;
+        obj.insert("size", it->size);
+        obj.insert("mtime", it->modified.toMSecsSinceEpoch());
+        obj.insert("sha256", QString::fromLatin1(it->sha256));
+        files.insert(dir.relativeFilePath(it.key()), obj);
+    }
+    QJsonObject root;
+    root.insert("directory", watchedDir);
+    root.insert("files", files);
+
+    QDir().mkpath(QFileInfo(statePath()).absolutePath());
+    QSaveFile file(statePath());
+    if (!file.open(QIODevice::WriteOnly)) return;
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.commit();
+}
@@ -0,0 +1,68 @@
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QString>
+#include <QTimer>
+
+class TransferQueue;
+
+// Автозагрузка из папки: новые и измененные файлы ставятся в TransferQueue.
+// Наблюдение идет за самой папкой (одна inotify-подписка на всю папку), события
+// сглаживаются таймером, а файл отправляется только когда его размер и время изменения
+// перестали меняться. Файлы с теми же размером/временем/хэшем, что при прошлой отправке,
+// пропускаются. Состояние отправленных файлов сохраняется между запусками
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int kDebounceMs = 1500;         // Пауза после последнего события папки
+    static const int kStableCheckMs = 2000;      // Интервал проверки, что файл дописан
+    static const int kSafetyRescanMs = 5 * 60 * 1000; // Редкий полный обход (запись "на месте" без событий папки)
+
+    explicit FolderWatcher(TransferQueue *queue, QObject *parent = nullptr);
+
+    bool start(const QString &directory);
+    void stop();
+    bool isActive() const;
+    QString directory() const;
+
+signals:
+    void fileQueued(const QString &filePath);
+    void fileSkipped(const QString &filePath); // Содержимое не изменилось
+
+private slots:
+    void scanDirectory();
+    void checkCandidates();
+    void handleUploadFinished(const QString &filePath, bool ok, const QString &errorString);
+
+private:
+    struct FileState {
+        qint64 size = -1;
+        QDateTime modified;
+        QByteArray sha256; // hex, только у отправленных
+    };
+
+    TransferQueue *transferQueue;
+    QFileSystemWatcher watcher;
+    QTimer debounceTimer;
+    QTimer stableTimer;
+    QTimer rescanTimer;
+    QString watchedDir;
+    QHash<QString, FileState> uploaded;   // Что и в каком виде уже отправлено
+    QHash<QString, FileState> candidates; // Изменились, ждут стабилизации
+    QHash<QString, FileState> hashing;    // Стабильны, считается хэш
+    QHash<QString, FileState> pending;    // Поставлены в очередь, ждут результата
+
+    void hashStableFiles(const QList<QString> &paths);
+    static bool isIgnored(const QString &fileName);
+    QString statePath() const;
+    void loadState();
+    void saveState() const;
+};
+
+#endif // FOLDERWATCHER_H
@@ -0,0 +1,981 @@
+#include "loadgencli.h"
+#include "apiclient.h"
+#include "bandwidthlimiter.h"
+#include "loadgenerator.h"
+#include "mappedfiledevice.h"
+#include "netemproxy.h"
+#include "previewservice.h"
+#include "requesthandle.h"
+#include "standinserver.h"
+#include "transferqueue.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QColor>
+#include <QImage>
+#include <QJsonObject>
+#include <QLocale>
+#include <QLoggingCategory>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+#include <algorithm>
+#include <cstring>
+#include <functional>
+
+namespace LoadGenCli {
+
+namespace {
+
+// Эндпоинт, который нагружает операция (для таблицы итогов)
+const char *endpointName(LoadGenerator::Operation operation)
+{
+    switch (operation) {
+    case LoadGenerator::Login: return "auth.php";
+    case LoadGenerator::List: return "user_files.php";
+    case LoadGenerator::Info: return "file_info.php";
+    case LoadGenerator::Upload: return "upload_file.php";
+    case LoadGenerator::Download: return "download_file.php";
+    case LoadGenerator::OperationCount: break;
+    }
+    return "";
+}
+
+void printReport(QTextStream &out, const LoadReport &report)
+{
+    const double seconds = qMax<qint64>(1, report.elapsedMs) / 1000.0;
+    out << QString("Пользователей: %1, время: %2 с, операций: %3 (%4/с), ошибок: %5")
+               .arg(report.usersStarted).arg(seconds, 0, 'f', 1)
+               .arg(report.totalSucceeded() + report.totalFailed())
+               .arg(report.totalSucceeded() / seconds, 0, 'f', 1)
+               .arg(report.totalFailed()) << Qt::endl;
+    out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9")
+               .arg("операция", -26).arg("успешно", 8).arg("ошибок", 7).arg("оп/с", 8)
+               .arg("p50, мс", 9).arg("p90, мс", 9).arg("p99, мс", 9).arg("макс, мс", 9).arg("данные/с", 12) << Qt::endl;
+    for (int i = 0; i < LoadGenerator::OperationCount; ++i) {
+        const LoadGenerator::Operation operation = static_cast<LoadGenerator::Operation>(i);
+        const LoadReport::Operation &stats = report.operations.at(i);
+        if (stats.succeeded + stats.failed == 0) continue;
+        const QString name = QString("%1 (%2)").arg(QString::fromLatin1(LoadGenerator::operationName(operation)),
+                                                    QString::fromLatin1(endpointName(operation)));
+        out << QString("%1 %2 %3 %4 %5 %6 %7 %8 %9")
+                   .arg(name, -26).arg(stats.succeeded, 8).arg(stats.failed, 7)
+                   .arg(stats.succeeded / seconds, 8, 'f', 1)
+                   .arg(stats.percentileMs(0.5), 9, 'f', 1).arg(stats.percentileMs(0.9), 9, 'f', 1)
+                   .arg(stats.percentileMs(0.99), 9, 'f', 1).arg(stats.percentileMs(1.0), 9, 'f', 1)
+                   .arg(stats.bytes > 0 ? QLocale::system().formattedDataSize(static_cast<qint64>(stats.bytes / seconds)) : QString("-"), 12)
+            << Qt::endl;
+    }
+}
+
+// Задержка цикла событий основного потока, пока идут передачи: таймер с периодом kIntervalMs
+// отмечает, насколько позже срока он сработал. Большие задержки - признак того, что обработка
+// передач (чтение тел, хэширование, прогресс) снова попала в поток GUI (см. TransferWorker)
+class EventLoopProbe
+{
+public:
+    static const int kIntervalMs = 10;
+
+    EventLoopProbe()
+    {
+        timer.setTimerType(Qt::PreciseTimer);
+        timer.setInterval(kIntervalMs);
+        QObject::connect(&timer, &QTimer::timeout, [this]() {
+            const qint64 nowUs = clock.nsecsElapsed() / 1000;
+            lagsUs.append(qMax<qint64>(0, nowUs - lastUs - kIntervalMs * 1000));
+            lastUs = nowUs;
+        });
+    }
+
+    void start()
+    {
+        lagsUs.clear();
+        clock.start();
+        lastUs = 0;
+        timer.start();
+    }
+
+    void stop() { timer.stop(); }
+
+    QString describe() const
+    {
+        if (lagsUs.isEmpty()) return QString("задержка цикла событий: нет замеров");
+        QList<qint64> sorted = lagsUs;
+        std::sort(sorted.begin(), sorted.end());
+        const auto percentileMs = [&sorted](double p) {
+            return sorted.at(qMin<qsizetype>(sorted.size() - 1, static_cast<qsizetype>(p * sorted.size()))) / 1000.0;
+        };
+        return QString("задержка цикла событий p50 %1 мс, p99 %2 мс, макс %3 мс")
+            .arg(percentileMs(0.5), 0, 'f', 1).arg(percentileMs(0.99), 0, 'f', 1).arg(sorted.last() / 1000.0, 0, 'f', 1);
+    }
+
+private:
+    QTimer timer;
+    QElapsedTimer clock;
+    qint64 lastUs = 0;
+    QList<qint64> lagsUs;
+};
+
+// Замер загрузки множества мелких файлов (--upload-bench): одни и те же файлы уходят через
+// TransferQueue сначала по одному запросу на файл, затем пакетами (BatchArchive)
+struct UploadBenchPhase {
+    QString name;
+    bool batched = false;
+    int succeeded = 0;
+    int failed = 0;
+    int requests = 0;
+    qint64 elapsedMs = 0;
+};
+
+int runUploadBench(QCoreApplication &app, QTextStream &out, QTextStream &err, const QString &serverUrl,
+                   const QString &user, const QString &password, int fileCount, qint64 fileSize, int concurrency)
+{
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        err << "Не удалось создать временный каталог для файлов." << Qt::endl;
+        return 1;
+    }
+    // Содержимое случайное, но одинаковое от прогона к прогону
+    QRandomGenerator random(1);
+    QStringList paths;
+    QByteArray data(fileSize, Qt::Uninitialized);
+    for (int i = 0; i < fileCount; ++i) {
+        random.fillRange(reinterpret_cast<quint32 *>(data.data()), data.size() / sizeof(quint32));
+        const QString path = QDir(dir.path()).filePath(QString("bench_%1.cfg").arg(i + 1, 5, 10, QChar('0')));
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+            err << "Не удалось записать " << path << ": " << file.errorString() << Qt::endl;
+            return 1;
+        }
+        paths.append(path);
+    }
+    out << QString("Загрузка %1 файлов по %2 на %3, параллельно %4")
+               .arg(fileCount).arg(QLocale::system().formattedDataSize(fileSize), serverUrl).arg(concurrency) << Qt::endl;
+
+    QList<UploadBenchPhase> phases(2);
+    phases[0].name = "по одному";
+    phases[1].name = "пакетами";
+    phases[1].batched = true;
+    int current = 0;
+    int requestsBefore = 0;
+    int exitCode = 0;
+    QElapsedTimer timer;
+    EventLoopProbe probe;
+
+    ApiClient client(serverUrl);
+    TransferQueue queue(&client);
+    queue.setConcurrency(concurrency);
+    const std::function<void()> startPhase = [&]() {
+        client.setBatchUploads(phases[current].batched);
+        requestsBefore = queue.requestsSent();
+        timer.start();
+        probe.start();
+        for (const QString &path : paths) queue.enqueueUpload(path);
+    };
+    QObject::connect(&client, &ApiClient::loginFailed, &app, [&](const QString &errorString, int) {
+        err << "Вход не удался: " << errorString << Qt::endl;
+        exitCode = 1;
+        app.quit();
+    });
+    QObject::connect(&client, &ApiClient::loginSuccess, &app, [&](const QString &token, const QString &) {
+        queue.setToken(token);
+        startPhase();
+    });
+    QObject::connect(&queue, &TransferQueue::uploadFinished, &app, [&](const QString &, bool ok, const QString &) {
+        if (ok) {
+            phases[current].succeeded++;
+        } else {
+            phases[current].failed++;
+        }
+    });
+    QObject::connect(&queue, &TransferQueue::idle, &app, [&]() {
+        UploadBenchPhase &phase = phases[current];
+        probe.stop();
+        phase.elapsedMs = qMax<qint64>(1, timer.elapsed());
+        phase.requests = queue.requestsSent() - requestsBefore;
+        out << QString("%1: %2 с, запросов %3, файлов/с %4, ошибок %5")
+                   .arg(phase.name, -10).arg(phase.elapsedMs / 1000.0, 0, 'f', 2).arg(phase.requests)
+                   .arg(phase.succeeded * 1000.0 / phase.elapsedMs, 0, 'f', 1).arg(phase.failed) << Qt::endl;
+        out << QString("%1  %2").arg(QString(), -10).arg(probe.describe()) << Qt::endl;
+        if (phase.batched && !client.batchUploadsEnabled()) out << "Сервер не принимает пакеты - файлы ушли по одному." << Qt::endl;
+        if (++current < phases.count()) {
+            startPhase();
+            return;
+        }
+        if (phases[0].failed + phases[1].failed > 0) exitCode = 1;
+        out << QString("Пакеты быстрее в %1 раз").arg(static_cast<double>(phases[0].elapsedMs) / phases[1].elapsedMs, 0, 'f', 1)
+            << Qt::endl;
+        app.quit();
+    });
+    client.login(user, password);
+    app.exec();
+    return exitCode;
+}
+
+// Замер загрузки по кускам (--delta-bench): большой файл загружается, затем в нем меняются
+// несколько участков общим размером changedBytes и он загружается снова. Во втором проходе
+// на сервер должны уйти только куски с изменениями (DeltaUpload)
+int runDeltaBench(QCoreApplication &app, QTextStream &out, QTextStream &err, const QString &serverUrl,
+                  const QString &user, const QString &password, qint64 fileSize, qint64 changedBytes)
+{
+    const int kChangedRegions = 4;
+    const qint64 kWriteBlock = 1024 * 1024;
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        err << "Не удалось создать временный каталог для файла." << Qt::endl;
+        return 1;
+    }
+    const QString path = QDir(dir.path()).filePath("delta_bench.bin");
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        err << "Не удалось записать " << path << ": " << file.errorString() << Qt::endl;
+        return 1;
+    }
+    QRandomGenerator random(1);
+    QByteArray block(kWriteBlock, Qt::Uninitialized);
+    for (qint64 written = 0; written < fileSize; written += block.size()) {
+        random.fillRange(reinterpret_cast<quint32 *>(block.data()), block.size() / sizeof(quint32));
+        const qint64 size = qMin<qint64>(block.size(), fileSize - written);
+        if (file.write(block.constData(), size) != size) {
+            err << "Не удалось записать " << path << ": " << file.errorString() << Qt::endl;
+            return 1;
+        }
+    }
+    file.close();
+    out << QString("Загрузка файла %1 на %2, затем повторно после изменения %3 в %4 местах")
+               .arg(QLocale::system().formattedDataSize(fileSize), serverUrl,
+                    QLocale::system().formattedDataSize(changedBytes)).arg(kChangedRegions) << Qt::endl;
+
+    int pass = 0;
+    int exitCode = 0;
+    QString apiToken;
+    TransferStats lastStats;
+    QList<TransferStats> passStats;
+
+    ApiClient client(serverUrl);
+    std::function<void()> startPass;
+    QObject::connect(&client, &ApiClient::transferStats, &app, [&](const TransferStats &stats) {
+        if (stats.direction == "upload") lastStats = stats;
+    });
+    QObject::connect(&client, &ApiClient::loginFailed, &app, [&](const QString &errorString, int) {
+        err << "Вход не удался: " << errorString << Qt::endl;
+        exitCode = 1;
+        app.quit();
+    });
+    QObject::connect(&client, &ApiClient::loginSuccess, &app, [&](const QString &token, const QString &) {
+        apiToken = token;
+        startPass();
+    });
+    startPass = [&]() {
+        lastStats = TransferStats();
+        RequestHandle *handle = client.upload(apiToken, path);
+        QObject::connect(handle, &RequestHandle::failed, &app, [&](const QString &errorString, int) {
+            err << "Загрузка не удалась: " << errorString << Qt::endl;
+            exitCode = 1;
+            app.quit();
+        });
+        QObject::connect(handle, &RequestHandle::jsonReady, &app, [&](const QJsonObject &) {
+            passStats.append(lastStats);
+            out << QString("%1: отправлено %2 из %3 (%4%) за %5 с, способ %6")
+                       .arg(pass == 0 ? "новый файл" : "после правки", -13)
+                       .arg(QLocale::system().formattedDataSize(lastStats.wireBytes),
+                            QLocale::system().formattedDataSize(fileSize))
+                       .arg(lastStats.wireBytes * 100.0 / fileSize, 0, 'f', 1)
+                       .arg(lastStats.elapsedMs / 1000.0, 0, 'f', 2).arg(lastStats.encoding) << Qt::endl;
+            if (++pass == 2) {
+                if (lastStats.encoding != "delta") out << "Сервер не принимает загрузку по кускам - файл ушел целиком." << Qt::endl;
+                app.quit();
+                return;
+            }
+            // Правки разнесены по файлу: каждая задевает свои куски, а не соседние
+            QFile changed(path);
+            if (!changed.open(QIODevice::ReadWrite)) {
+                err << "Не удалось изменить " << path << ": " << changed.errorString() << Qt::endl;
+                exitCode = 1;
+                app.quit();
+                return;
+            }
+            const qint64 regionSize = changedBytes / kChangedRegions;
+            QByteArray patch(regionSize, Qt::Uninitialized);
+            for (int i = 0; i < kChangedRegions; ++i) {
+                random.fillRange(reinterpret_cast<quint32 *>(patch.data()), patch.size() / sizeof(quint32));
+                const qint64 offset = fileSize * (2 * i + 1) / (2 * kChangedRegions) - regionSize / 2;
+                if (!changed.seek(qMax<qint64>(0, offset)) || changed.write(patch) != patch.size()) {
+                    err << "Не удалось изменить " << path << ": " << changed.errorString() << Qt::endl;
+                    exitCode = 1;
+                    app.quit();
+                    return;
+                }
+            }
+            changed.close();
+            startPass();
+        });
+    };
+    client.login(user, password);
+    app.exec();
+    return exitCode;
+}
+
+// Проверка ограничения скорости (--rate-check): файл загружается и скачивается обратно при
+// общем лимите rate байт/с в обе стороны; итог - достигнутая скорость относительно лимита.
+// Скорость выше лимита больше чем на kRateTolerance - ошибка (ведро пропускает лишнее)
+int runRateCheck(QCoreApplication &app, QTextStream &out, QTextStream &err, const QString &serverUrl,
+                 const QString &user, const QString &password, qint64 fileSize, qint64 rate)
+{
+    const double kRateTolerance = 0.1;
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        err << "Не удалось создать временный каталог для файла." << Qt::endl;
+        return 1;
+    }
+    // Содержимое каждый раз новое: скачивание не должно попасть в кэш прошлого прогона
+    const QString path = QDir(dir.path()).filePath("rate_check.bin");
+    QFile file(path);
+    QByteArray data(fileSize, Qt::Uninitialized);
+    QRandomGenerator::global()->fillRange(reinterpret_cast<quint32 *>(data.data()), data.size() / sizeof(quint32));
+    if (!file.open(QIODevice::WriteOnly) || file.write(data) != data.size()) {
+        err << "Не удалось записать " << path << ": " << file.errorString() << Qt::endl;
+        return 1;
+    }
+    file.close();
+    out << QString("Загрузка и скачивание %1 на %2 с лимитом %3/с")
+               .arg(QLocale::system().formattedDataSize(fileSize), serverUrl, QLocale::system().formattedDataSize(rate))
+        << Qt::endl;
+
+    int exitCode = 0;
+    QString apiToken;
+    TransferStats lastStats;
+
+    ApiClient client(serverUrl);
+    client.bandwidthLimiter()->setGlobalLimit(BandwidthLimiter::Upload, rate);
+    client.bandwidthLimiter()->setGlobalLimit(BandwidthLimiter::Download, rate);
+    // Сжатие меняет число байт на проводе - сравнивать с лимитом нужно переданное как есть
+    client.setUploadCompression(Compression::Method::None);
+
+    const auto report = [&](const QString &name) {
+        const double achieved = lastStats.wireBytes * 1000.0 / qMax<qint64>(1, lastStats.elapsedMs);
+        const bool tooFast = achieved > rate * (1.0 + kRateTolerance);
+        out << QString("%1: %2 за %3 с, %4/с (%5% лимита)%6")
+                   .arg(name, -10).arg(QLocale::system().formattedDataSize(lastStats.wireBytes))
+                   .arg(lastStats.elapsedMs / 1000.0, 0, 'f', 2)
+                   .arg(QLocale::system().formattedDataSize(static_cast<qint64>(achieved)))
+                   .arg(achieved * 100.0 / rate, 0, 'f', 0)
+                   .arg(tooFast ? " - ВЫШЕ ЛИМИТА" : "") << Qt::endl;
+        if (tooFast) exitCode = 1;
+    };
+    const auto fail = [&](const QString &errorString) {
+        err << errorString << Qt::endl;
+        exitCode = 1;
+        app.quit();
+    };
+
+    QObject::connect(&client, &ApiClient::transferStats, &app, [&](const TransferStats &stats) { lastStats = stats; });
+    QObject::connect(&client, &ApiClient::loginFailed, &app, [&](const QString &errorString, int) {
+        fail("Вход не удался: " + errorString);
+    });
+    QObject::connect(&client, &ApiClient::loginSuccess, &app, [&](const QString &token, const QString &) {
+        apiToken = token;
+        lastStats = TransferStats();
+        RequestHandle *upload = client.upload(apiToken, path);
+        QObject::connect(upload, &RequestHandle::failed, &app, [&](const QString &errorString, int) {
+            fail("Загрузка не удалась: " + errorString);
+        });
+        QObject::connect(upload, &RequestHandle::jsonReady, &app, [&](const QJsonObject &response) {
+            report("загрузка");
+            const QString fileId = response.value("file_id").toString();
+            if (fileId.isEmpty()) {
+                fail("Сервер не вернул file_id загруженного файла.");
+                return;
+            }
+            lastStats = TransferStats();
+            RequestHandle *download = client.downloadFile(apiToken, fileId, "rate_check.bin");
+            QObject::connect(download, &RequestHandle::failed, &app, [&](const QString &errorString, int) {
+                fail("Скачивание не удалось: " + errorString);
+            });
+            QObject::connect(download, &RequestHandle::dataReady, &app, [&](const QByteArray &received, const QString &) {
+                report("скачивание");
+                if (lastStats.encoding == "cache") out << "Файл отдан из локального кэша - скорость не показательна." << Qt::endl;
+                if (received != data) fail("Скачанный файл не совпадает с загруженным.");
+                app.quit();
+            });
+        });
+    });
+    client.login(user, password);
+    app.exec();
+    return exitCode;
+}
+
+// Замер источника тела загрузки (--mapped-bench). Сначала локально: файл вычитывается порциями
+// по 64 КиБ (как их забирает QNetworkAccessManager) с хэшированием каждой порции - через QFile,
+// через отображение в память и через упреждающее чтение MappedFileDevice. Затем тот же файл
+// загружается на сервер с QFile и с MappedFileDevice (для файла пользователя - упреждающее чтение).
+// Только что записанный файл обычно в кэше ОС: для холодного чтения его нужно положить заранее (--mapped-file)
+int runMappedBench(QCoreApplication &app, QTextStream &out, QTextStream &err, const QString &serverUrl,
+                   const QString &user, const QString &password, qint64 fileSize, const QString &existingFile)
+{
+    const qint64 kPieceSize = 64 * 1024;
+    QTemporaryDir dir;
+    QString path = existingFile;
+    if (path.isEmpty()) {
+        if (!dir.isValid()) {
+            err << "Не удалось создать временный каталог для файла." << Qt::endl;
+            return 1;
+        }
+        path = QDir(dir.path()).filePath("mapped_bench.bin");
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            err << "Не удалось записать " << path << ": " << file.errorString() << Qt::endl;
+            return 1;
+        }
+        QRandomGenerator random(1);
+        QByteArray block(MappedFileDevice::kBlockSize, Qt::Uninitialized);
+        for (qint64 written = 0; written < fileSize; written += block.size()) {
+            random.fillRange(reinterpret_cast<quint32 *>(block.data()), block.size() / sizeof(quint32));
+            const qint64 size = qMin<qint64>(block.size(), fileSize - written);
+            if (file.write(block.constData(), size) != size) {
+                err << "Не удалось записать " << path << ": " << file.errorString() << Qt::endl;
+                return 1;
+            }
+        }
+    }
+    fileSize = QFileInfo(path).size();
+    out << QString("Файл %1 (%2)").arg(path, QLocale::system().formattedDataSize(fileSize)) << Qt::endl;
+
+    const auto rateText = [fileSize](qint64 elapsedMs) {
+        return QLocale::system().formattedDataSize(static_cast<qint64>(fileSize * 1000.0 / qMax<qint64>(1, elapsedMs))) + "/с";
+    };
+    int exitCode = 0;
+    const auto readAll = [&](const QString &name, QIODevice *device, const char *source) {
+        QElapsedTimer timer;
+        timer.start();
+        if (!device->open(QIODevice::ReadOnly)) {
+            err << name << ": не удалось открыть файл: " << device->errorString() << Qt::endl;
+            exitCode = 1;
+            return;
+        }
+        QByteArray piece(kPieceSize, Qt::Uninitialized);
+        QCryptographicHash hash(QCryptographicHash::Sha256);
+        qint64 total = 0;
+        for (qint64 got; (got = device->read(piece.data(), piece.size())) > 0;) {
+            hash.addData(QByteArrayView(piece.constData(), got));
+            total += got;
+        }
+        const qint64 elapsedMs = timer.elapsed();
+        const QString actual = source ? QString::fromLatin1(source) : QString::fromLatin1(qobject_cast<MappedFileDevice *>(device)->sourceName());
+        device->close();
+        out << QString("чтение, %1: %2 за %3 с, %4%5")
+                   .arg(name, -22).arg(QLocale::system().formattedDataSize(total))
+                   .arg(elapsedMs / 1000.0, 0, 'f', 2).arg(rateText(elapsedMs))
+                   .arg(actual == name ? QString() : QString(" (источник: %1)").arg(actual)) << Qt::endl;
+        if (total != fileSize) exitCode = 1;
+    };
+    {
+        QFile plain(path);
+        readAll("QFile", &plain, "QFile");
+        MappedFileDevice mapped(path);
+        readAll("mmap", &mapped, nullptr);
+        MappedFileDevice readAhead(path);
+        readAhead.setMappingAllowed(false);
+        readAll("read-ahead", &readAhead, nullptr);
+    }
+
+    // Загрузка: сжатие и куски выключены, чтобы тело шло из выбранного источника целиком
+    struct UploadPass { QString name; bool mapped; };
+    const QList<UploadPass> passes = {{"QFile", false}, {"MappedFileDevice", true}};
+    int current = 0;
+    QString apiToken;
+    TransferStats lastStats;
+    ApiClient client(serverUrl);
+    client.setUploadCompression(Compression::Method::None);
+    client.setDeltaUploads(false);
+    std::function<void()> startPass;
+    QObject::connect(&client, &ApiClient::transferStats, &app, [&](const TransferStats &stats) {
+        if (stats.direction == "upload") lastStats = stats;
+    });
+    QObject::connect(&client, &ApiClient::loginFailed, &app, [&](const QString &errorString, int) {
+        err << "Вход не удался: " << errorString << Qt::endl;
+        exitCode = 1;
+        app.quit();
+    });
+    QObject::connect(&client, &ApiClient::loginSuccess, &app, [&](const QString &token, const QString &) {
+        apiToken = token;
+        startPass();
+    });
+    startPass = [&]() {
+        client.setMappedUploads(passes[current].mapped);
+        lastStats = TransferStats();
+        RequestHandle *handle = client.upload(apiToken, path);
+        QObject::connect(handle, &RequestHandle::failed, &app, [&](const QString &errorString, int) {
+            err << "Загрузка не удалась: " << errorString << Qt::endl;
+            exitCode = 1;
+            app.quit();
+        });
+        QObject::connect(handle, &RequestHandle::jsonReady, &app, [&](const QJsonObject &) {
+            out << QString("загрузка, %1: %2 за %3 с, %4")
+                       .arg(passes[current].name, -20).arg(QLocale::system().formattedDataSize(lastStats.wireBytes))
+                       .arg(lastStats.elapsedMs / 1000.0, 0, 'f', 2).arg(rateText(lastStats.elapsedMs)) << Qt::endl;
+            if (++current < passes.count()) {
+                startPass();
+                return;
+            }
+            app.quit();
+        });
+    };
+    client.login(user, password);
+    app.exec();
+    return exitCode;
+}
+
+// Окна деталей при массовом скачивании (--preview-bench): count файлов-изображений скачиваются
+// разом, и для каждого открыто "окно" - получатель миниатюры своего файла через watchPreview.
+// Итог - время, задержка цикла событий и число вызовов обработчиков миниатюр в сравнении с
+// общей рассылкой previewReady, которую раньше фильтровало каждое окно
+int runPreviewBench(QCoreApplication &app, QTextStream &out, QTextStream &err, const QString &serverUrl,
+                    const QString &user, const QString &password, int count)
+{
+    QTemporaryDir dir;
+    if (!dir.isValid()) {
+        err << "Не удалось создать временный каталог для файлов." << Qt::endl;
+        return 1;
+    }
+    QStringList paths;
+    QRandomGenerator random(1);
+    for (int i = 0; i < count; ++i) {
+        QImage image(800, 600, QImage::Format_RGB32);
+        image.fill(QColor::fromRgb(random.generate()));
+        const QString path = QDir(dir.path()).filePath(QString("preview_bench_%1.png").arg(i + 1));
+        if (!image.save(path, "PNG")) {
+            err << "Не удалось записать " << path << Qt::endl;
+            return 1;
+        }
+        paths.append(path);
+    }
+    out << QString("Скачиваний и окон деталей: %1 (%2)").arg(count).arg(serverUrl) << Qt::endl;
+
+    int exitCode = 0;
+    QString apiToken;
+    QStringList fileIds;
+    int uploaded = 0;
+    int downloadsDone = 0;
+    int previewsDone = 0;
+    int callbacks = 0;
+    int broadcasts = 0;
+    QElapsedTimer timer;
+    EventLoopProbe probe;
+    QObject dialogs; // Родитель "окон": удаляются вместе, как при закрытии
+    ApiClient client(serverUrl);
+    client.downloadCache()->setBudget(0); // Скачивание должно идти по сети
+    PreviewService *previews = client.previewService();
+
+    const auto fail = [&](const QString &errorString) {
+        err << errorString << Qt::endl;
+        exitCode = 1;
+        app.quit();
+    };
+    const auto checkDone = [&]() {
+        if (downloadsDone < count || previewsDone < count) return;
+        probe.stop();
+        out << QString("Готово за %1 с, %2").arg(timer.elapsed() / 1000.0, 0, 'f', 2).arg(probe.describe()) << Qt::endl;
+        out << QString("Вызовов обработчиков миниатюр: %1 (при общей рассылке previewReady: %2)")
+                   .arg(callbacks).arg(static_cast<qint64>(broadcasts) * count) << Qt::endl;
+        app.quit();
+    };
+    const auto startDialogs = [&]() {
+        timer.start();
+        probe.start();
+        for (int i = 0; i < count; ++i) {
+            const QString fileId = fileIds.at(i);
+            const QString fileName = QFileInfo(paths.at(i)).fileName();
+            RequestHandle *download = client.downloadFile(apiToken, fileId, fileName);
+            QObject::connect(download, &RequestHandle::failed, &app, [&](const QString &errorString, int) {
+                fail("Скачивание не удалось: " + errorString);
+            });
+            QObject::connect(download, &RequestHandle::dataReady, &app, [&](const QByteArray &, const QString &) {
+                downloadsDone++;
+                checkDone();
+            });
+            QObject *dialog = new QObject(&dialogs);
+            previews->watchPreview(fileId, dialog, [&](const QImage &) {
+                callbacks++;
+                previewsDone++;
+                checkDone();
+            });
+            previews->requestPreview(apiToken, fileId, fileName, true);
+        }
+    };
+
+    QObject::connect(previews, &PreviewService::previewReady, &app, [&](const QString &, const QImage &) { broadcasts++; });
+    QObject::connect(previews, &PreviewService::previewUnavailable, &app, [&](const QString &fileId) {
+        err << "Миниатюра файла ID " << fileId << " недоступна." << Qt::endl;
+        previewsDone++;
+        checkDone();
+    });
+    QObject::connect(&client, &ApiClient::loginFailed, &app, [&](const QString &errorString, int) {
+        fail("Вход не удался: " + errorString);
+    });
+    QObject::connect(&client, &ApiClient::loginSuccess, &app, [&](const QString &token, const QString &) {
+        apiToken = token;
+        fileIds.resize(count);
+        for (int i = 0; i < count; ++i) {
+            RequestHandle *upload = client.upload(apiToken, paths.at(i));
+            QObject::connect(upload, &RequestHandle::failed, &app, [&](const QString &errorString, int) {
+                fail("Загрузка не удалась: " + errorString);
+            });
+            QObject::connect(upload, &RequestHandle::jsonReady, &app, [&, i](const QJsonObject &response) {
+                fileIds[i] = response.value("file_id").toString();
+                if (fileIds.at(i).isEmpty()) {
+                    fail("Сервер не вернул file_id загруженного файла.");
+                    return;
+                }
+                if (++uploaded == count) startDialogs();
+            });
+        }
+    });
+    client.login(user, password);
+    app.exec();
+    return exitCode;
+}
+
+// Профиль эмулятора сети: именованный (--netem) и поправки к нему отдельными параметрами
+struct NetemOptions {
+    QCommandLineOption profile{"netem", "Пропускать запросы через эмулятор сети с профилем (" + NetemProxy::Profile::names().join(", ") + ").", "profile"};
+    QCommandLineOption latency{"latency", "Задержка эмулятора в одну сторону, мс.", "ms"};
+    QCommandLineOption jitter{"jitter", "Разброс задержки эмулятора, +- мс.", "ms"};
+    QCommandLineOption bandwidth{"bandwidth", "Полоса эмулятора на соединение, КиБ/с (0 - без ограничения).", "kib"};
+    QCommandLineOption resetRate{"reset-rate", "Доля соединений, сбрасываемых посреди ответа, %.", "percent"};
+    QCommandLineOption truncateRate{"truncate-rate", "Доля соединений, закрываемых посреди ответа, %.", "percent"};
+    QCommandLineOption seed{"seed", "Зерно случайных сбоев эмулятора (одинаковое зерно - одинаковые сбои).", "n", "1"};
+
+    QList<QCommandLineOption> all() const { return {profile, latency, jitter, bandwidth, resetRate, truncateRate, seed}; }
+    bool isRequested(const QCommandLineParser &parser) const
+    {
+        for (const QCommandLineOption &option : all()) {
+            if (option.names() != seed.names() && parser.isSet(option)) return true;
+        }
+        return false;
+    }
+
+    bool read(const QCommandLineParser &parser, NetemProxy::Profile *result, QString *errorString) const
+    {
+        NetemProxy::Profile parsed;
+        if (parser.isSet(profile) && !NetemProxy::Profile::byName(parser.value(profile), &parsed)) {
+            *errorString = QString("Неизвестный профиль сети \"%1\". Есть: %2")
+                               .arg(parser.value(profile), NetemProxy::Profile::names().join(", "));
+            return false;
+        }
+        if (!parser.isSet(profile)) parsed.name = "custom";
+        if (parser.isSet(latency)) parsed.latencyMs = qMax(0, parser.value(latency).toInt());
+        if (parser.isSet(jitter)) parsed.jitterMs = qMax(0, parser.value(jitter).toInt());
+        if (parser.isSet(bandwidth)) parsed.bandwidthBytesPerSec = qMax<qint64>(0, parser.value(bandwidth).toLongLong()) * 1024;
+        if (parser.isSet(resetRate)) parsed.resetProbability = qBound(0.0, parser.value(resetRate).toDouble() / 100.0, 1.0);
+        if (parser.isSet(truncateRate)) parsed.truncateProbability = qBound(0.0, parser.value(truncateRate).toDouble() / 100.0, 1.0);
+        *result = parsed;
+        return true;
+    }
+};
+
+// Эмулятор сети в своем потоке (как и замена сервера); адрес клиентов переписывается на прокси
+NetemProxy *startProxy(QThread *thread, const NetemProxy::Profile &profile, const QString &upstreamUrl, quint32 seed,
+                       quint16 port, QString *proxiedUrl, QString *errorString)
+{
+    const QUrl upstream(upstreamUrl);
+    if (upstream.scheme() != "http") {
+        *errorString = "Эмулятор сети работает только с http:// (TLS не проходит через подмену адреса).";
+        return nullptr;
+    }
+    NetemProxy *proxy = new NetemProxy(profile, upstream.host(), static_cast<quint16>(upstream.port(80)), seed);
+    proxy->moveToThread(thread);
+    QObject::connect(thread, &QThread::finished, proxy, &QObject::deleteLater);
+    thread->start();
+    bool listening = false;
+    QMetaObject::invokeMethod(proxy, [proxy, port, &listening, proxiedUrl, upstreamUrl]() {
+        listening = proxy->listen(QHostAddress::LocalHost, port);
+        *proxiedUrl = proxy->proxiedUrl(upstreamUrl);
+    }, Qt::BlockingQueuedConnection);
+    if (!listening) {
+        *errorString = "Не удалось запустить эмулятор сети.";
+        return nullptr;
+    }
+    return proxy;
+}
+
+int runStandInOnly(QCoreApplication &app, quint16 port)
+{
+    QTextStream err(stderr);
+    StandInServer server;
+    if (!server.listen(QHostAddress::LocalHost, port)) {
+        err << "Не удалось запустить локальный сервер на порту " << port << Qt::endl;
+        return 1;
+    }
+    QTextStream(stdout) << "Локальный сервер: " << server.baseUrl() << " (Ctrl+C - выход)" << Qt::endl;
+    return app.exec();
+}
+
+int runProxyOnly(QCoreApplication &app, const NetemProxy::Profile &profile, const QString &upstreamUrl, quint32 seed, quint16 port)
+{
+    QTextStream err(stderr);
+    const QUrl upstream(upstreamUrl);
+    if (upstream.scheme() != "http") {
+        err << "Эмулятор сети работает только с http:// (TLS не проходит через подмену адреса)." << Qt::endl;
+        return 2;
+    }
+    NetemProxy proxy(profile, upstream.host(), static_cast<quint16>(upstream.port(80)), seed);
+    if (!proxy.listen(QHostAddress::LocalHost, port)) {
+        err << "Не удалось запустить эмулятор сети на порту " << port << Qt::endl;
+        return 1;
+    }
+    QTextStream(stdout) << "Эмулятор сети (" << profile.describe() << "): " << proxy.proxiedUrl(upstreamUrl)
+                        << " -> " << upstreamUrl << " (Ctrl+C - выход)" << Qt::endl;
+    return app.exec();
+}
+
+}
+
+bool isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--loadgen") == 0 || std::strcmp(argv[i], "--standin-server") == 0
+            || std::strcmp(argv[i], "--netem-proxy") == 0 || std::strcmp(argv[i], "--upload-bench") == 0
+            || std::strcmp(argv[i], "--delta-bench") == 0 || std::strcmp(argv[i], "--rate-check") == 0
+            || std::strcmp(argv[i], "--mapped-bench") == 0 || std::strcmp(argv[i], "--preview-bench") == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+int run(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    // Свое имя приложения: кэши и настройки виртуальных пользователей не смешиваются с GUI
+    QCoreApplication::setOrganizationName("FilesExchange");
+    QCoreApplication::setApplicationName("FilesExchangeLoadGen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Нагрузочная проверка API FilesExchange");
+    parser.addHelpOption();
+    QCommandLineOption loadgenOption("loadgen", "Запустить нагрузку.");
+    QCommandLineOption standInServerOption("standin-server", "Только запустить локальную замену сервера.");
+    QCommandLineOption netemProxyOption("netem-proxy", "Только запустить эмулятор сети перед --upstream.");
+    QCommandLineOption upstreamOption("upstream", "Сервер за эмулятором сети для --netem-proxy.", "url", "http://127.0.0.1:8080/api/");
+    QCommandLineOption portOption("port", "Порт для --standin-server и --netem-proxy (0 - любой свободный).", "n", "8080");
+    QCommandLineOption serverOption("server", "Адрес API.", "url", ApiClient::defaultBaseUrl());
+    QCommandLineOption standInOption("standin", "Нагружать локальную замену сервера в этом же процессе.");
+    QCommandLineOption usersOption("users", "Виртуальных пользователей (у каждого свой ApiClient с двумя пулами соединений "
+                                                 "на общем потоке передач; сотни - предел одного процесса, "
+                                                 "больше - несколько процессов).", "n", "10");
+    QCommandLineOption durationOption("duration", "Длительность прогона, с.", "s", "60");
+    QCommandLineOption rampOption("ramp-up", "За сколько секунд подключаются все пользователи.", "s", "10");
+    QCommandLineOption thinkOption("think-time", "Средняя пауза между операциями пользователя, мс.", "ms", "1000");
+    QCommandLineOption mixOption("mix", "Смесь операций (login, list, info, upload, download).", "weights",
+                                 "list=40,info=30,download=20,upload=8,login=2");
+    QCommandLineOption uploadSizeOption("upload-size", "Размер загружаемого файла, КиБ.", "kib", "256");
+    QCommandLineOption prefixOption("user-prefix", "Префикс имен пользователей (имя1, имя2, ...).", "name", "loaduser");
+    QCommandLineOption passwordOption("password", "Пароль пользователей (или переменная окружения FX_PASSWORD).", "password");
+    QCommandLineOption verboseOption("verbose", "Подробный журнал клиента.");
+    QCommandLineOption uploadBenchOption("upload-bench", "Вместо нагрузки сравнить загрузку мелких файлов по одному и пакетами.");
+    QCommandLineOption filesOption("files", "Файлов для --upload-bench.", "n", "10000");
+    QCommandLineOption fileSizeOption("file-size", "Размер файла для --upload-bench, КиБ.", "kib", "4");
+    QCommandLineOption concurrencyOption("concurrency", "Параллельных загрузок для --upload-bench.", "n",
+                                         QString::number(TransferQueue::kDefaultConcurrency));
+    QCommandLineOption deltaBenchOption("delta-bench", "Вместо нагрузки замерить повторную загрузку измененного большого файла.");
+    QCommandLineOption deltaSizeOption("delta-size", "Размер файла для --delta-bench, МиБ (не меньше 8).", "mib", "64");
+    QCommandLineOption deltaChangedOption("delta-changed", "Сколько изменить перед второй загрузкой, МиБ.", "mib", "4");
+    QCommandLineOption rateCheckOption("rate-check", "Вместо нагрузки проверить ограничение скорости загрузки и скачивания.");
+    QCommandLineOption limitRateOption("limit-rate", "Лимит скорости для --rate-check, КиБ/с.", "kbps", "256");
+    QCommandLineOption rateSizeOption("rate-size", "Размер файла для --rate-check, КиБ.", "kib", "2048");
+    QCommandLineOption mappedBenchOption("mapped-bench", "Вместо нагрузки сравнить источники тела загрузки (QFile, mmap, упреждающее чтение).");
+    QCommandLineOption mappedSizeOption("mapped-size", "Размер файла для --mapped-bench, МиБ (замена сервера принимает до 256).", "mib", "128");
+    QCommandLineOption mappedFileOption("mapped-file", "Готовый файл для --mapped-bench вместо нового (например, не из кэша ОС).", "path");
+    QCommandLineOption previewBenchOption("preview-bench", "Вместо нагрузки скачать файлы разом при открытом окне деталей на каждый.");
+    QCommandLineOption previewCountOption("preview-count", "Скачиваний и окон для --preview-bench.", "n", "50");
+    NetemOptions netemOptions;
+    parser.addOptions({loadgenOption, standInServerOption, netemProxyOption, upstreamOption, portOption, serverOption,
+                       standInOption, usersOption, durationOption, rampOption, thinkOption, mixOption, uploadSizeOption,
+                       prefixOption, passwordOption, verboseOption, uploadBenchOption, filesOption, fileSizeOption,
+                       concurrencyOption, deltaBenchOption, deltaSizeOption, deltaChangedOption,
+                       rateCheckOption, limitRateOption, rateSizeOption, mappedBenchOption, mappedSizeOption,
+                       mappedFileOption, previewBenchOption, previewCountOption});
+    parser.addOptions(netemOptions.all());
+    parser.process(app);
+
+    // Журнал каждого запроса сотен клиентов только мешает: по умолчанию предупреждения и ошибки
+    if (!parser.isSet(verboseOption)) QLoggingCategory::setFilterRules("default.debug=false");
+
+    if (parser.isSet(standInServerOption)) return runStandInOnly(app, parser.value(portOption).toUShort());
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    NetemProxy::Profile netemProfile;
+    QString netemError;
+    if (!netemOptions.read(parser, &netemProfile, &netemError)) {
+        err << netemError << Qt::endl;
+        return 2;
+    }
+    const quint32 netemSeed = parser.value(netemOptions.seed).toUInt();
+    if (parser.isSet(netemProxyOption)) {
+        return runProxyOnly(app, netemProfile, parser.value(upstreamOption), netemSeed, parser.value(portOption).toUShort());
+    }
+
+    LoadGenerator::Options options;
+    options.serverUrl = parser.value(serverOption);
+    options.userPrefix = parser.value(prefixOption);
+    options.password = parser.isSet(passwordOption) ? parser.value(passwordOption) : qEnvironmentVariable("FX_PASSWORD");
+    options.users = parser.value(usersOption).toInt();
+    options.durationSec = parser.value(durationOption).toInt();
+    options.rampUpSec = parser.value(rampOption).toInt();
+    options.thinkTimeMs = parser.value(thinkOption).toInt();
+    options.uploadSize = qMax<qint64>(1, parser.value(uploadSizeOption).toLongLong()) * 1024;
+    QString mixError;
+    if (!LoadGenerator::parseMix(parser.value(mixOption), &options, &mixError)) {
+        err << mixError << Qt::endl;
+        return 2;
+    }
+
+    // Замена сервера - в своем потоке: ее работа не должна попадать в задержки клиентов
+    QThread standInThread;
+    standInThread.setObjectName("StandInServer");
+    if (parser.isSet(standInOption)) {
+        StandInServer *server = new StandInServer;
+        server->moveToThread(&standInThread);
+        QObject::connect(&standInThread, &QThread::finished, server, &QObject::deleteLater);
+        standInThread.start();
+        bool listening = false;
+        QMetaObject::invokeMethod(server, [server, &listening, &options]() {
+            listening = server->listen();
+            options.serverUrl = server->baseUrl();
+        }, Qt::BlockingQueuedConnection);
+        if (!listening) {
+            standInThread.quit();
+            standInThread.wait();
+            err << "Не удалось запустить локальную замену сервера." << Qt::endl;
+            return 1;
+        }
+        if (options.password.isEmpty()) options.password = "loadgen";
+    }
+    if (options.password.isEmpty()) {
+        err << "Нужен пароль виртуальных пользователей (--password или FX_PASSWORD)." << Qt::endl;
+        return 2;
+    }
+
+    QThread netemThread;
+    netemThread.setObjectName("NetemProxy");
+    NetemProxy *proxy = nullptr;
+    if (netemOptions.isRequested(parser)) {
+        QString proxiedUrl;
+        proxy = startProxy(&netemThread, netemProfile, options.serverUrl, netemSeed, 0, &proxiedUrl, &netemError);
+        if (!proxy) {
+            netemThread.quit();
+            netemThread.wait();
+            standInThread.quit();
+            standInThread.wait();
+            err << netemError << Qt::endl;
+            return 2;
+        }
+        out << "Эмулятор сети: " << netemProfile.describe() << ", зерно " << netemSeed << Qt::endl;
+        options.serverUrl = proxiedUrl;
+    }
+
+    if (parser.isSet(uploadBenchOption)) {
+        const int exitCode = runUploadBench(app, out, err, options.serverUrl, options.userPrefix + "1", options.password,
+                                            qMax(1, parser.value(filesOption).toInt()),
+                                            qMax<qint64>(1, parser.value(fileSizeOption).toLongLong()) * 1024,
+                                            qMax(1, parser.value(concurrencyOption).toInt()));
+        netemThread.quit();
+        netemThread.wait();
+        standInThread.quit();
+        standInThread.wait();
+        return exitCode;
+    }
+
+    if (parser.isSet(deltaBenchOption)) {
+        // Меньшие файлы ApiClient отправляет целиком
+        const qint64 fileSize = qMax<qint64>(8, parser.value(deltaSizeOption).toLongLong()) * 1024 * 1024;
+        const qint64 changed = qBound<qint64>(1, parser.value(deltaChangedOption).toLongLong(), fileSize / (1024 * 1024)) * 1024 * 1024;
+        const int exitCode = runDeltaBench(app, out, err, options.serverUrl, options.userPrefix + "1", options.password,
+                                           fileSize, changed);
+        netemThread.quit();
+        netemThread.wait();
+        standInThread.quit();
+        standInThread.wait();
+        return exitCode;
+    }
+
+    if (parser.isSet(mappedBenchOption)) {
+        const int exitCode = runMappedBench(app, out, err, options.serverUrl, options.userPrefix + "1", options.password,
+                                            qMax<qint64>(1, parser.value(mappedSizeOption).toLongLong()) * 1024 * 1024,
+                                            parser.value(mappedFileOption));
+        netemThread.quit();
+        netemThread.wait();
+        standInThread.quit();
+        standInThread.wait();
+        return exitCode;
+    }
+
+    if (parser.isSet(previewBenchOption)) {
+        const int exitCode = runPreviewBench(app, out, err, options.serverUrl, options.userPrefix + "1", options.password,
+                                             qMax(1, parser.value(previewCountOption).toInt()));
+        netemThread.quit();
+        netemThread.wait();
+        standInThread.quit();
+        standInThread.wait();
+        return exitCode;
+    }
+
+    if (parser.isSet(rateCheckOption)) {
+        const int exitCode = runRateCheck(app, out, err, options.serverUrl, options.userPrefix + "1", options.password,
+                                          qMax<qint64>(1, parser.value(rateSizeOption).toLongLong()) * 1024,
+                                          qMax<qint64>(1, parser.value(limitRateOption).toLongLong()) * 1024);
+        netemThread.quit();
+        netemThread.wait();
+        standInThread.quit();
+        standInThread.wait();
+        return exitCode;
+    }
+
+    out << QString("Нагрузка на %1: %2 пользователей, %3 с (подключение за %4 с), пауза ~%5 мс")
+               .arg(options.serverUrl).arg(options.users).arg(options.durationSec)
+               .arg(options.rampUpSec).arg(options.thinkTimeMs) << Qt::endl;
+
+    int exitCode = 0;
+    {
+        LoadGenerator generator(options);
+        EventLoopProbe probe;
+        QObject::connect(&generator, &LoadGenerator::status, &app, [&out](const QString &text) {
+            out << text << Qt::endl;
+        });
+        QObject::connect(&generator, &LoadGenerator::finished, &app, [&](const LoadReport &report) {
+            probe.stop();
+            printReport(out, report);
+            out << "Клиенты: " << probe.describe() << Qt::endl;
+            if (proxy) {
+                NetemProxy::Stats stats;
+                QMetaObject::invokeMethod(proxy, [proxy, &stats]() { stats = proxy->stats(); }, Qt::BlockingQueuedConnection);
+                out << QString("Эмулятор сети: соединений %1, сброшено %2, оборвано %3, к серверу %4, к клиентам %5")
+                           .arg(stats.connections).arg(stats.resets).arg(stats.truncations)
+                           .arg(QLocale::system().formattedDataSize(stats.bytesUp))
+                           .arg(QLocale::system().formattedDataSize(stats.bytesDown)) << Qt::endl;
+            }
+            exitCode = report.totalSucceeded() > 0 ? 0 : 1;
+            app.quit();
+        });
+        generator.start();
+        probe.start();
+        app.exec();
+    }
+    netemThread.quit();
+    netemThread.wait();
+    standInThread.quit();
+    standInThread.wait();
+    return exitCode;
+}
+
+}
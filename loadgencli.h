@@ -0,0 +1,38 @@
+#ifndef LOADGENCLI_H
+#define LOADGENCLI_H
+
+// Режимы командной строки для проверки сервера под нагрузкой:
+//   FilesExchangePC --loadgen [--server <url> | --standin] [--users N] [--duration с] [--ramp-up с]
+//                   [--think-time мс] [--mix list=40,info=30,download=20,upload=8,login=2]
+//                   [--upload-size КиБ] [--user-prefix имя] [--password <пароль>]
+//                   [--netem профиль] [--latency мс] [--jitter мс] [--bandwidth КиБ/с]
+//                   [--reset-rate %] [--truncate-rate %] [--seed N]
+//   FilesExchangePC --standin-server [--port N]
+//   FilesExchangePC --netem-proxy [--upstream <url>] [--port N] [--netem профиль] ...
+//   FilesExchangePC --upload-bench [--server <url> | --standin] [--files N] [--file-size КиБ] [--concurrency N]
+//   FilesExchangePC --delta-bench [--server <url> | --standin] [--delta-size МиБ] [--delta-changed МиБ]
+//   FilesExchangePC --rate-check [--server <url> | --standin] [--limit-rate КиБ/с] [--rate-size КиБ]
+//   FilesExchangePC --mapped-bench [--server <url> | --standin] [--mapped-size МиБ] [--mapped-file <путь>]
+// --standin поднимает локальную замену сервера (StandInServer) в отдельном потоке этого же процесса,
+// --standin-server запускает только ее - для GUI и других клиентов при разработке.
+// --netem и поправки к профилю пускают нагрузку через эмулятор плохой сети (NetemProxy),
+// --netem-proxy запускает только его; GUI направляется на него через FX_SERVER.
+// --upload-bench вместо нагрузки загружает одни и те же мелкие файлы по одному и пакетами
+// (upload_batch.php) и сравнивает время и число запросов.
+// --loadgen и --upload-bench вместе с итогами печатают задержку цикла событий основного потока
+// за время прогона: передачи не должны его занимать.
+// --delta-bench загружает большой файл, меняет в нем несколько участков и загружает снова:
+// во втором проходе по кускам (chunk_*.php) должны уйти только измененные байты.
+// --rate-check загружает и скачивает файл с лимитом скорости (BandwidthLimiter) и сравнивает
+// достигнутую скорость с лимитом; превышение больше чем на 10% - код возврата 1.
+// --mapped-bench сравнивает источники тела загрузки: QFile, отображение в память и упреждающее
+// чтение MappedFileDevice - при локальном чтении и при загрузке на сервер.
+// Пароль виртуальных пользователей можно передать через FX_PASSWORD
+namespace LoadGenCli {
+
+bool isRequested(int argc, char *argv[]);
+int run(int argc, char *argv[]);
+
+}
+
+#endif // LOADGENCLI_H
@@ -0,0 +1,347 @@
+#include "loadgenerator.h"
+#include "apiclient.h"
+#include "requesthandle.h"
+#include "transferworker.h"
+
+#include <QDir>
+#include <QRandomGenerator>
+#include <QTemporaryFile>
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+double LoadReport::Operation::percentileMs(double fraction) const
+{
+    if (latencyUs.isEmpty()) return 0.0;
+    QList<qint64> sorted = latencyUs;
+    std::sort(sorted.begin(), sorted.end());
+    const int index = qBound(0, static_cast<int>(std::ceil(fraction * sorted.size())) - 1, static_cast<int>(sorted.size()) - 1);
+    return sorted.at(index) / 1000.0;
+}
+
+int LoadReport::totalSucceeded() const
+{
+    int total = 0;
+    for (const Operation &operation : operations) total += operation.succeeded;
+    return total;
+}
+
+int LoadReport::totalFailed() const
+{
+    int total = 0;
+    for (const Operation &operation : operations) total += operation.failed;
+    return total;
+}
+
+// Один виртуальный пользователь: свой ApiClient (на общем потоке передач) и не больше одной операции одновременно,
+// как у человека перед окном программы
+class VirtualUser : public QObject
+{
+public:
+    VirtualUser(LoadGenerator *generator, const QString &username, const QString &password, const QString &uploadPath);
+
+    void start();
+
+private:
+    LoadGenerator *generator;
+    ApiClient *client;
+    QString username;
+    QString password;
+    QString uploadPath;
+    QString token;
+    QList<FileInfo> files;
+    LoadGenerator::Operation current;
+    QElapsedTimer operationTimer;
+    bool busy;
+
+    void scheduleNext();
+    void runNext();
+    void begin(LoadGenerator::Operation operation);
+    void end(bool ok, qint64 bytes = 0);
+    void watch(RequestHandle *handle);
+};
+
+VirtualUser::VirtualUser(LoadGenerator *generator, const QString &username, const QString &password, const QString &uploadPath)
+    : QObject(generator),
+      generator(generator),
+      client(new ApiClient(generator->options.serverUrl, this, generator->transferWorker)),
+      username(username),
+      password(password),
+      uploadPath(uploadPath),
+      current(LoadGenerator::Login),
+      busy(false)
+{
+    // Каждый виртуальный пользователь - "чистый" клиент: локальная копия файла не подменяет скачивание
+    client->downloadCache()->setBudget(0);
+
+    connect(client, &ApiClient::loginSuccess, this, [this](const QString &newToken, const QString &) {
+        token = newToken;
+        end(true);
+    });
+    connect(client, &ApiClient::loginFailed, this, [this](const QString &errorString, int) {
+        qWarning() << "LoadGenerator:" << username << "не вошел:" << errorString;
+        end(false);
+    });
+    connect(client, &ApiClient::userFilesSuccess, this, [this](const QList<FileInfo> &list) {
+        files = list;
+        end(true);
+    });
+    connect(client, &ApiClient::userFilesFailed, this, [this](const QString &, int) { end(false); });
+}
+
+void VirtualUser::start()
+{
+    if (generator->stopping) return;
+    begin(LoadGenerator::Login);
+    client->login(username, password);
+}
+
+void VirtualUser::scheduleNext()
+{
+    if (generator->stopping) return;
+    QTimer::singleShot(generator->thinkTime(), this, [this]() { runNext(); });
+}
+
+void VirtualUser::runNext()
+{
+    if (generator->stopping || busy) return;
+    LoadGenerator::Operation operation = token.isEmpty() ? LoadGenerator::Login : generator->pickOperation();
+    // Детали и скачивание - по файлам из списка; пока списка нет, сначала запрашиваем его
+    if ((operation == LoadGenerator::Info || operation == LoadGenerator::Download) && files.isEmpty()) {
+        operation = LoadGenerator::List;
+    }
+    const FileInfo file = files.isEmpty() ? FileInfo() : files.at(QRandomGenerator::global()->bounded(files.size()));
+
+    begin(operation);
+    switch (operation) {
+    case LoadGenerator::Login:
+        client->login(username, password);
+        break;
+    case LoadGenerator::List:
+        client->getUserFiles(token);
+        break;
+    case LoadGenerator::Info: {
+        RequestHandle *handle = client->getFileInfo(token, file.fileUrl.section('/', -1));
+        watch(handle);
+        break;
+    }
+    case LoadGenerator::Upload: {
+        RequestHandle *handle = client->upload(token, uploadPath);
+        watch(handle);
+        break;
+    }
+    case LoadGenerator::Download: {
+        RequestHandle *handle = client->downloadFile(token, file.id, file.fileName);
+        watch(handle);
+        break;
+    }
+    case LoadGenerator::OperationCount:
+        end(false);
+        break;
+    }
+}
+
+void VirtualUser::begin(LoadGenerator::Operation operation)
+{
+    current = operation;
+    busy = true;
+    operationTimer.start();
+    generator->operationStarted();
+}
+
+void VirtualUser::end(bool ok, qint64 bytes)
+{
+    if (!busy) return;
+    busy = false;
+    generator->record(current, operationTimer.nsecsElapsed() / 1000, ok, bytes);
+    generator->operationFinished();
+    scheduleNext();
+}
+
+void VirtualUser::watch(RequestHandle *handle)
+{
+    const qint64 uploadBytes = current == LoadGenerator::Upload ? generator->options.uploadSize : 0;
+    connect(handle, &RequestHandle::jsonReady, this, [this, uploadBytes](const QJsonObject &) { end(true, uploadBytes); });
+    connect(handle, &RequestHandle::dataReady, this, [this](const QByteArray &data, const QString &) { end(true, data.size()); });
+    connect(handle, &RequestHandle::failed, this, [this](const QString &, int) { end(false); });
+}
+
+const char *LoadGenerator::operationName(Operation operation)
+{
+    switch (operation) {
+    case Login: return "login";
+    case List: return "list";
+    case Info: return "info";
+    case Upload: return "upload";
+    case Download: return "download";
+    case OperationCount: break;
+    }
+    return "?";
+}
+
+bool LoadGenerator::parseMix(const QString &text, Options *options, QString *errorString)
+{
+    int weights[OperationCount] = {};
+    for (const QString &item : text.split(',', Qt::SkipEmptyParts)) {
+        const QString name = item.section('=', 0, 0).trimmed();
+        bool ok = false;
+        const int weight = item.section('=', 1).trimmed().toInt(&ok);
+        int index = 0;
+        while (index < OperationCount && name != QLatin1String(operationName(static_cast<Operation>(index)))) ++index;
+        if (index == OperationCount || !ok || weight < 0) {
+            *errorString = QString("Неверный элемент смеси операций: \"%1\"").arg(item);
+            return false;
+        }
+        weights[index] = weight;
+    }
+    int total = 0;
+    for (int weight : weights) total += weight;
+    if (total == 0) {
+        *errorString = "В смеси операций нет ни одной операции с ненулевым весом.";
+        return false;
+    }
+    std::copy(std::begin(weights), std::end(weights), std::begin(options->weights));
+    return true;
+}
+
+LoadGenerator::LoadGenerator(const Options &options, QObject *parent)
+    : QObject(parent),
+      options(options),
+      transferWorker(new TransferWorker(this)),
+      uploadSource(nullptr),
+      totalWeight(0),
+      activeOperations(0),
+      stopping(false),
+      done(false)
+{
+    this->options.users = qMax(1, options.users);
+    for (int weight : this->options.weights) totalWeight += weight;
+    for (int i = 0; i < OperationCount; ++i) report.operations.append(LoadReport::Operation());
+    reportTimer.setInterval(kReportIntervalMs);
+    connect(&reportTimer, &QTimer::timeout, this, &LoadGenerator::reportStatus);
+}
+
+LoadGenerator::~LoadGenerator()
+{
+    // Обработчики в потоке передач ссылаются на клиентов: сначала поток, потом клиенты,
+    // и все это раньше, чем удалится файл для загрузок
+    transferWorker->stop();
+    qDeleteAll(users);
+    users.clear();
+}
+
+void LoadGenerator::start()
+{
+    if (options.weights[Upload] > 0) {
+        // Один файл на всех: содержимое случайное, чтобы сжатие и кэши не искажали объем
+        uploadSource = new QTemporaryFile(QDir::tempPath() + "/fx_loadgen_XXXXXX.bin", this);
+        if (uploadSource->open()) {
+            QByteArray block(64 * 1024, Qt::Uninitialized);
+            for (qint64 written = 0; written < options.uploadSize; written += block.size()) {
+                QRandomGenerator::global()->fillRange(reinterpret_cast<quint32 *>(block.data()), block.size() / int(sizeof(quint32)));
+                uploadSource->write(block.constData(), qMin<qint64>(block.size(), options.uploadSize - written));
+            }
+            uploadSource->close();
+        } else {
+            qWarning() << "LoadGenerator: Не удалось создать файл для загрузок:" << uploadSource->errorString();
+            options.weights[Upload] = 0;
+            totalWeight = 0;
+            for (int weight : options.weights) totalWeight += weight;
+        }
+    }
+
+    clock.start();
+    reportTimer.start();
+    // Равномерное подключение пользователей: сервер видит рост нагрузки, а не залп входов
+    const qint64 rampMs = qMax(0, options.rampUpSec) * 1000LL;
+    for (int i = 0; i < options.users; ++i) {
+        VirtualUser *user = new VirtualUser(this, options.userPrefix + QString::number(i + 1), options.password,
+                                            uploadSource ? uploadSource->fileName() : QString());
+        users.append(user);
+        QTimer::singleShot(static_cast<int>(rampMs * i / options.users), user, [this, user]() {
+            if (stopping) return;
+            report.usersStarted++;
+            user->start();
+        });
+    }
+    QTimer::singleShot(qMax(1, options.durationSec) * 1000, this, &LoadGenerator::stop);
+}
+
+LoadGenerator::Operation LoadGenerator::pickOperation() const
+{
+    if (totalWeight <= 0) return List;
+    int roll = QRandomGenerator::global()->bounded(totalWeight);
+    for (int i = 0; i < OperationCount; ++i) {
+        if (roll < options.weights[i]) return static_cast<Operation>(i);
+        roll -= options.weights[i];
+    }
+    return List;
+}
+
+int LoadGenerator::thinkTime() const
+{
+    if (options.thinkTimeMs <= 0) return 0;
+    // Экспоненциальные паузы: поток запросов как у множества независимых людей (пуассоновский)
+    const double uniform = QRandomGenerator::global()->generateDouble();
+    return static_cast<int>(qMin(-std::log(1.0 - uniform) * options.thinkTimeMs, 10.0 * options.thinkTimeMs));
+}
+
+void LoadGenerator::record(Operation operation, qint64 latencyUs, bool ok, qint64 bytes)
+{
+    LoadReport::Operation &stats = report.operations[operation];
+    if (ok) {
+        stats.succeeded++;
+        stats.bytes += bytes;
+        stats.latencyUs.append(latencyUs);
+    } else {
+        stats.failed++;
+    }
+}
+
+void LoadGenerator::operationStarted()
+{
+    activeOperations++;
+}
+
+void LoadGenerator::operationFinished()
+{
+    activeOperations--;
+    if (stopping && activeOperations == 0) finish();
+}
+
+void LoadGenerator::stop()
+{
+    if (stopping) return;
+    stopping = true;
+    report.elapsedMs = clock.elapsed();
+    qDebug() << "LoadGenerator: Время прогона вышло, ждем" << activeOperations << "операций.";
+    if (activeOperations == 0) {
+        finish();
+        return;
+    }
+    QTimer::singleShot(kDrainTimeoutMs, this, [this]() {
+        if (done) return;
+        qWarning() << "LoadGenerator:" << activeOperations << "операций не завершились за" << kDrainTimeoutMs << "мс.";
+        finish();
+    });
+}
+
+void LoadGenerator::finish()
+{
+    if (done) return;
+    done = true;
+    reportTimer.stop();
+    // Пропускная способность считается по времени прогона, без ожидания хвоста
+    if (report.elapsedMs == 0) report.elapsedMs = clock.elapsed();
+    emit finished(report);
+}
+
+void LoadGenerator::reportStatus()
+{
+    const int completed = report.totalSucceeded() + report.totalFailed();
+    const double seconds = clock.elapsed() / 1000.0;
+    emit status(QString("[%1 с] пользователей: %2/%3, операций: %4 (%5/с), ошибок: %6, выполняется: %7")
+                    .arg(seconds, 0, 'f', 0).arg(report.usersStarted).arg(options.users)
+                    .arg(completed).arg(seconds > 0 ? completed / seconds : 0.0, 0, 'f', 1)
+                    .arg(report.totalFailed()).arg(activeOperations));
+}
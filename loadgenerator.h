@@ -0,0 +1,101 @@
+#ifndef LOADGENERATOR_H
+#define LOADGENERATOR_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QList>
+#include <QMetaType>
+#include <QString>
+#include <QTimer>
+
+class QTemporaryFile;
+class TransferWorker;
+class VirtualUser;
+
+// Итог нагрузочного прогона по операциям
+struct LoadReport {
+    struct Operation {
+        int succeeded = 0;
+        int failed = 0;
+        qint64 bytes = 0;        // Полезные байты (тела загрузок и скачиваний)
+        QList<qint64> latencyUs; // Задержки успешных операций
+        double percentileMs(double fraction) const; // fraction: 0.5, 0.9, 0.99
+    };
+
+    int usersStarted = 0;
+    qint64 elapsedMs = 0;
+    QList<Operation> operations; // По индексу LoadGenerator::Operation
+
+    int totalSucceeded() const;
+    int totalFailed() const;
+};
+Q_DECLARE_METATYPE(LoadReport)
+
+// Нагрузка на API от множества виртуальных пользователей (--loadgen).
+// Каждый пользователь - отдельный ApiClient (свой пул соединений, как у настоящего клиента),
+// но поток передач у всех один (TransferWorker): сотни потоков в одном процессе мерили бы
+// планировщик ОС, а не сервер. Миниатюры и кэши окон виртуальным пользователям не создаются.
+// входит в систему и дальше выполняет операции по заданной смеси с паузами "на раздумье"
+// (экспоненциальное распределение со средним thinkTimeMs). Пользователи подключаются равномерно
+// в течение rampUpSec; через durationSec новые операции не начинаются, идущие дожидаются
+class LoadGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Operation { Login, List, Info, Upload, Download, OperationCount };
+
+    struct Options {
+        QString serverUrl;
+        QString userPrefix = "loaduser"; // Имена: loaduser1, loaduser2, ...
+        QString password;
+        int users = 10;
+        int durationSec = 60;
+        int rampUpSec = 10;
+        int thinkTimeMs = 1000;
+        qint64 uploadSize = 256 * 1024;
+        int weights[OperationCount] = { 2, 40, 30, 8, 20 }; // Доли операций после входа
+    };
+
+    static const int kDrainTimeoutMs = 30000; // Сколько ждать идущие операции после окончания прогона
+    static const int kReportIntervalMs = 5000;
+
+    static const char *operationName(Operation operation);
+    // "list=40,info=30,download=20,upload=8,login=2"; неуказанные операции получают вес 0
+    static bool parseMix(const QString &text, Options *options, QString *errorString);
+
+    explicit LoadGenerator(const Options &options, QObject *parent = nullptr);
+    ~LoadGenerator();
+
+    void start();
+
+signals:
+    void status(const QString &text); // Промежуточная сводка раз в kReportIntervalMs
+    void finished(const LoadReport &report);
+
+private:
+    friend class VirtualUser;
+
+    Options options;
+    QList<VirtualUser *> users;
+    TransferWorker *transferWorker; // Общий поток передач всех клиентов
+    QTemporaryFile *uploadSource;
+    LoadReport report;
+    QElapsedTimer clock;
+    QTimer reportTimer;
+    int totalWeight;
+    int activeOperations;
+    bool stopping;
+    bool done;
+
+    Operation pickOperation() const;
+    int thinkTime() const;
+    void record(Operation operation, qint64 latencyUs, bool ok, qint64 bytes);
+    void operationStarted();
+    void operationFinished();
+    void stop();
+    void finish();
+    void reportStatus();
+};
+
+#endif // LOADGENERATOR_H
@@ -1,11 +1,30 @@
 #include "filesexchange.h"
+#include "synccli.h"
+#include "loadgencli.h"
+#include "tracer.h"
 
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    // FX_TRACE=<файл.json> - запись временной шкалы запросов и работы интерфейса
+    Tracer::startFromEnvironment();
+
+    // Режимы командной строки работают без окон (и без дисплея)
+    if (SyncCli::isRequested(argc, argv) || LoadGenCli::isRequested(argc, argv)) {
+        const int exitCode = SyncCli::isRequested(argc, argv) ? SyncCli::run(argc, argv) : LoadGenCli::run(argc, argv);
+        Tracer::finish();
+        return exitCode;
+    }
+
     QApplication a(argc, argv);
+    // Имена нужны QSettings и QStandardPaths (настройки передач, кэши)
+    QCoreApplication::setOrganizationName("FilesExchange");
+    QCoreApplication::setApplicationName("FilesExchangePC");
     FileseXchange w;
-    w.show();
-    return a.exec();
+    // Сохраненная сессия открывает рабочее окно сразу, без формы входа
+    if (!w.resumeSavedSession()) w.show();
+    const int exitCode = a.exec();
+    Tracer::finish();
+    return exitCode;
 }
@@ -0,0 +1,250 @@
+#include "mappedfiledevice.h"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QThread>
+#include <cstring>
+
+MappedFileDevice::MappedFileDevice(const QString &filePath, QObject *parent)
+    : QIODevice(parent),
+      file(filePath),
+      mapping(nullptr),
+      mappingAllowed(true),
+      fileSize(0),
+      hashedUpTo(0),
+      reader(nullptr),
+      streamPos(-1),
+      headOffset(0),
+      stopReading(false),
+      readDone(false)
+{
+}
+
+MappedFileDevice::~MappedFileDevice()
+{
+    close();
+}
+
+void MappedFileDevice::setMappingAllowed(bool allowed)
+{
+    mappingAllowed = allowed;
+}
+
+bool MappedFileDevice::open(OpenMode mode)
+{
+    if (mode & QIODevice::WriteOnly) {
+        qWarning() << "MappedFileDevice: Поддерживается только чтение.";
+        return false;
+    }
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        setErrorString(file.errorString());
+        return false;
+    }
+    fileSize = file.size();
+    if (fileSize > 0 && mappingAllowed) {
+        mapping = file.map(0, fileSize);
+        if (!mapping) {
+            qDebug() << "MappedFileDevice: Не удалось отобразить" << file.fileName()
+                     << "в память (" << file.errorString() << "), используется упреждающее чтение.";
+        }
+    }
+    if (!mapping) startReader(0);
+    // Unbuffered: данные копируются из отображения сразу в буфер вызывающего
+    return QIODevice::open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+void MappedFileDevice::close()
+{
+    if (!isOpen()) return;
+    stopReader();
+    if (mapping) {
+        file.unmap(mapping);
+        mapping = nullptr;
+    }
+    file.close();
+    QIODevice::close();
+}
+
+bool MappedFileDevice::isSequential() const
+{
+    return false;
+}
+
+qint64 MappedFileDevice::size() const
+{
+    return fileSize; // Точный размер: multipart не нужно буферизовать тело
+}
+
+bool MappedFileDevice::seek(qint64 pos)
+{
+    if (pos < 0 || pos > fileSize) return false;
+    // Поток чтения перезапускается в readData, если следующее чтение начнется не там, где он остановился
+    return QIODevice::seek(pos);
+}
+
+bool MappedFileDevice::atEnd() const
+{
+    return pos() >= fileSize;
+}
+
+QString MappedFileDevice::filePath() const
+{
+    return file.fileName();
+}
+
+bool MappedFileDevice::isMapped() const
+{
+    return mapping != nullptr;
+}
+
+const char *MappedFileDevice::sourceName() const
+{
+    return mapping ? "mmap" : "read-ahead";
+}
+
+QString MappedFileDevice::fileErrorString() const
+{
+    return file.errorString();
+}
+
+void MappedFileDevice::enableHashing(QCryptographicHash::Algorithm algorithm)
+{
+    hash.reset(new QCryptographicHash(algorithm));
+    hashedUpTo = 0;
+}
+
+bool MappedFileDevice::isHashComplete() const
+{
+    return hash && hashedUpTo == fileSize;
+}
+
+QByteArray MappedFileDevice::hashResult() const
+{
+    return isHashComplete() ? hash->result() : QByteArray();
+}
+
+qint64 MappedFileDevice::readData(char *data, qint64 maxSize)
+{
+    const qint64 position = pos();
+    const qint64 toRead = qMin(maxSize, fileSize - position);
+    if (toRead <= 0) return 0;
+
+    if (mapping) {
+        std::memcpy(data, mapping + position, static_cast<size_t>(toRead));
+        if (hash && position == hashedUpTo) {
+            hash->addData(QByteArrayView(data, toRead));
+            hashedUpTo += toRead;
+        }
+        return toRead;
+    }
+
+    // Чтение не с того места, где остановился поток (seek назад при повторной отправке) -
+    // очередь устарела, поток начинает заново с нужного блока
+    QMutexLocker locker(&readMutex);
+    if (position != streamPos) {
+        locker.unlock();
+        startReader(position);
+        locker.relock();
+    }
+    qint64 total = 0;
+    while (total < toRead) {
+        if (blocks.isEmpty()) {
+            if (readDone) break;
+            readCondition.wait(&readMutex);
+            continue;
+        }
+        const QByteArray &head = blocks.head();
+        const qint64 count = qMin(toRead - total, head.size() - headOffset);
+        if (count <= 0) break; // Первый блок короче начальной позиции: файл укоротили
+        std::memcpy(data + total, head.constData() + headOffset, static_cast<size_t>(count));
+        total += count;
+        headOffset += count;
+        streamPos += count;
+        if (headOffset == head.size()) {
+            blocks.dequeue();
+            headOffset = 0;
+            readCondition.wakeAll(); // Место в очереди освободилось
+        }
+    }
+    if (total < toRead && readDone) {
+        // Ошибка чтения или файл укоротили во время отправки: тело уже не совпадет с объявленным размером
+        setErrorString(readError.isEmpty() ? QString("Файл %1 изменился во время отправки.").arg(file.fileName()) : readError);
+        if (total == 0) return -1;
+    }
+    locker.unlock();
+
+    if (hash && position == hashedUpTo && total > 0) {
+        hash->addData(QByteArrayView(data, total));
+        hashedUpTo += total;
+    }
+    return total;
+}
+
+void MappedFileDevice::startReader(qint64 from)
+{
+    stopReader();
+    const qint64 alignedFrom = from - from % kBlockSize;
+    {
+        QMutexLocker locker(&readMutex);
+        blocks.clear();
+        streamPos = from;
+        headOffset = from - alignedFrom;
+        stopReading = false;
+        readDone = false;
+        readError.clear();
+    }
+    reader = QThread::create([this, alignedFrom]() { readBlocks(alignedFrom); });
+    reader->setObjectName("MappedFileDevice reader");
+    reader->start();
+}
+
+void MappedFileDevice::stopReader()
+{
+    if (!reader) return;
+    {
+        QMutexLocker locker(&readMutex);
+        stopReading = true;
+        readCondition.wakeAll();
+    }
+    reader->wait();
+    delete reader;
+    reader = nullptr;
+}
+
+// Выполняется в потоке reader: свой дескриптор файла, блоки по kBlockSize от выровненной позиции
+void MappedFileDevice::readBlocks(qint64 alignedFrom)
+{
+    QFile source(file.fileName());
+    QString error;
+    if (!source.open(QIODevice::ReadOnly | QIODevice::Unbuffered) || !source.seek(alignedFrom)) error = source.errorString();
+    for (qint64 offset = alignedFrom; error.isEmpty() && offset < fileSize; offset += kBlockSize) {
+        {
+            QMutexLocker locker(&readMutex);
+            while (blocks.size() >= kReadAheadBlocks && !stopReading) readCondition.wait(&readMutex);
+            if (stopReading) return;
+        }
+        QByteArray block(qMin(kBlockSize, fileSize - offset), Qt::Uninitialized);
+        const qint64 got = source.read(block.data(), block.size());
+        if (got < 0) {
+            error = source.errorString();
+            break;
+        }
+        if (got == 0) break; // Файл укоротили - readData сообщит об ошибке
+        block.truncate(got);
+        QMutexLocker locker(&readMutex);
+        blocks.enqueue(block);
+        readCondition.wakeAll();
+        if (got < kBlockSize && offset + got < fileSize) break;
+    }
+    QMutexLocker locker(&readMutex);
+    readDone = true;
+    readError = error;
+    readCondition.wakeAll();
+}
+
+qint64 MappedFileDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
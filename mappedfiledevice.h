@@ -0,0 +1,81 @@
+#ifndef MAPPEDFILEDEVICE_H
+#define MAPPEDFILEDEVICE_H
+
+#include <QIODevice>
+#include <QFile>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+#include <QWaitCondition>
+#include <QCryptographicHash>
+#include <memory>
+
+class QThread;
+
+// Устройство-источник тела загрузки: файл отображается в память целиком,
+// а чтения отдаются напрямую из отображения без буфера QIODevice.
+// Если отображать нельзя или не удалось (сетевая ФС, нехватка адресного пространства),
+// файл читает фоновый поток крупными выровненными блоками с упреждением: готовые блоки
+// ждут в ограниченной очереди (kReadAheadBlocks), и отправка не стоит на чтении диска.
+// Отображать можно только файлы, которые приложение создало само (временные сжатые тела):
+// если другой процесс укоротит отображенный файл, чтение за новым концом убивает процесс
+// сигналом SIGBUS. Файлы пользователя читаются с упреждением (setMappingAllowed(false)).
+class MappedFileDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    static const qint64 kBlockSize = 1024 * 1024; // Блок упреждающего чтения (кратен размеру страницы)
+    static const int kReadAheadBlocks = 8;        // Не больше 8 МиБ прочитанного впрок на загрузку
+
+    explicit MappedFileDevice(const QString &filePath, QObject *parent = nullptr);
+    ~MappedFileDevice();
+
+    void setMappingAllowed(bool allowed); // До open(); по умолчанию разрешено
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+    bool atEnd() const override;
+
+    QString filePath() const;
+    bool isMapped() const;
+    const char *sourceName() const; // "mmap" или "read-ahead" - для журнала, после open()
+    QString fileErrorString() const;
+
+    // Хэш считается по ходу отправки: учитываются только последовательные чтения,
+    // повторные чтения после seek() назад (повторная отправка) не искажают результат
+    void enableHashing(QCryptographicHash::Algorithm algorithm);
+    bool isHashComplete() const;
+    QByteArray hashResult() const;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QFile file;
+    uchar *mapping;
+    bool mappingAllowed;
+    qint64 fileSize;
+    std::unique_ptr<QCryptographicHash> hash;
+    qint64 hashedUpTo;
+
+    // Упреждающее чтение: поток reader пополняет blocks, readData забирает из головы очереди
+    QThread *reader;
+    QMutex readMutex;
+    QWaitCondition readCondition;
+    QQueue<QByteArray> blocks;
+    qint64 streamPos;   // Позиция в файле, с которой начинаются непрочитанные данные очереди
+    qint64 headOffset;  // Сколько байт головного блока уже отдано
+    bool stopReading;
+    bool readDone;
+    QString readError;
+
+    void startReader(qint64 from);
+    void stopReader();
+    void readBlocks(qint64 alignedFrom);
+};
+
+#endif // MAPPEDFILEDEVICE_H
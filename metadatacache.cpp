@@ -0,0 +1,190 @@
+#include "metadatacache.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <QHash>
+#include <QMutex>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
+
+namespace {
+
+const quint32 kCacheMagic = 0x46584D43; // "FXMC"
+const quint16 kCacheVersion = 1;
+const qint64 kMinRecordSize = 4; // Длина одной QString - меньше записи не бывает
+
+QDataStream &operator<<(QDataStream &out, const FileInfo &file)
+{
+    out << file.id << file.fileName << file.ownerName << file.fileSize
+        << file.fileUrl << file.uploadDate << file.countViews;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, FileInfo &file)
+{
+    in >> file.id >> file.fileName >> file.ownerName >> file.fileSize
+       >> file.fileUrl >> file.uploadDate >> file.countViews;
+    return in;
+}
+
+QDataStream &operator<<(QDataStream &out, const UserData &user)
+{
+    out << user.id << user.username;
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, UserData &user)
+{
+    in >> user.id >> user.username;
+    return in;
+}
+
+template <typename T>
+bool readList(const QString &path, QList<T> *items)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_0);
+    quint32 magic = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if (magic != kCacheMagic || version != kCacheVersion) {
+        qDebug() << "MetadataCache: Устаревший или поврежденный кэш, игнорируем:" << path;
+        return false;
+    }
+    quint32 count = 0;
+    in >> count;
+    // Счетчик из файла еще не проверен: больше записей, чем помещается в остаток файла, быть не может
+    if (in.status() != QDataStream::Ok || count > file.bytesAvailable() / kMinRecordSize) {
+        qWarning() << "MetadataCache: Поврежденный кэш (записей" << count << "), игнорируем:" << path;
+        return false;
+    }
+    QList<T> result;
+    result.reserve(count);
+    for (quint32 i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        T item;
+        in >> item;
+        result.append(item);
+    }
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "MetadataCache: Ошибка чтения кэша:" << path;
+        return false;
+    }
+    *items = result;
+    return true;
+}
+
+// Все записи кэша идут через один поток: задачи выполняются в порядке постановки,
+// и старый список не может лечь на диск поверх более нового
+QThreadPool *writerPool()
+{
+    static QThreadPool *pool = [] {
+        auto *p = new QThreadPool;
+        p->setMaxThreadCount(1);
+        return p;
+    }();
+    return pool;
+}
+
+// Номер последней поставленной записи для каждого файла: устаревшие записи из очереди пропускаются
+QMutex writeSequenceMutex;
+QHash<QString, quint64> writeSequence;
+
+template <typename T>
+void writeList(const QString &path, const QList<T> &items)
+{
+    quint64 sequence = 0;
+    {
+        QMutexLocker locker(&writeSequenceMutex);
+        sequence = ++writeSequence[path];
+    }
+    // Запись в фоне через QSaveFile: окно не ждет диска, а кэш не бывает наполовину записан
+    (void)QtConcurrent::run(writerPool(), [path, items, sequence]() {
+        {
+            QMutexLocker locker(&writeSequenceMutex);
+            if (writeSequence.value(path) != sequence) return; // Уже поставлен более новый список
+        }
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QSaveFile file(path);
+        if (!file.open(QIODevice::WriteOnly)) {
+            qWarning() << "MetadataCache: Не удалось открыть кэш для записи:" << path << file.errorString();
+            return;
+        }
+        QDataStream out(&file);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << kCacheMagic << kCacheVersion << static_cast<quint32>(items.size());
+        for (const T &item : items) out << item;
+        if (!file.commit()) {
+            qWarning() << "MetadataCache: Не удалось сохранить кэш:" << path << file.errorString();
+        }
+    });
+}
+
+}
+
+MetadataCache::MetadataCache()
+{
+}
+
+void MetadataCache::setScope(const QString &serverUrl, const QString &username)
+{
+    // Имя каталога - хэш, чтобы не тащить URL и логин в путь файловой системы
+    QByteArray key = QCryptographicHash::hash((serverUrl + '\n' + username).toUtf8(), QCryptographicHash::Sha1).toHex();
+    scopeDir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/metadata/" + QString::fromLatin1(key);
+}
+
+bool MetadataCache::hasScope() const
+{
+    return !scopeDir.isEmpty();
+}
+
+void MetadataCache::clearScope()
+{
+    scopeDir.clear();
+}
+
+QString MetadataCache::filePath(const QString &name) const
+{
+    return scopeDir + "/" + name;
+}
+
+bool MetadataCache::loadFiles(QList<FileInfo> *files) const
+{
+    if (!hasScope()) return false;
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = readList(filePath("files.bin"), files);
+    if (ok) qDebug() << "MetadataCache: Загружено" << files->count() << "файлов из кэша за" << timer.elapsed() << "мс";
+    return ok;
+}
+
+void MetadataCache::saveFiles(const QList<FileInfo> &files) const
+{
+    if (!hasScope()) return;
+    writeList(filePath("files.bin"), files);
+}
+
+bool MetadataCache::loadUsers(QList<UserData> *users) const
+{
+    if (!hasScope()) return false;
+    QElapsedTimer timer;
+    timer.start();
+    bool ok = readList(filePath("users.bin"), users);
+    if (ok) qDebug() << "MetadataCache: Загружено" << users->count() << "пользователей из кэша за" << timer.elapsed() << "мс";
+    return ok;
+}
+
+void MetadataCache::saveUsers(const QList<UserData> &users) const
+{
+    if (!hasScope()) return;
+    writeList(filePath("users.bin"), users);
+}
@@ -0,0 +1,32 @@
+#ifndef METADATACACHE_H
+#define METADATACACHE_H
+
+#include <QString>
+#include <QList>
+#include "datatypes.h"
+
+// Локальный кэш метаданных (списки файлов и пользователей) для мгновенного старта окна.
+// Хранится в компактном бинарном формате QDataStream, отдельно для каждой пары сервер+пользователь
+class MetadataCache
+{
+public:
+    MetadataCache();
+
+    // Область кэша: сервер и пользователь. Без области кэш ничего не читает и не пишет
+    void setScope(const QString &serverUrl, const QString &username);
+    bool hasScope() const;
+    void clearScope();
+
+    bool loadFiles(QList<FileInfo> *files) const;
+    void saveFiles(const QList<FileInfo> &files) const;
+
+    bool loadUsers(QList<UserData> *users) const;
+    void saveUsers(const QList<UserData> &users) const;
+
+private:
+    QString scopeDir;
+
+    QString filePath(const QString &name) const;
+};
+
+#endif // METADATACACHE_H
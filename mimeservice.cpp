@@ -0,0 +1,115 @@
+#include "mimeservice.h"
+
+#include <QMimeDatabase>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QCryptographicHash>
+#include <QElapsedTimer>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+
+namespace {
+
+// Кэш по сигнатурам ограничен: при переполнении просто начинается заново
+const int kMaxCachedPrefixes = 4096;
+
+struct SuffixEntry {
+    QString byName;  // Тип только по имени
+    bool ambiguous;  // Имя подходит под несколько типов или ни под один - нужно смотреть содержимое
+};
+
+struct MimeCache {
+    QMutex mutex;
+    bool warmUpStarted = false;
+    QHash<QString, SuffixEntry> bySuffix;
+    QHash<QByteArray, QString> byPrefix; // Ключ расширения + SHA-1 начала файла -> тип
+};
+
+MimeCache &cache()
+{
+    static MimeCache instance;
+    return instance;
+}
+
+// Ключ кэша по имени: последние два расширения (".tar.gz", ".txt") или имя целиком, если точки нет
+// (Makefile, README - в базе есть шаблоны на полные имена)
+QString nameKey(const QString &fileName)
+{
+    const QString name = QFileInfo(fileName).fileName().toLower();
+    const int last = name.lastIndexOf('.');
+    if (last <= 0) return name;
+    const int previous = name.lastIndexOf('.', last - 1);
+    return name.mid(previous > 0 ? previous : last);
+}
+
+SuffixEntry suffixEntry(const QString &fileName)
+{
+    const QString key = nameKey(fileName);
+    MimeCache &c = cache();
+    {
+        QMutexLocker locker(&c.mutex);
+        auto it = c.bySuffix.constFind(key);
+        if (it != c.bySuffix.constEnd()) return it.value();
+    }
+    QMimeDatabase db;
+    SuffixEntry entry;
+    entry.byName = db.mimeTypeForFile(fileName, QMimeDatabase::MatchExtension).name();
+    entry.ambiguous = db.mimeTypesForFileName(fileName).size() != 1;
+    QMutexLocker locker(&c.mutex);
+    c.bySuffix.insert(key, entry);
+    return entry;
+}
+
+}
+
+void MimeService::warmUp()
+{
+    MimeCache &c = cache();
+    {
+        QMutexLocker locker(&c.mutex);
+        if (c.warmUpStarted) return;
+        c.warmUpStarted = true;
+    }
+    (void)QtConcurrent::run([]() {
+        QElapsedTimer timer;
+        timer.start();
+        QMimeDatabase db;
+        // Шаблоны имен и сигнатуры загружаются при первом обращении к каждому из них
+        db.mimeTypeForFileNameAndData("warmup.bin", QByteArray("\x89PNG\r\n\x1a\n", 8));
+        db.mimeTypeForName("text/plain").allAncestors();
+        qDebug() << "MimeService: База MIME-типов загружена за" << timer.elapsed() << "мс.";
+    });
+}
+
+QMimeType MimeService::mimeTypeForFileName(const QString &fileName)
+{
+    return QMimeDatabase().mimeTypeForName(suffixEntry(fileName).byName);
+}
+
+QMimeType MimeService::mimeTypeForFile(const QString &filePath)
+{
+    QMimeDatabase db;
+    const SuffixEntry entry = suffixEntry(filePath);
+    if (!entry.ambiguous) return db.mimeTypeForName(entry.byName);
+
+    // Расширение ничего не решает - смотрим на начало файла
+    QFile file(filePath);
+    if (!file.open(QIODevice::ReadOnly)) return db.mimeTypeForName(entry.byName);
+    const QByteArray prefix = file.read(kMagicPrefixSize);
+    file.close();
+
+    const QByteArray key = nameKey(filePath).toUtf8() + '\0' + QCryptographicHash::hash(prefix, QCryptographicHash::Sha1);
+    MimeCache &c = cache();
+    {
+        QMutexLocker locker(&c.mutex);
+        auto it = c.byPrefix.constFind(key);
+        if (it != c.byPrefix.constEnd()) return db.mimeTypeForName(it.value());
+    }
+    const QMimeType type = db.mimeTypeForFileNameAndData(filePath, prefix);
+    QMutexLocker locker(&c.mutex);
+    if (c.byPrefix.size() >= kMaxCachedPrefixes) c.byPrefix.clear();
+    c.byPrefix.insert(key, type.name());
+    return type;
+}
@@ -0,0 +1,29 @@
+#ifndef MIMESERVICE_H
+#define MIMESERVICE_H
+
+#include <QMimeType>
+#include <QString>
+
+// Общее определение MIME-типов для загрузок, эвристики сжатия и миниатюр.
+// Первое обращение к QMimeDatabase разбирает базу shared-mime-info - это делает warmUp() в фоне при старте.
+// Результаты кэшируются: однозначные расширения - по расширению, остальные - по расширению
+// и первым байтам файла (сигнатуре). Можно вызывать из любого потока
+class MimeService
+{
+public:
+    // Сколько байт начала файла читается для определения по содержимому (хватает сигнатурам
+    // распространенных форматов, включая tar с "ustar" на смещении 257)
+    static const int kMagicPrefixSize = 4096;
+
+    static void warmUp();
+
+    // По имени и, если расширение неоднозначно или неизвестно, по началу файла
+    static QMimeType mimeTypeForFile(const QString &filePath);
+    // Только по имени (файл на сервере, содержимого нет)
+    static QMimeType mimeTypeForFileName(const QString &fileName);
+
+private:
+    MimeService() = delete;
+};
+
+#endif // MIMESERVICE_H
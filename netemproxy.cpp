@@ -0,0 +1,306 @@
+#include "netemproxy.h"
+
+#include <QLocale>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+#include <QDebug>
+#include <limits>
+#ifdef Q_OS_WIN
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#endif
+
+namespace {
+
+struct NamedProfile {
+    const char *name;
+    int latencyMs;
+    int jitterMs;
+    qint64 bandwidthBytesPerSec;
+    double resetProbability;
+    double truncateProbability;
+};
+
+// Типичные условия из жалоб пользователей; параметры профиля можно переопределить по одному
+const NamedProfile kProfiles[] = {
+    { "clean",     0,   0,  0,           0.0,  0.0  },
+    { "lan",       1,   0,  0,           0.0,  0.0  },
+    { "dsl",       20,  5,  1000 * 1000, 0.0,  0.0  },
+    { "3g",        150, 50, 125 * 1000,  0.01, 0.0  },
+    { "satellite", 300, 30, 250 * 1000,  0.0,  0.01 },
+    { "lossy",     80,  60, 250 * 1000,  0.05, 0.05 },
+    { "flaky",     50,  20, 0,           0.15, 0.15 },
+};
+
+const qint64 kSocketReadBuffer = 256 * 1024;
+
+// Закрытие с SO_LINGER {1, 0}: ядро отправляет RST вместо FIN, и клиент видит именно сброс
+// (ECONNRESET), а не обычный конец данных
+void resetConnection(QTcpSocket *socket)
+{
+    socket->flush(); // Байты до точки сбоя должны успеть уйти в ядро
+    const qintptr descriptor = socket->socketDescriptor();
+    if (descriptor != -1) {
+        struct linger option;
+        option.l_onoff = 1;
+        option.l_linger = 0;
+#ifdef Q_OS_WIN
+        ::setsockopt(static_cast<SOCKET>(descriptor), SOL_SOCKET, SO_LINGER, reinterpret_cast<const char *>(&option), sizeof(option));
+#else
+        ::setsockopt(static_cast<int>(descriptor), SOL_SOCKET, SO_LINGER, &option, sizeof(option));
+#endif
+    }
+    socket->abort();
+}
+
+}
+
+QStringList NetemProxy::Profile::names()
+{
+    QStringList result;
+    for (const NamedProfile &named : kProfiles) result.append(QString::fromLatin1(named.name));
+    return result;
+}
+
+bool NetemProxy::Profile::byName(const QString &name, Profile *profile)
+{
+    for (const NamedProfile &named : kProfiles) {
+        if (name != QLatin1String(named.name)) continue;
+        profile->name = name;
+        profile->latencyMs = named.latencyMs;
+        profile->jitterMs = named.jitterMs;
+        profile->bandwidthBytesPerSec = named.bandwidthBytesPerSec;
+        profile->resetProbability = named.resetProbability;
+        profile->truncateProbability = named.truncateProbability;
+        return true;
+    }
+    return false;
+}
+
+QString NetemProxy::Profile::describe() const
+{
+    return QString("%1: задержка %2±%3 мс, полоса %4, сброс %5%, обрыв %6%")
+        .arg(name).arg(latencyMs).arg(jitterMs)
+        .arg(bandwidthBytesPerSec > 0 ? QLocale::system().formattedDataSize(bandwidthBytesPerSec) + "/с" : QString("без ограничения"))
+        .arg(resetProbability * 100, 0, 'g', 3).arg(truncateProbability * 100, 0, 'g', 3);
+}
+
+NetemProxy::NetemProxy(const Profile &profile, const QString &upstreamHost, quint16 upstreamPort, quint32 seed, QObject *parent)
+    : QObject(parent),
+      profile(profile),
+      upstreamHost(upstreamHost),
+      upstreamPort(upstreamPort),
+      random(seed),
+      tcpServer(new QTcpServer(this)),
+      lastPumpMs(0)
+{
+    pump.setInterval(kTickMs);
+    pump.setTimerType(Qt::PreciseTimer);
+    connect(&pump, &QTimer::timeout, this, &NetemProxy::pumpAll);
+    connect(tcpServer, &QTcpServer::newConnection, this, &NetemProxy::acceptConnections);
+    clock.start();
+}
+
+NetemProxy::~NetemProxy()
+{
+    while (!connections.isEmpty()) close(connections.first());
+}
+
+bool NetemProxy::listen(const QHostAddress &address, quint16 port)
+{
+    if (!tcpServer->listen(address, port)) {
+        qWarning() << "NetemProxy: Не удалось открыть порт" << port << ":" << tcpServer->errorString();
+        return false;
+    }
+    qDebug() << "NetemProxy: Порт" << tcpServer->serverPort() << "->" << upstreamHost << upstreamPort << "," << profile.describe();
+    return true;
+}
+
+quint16 NetemProxy::port() const
+{
+    return tcpServer->serverPort();
+}
+
+QString NetemProxy::proxiedUrl(const QString &upstreamUrl) const
+{
+    QUrl url(upstreamUrl);
+    url.setScheme("http");
+    url.setHost(QHostAddress(QHostAddress::LocalHost).toString());
+    url.setPort(tcpServer->serverPort());
+    return url.toString();
+}
+
+NetemProxy::Stats NetemProxy::stats() const
+{
+    return counters;
+}
+
+void NetemProxy::acceptConnections()
+{
+    while (QTcpSocket *client = tcpServer->nextPendingConnection()) {
+        Connection *connection = new Connection;
+        connection->client = client;
+        connection->upstream = new QTcpSocket(this);
+        // Ограниченный буфер чтения: пока очередь полна, Qt не вычитывает сокет и окно TCP закрывается
+        client->setReadBufferSize(kSocketReadBuffer);
+        connection->upstream->setReadBufferSize(kSocketReadBuffer);
+        counters.connections++;
+
+        // Судьба соединения решается сразу: последовательность решений зависит только от зерна
+        const double roll = random.generateDouble();
+        if (roll < profile.resetProbability + profile.truncateProbability) {
+            connection->faultIsReset = roll < profile.resetProbability;
+            connection->faultAt = 1 + random.bounded(kFaultWindow);
+        }
+        connections.append(connection);
+
+        connect(client, &QTcpSocket::readyRead, this, [this, connection]() {
+            readInto(connection->client, connection->up, counters.bytesUp);
+        });
+        connect(connection->upstream, &QTcpSocket::readyRead, this, [this, connection]() {
+            readInto(connection->upstream, connection->down, counters.bytesDown);
+        });
+        // Сервер закрыл соединение - клиенту оно закрывается после доставки уже принятых данных
+        connect(connection->upstream, &QTcpSocket::disconnected, this, [this, connection]() {
+            connection->upstreamClosed = true;
+            if (!pump.isActive()) pumpAll();
+        });
+        connect(connection->upstream, &QTcpSocket::errorOccurred, this, [this, connection](QAbstractSocket::SocketError error) {
+            if (error == QAbstractSocket::RemoteHostClosedError) return; // Обработает disconnected
+            qWarning() << "NetemProxy: Сервер недоступен:" << connection->upstream->errorString();
+            connection->upstreamClosed = true;
+            if (!pump.isActive()) pumpAll();
+        });
+        connect(client, &QTcpSocket::disconnected, this, [this, connection]() { close(connection); });
+        connect(connection->upstream, &QTcpSocket::connected, this, [this]() {
+            if (!pump.isActive()) pump.start(); // Запрос мог прийти раньше соединения с сервером
+        });
+
+        connection->upstream->connectToHost(upstreamHost, upstreamPort);
+    }
+}
+
+// Читает не больше, чем осталось места в очереди; остальное ждет в сокете до следующего такта
+void NetemProxy::readInto(QTcpSocket *source, Direction &direction, qint64 &counter)
+{
+    const qint64 room = kMaxQueuedBytes - direction.queuedBytes;
+    if (room <= 0) return;
+    const QByteArray data = source->read(room);
+    counter += data.size();
+    enqueue(direction, data);
+}
+
+void NetemProxy::enqueue(Direction &direction, const QByteArray &data)
+{
+    if (data.isEmpty()) return;
+    direction.queuedBytes += data.size();
+    qint64 dueMs = clock.elapsed() + profile.latencyMs;
+    if (profile.jitterMs > 0) dueMs += random.bounded(2 * profile.jitterMs + 1) - profile.jitterMs;
+    // Разброс задержки не переставляет байты: TCP доставляет их по порядку
+    dueMs = qMax(dueMs, direction.lastDueMs);
+    direction.lastDueMs = dueMs;
+    direction.queue.enqueue({dueMs, data});
+    if (!pump.isActive()) {
+        lastPumpMs = clock.elapsed();
+        pump.start();
+    }
+}
+
+void NetemProxy::pumpAll()
+{
+    const qint64 now = clock.elapsed();
+    const double budget = profile.bandwidthBytesPerSec > 0
+                              ? profile.bandwidthBytesPerSec * (now - lastPumpMs) / 1000.0
+                              : std::numeric_limits<double>::infinity();
+    lastPumpMs = now;
+
+    bool pending = false;
+    const QList<Connection *> snapshot = connections;
+    for (Connection *connection : snapshot) {
+        if (!pumpConnection(connection, budget)) continue;
+        pending = pending || !connection->up.queue.isEmpty() || !connection->down.queue.isEmpty()
+                  || connection->client->bytesAvailable() > 0 || connection->upstream->bytesAvailable() > 0;
+    }
+    if (!pending) pump.stop();
+}
+
+bool NetemProxy::pumpConnection(Connection *connection, double budgetBytes)
+{
+    const qint64 now = clock.elapsed();
+    // Не больше 50 мс полосы сразу, иначе после простоя ограничение выдаст залп
+    const double burst = profile.bandwidthBytesPerSec > 0 ? qMax<double>(profile.bandwidthBytesPerSec / 20.0, 1500.0)
+                                                          : std::numeric_limits<double>::infinity();
+
+    // Клиент -> сервер, как только сервер принял соединение
+    connection->up.allowance = qMin(connection->up.allowance + budgetBytes, burst);
+    if (connection->upstream->state() == QAbstractSocket::ConnectedState) flush(connection->up, connection->upstream, now, nullptr);
+
+    // Сервер -> клиент, со сбоем на заданном байте
+    Direction &down = connection->down;
+    down.allowance = qMin(down.allowance + budgetBytes, burst);
+    if (!flush(down, connection->client, now, connection)) return false;
+
+    // Место в очередях освободилось - дочитываем то, что ждало в сокетах
+    readInto(connection->client, connection->up, counters.bytesUp);
+    readInto(connection->upstream, down, counters.bytesDown);
+
+    if (connection->upstreamClosed && down.queue.isEmpty() && connection->upstream->bytesAvailable() == 0) {
+        connection->client->disconnectFromHost();
+        close(connection);
+        return false;
+    }
+    return true;
+}
+
+// Отправляет из очереди то, что уже отстояло задержку, в пределах полосы. Пока получатель не
+// разбирает буфер записи сокета, не отправляет ничего. faultConnection задается для ответа
+// сервера - на нем срабатывает сбой соединения
+bool NetemProxy::flush(Direction &direction, QTcpSocket *target, qint64 now, Connection *faultConnection)
+{
+    while (!direction.queue.isEmpty() && direction.queue.head().dueMs <= now && direction.allowance >= 1
+           && target->bytesToWrite() < kMaxQueuedBytes) {
+        Chunk &chunk = direction.queue.head();
+        qint64 count = qMin<qint64>(chunk.data.size(), static_cast<qint64>(qMin(direction.allowance, 1e15)));
+        const bool fault = faultConnection && faultConnection->faultAt >= 0
+                           && direction.delivered + count >= faultConnection->faultAt;
+        if (fault) count = faultConnection->faultAt - direction.delivered;
+        target->write(chunk.data.constData(), count);
+        direction.allowance -= count;
+        direction.delivered += count;
+        direction.queuedBytes -= count;
+        chunk.data.remove(0, count);
+        if (chunk.data.isEmpty()) direction.queue.dequeue();
+        if (fault) {
+            if (faultConnection->faultIsReset) {
+                counters.resets++;
+                resetConnection(target); // RST: недоставленное из буфера сокета теряется вместе с соединением
+            } else {
+                counters.truncations++;
+                target->disconnectFromHost(); // Корректное закрытие посреди ответа
+            }
+            close(faultConnection);
+            return false;
+        }
+    }
+    return true;
+}
+
+void NetemProxy::close(Connection *connection)
+{
+    if (!connections.removeOne(connection)) return;
+    // Сигналы отключаются до закрытия: обработчики ссылаются на удаляемое соединение
+    QObject::disconnect(connection->client, nullptr, this, nullptr);
+    QObject::disconnect(connection->upstream, nullptr, this, nullptr);
+    connection->upstream->abort();
+    connection->upstream->deleteLater();
+    if (connection->client->state() == QAbstractSocket::UnconnectedState) {
+        connection->client->deleteLater();
+    } else {
+        // Закрытие идет после отправки уже записанных данных
+        connect(connection->client, &QTcpSocket::disconnected, connection->client, &QObject::deleteLater);
+        connection->client->disconnectFromHost();
+    }
+    delete connection;
+}
@@ -0,0 +1,110 @@
+#ifndef NETEMPROXY_H
+#define NETEMPROXY_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QList>
+#include <QQueue>
+#include <QRandomGenerator>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+class QTcpServer;
+class QTcpSocket;
+
+// Эмулятор плохой сети: TCP-прокси между клиентом и сервером (обычно StandInServer), который
+// добавляет задержку с разбросом, ограничивает полосу и обрывает соединения.
+// Решения о сбоях принимает генератор с заданным зерном - один и тот же профиль с тем же зерном
+// воспроизводит ту же последовательность сбоев при той же последовательности соединений.
+// Работает на уровне байтов, поэтому подходит только для http:// (TLS оборвется на сертификате)
+class NetemProxy : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Profile {
+        QString name = "clean";
+        int latencyMs = 0;                // Задержка в одну сторону
+        int jitterMs = 0;                 // Разброс задержки, +-
+        qint64 bandwidthBytesPerSec = 0;  // На соединение и направление; 0 - без ограничения
+        double resetProbability = 0;      // Доля соединений, сбрасываемых (RST) посреди ответа
+        double truncateProbability = 0;   // Доля соединений, закрываемых (FIN) посреди ответа
+
+        static QStringList names();
+        static bool byName(const QString &name, Profile *profile);
+        QString describe() const;
+    };
+
+    struct Stats {
+        int connections = 0;
+        int resets = 0;
+        int truncations = 0;
+        qint64 bytesUp = 0;   // Клиент -> сервер
+        qint64 bytesDown = 0; // Сервер -> клиент
+    };
+
+    static const int kTickMs = 5;
+    // Сбой случается на случайном байте ответа из этого окна: короткие ответы доходят чаще длинных
+    static const qint64 kFaultWindow = 512 * 1024;
+    // Больше этого в очереди направления (или в буфере записи сокета) не набирается: чтение с другой
+    // стороны приостанавливается, и TCP притормаживает отправителя, как настоящий узкий канал
+    static const qint64 kMaxQueuedBytes = 1024 * 1024;
+
+    NetemProxy(const Profile &profile, const QString &upstreamHost, quint16 upstreamPort, quint32 seed,
+               QObject *parent = nullptr);
+    ~NetemProxy();
+
+    bool listen(const QHostAddress &address = QHostAddress::LocalHost, quint16 port = 0);
+    quint16 port() const;
+    // Адрес сервера upstreamUrl, но через прокси (схема, хост и порт заменяются)
+    QString proxiedUrl(const QString &upstreamUrl) const;
+    Stats stats() const;
+
+private:
+    struct Chunk {
+        qint64 dueMs;
+        QByteArray data;
+    };
+
+    // Одно направление соединения: данные ждут своей задержки, затем уходят с ограничением полосы
+    struct Direction {
+        QQueue<Chunk> queue;
+        qint64 lastDueMs = 0;
+        double allowance = 0; // Байты, которые можно отправить (ведро токенов)
+        qint64 delivered = 0;
+        qint64 queuedBytes = 0;
+    };
+
+    struct Connection {
+        QTcpSocket *client = nullptr;
+        QTcpSocket *upstream = nullptr;
+        Direction up;
+        Direction down;
+        qint64 faultAt = -1;       // Байт ответа, на котором случится сбой
+        bool faultIsReset = false;
+        bool upstreamClosed = false;
+    };
+
+    Profile profile;
+    QString upstreamHost;
+    quint16 upstreamPort;
+    QRandomGenerator random;
+    QTcpServer *tcpServer;
+    QList<Connection *> connections;
+    QTimer pump;
+    QElapsedTimer clock;
+    qint64 lastPumpMs;
+    Stats counters;
+
+    void acceptConnections();
+    void readInto(QTcpSocket *source, Direction &direction, qint64 &counter);
+    void enqueue(Direction &direction, const QByteArray &data);
+    bool flush(Direction &direction, QTcpSocket *target, qint64 now, Connection *faultConnection); // false - соединение закрыто
+    void pumpAll();
+    bool pumpConnection(Connection *connection, double budgetBytes); // false - соединение закрыто
+    void close(Connection *connection);
+};
+
+#endif // NETEMPROXY_H
@@ -0,0 +1,245 @@
+#include "previewservice.h"
+#include "apiclient.h"
+#include "mimeservice.h"
+#include "tracer.h"
+
+#include <QBuffer>
+#include <QImageReader>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QDebug>
+
+namespace {
+
+// Одновременно тянем из сети не больше стольких миниатюр
+const int kMaxConcurrentFetches = 3;
+const qint64 kDefaultMemoryBudget = 32 * 1024 * 1024;
+const qint64 kDefaultDiskBudget = 128 * 1024 * 1024;
+
+QImage decodeAndScale(const QByteArray &data)
+{
+    TRACE_SCOPE_ARG("decode", "decodeAndScale", "bytes", static_cast<qint64>(data.size()));
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+    QImageReader reader(&buffer);
+    reader.setAutoTransform(true);
+    // Масштабируем при декодировании: для JPEG это заметно дешевле полного размера
+    QSize size = reader.size();
+    if (size.isValid() && (size.width() > PreviewService::kThumbnailSize || size.height() > PreviewService::kThumbnailSize)) {
+        reader.setScaledSize(size.scaled(PreviewService::kThumbnailSize, PreviewService::kThumbnailSize, Qt::KeepAspectRatio));
+    }
+    QImage image = reader.read();
+    if (image.isNull()) return image;
+    if (image.width() > PreviewService::kThumbnailSize || image.height() > PreviewService::kThumbnailSize) {
+        image = image.scaled(PreviewService::kThumbnailSize, PreviewService::kThumbnailSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    return image;
+}
+
+int imageCostKiB(const QImage &image)
+{
+    return qMax(1, static_cast<int>(image.sizeInBytes() / 1024));
+}
+
+}
+
+PreviewService::PreviewService(ApiClient *client, QObject *parent)
+    : QObject(parent),
+      apiClient(client),
+      activeFetches(0),
+      diskBudget(kDefaultDiskBudget)
+{
+    memoryCache.setMaxCost(static_cast<int>(kDefaultMemoryBudget / 1024));
+    connect(apiClient, &ApiClient::previewDataReady, this, &PreviewService::handlePreviewData);
+    connect(apiClient, &ApiClient::previewFailed, this, &PreviewService::handlePreviewFailed);
+}
+
+bool PreviewService::isPreviewable(const QString &fileName)
+{
+    // Изображения, которые умеет декодировать QImageReader, и PDF (только через серверную миниатюру)
+    static const QList<QByteArray> decodable = QImageReader::supportedMimeTypes();
+    const QMimeType mimeType = MimeService::mimeTypeForFileName(fileName);
+    if (!mimeType.isValid()) return false;
+    return mimeType.name() == "application/pdf" || decodable.contains(mimeType.name().toLatin1());
+}
+
+QImage PreviewService::cachedPreview(const QString &fileId) const
+{
+    QImage *image = memoryCache.object(fileId);
+    return image ? *image : QImage();
+}
+
+void PreviewService::setMemoryBudget(qint64 bytes)
+{
+    memoryCache.setMaxCost(static_cast<int>(qMax<qint64>(1, bytes / 1024)));
+}
+
+void PreviewService::setDiskBudget(qint64 bytes)
+{
+    diskBudget = bytes;
+}
+
+QString PreviewService::diskPath(const QString &fileId) const
+{
+    // Ключ включает сервер: одинаковые ID на разных серверах - разные файлы
+    QByteArray key = QCryptographicHash::hash((apiClient->baseUrl() + '\n' + fileId).toUtf8(), QCryptographicHash::Sha1).toHex();
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/previews/" + QString::fromLatin1(key) + ".png";
+}
+
+void PreviewService::requestPreview(const QString &token, const QString &fileId, const QString &fileName, bool allowFileDownload)
+{
+    if (fileId.isEmpty() || memoryCache.contains(fileId) || unavailable.contains(fileId)) return;
+    if (!isPreviewable(fileName)) return;
+    // Начало PDF не декодируется - для него только серверная миниатюра
+    const bool allowPrefix = allowFileDownload && MimeService::mimeTypeForFileName(fileName).name() != "application/pdf";
+    if (inFlight.contains(fileId)) {
+        // Список уже спрашивает серверную миниатюру; если ее нет, окно деталей получит начало файла
+        if (allowPrefix) wantsFileDownload.insert(fileId);
+        return;
+    }
+    if (noServerPreview.contains(fileId) && !allowPrefix) return;
+    inFlight.insert(fileId);
+    if (allowPrefix) wantsFileDownload.insert(fileId);
+
+    // Сначала дисковый кэш - читаем и декодируем PNG в пуле потоков
+    const QString path = diskPath(fileId);
+    QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, token, fileId, allowPrefix]() {
+        QImage image = watcher->result();
+        watcher->deleteLater();
+        if (!image.isNull()) {
+            memoryCache.insert(fileId, new QImage(image), imageCostKiB(image));
+            inFlight.remove(fileId);
+            notifyWatchers(fileId, image);
+            emit previewReady(fileId, image);
+            return;
+        }
+        fetchQueue.enqueue({token, fileId, allowPrefix});
+        startNextFetches();
+    });
+    watcher->setFuture(QtConcurrent::run([path]() {
+        if (!QFileInfo::exists(path)) return QImage();
+        QImage image(path);
+        if (!image.isNull()) {
+            // Обновляем время доступа для LRU-вытеснения на диске
+            QFile file(path);
+            if (file.open(QIODevice::ReadWrite)) file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        }
+        return image;
+    }));
+}
+
+void PreviewService::watchPreview(const QString &fileId, QObject *receiver, std::function<void(const QImage &)> onReady)
+{
+    if (fileId.isEmpty() || !receiver || unavailable.contains(fileId)) return;
+    watchers[fileId].append({receiver, std::move(onReady)});
+    connect(receiver, &QObject::destroyed, this, [this, fileId, receiver]() {
+        auto it = watchers.find(fileId);
+        if (it == watchers.end()) return;
+        it->removeIf([receiver](const Watcher &watcher) { return watcher.receiver == receiver; });
+        if (it->isEmpty()) watchers.erase(it);
+    });
+}
+
+void PreviewService::notifyWatchers(const QString &fileId, const QImage &image)
+{
+    // Подписка одноразовая: миниатюра файла готовится один раз
+    const QList<Watcher> ready = watchers.take(fileId);
+    for (const Watcher &watcher : ready) watcher.onReady(image);
+}
+
+void PreviewService::startNextFetches()
+{
+    while (activeFetches < kMaxConcurrentFetches && !fetchQueue.isEmpty()) {
+        PendingFetch fetch = fetchQueue.dequeue();
+        activeFetches++;
+        fetching.insert(fetch.fileId, fetch);
+        apiClient->fetchPreview(fetch.token, fetch.fileId, fetch.allowPrefix);
+    }
+}
+
+void PreviewService::fetchFinished(const QString &fileId)
+{
+    fetching.remove(fileId);
+    activeFetches = qMax(0, activeFetches - 1);
+    startNextFetches();
+}
+
+void PreviewService::handlePreviewData(const QString &fileId, const QByteArray &data)
+{
+    if (!inFlight.contains(fileId)) return;
+    fetchFinished(fileId);
+
+    QFutureWatcher<QImage> *watcher = new QFutureWatcher<QImage>(this);
+    connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, fileId]() {
+        QImage image = watcher->result();
+        watcher->deleteLater();
+        storeResult(fileId, image);
+    });
+    watcher->setFuture(QtConcurrent::run([data]() { return decodeAndScale(data); }));
+}
+
+void PreviewService::handlePreviewFailed(const QString &fileId, const QString &errorString, int statusCode)
+{
+    if (!inFlight.contains(fileId)) return;
+    const PendingFetch fetch = fetching.value(fileId);
+    fetchFinished(fileId);
+    if (!fetch.allowPrefix && statusCode == 404) {
+        if (wantsFileDownload.contains(fileId)) {
+            // Пока шел запрос из списка, окно деталей разрешило скачать начало файла
+            fetchQueue.enqueue({fetch.token, fileId, true});
+            startNextFetches();
+            return;
+        }
+        // Серверной миниатюры нет - начало файла скачается, только если его попросит окно деталей
+        inFlight.remove(fileId);
+        noServerPreview.insert(fileId);
+        emit previewUnavailable(fileId);
+        return;
+    }
+    qDebug() << "PreviewService: Миниатюра для файла ID:" << fileId << "недоступна. Статус:" << statusCode << errorString;
+    storeResult(fileId, QImage());
+}
+
+void PreviewService::storeResult(const QString &fileId, const QImage &image)
+{
+    inFlight.remove(fileId);
+    wantsFileDownload.remove(fileId);
+    noServerPreview.remove(fileId);
+    if (image.isNull()) {
+        unavailable.insert(fileId);
+        watchers.remove(fileId); // Миниатюры не будет - ждать нечего
+        emit previewUnavailable(fileId);
+        return;
+    }
+    memoryCache.insert(fileId, new QImage(image), imageCostKiB(image));
+    notifyWatchers(fileId, image);
+    emit previewReady(fileId, image);
+
+    // Запись на диск и вытеснение старых миниатюр - в фоне
+    const QString path = diskPath(fileId);
+    const qint64 budget = diskBudget;
+    (void)QtConcurrent::run([path, image, budget]() {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        if (!image.save(path, "PNG")) {
+            qWarning() << "PreviewService: Не удалось сохранить миниатюру:" << path;
+            return;
+        }
+        QDir dir(QFileInfo(path).absolutePath());
+        QFileInfoList entries = dir.entryInfoList(QStringList() << "*.png", QDir::Files, QDir::Time | QDir::Reversed);
+        qint64 total = 0;
+        for (const QFileInfo &entry : entries) total += entry.size();
+        // Самые давно использованные - в начале списка
+        for (const QFileInfo &entry : entries) {
+            if (total <= budget) break;
+            total -= entry.size();
+            QFile::remove(entry.absoluteFilePath());
+        }
+    });
+}
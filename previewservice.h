@@ -0,0 +1,84 @@
+#ifndef PREVIEWSERVICE_H
+#define PREVIEWSERVICE_H
+
+#include <QObject>
+#include <QCache>
+#include <QHash>
+#include <QImage>
+#include <QSet>
+#include <QQueue>
+#include <QString>
+#include <functional>
+
+class ApiClient;
+
+// Миниатюры файлов: сеть (серверная миниатюра или ограниченный префикс файла) ->
+// декодирование и масштабирование в пуле потоков -> LRU-кэш в памяти и на диске.
+// GUI получает готовые QImage через previewReady (списки) или watchPreview (одно окно на файл)
+// и никогда не ждет декодирования
+class PreviewService : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit PreviewService(ApiClient *client, QObject *parent = nullptr);
+
+    static const int kThumbnailSize = 256;
+
+    // Есть ли смысл запрашивать миниатюру для такого файла (по расширению)
+    static bool isPreviewable(const QString &fileName);
+
+    // Уже готовая миниатюра из памяти (без обращения к диску и сети)
+    QImage cachedPreview(const QString &fileId) const;
+    // Запросить миниатюру; результат придет сигналом previewReady.
+    // allowFileDownload: если на сервере нет миниатюр, декодировать начало самого файла
+    // (ranged-запрос download_file.php, до 2 МиБ) - только для одного файла (окно деталей), не для списков
+    void requestPreview(const QString &token, const QString &fileId, const QString &fileName, bool allowFileDownload = false);
+    // Миниатюра одного файла для одного получателя (окно деталей): onReady вызывается один раз и
+    // только для своего fileId, без рассылки previewReady всем окнам. Подписка снимается сама,
+    // когда receiver удален
+    void watchPreview(const QString &fileId, QObject *receiver, std::function<void(const QImage &)> onReady);
+
+    void setMemoryBudget(qint64 bytes);
+    void setDiskBudget(qint64 bytes);
+
+signals:
+    void previewReady(const QString &fileId, const QImage &image);
+    void previewUnavailable(const QString &fileId);
+
+private slots:
+    void handlePreviewData(const QString &fileId, const QByteArray &data);
+    void handlePreviewFailed(const QString &fileId, const QString &errorString, int statusCode);
+
+private:
+    struct PendingFetch {
+        QString token;
+        QString fileId;
+        bool allowPrefix; // Можно ли декодировать начало самого файла (для PDF - нет)
+    };
+
+    struct Watcher {
+        QObject *receiver;
+        std::function<void(const QImage &)> onReady;
+    };
+
+    ApiClient *apiClient;
+    QHash<QString, QList<Watcher>> watchers; // ID файла -> ждущие его окна
+    QCache<QString, QImage> memoryCache; // Стоимость - размер изображения в КиБ
+    QSet<QString> inFlight;              // Дисковое чтение, сеть или декодирование уже идут
+    QSet<QString> unavailable;           // Не удалось получить/декодировать - не повторяем в этой сессии
+    QSet<QString> noServerPreview;       // Серверной миниатюры нет, начало файла еще не пробовали
+    QSet<QString> wantsFileDownload;     // Запросивший разрешил декодировать начало файла
+    QHash<QString, PendingFetch> fetching; // Идущие сетевые запросы
+    QQueue<PendingFetch> fetchQueue;
+    int activeFetches;
+    qint64 diskBudget;
+
+    void startNextFetches();
+    void fetchFinished(const QString &fileId);
+    void storeResult(const QString &fileId, const QImage &image);
+    void notifyWatchers(const QString &fileId, const QImage &image);
+    QString diskPath(const QString &fileId) const;
+};
+
+#endif // PREVIEWSERVICE_H
@@ -0,0 +1,112 @@
+#include "progressaggregator.h"
+#include "requesthandle.h"
+
+#include <QLocale>
+
+namespace {
+// Вес новой отметки в сглаженной скорости: за ~10 тактов (полсекунды) старые значения почти забываются
+const double kRateSmoothing = 0.3;
+}
+
+ProgressAggregator::ProgressAggregator(QObject *parent, int intervalMs)
+    : QObject(parent),
+    lastSampleBytes(0),
+    lastSampleMs(-1),
+    dirty(false)
+{
+    tick.setInterval(intervalMs);
+    tick.setTimerType(Qt::CoarseTimer);
+    connect(&tick, &QTimer::timeout, this, [this]() {
+        if (dirty) publish();
+        else tick.stop(); // Передача стоит - не будим поток впустую
+    });
+    clock.start();
+}
+
+void ProgressAggregator::track(RequestHandle *handle)
+{
+    reset();
+    if (handle) connect(handle, &RequestHandle::progress, this, &ProgressAggregator::update);
+}
+
+void ProgressAggregator::reset()
+{
+    tick.stop();
+    state = TransferProgress();
+    lastSampleBytes = 0;
+    lastSampleMs = -1;
+    dirty = false;
+    clock.restart();
+}
+
+TransferProgress ProgressAggregator::current() const
+{
+    return state;
+}
+
+void ProgressAggregator::update(qint64 bytesDone, qint64 bytesTotal)
+{
+    if (bytesDone < state.bytesDone) {
+        // Передача началась заново (повтор после ошибки) - прежняя скорость к ней не относится
+        state.bytesPerSecond = 0;
+        lastSampleBytes = bytesDone;
+        lastSampleMs = clock.elapsed();
+    }
+    state.bytesDone = bytesDone;
+    state.bytesTotal = bytesTotal > 0 ? bytesTotal : -1;
+    state.finished = bytesTotal > 0 && bytesDone >= bytesTotal;
+    dirty = true;
+
+    // Первую отметку и завершение показываем сразу, остальные - по таймеру
+    if (lastSampleMs < 0 || state.finished) {
+        tick.stop();
+        publish();
+    } else if (!tick.isActive()) {
+        tick.start();
+    }
+}
+
+void ProgressAggregator::publish()
+{
+    const qint64 now = clock.elapsed();
+    if (lastSampleMs >= 0 && now > lastSampleMs) {
+        const double instant = (state.bytesDone - lastSampleBytes) * 1000.0 / (now - lastSampleMs);
+        state.bytesPerSecond = state.bytesPerSecond > 0
+                                   ? kRateSmoothing * instant + (1.0 - kRateSmoothing) * state.bytesPerSecond
+                                   : instant;
+    }
+    lastSampleBytes = state.bytesDone;
+    lastSampleMs = now;
+
+    if (state.bytesTotal > 0) {
+        state.percent = static_cast<int>(state.bytesDone * 100 / state.bytesTotal);
+        const qint64 remaining = state.bytesTotal - state.bytesDone;
+        state.etaMs = remaining <= 0 ? 0
+                      : state.bytesPerSecond > 0 ? static_cast<qint64>(remaining * 1000.0 / state.bytesPerSecond)
+                                                 : -1;
+    } else {
+        state.percent = -1;
+        state.etaMs = -1;
+    }
+    dirty = false;
+    emit progressChanged(state);
+}
+
+QString ProgressAggregator::describe(const TransferProgress &progress)
+{
+    const QLocale locale = QLocale::system();
+    QString text = locale.formattedDataSize(progress.bytesDone);
+    if (progress.bytesTotal > 0) text += " / " + locale.formattedDataSize(progress.bytesTotal);
+    if (progress.finished) return text;
+    if (progress.bytesPerSecond >= 1) {
+        text += ", " + locale.formattedDataSize(static_cast<qint64>(progress.bytesPerSecond)) + "/с";
+    }
+    if (progress.etaMs > 0) {
+        const qint64 seconds = (progress.etaMs + 999) / 1000;
+        const QString eta = seconds >= 3600
+                                ? QString("%1:%2:%3").arg(seconds / 3600).arg(seconds / 60 % 60, 2, 10, QChar('0')).arg(seconds % 60, 2, 10, QChar('0'))
+                                : QString("%1:%2").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+        text += ", осталось " + eta;
+    }
+    return text;
+}
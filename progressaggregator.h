@@ -0,0 +1,50 @@
+#ifndef PROGRESSAGGREGATOR_H
+#define PROGRESSAGGREGATOR_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include "datatypes.h"
+
+class RequestHandle;
+
+// Прореживание прогресса передачи: сеть присылает тысячи отметок в секунду, а интерфейсу
+// (и выводу в консоль) хватает ~20 обновлений. Сохраняет только последнюю отметку и
+// отдает ее по таймеру вместе со сглаженной скоростью и оценкой оставшегося времени.
+// Первая отметка и завершение передачи отдаются сразу
+class ProgressAggregator : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int kDefaultIntervalMs = 50; // 20 Гц
+
+    explicit ProgressAggregator(QObject *parent = nullptr, int intervalMs = kDefaultIntervalMs);
+
+    // Подписка на прогресс дескриптора запроса (вместо прямого connect к update)
+    void track(RequestHandle *handle);
+    void reset(); // Новая передача: скорость и время считаются заново
+
+    TransferProgress current() const;
+
+    // "1,2 MB / 5 MB, 3,4 MB/с, осталось 0:12" - для прогресс-баров и консоли
+    static QString describe(const TransferProgress &progress);
+
+public slots:
+    void update(qint64 bytesDone, qint64 bytesTotal);
+
+signals:
+    void progressChanged(const TransferProgress &progress);
+
+private:
+    QTimer tick;
+    QElapsedTimer clock;
+    TransferProgress state;
+    qint64 lastSampleBytes;
+    qint64 lastSampleMs;
+    bool dirty;
+
+    void publish();
+};
+
+#endif // PROGRESSAGGREGATOR_H
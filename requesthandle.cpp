@@ -0,0 +1,69 @@
+#include "requesthandle.h"
+
+#include <QMetaObject>
+
+RequestHandle::RequestHandle(QObject *parent)
+    : QObject(parent),
+      done(false)
+{
+}
+
+bool RequestHandle::isFinished() const
+{
+    return done;
+}
+
+void RequestHandle::reportProgress(qint64 bytesDone, qint64 bytesTotal)
+{
+    if (done) return;
+    emit progress(bytesDone, bytesTotal);
+}
+
+void RequestHandle::finishWithJson(const QJsonObject &data)
+{
+    if (done) return;
+    done = true;
+    emit jsonReady(data);
+    complete();
+}
+
+void RequestHandle::finishWithData(const QByteArray &data, const QString &fileName)
+{
+    if (done) return;
+    done = true;
+    emit dataReady(data, fileName);
+    complete();
+}
+
+void RequestHandle::fail(const QString &errorString, int statusCode)
+{
+    if (done) return;
+    done = true;
+    emit failed(errorString, statusCode);
+    complete();
+}
+
+void RequestHandle::finishWithJsonLater(const QJsonObject &data)
+{
+    QMetaObject::invokeMethod(this, [this, data]() { finishWithJson(data); }, Qt::QueuedConnection);
+}
+
+void RequestHandle::failLater(const QString &errorString, int statusCode)
+{
+    QMetaObject::invokeMethod(this, [this, errorString, statusCode]() { fail(errorString, statusCode); }, Qt::QueuedConnection);
+}
+
+void RequestHandle::abort()
+{
+    if (done) return;
+    // Помечаем завершенным до отмены: ApiClient не будет ни дозапрашивать, ни сообщать об ошибке
+    done = true;
+    emit abortRequested();
+    complete();
+}
+
+void RequestHandle::complete()
+{
+    emit finished();
+    deleteLater();
+}
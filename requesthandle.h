@@ -0,0 +1,48 @@
+#ifndef REQUESTHANDLE_H
+#define REQUESTHANDLE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+// Дескриптор одного запроса ApiClient. Результат и прогресс получает только тот,
+// кто запрос инициировал и подключился к этому объекту, а не все открытые окна.
+// После завершения (успех или ошибка) дескриптор удаляет себя сам
+class RequestHandle : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit RequestHandle(QObject *parent = nullptr);
+
+    bool isFinished() const;
+
+    // --- Вызываются ApiClient ---
+    void reportProgress(qint64 bytesDone, qint64 bytesTotal);
+    void finishWithJson(const QJsonObject &data);
+    void finishWithData(const QByteArray &data, const QString &fileName);
+    void fail(const QString &errorString, int statusCode = 0);
+    // Завершение в следующем проходе цикла событий: инициатор успеет подключиться
+    void finishWithJsonLater(const QJsonObject &data);
+    void failLater(const QString &errorString, int statusCode = 0);
+
+public slots:
+    // Отмена по инициативе получателя (например, окно закрыто). failed не испускается
+    void abort();
+
+signals:
+    void progress(qint64 done, qint64 total);
+    void jsonReady(const QJsonObject &data);
+    void dataReady(const QByteArray &data, const QString &fileName);
+    void failed(const QString &errorString, int statusCode);
+    void finished();
+    void abortRequested();
+
+private:
+    bool done;
+
+    void complete();
+};
+
+#endif // REQUESTHANDLE_H
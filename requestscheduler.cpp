@@ -0,0 +1,147 @@
+#include "requestscheduler.h"
+#include "transferworker.h"
+#include "tracer.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QSettings>
+#include <QThread>
+#include <QDebug>
+#include <memory>
+
+namespace {
+
+// Ожидание дольше этого попадает в лог
+const qint64 kSlowWaitMs = 500;
+
+const char *priorityName(RequestScheduler::Priority priority)
+{
+    switch (priority) {
+    case RequestScheduler::Interactive: return "interactive";
+    case RequestScheduler::Background: return "background";
+    case RequestScheduler::Bulk: return "bulk";
+    }
+    return "?";
+}
+
+}
+
+RequestScheduler::RequestScheduler(QObject *parent, TransferWorker *sharedWorker)
+    : QObject(parent),
+      interactiveManager(new QNetworkAccessManager(this)),
+      worker(sharedWorker ? sharedWorker : new TransferWorker(this)),
+      ownsWorker(sharedWorker == nullptr),
+      bulkManager(sharedWorker ? sharedWorker->createManager() : worker->manager())
+{
+    QSettings settings;
+    limits[Interactive] = 0; // Без ограничения
+    limits[Background] = qMax(1, settings.value("transfer/maxBackgroundRequests", kDefaultMaxBackground).toInt());
+    limits[Bulk] = qMax(1, settings.value("transfer/maxBulkRequests", kDefaultMaxBulk).toInt());
+}
+
+QNetworkAccessManager *RequestScheduler::manager(Priority priority) const
+{
+    return priority == Bulk ? bulkManager : interactiveManager;
+}
+
+TransferWorker *RequestScheduler::transferWorker() const
+{
+    return worker;
+}
+
+bool RequestScheduler::ownsTransferWorker() const
+{
+    return ownsWorker;
+}
+
+void RequestScheduler::setMaxConcurrent(Priority priority, int maxRunning)
+{
+    if (priority == Interactive) return;
+    limits[priority] = qMax(1, maxRunning);
+    dispatch(priority);
+}
+
+void RequestScheduler::schedule(Priority priority, const QString &label, StartFunction start)
+{
+    if (QThread::currentThread() != thread()) {
+        // Например, дозапрос скачивания из потока передач: очереди меняются только в своем потоке
+        QMetaObject::invokeMethod(this, [this, priority, label, start]() { schedule(priority, label, start); }, Qt::QueuedConnection);
+        return;
+    }
+    Pending pending;
+    pending.label = label;
+    pending.start = std::move(start);
+    pending.queuedAt.start();
+    queues[priority].enqueue(std::move(pending));
+    classStats[priority].queued = queues[priority].count();
+    dispatch(priority);
+}
+
+RequestScheduler::Stats RequestScheduler::stats(Priority priority) const
+{
+    return classStats[priority];
+}
+
+void RequestScheduler::dispatch(Priority priority)
+{
+    Stats &stats = classStats[priority];
+    while (!queues[priority].isEmpty() && (limits[priority] == 0 || stats.running < limits[priority])) {
+        run(priority, queues[priority].dequeue());
+    }
+    stats.queued = queues[priority].count();
+}
+
+void RequestScheduler::run(Priority priority, Pending pending)
+{
+    Stats &stats = classStats[priority];
+    const qint64 waitMs = pending.queuedAt.elapsed();
+    stats.started++;
+    stats.totalWaitMs += waitMs;
+    stats.maxWaitMs = qMax(stats.maxWaitMs, waitMs);
+    stats.lastWaitMs = waitMs;
+    if (waitMs >= kSlowWaitMs) {
+        qDebug() << "RequestScheduler:" << pending.label << "ждал в очереди" << priorityName(priority) << waitMs << "мс"
+                 << "(в очереди еще" << queues[priority].count() << ")";
+    }
+    emit queueWaitMeasured(priority, pending.label, waitMs);
+    if (Tracer::isEnabled()) {
+        const qint64 waitUs = pending.queuedAt.nsecsElapsed() / 1000;
+        Tracer::complete("queue", pending.label, Tracer::nowUs() - waitUs, waitUs, {{"class", priorityName(priority)}});
+    }
+
+    stats.running++;
+    if (priority == Bulk) {
+        // Передача запускается и обслуживается в своем потоке
+        QMetaObject::invokeMethod(worker->context(), [this, priority, label = pending.label, start = pending.start]() {
+            watchReply(priority, label, start());
+        }, Qt::QueuedConnection);
+        return;
+    }
+    watchReply(priority, pending.label, pending.start());
+}
+
+// Вызывается в потоке ответа; освобождение места всегда обрабатывается в потоке планировщика
+void RequestScheduler::watchReply(Priority priority, const QString &label, QNetworkReply *reply)
+{
+    if (!reply) {
+        // Запрос успели отменить - место сразу достается следующему
+        QMetaObject::invokeMethod(this, [this, priority]() { release(priority); }, Qt::QueuedConnection);
+        return;
+    }
+    Tracer::traceReply(reply, label);
+    // Место освобождается один раз: по finished или, если ответ удалили раньше, по destroyed
+    std::shared_ptr<bool> released = std::make_shared<bool>(false);
+    auto releaseOnce = [this, priority, released]() {
+        if (*released) return;
+        *released = true;
+        release(priority);
+    };
+    connect(reply, &QNetworkReply::finished, this, releaseOnce);
+    connect(reply, &QObject::destroyed, this, releaseOnce);
+}
+
+void RequestScheduler::release(Priority priority)
+{
+    classStats[priority].running--;
+    dispatch(priority);
+}
@@ -0,0 +1,80 @@
+#ifndef REQUESTSCHEDULER_H
+#define REQUESTSCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QString>
+#include <functional>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class TransferWorker;
+
+// Очередь запросов по классам приоритета.
+// Interactive (вход, списки, file_info по клику) идут сразу через свой QNetworkAccessManager:
+// его соединения с сервером не заняты передачами файлов, поэтому клик не ждет чужих загрузок.
+// Background (миниатюры) идет через тот же менеджер, но не больше нескольких запросов разом,
+// чтобы оставить соединения интерактивным. Bulk (тела файлов) - через отдельный менеджер
+// со своим пулом соединений и своим ограничением параллельности.
+// Время ожидания в очереди считается по каждому классу
+class RequestScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority { Interactive, Background, Bulk };
+
+    struct Stats {
+        int started = 0;
+        int running = 0;
+        int queued = 0;
+        qint64 totalWaitMs = 0;
+        qint64 maxWaitMs = 0;
+        qint64 lastWaitMs = 0;
+        double averageWaitMs() const { return started > 0 ? static_cast<double>(totalWaitMs) / started : 0.0; }
+    };
+
+    // Запускает запрос и возвращает ответ; nullptr - запрос больше не нужен (отменен, пока ждал).
+    // Для Bulk вызывается в потоке передач
+    using StartFunction = std::function<QNetworkReply *()>;
+
+    static const int kDefaultMaxBackground = 2;
+    static const int kDefaultMaxBulk = 4;
+
+    // sharedWorker - поток передач, общий для нескольких клиентов (нагрузочный режим): у каждого
+    // планировщика все равно свой менеджер Bulk, а поток останавливает владелец sharedWorker
+    explicit RequestScheduler(QObject *parent = nullptr, TransferWorker *sharedWorker = nullptr);
+
+    QNetworkAccessManager *manager(Priority priority) const;
+    TransferWorker *transferWorker() const;
+    bool ownsTransferWorker() const;
+    void setMaxConcurrent(Priority priority, int maxRunning); // Для Interactive не действует
+    void schedule(Priority priority, const QString &label, StartFunction start); // Из любого потока
+    Stats stats(Priority priority) const;
+
+signals:
+    void queueWaitMeasured(RequestScheduler::Priority priority, const QString &label, qint64 waitMs);
+
+private:
+    struct Pending {
+        QString label;
+        StartFunction start;
+        QElapsedTimer queuedAt;
+    };
+
+    QNetworkAccessManager *interactiveManager;
+    TransferWorker *worker;
+    bool ownsWorker;
+    QNetworkAccessManager *bulkManager; // Живет в потоке передач
+    QQueue<Pending> queues[3];
+    int limits[3];
+    Stats classStats[3];
+
+    void dispatch(Priority priority);
+    void run(Priority priority, Pending pending);
+    void watchReply(Priority priority, const QString &label, QNetworkReply *reply);
+    void release(Priority priority);
+};
+
+#endif // REQUESTSCHEDULER_H
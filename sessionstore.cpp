@@ -0,0 +1,154 @@
+#include "sessionstore.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <QSysInfo>
+#include <QMessageAuthenticationCode>
+#include <QCryptographicHash>
+#include <QRandomGenerator>
+#include <QtEndian>
+#include <QDebug>
+
+namespace {
+
+const QByteArray kMagic = "FXSS";
+const quint16 kVersion = 1;
+const int kNonceSize = 16;
+const int kMacSize = 32; // HMAC-SHA256
+
+// Привязка к машине и учетной записи ОС. machineUniqueId бывает пустым (контейнеры) - тогда хотя бы имя хоста.
+// Все входные данные известны любому процессу этого пользователя, так что это не секрет (см. sessionstore.h)
+QByteArray machineSecret()
+{
+    QByteArray machine = QSysInfo::machineUniqueId();
+    if (machine.isEmpty()) machine = QSysInfo::machineHostName().toUtf8();
+    QByteArray account = qgetenv("USER");
+    if (account.isEmpty()) account = qgetenv("USERNAME");
+    return QCryptographicHash::hash(machine + '\n' + account + '\n' + QDir::homePath().toUtf8(),
+                                    QCryptographicHash::Sha256);
+}
+
+QByteArray hmac(const QByteArray &key, const QByteArray &message)
+{
+    return QMessageAuthenticationCode::hash(message, key, QCryptographicHash::Sha256);
+}
+
+}
+
+SessionStore::SessionStore()
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    path = dir + "/session.dat";
+    // Разные ключи для шифрования и для проверки целостности
+    const QByteArray secret = machineSecret();
+    encryptionKey = hmac(secret, "FilesExchange session encryption");
+    macKey = hmac(secret, "FilesExchange session integrity");
+}
+
+// Поток ключа: HMAC-SHA256(ключ, nonce || номер блока), как в режиме счетчика
+QByteArray SessionStore::keystream(const QByteArray &nonce, int length) const
+{
+    QByteArray stream;
+    stream.reserve(length + kMacSize);
+    for (quint32 block = 0; stream.size() < length; ++block) {
+        quint32 counter = qToBigEndian(block);
+        stream += hmac(encryptionKey, nonce + QByteArray(reinterpret_cast<const char *>(&counter), sizeof(counter)));
+    }
+    stream.truncate(length);
+    return stream;
+}
+
+bool SessionStore::load(Session *session) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return false;
+    const QByteArray blob = file.readAll();
+    const int headerSize = kMagic.size() + static_cast<int>(sizeof(kVersion)) + kNonceSize;
+    if (blob.size() < headerSize + kMacSize || !blob.startsWith(kMagic)) {
+        qWarning() << "SessionStore: Файл сессии поврежден, игнорируем.";
+        return false;
+    }
+    const QByteArray signedPart = blob.left(blob.size() - kMacSize);
+    if (hmac(macKey, signedPart) != blob.right(kMacSize)) {
+        // Файл с другой машины (или изменен) - войти придется заново
+        qWarning() << "SessionStore: Сохраненная сессия не прошла проверку целостности, игнорируем.";
+        return false;
+    }
+    if (qFromBigEndian<quint16>(blob.constData() + kMagic.size()) != kVersion) {
+        qDebug() << "SessionStore: Устаревший формат сохраненной сессии, игнорируем.";
+        return false;
+    }
+    const QByteArray nonce = signedPart.mid(kMagic.size() + sizeof(kVersion), kNonceSize);
+    QByteArray plain = signedPart.mid(headerSize);
+    const QByteArray stream = keystream(nonce, plain.size());
+    for (int i = 0; i < plain.size(); ++i) plain[i] = plain[i] ^ stream[i];
+
+    Session result;
+    QDataStream in(plain);
+    in.setVersion(QDataStream::Qt_6_0);
+    in >> result.serverUrl >> result.username >> result.token >> result.role >> result.lastUsed;
+    if (in.status() != QDataStream::Ok || result.token.isEmpty()) {
+        qWarning() << "SessionStore: Не удалось разобрать сохраненную сессию.";
+        return false;
+    }
+    if (!result.lastUsed.isValid() || result.lastUsed.daysTo(QDateTime::currentDateTimeUtc()) > kMaxIdleDays) {
+        qDebug() << "SessionStore: Сохраненная сессия" << result.username << "истекла.";
+        return false;
+    }
+    *session = result;
+    return true;
+}
+
+bool SessionStore::save(const Session &session) const
+{
+    QByteArray plain;
+    {
+        QDataStream out(&plain, QIODevice::WriteOnly);
+        out.setVersion(QDataStream::Qt_6_0);
+        out << session.serverUrl << session.username << session.token << session.role
+            << (session.lastUsed.isValid() ? session.lastUsed : QDateTime::currentDateTimeUtc());
+    }
+    QByteArray nonce(kNonceSize, Qt::Uninitialized);
+    QRandomGenerator::system()->fillRange(reinterpret_cast<quint32 *>(nonce.data()), kNonceSize / sizeof(quint32));
+    const QByteArray stream = keystream(nonce, plain.size());
+    for (int i = 0; i < plain.size(); ++i) plain[i] = plain[i] ^ stream[i];
+
+    quint16 version = qToBigEndian(kVersion);
+    QByteArray blob = kMagic + QByteArray(reinterpret_cast<const char *>(&version), sizeof(version)) + nonce + plain;
+    blob += hmac(macKey, blob);
+
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "SessionStore: Не удалось сохранить сессию:" << file.errorString();
+        return false;
+    }
+    // Права ставятся на временный файл до переименования: файл с токеном ни на миг не бывает
+    // доступен другим пользователям системы
+    file.setPermissions(QFile::ReadOwner | QFile::WriteOwner);
+    file.write(blob);
+    if (!file.commit()) {
+        qWarning() << "SessionStore: Не удалось сохранить сессию:" << file.errorString();
+        return false;
+    }
+    return true;
+}
+
+void SessionStore::touch() const
+{
+    Session session;
+    if (!load(&session)) return;
+    session.lastUsed = QDateTime::currentDateTimeUtc();
+    save(session);
+}
+
+void SessionStore::clear() const
+{
+    if (QFile::exists(path) && !QFile::remove(path)) {
+        qWarning() << "SessionStore: Не удалось удалить сохраненную сессию:" << path;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef SESSIONSTORE_H
+#define SESSIONSTORE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+
+// Сохраненная сессия ("Запомнить вход"): токен и роль после login, чтобы при следующем запуске
+// сразу открыть рабочее окно, не дожидаясь auth.php.
+// Файл зашифрован ключом, выведенным из идентификатора машины и учетной записи ОС:
+// скопированный на другую машину (или к другому пользователю) файл не расшифруется и будет проигнорирован.
+// Каждая запись - со случайным nonce и HMAC-SHA256 для проверки целостности.
+// Это привязка к машине и запутывание, а не защита: ключ выводится из общедоступных данных
+// (machineUniqueId, имя пользователя, домашний каталог), и любая программа под этой же учетной
+// записью может его повторить и прочитать токен. Защищают файл только права доступа (0600)
+class SessionStore
+{
+public:
+    struct Session {
+        QString serverUrl;
+        QString username;
+        QString token;
+        QString role;
+        QDateTime lastUsed; // Последний успешный вход или проверка токена
+    };
+
+    // Сессия, не проверявшаяся дольше этого срока, считается истекшей
+    static const int kMaxIdleDays = 30;
+
+    SessionStore();
+
+    bool load(Session *session) const; // false - нет файла, чужая машина, поврежден или истек
+    bool save(const Session &session) const;
+    void touch() const;                // Продлевает срок сохраненной сессии
+    void clear() const;
+
+private:
+    QString path;
+    QByteArray encryptionKey;
+    QByteArray macKey;
+
+    QByteArray keystream(const QByteArray &nonce, int length) const;
+};
+
+#endif // SESSIONSTORE_H
@@ -0,0 +1,501 @@
+#include "standinserver.h"
+#include "batcharchive.h"
+#include "compression.h"
+
+#include <QCryptographicHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QRandomGenerator>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QDebug>
+
+namespace {
+
+const int kMaxHeaderSize = 64 * 1024;
+
+QByteArray statusText(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 401: return "Unauthorized";
+    case 404: return "Not Found";
+    case 409: return "Conflict";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 416: return "Range Not Satisfiable";
+    }
+    return "Error";
+}
+
+QString formValue(const QUrlQuery &form, const QString &key)
+{
+    return form.queryItemValue(key, QUrl::FullyDecoded);
+}
+
+QByteArray randomBytes(int size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+    QRandomGenerator::global()->fillRange(reinterpret_cast<quint32 *>(data.data()), size / int(sizeof(quint32)));
+    return data;
+}
+
+}
+
+StandInServer::StandInServer(QObject *parent)
+    : QObject(parent),
+      tcpServer(new QTcpServer(this)),
+      nextFileId(1),
+      chunkBytes(0),
+      served(0)
+{
+    connect(tcpServer, &QTcpServer::newConnection, this, &StandInServer::acceptConnections);
+}
+
+bool StandInServer::listen(const QHostAddress &address, quint16 port)
+{
+    if (!tcpServer->listen(address, port)) {
+        qWarning() << "StandInServer: Не удалось открыть порт" << port << ":" << tcpServer->errorString();
+        return false;
+    }
+    qDebug() << "StandInServer: Слушает" << baseUrl();
+    return true;
+}
+
+quint16 StandInServer::port() const
+{
+    return tcpServer->serverPort();
+}
+
+QString StandInServer::baseUrl() const
+{
+    QHostAddress address = tcpServer->serverAddress();
+    if (address == QHostAddress::Any || address == QHostAddress::AnyIPv4) address = QHostAddress::LocalHost;
+    return QString("http://%1:%2/api/").arg(address.toString()).arg(tcpServer->serverPort());
+}
+
+qint64 StandInServer::requestsServed() const
+{
+    return served.load();
+}
+
+void StandInServer::acceptConnections()
+{
+    while (QTcpSocket *socket = tcpServer->nextPendingConnection()) {
+        pending.insert(socket, QByteArray());
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { readRequests(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() {
+            pending.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+// Разбирает все полностью пришедшие запросы соединения (клиент может слать их подряд)
+void StandInServer::readRequests(QTcpSocket *socket)
+{
+    QByteArray &buffer = pending[socket];
+    buffer += socket->readAll();
+    for (;;) {
+        const int headEnd = buffer.indexOf("\r\n\r\n");
+        if (headEnd < 0) {
+            if (buffer.size() > kMaxHeaderSize) {
+                writeResponse(socket, errorResponse(400, "Слишком длинные заголовки"), false);
+            }
+            return;
+        }
+        const QList<QByteArray> lines = buffer.left(headEnd).split('\n');
+        const QList<QByteArray> requestLine = lines.value(0).trimmed().split(' ');
+        Request request;
+        request.method = requestLine.value(0);
+        const QUrl target(QString::fromLatin1(requestLine.value(1)));
+        request.endpoint = target.path().section('/', -1);
+        request.query = QUrlQuery(target);
+        for (int i = 1; i < lines.size(); ++i) {
+            const int colon = lines.at(i).indexOf(':');
+            if (colon > 0) request.headers.insert(lines.at(i).left(colon).trimmed().toLower(), lines.at(i).mid(colon + 1).trimmed());
+        }
+        const bool keepAlive = request.headers.value("connection").toLower() != "close";
+
+        bool hasLength = true;
+        qint64 length = 0;
+        if (request.headers.contains("content-length")) length = request.headers.value("content-length").toLongLong(&hasLength);
+        if (request.headers.value("transfer-encoding").toLower().contains("chunked") || !hasLength) {
+            writeResponse(socket, errorResponse(411, "Нужен Content-Length"), false);
+            return;
+        }
+        if (length > kMaxBodySize) {
+            writeResponse(socket, errorResponse(413, "Слишком большой запрос"), false);
+            return;
+        }
+        if (buffer.size() < headEnd + 4 + length) return; // Тело еще идет
+        request.body = buffer.mid(headEnd + 4, length);
+        buffer.remove(0, headEnd + 4 + length);
+
+        served++;
+        writeResponse(socket, handle(request), keepAlive);
+        if (!keepAlive) return;
+    }
+}
+
+void StandInServer::writeResponse(QTcpSocket *socket, const Response &response, bool keepAlive)
+{
+    QByteArray head = "HTTP/1.1 " + QByteArray::number(response.status) + " " + statusText(response.status) + "\r\n";
+    head += "Content-Type: " + response.contentType + "\r\n";
+    head += "Content-Length: " + QByteArray::number(response.body.size()) + "\r\n";
+    for (const QPair<QByteArray, QByteArray> &header : response.headers) {
+        head += header.first + ": " + header.second + "\r\n";
+    }
+    if (!keepAlive) head += "Connection: close\r\n";
+    socket->write(head + "\r\n");
+    socket->write(response.body);
+    if (!keepAlive) {
+        pending.remove(socket);
+        socket->disconnectFromHost();
+    }
+}
+
+StandInServer::Response StandInServer::handle(const Request &request)
+{
+    if (request.endpoint == "download_file.php") return handleDownload(request);
+    if (request.method != "POST") return errorResponse(404, "Нет такого эндпоинта");
+
+    if (request.endpoint == "upload_file.php" || request.endpoint == "upload_batch.php" || request.endpoint == "chunk_upload.php") {
+        const QHash<QByteArray, FormPart> parts = parseMultipart(request);
+        const QString user = userForToken(QString::fromUtf8(parts.value("token_api").data));
+        if (user.isEmpty()) return errorResponse(401, "Неверный токен");
+        if (request.endpoint == "upload_batch.php") return handleUploadBatch(user, parts);
+        if (request.endpoint == "chunk_upload.php") return handleChunkUpload(parts);
+        return handleUpload(user, parts);
+    }
+
+    const QUrlQuery form(QString::fromUtf8(request.body));
+    if (request.endpoint == "auth.php") return handleAuth(form);
+
+    const QString user = userForToken(formValue(form, "token_api"));
+    if (request.endpoint == "session_check.php") return handleSessionCheck(user);
+    if (user.isEmpty()) return errorResponse(401, "Неверный токен");
+    if (request.endpoint == "user_files.php") return handleUserFiles(user);
+    if (request.endpoint == "file_info.php") return handleFileInfo(form);
+    if (request.endpoint == "chunk_query.php") return handleChunkQuery(form);
+    if (request.endpoint == "chunk_commit.php") return handleChunkCommit(user, form);
+    return errorResponse(404, "Нет такого эндпоинта");
+}
+
+StandInServer::Response StandInServer::handleAuth(const QUrlQuery &form)
+{
+    const QString username = formValue(form, "username").trimmed();
+    if (username.isEmpty() || formValue(form, "password").isEmpty()) {
+        return errorResponse(401, "Неверный логин или пароль");
+    }
+    const QString token = QString::fromLatin1(randomBytes(16).toHex());
+    tokens.insert(token, username);
+    seedUser(username);
+    QJsonObject result;
+    result.insert("status", "success");
+    result.insert("token_api", token);
+    result.insert("role", username.startsWith("admin") ? "admin" : "user");
+    return jsonResponse(200, result);
+}
+
+StandInServer::Response StandInServer::handleSessionCheck(const QString &user)
+{
+    if (user.isEmpty()) return errorResponse(401, "Сессия истекла");
+    QJsonObject result;
+    result.insert("status", "success");
+    result.insert("role", user.startsWith("admin") ? "admin" : "user");
+    return jsonResponse(200, result);
+}
+
+StandInServer::Response StandInServer::handleUserFiles(const QString &user)
+{
+    QJsonArray list;
+    for (const QString &id : userFiles.value(user)) {
+        const StoredFile &file = files[id];
+        QJsonObject entry;
+        entry.insert("id", file.id);
+        entry.insert("file_name", file.name);
+        entry.insert("owner_name", file.owner);
+        entry.insert("file_size", QString::number(file.data.size()));
+        entry.insert("file_url", fileUrl(file));
+        entry.insert("upload_date", file.uploaded.toString("yyyy-MM-dd HH:mm:ss"));
+        entry.insert("count_views", QString::number(file.views));
+        list.append(entry);
+    }
+    QJsonObject result;
+    result.insert("status", "success");
+    result.insert("files", list);
+    return jsonResponse(200, result);
+}
+
+StandInServer::Response StandInServer::handleFileInfo(const QUrlQuery &form)
+{
+    const QString id = filesByUrl.value(formValue(form, "file_url"));
+    if (id.isEmpty()) return errorResponse(404, "Файл не найден");
+    StoredFile &file = files[id];
+    file.views++;
+    QJsonObject result;
+    result.insert("status", "success");
+    result.insert("id", file.id);
+    result.insert("file_name", file.name);
+    result.insert("file_size", QString::number(file.data.size()));
+    result.insert("owner_name", file.owner);
+    result.insert("upload_date", file.uploaded.toString("yyyy-MM-dd HH:mm:ss"));
+    result.insert("count_views", QString::number(file.views));
+    result.insert("count_downloads", QString::number(file.downloads));
+    return jsonResponse(200, result);
+}
+
+StandInServer::Response StandInServer::handleUpload(const QString &user, const QHash<QByteArray, FormPart> &parts)
+{
+    const FormPart filePart = parts.value("file");
+    if (filePart.fileName.isEmpty()) return errorResponse(400, "Нет файла в запросе");
+
+    QByteArray data = filePart.data;
+    const QByteArray encoding = parts.value("content_encoding").data;
+    if (!encoding.isEmpty() && encoding != "identity") {
+        // Сжатое тело (см. ApiClient::startFullUpload) - храним исходный файл
+        StreamDecoder decoder(encoding);
+        QByteArray decoded;
+        if (!decoder.isSupported() || !decoder.decode(data, &decoded) || !decoder.finish()) {
+            return errorResponse(400, "Не удалось распаковать файл: " + decoder.errorString());
+        }
+        data = decoded;
+    }
+    const QString id = addFile(user, QString::fromUtf8(filePart.fileName), data);
+    QJsonObject result;
+    result.insert("status", "success");
+    result.insert("file_id", id);
+    result.insert("sha256", QString::fromLatin1(files[id].sha256));
+    return jsonResponse(200, result);
+}
+
+StandInServer::Response StandInServer::handleUploadBatch(const QString &user, const QHash<QByteArray, FormPart> &parts)
+{
+    QList<BatchArchive::Entry> entries;
+    QString errorString;
+    if (!BatchArchive::unpack(parts.value("batch").data, &entries, &errorString)) return errorResponse(400, errorString);
+    if (entries.count() > BatchArchive::kMaxBatchFiles) return errorResponse(413, "Слишком много файлов в пакете");
+
+    QJsonArray results;
+    for (const BatchArchive::Entry &entry : entries) {
+        QJsonObject result;
+        result.insert("file_name", entry.name);
+        const QByteArray sha256 = QCryptographicHash::hash(entry.data, QCryptographicHash::Sha256).toHex();
+        if (entry.name.isEmpty() || sha256 != entry.sha256) {
+            result.insert("status", "error");
+            result.insert("message", entry.name.isEmpty() ? "Пустое имя файла" : "Контрольная сумма не совпадает");
+        } else {
+            const QString id = addFile(user, entry.name, entry.data);
+            result.insert("status", "success");
+            result.insert("file_id", id);
+            result.insert("sha256", QString::fromLatin1(sha256));
+        }
+        results.append(result);
+    }
+    QJsonObject response;
+    response.insert("status", "success");
+    response.insert("files", results);
+    return jsonResponse(200, response);
+}
+
+StandInServer::Response StandInServer::handleDownload(const Request &request)
+{
+    if (userForToken(request.query.queryItemValue("token_api", QUrl::FullyDecoded)).isEmpty()) {
+        return errorResponse(401, "Неверный токен");
+    }
+    auto it = files.find(request.query.queryItemValue("file_id"));
+    if (it == files.end()) return errorResponse(404, "Файл не найден");
+    StoredFile &file = it.value();
+
+    Response response;
+    response.contentType = "application/octet-stream";
+    response.headers.append({"ETag", "\"" + file.sha256 + "\""});
+    response.headers.append({"X-Content-SHA256", file.sha256});
+    response.headers.append({"Accept-Ranges", "bytes"});
+    if (request.headers.value("if-none-match").contains(file.sha256)) {
+        response.status = 304;
+        return response;
+    }
+    file.downloads++;
+
+    const QByteArray range = request.headers.value("range");
+    if (range.startsWith("bytes=")) {
+        // Только открытый диапазон "bytes=N-" - так дозапрашивает ApiClient
+        bool ok = false;
+        const qint64 from = range.mid(6).split('-').value(0).toLongLong(&ok);
+        if (!ok || from >= file.data.size()) {
+            response.status = 416;
+            response.headers.append({"Content-Range", "bytes */" + QByteArray::number(file.data.size())});
+            return response;
+        }
+        response.status = 206;
+        response.headers.append({"Content-Range", "bytes " + QByteArray::number(from) + "-"
+                                                      + QByteArray::number(file.data.size() - 1) + "/"
+                                                      + QByteArray::number(file.data.size())});
+        response.body = file.data.mid(from);
+        return response;
+    }
+    response.body = file.data;
+    return response;
+}
+
+StandInServer::Response StandInServer::handleChunkQuery(const QUrlQuery &form)
+{
+    // Куски общие для всех пользователей, как и дедупликация на настоящем сервере
+    QJsonArray missing;
+    for (const QString &hash : formValue(form, "chunks").split(',', Qt::SkipEmptyParts)) {
+        if (!chunks.contains(hash.toLatin1().toLower())) missing.append(hash);
+    }
+    QJsonObject result;
+    result.insert("status", "success");
+    result.insert("missing", missing);
+    return jsonResponse(200, result);
+}
+
+StandInServer::Response StandInServer::handleChunkUpload(const QHash<QByteArray, FormPart> &parts)
+{
+    const QByteArray hash = parts.value("sha256").data.toLower();
+    const QByteArray data = parts.value("chunk").data;
+    if (QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex() != hash) {
+        return errorResponse(400, "Контрольная сумма куска не совпадает");
+    }
+    if (!chunks.contains(hash)) {
+        chunks.insert(hash, data);
+        chunkOrder.append(hash);
+        chunkBytes += data.size();
+        while (chunkBytes > kMaxChunkStoreSize && chunkOrder.size() > 1) {
+            chunkBytes -= chunks.take(chunkOrder.takeFirst()).size();
+        }
+    }
+    QJsonObject result;
+    result.insert("status", "success");
+    return jsonResponse(200, result);
+}
+
+StandInServer::Response StandInServer::handleChunkCommit(const QString &user, const QUrlQuery &form)
+{
+    const QString name = formValue(form, "file_name");
+    if (name.isEmpty()) return errorResponse(400, "Пустое имя файла");
+    QByteArray data;
+    const qint64 declaredSize = formValue(form, "file_size").toLongLong();
+    if (declaredSize > 0 && declaredSize <= kMaxBodySize) data.reserve(declaredSize);
+    for (const QString &hash : formValue(form, "chunks").split(',', Qt::SkipEmptyParts)) {
+        auto it = chunks.constFind(hash.toLatin1().toLower());
+        if (it == chunks.constEnd()) return errorResponse(409, "Нет куска " + hash);
+        data += it.value();
+    }
+    const QByteArray sha256 = QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+    if (data.size() != declaredSize || sha256 != formValue(form, "sha256").toLatin1().toLower()) {
+        return errorResponse(400, "Собранный файл не совпадает с заявленным");
+    }
+    const QString id = addFile(user, name, data);
+    QJsonObject result;
+    result.insert("status", "success");
+    result.insert("file_id", id);
+    result.insert("sha256", QString::fromLatin1(sha256));
+    return jsonResponse(200, result);
+}
+
+QString StandInServer::userForToken(const QString &token) const
+{
+    return tokens.value(token);
+}
+
+void StandInServer::seedUser(const QString &user)
+{
+    if (userFiles.contains(user)) return;
+    userFiles.insert(user, QStringList());
+    // Тела общие для всех пользователей (QByteArray разделяет данные) - тысячи виртуальных
+    // пользователей не съедают память
+    while (seedContent.size() < kSeedFiles) seedContent.append(randomBytes(kSeedFileSize));
+    for (int i = 0; i < kSeedFiles; ++i) {
+        addFile(user, QString("sample_%1.bin").arg(i + 1, 2, 10, QChar('0')), seedContent.at(i));
+    }
+}
+
+QString StandInServer::addFile(const QString &user, const QString &name, const QByteArray &data)
+{
+    StoredFile file;
+    file.id = QString::number(nextFileId++);
+    file.urlId = QString::fromLatin1(randomBytes(8).toHex());
+    file.name = name;
+    file.owner = user;
+    file.data = data;
+    file.sha256 = QCryptographicHash::hash(data, QCryptographicHash::Sha256).toHex();
+    file.uploaded = QDateTime::currentDateTime();
+    files.insert(file.id, file);
+    filesByUrl.insert(file.urlId, file.id);
+
+    QStringList &owned = userFiles[user];
+    owned.append(file.id);
+    while (owned.size() > kMaxFilesPerUser) {
+        const StoredFile old = files.take(owned.takeFirst());
+        filesByUrl.remove(old.urlId);
+    }
+    return file.id;
+}
+
+QString StandInServer::fileUrl(const StoredFile &file) const
+{
+    return baseUrl() + "f/" + file.urlId;
+}
+
+StandInServer::Response StandInServer::jsonResponse(int status, const QJsonObject &object)
+{
+    Response response;
+    response.status = status;
+    response.body = QJsonDocument(object).toJson(QJsonDocument::Compact);
+    return response;
+}
+
+StandInServer::Response StandInServer::errorResponse(int status, const QString &message)
+{
+    QJsonObject object;
+    object.insert("status", "error");
+    object.insert("message", message);
+    return jsonResponse(status, object);
+}
+
+// multipart/form-data в том виде, как его собирает ApiClient::postMultipart
+QHash<QByteArray, StandInServer::FormPart> StandInServer::parseMultipart(const Request &request)
+{
+    QHash<QByteArray, FormPart> parts;
+    const QByteArray contentType = request.headers.value("content-type");
+    const int boundaryAt = contentType.indexOf("boundary=");
+    if (boundaryAt < 0) return parts;
+    QByteArray boundary = contentType.mid(boundaryAt + 9);
+    if (boundary.startsWith('"')) boundary = boundary.mid(1, boundary.indexOf('"', 1) - 1);
+    const QByteArray delimiter = "--" + boundary;
+
+    qsizetype pos = request.body.indexOf(delimiter);
+    while (pos >= 0) {
+        pos += delimiter.size();
+        if (request.body.mid(pos, 2) == "--") break; // Последний разделитель
+        const qsizetype headStart = pos + 2;         // После \r\n
+        const qsizetype headEnd = request.body.indexOf("\r\n\r\n", headStart);
+        if (headEnd < 0) break;
+        const qsizetype next = request.body.indexOf("\r\n" + delimiter, headEnd + 4);
+        if (next < 0) break;
+
+        const QByteArray head = request.body.mid(headStart, headEnd - headStart);
+        FormPart part;
+        part.data = request.body.mid(headEnd + 4, next - headEnd - 4);
+        QByteArray name;
+        for (const QByteArray &line : head.split('\n')) {
+            if (!line.toLower().startsWith("content-disposition:")) continue;
+            for (const QByteArray &param : line.split(';')) {
+                const QByteArray trimmed = param.trimmed();
+                if (trimmed.startsWith("name=")) name = trimmed.mid(5).replace('"', "");
+                else if (trimmed.startsWith("filename=")) part.fileName = trimmed.mid(9).replace('"', "");
+            }
+        }
+        if (!name.isEmpty()) parts.insert(name, part);
+        pos = next + 2;
+    }
+    return parts;
+}
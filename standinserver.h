@@ -0,0 +1,118 @@
+#ifndef STANDINSERVER_H
+#define STANDINSERVER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QDateTime>
+#include <QHash>
+#include <QHostAddress>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QUrlQuery>
+#include <atomic>
+
+class QTcpServer;
+class QTcpSocket;
+class QJsonObject;
+
+// Локальная замена API-сервера для разработки и нагрузочных прогонов (--loadgen --standin,
+// --standin-server). Понимает HTTP/1.1 с keep-alive и основные эндпоинты клиента:
+// auth.php, session_check.php, user_files.php, file_info.php, upload_file.php, upload_batch.php
+// (см. BatchArchive), chunk_query.php/chunk_upload.php/chunk_commit.php (см. DeltaUpload),
+// download_file.php (с Range, If-None-Match и X-Content-SHA256).
+// Остальные отвечают 404 - клиент для них уже умеет откатываться на старое поведение. Все данные только в памяти; любой непустой пароль
+// подходит, имена с префиксом "admin" получают роль администратора.
+// Объект можно перенести в отдельный поток (moveToThread) и вызвать listen() уже там
+class StandInServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int kSeedFiles = 20;                     // Файлов у нового пользователя
+    static const int kSeedFileSize = 64 * 1024;
+    static const int kMaxFilesPerUser = 200;              // Старые загрузки вытесняются
+    static const qint64 kMaxBodySize = 256LL * 1024 * 1024;
+    static const qint64 kMaxChunkStoreSize = 1024LL * 1024 * 1024; // Дальше куски вытесняются (сборка получит 409)
+
+    explicit StandInServer(QObject *parent = nullptr);
+
+    bool listen(const QHostAddress &address = QHostAddress::LocalHost, quint16 port = 0); // 0 - любой свободный
+    quint16 port() const;
+    QString baseUrl() const; // Адрес для ApiClient, например "http://127.0.0.1:8080/api/"
+    qint64 requestsServed() const;
+
+private:
+    struct StoredFile {
+        QString id;
+        QString urlId;
+        QString name;
+        QString owner;
+        QByteArray data;
+        QByteArray sha256; // hex
+        QDateTime uploaded;
+        int views = 0;
+        int downloads = 0;
+    };
+
+    struct Request {
+        QByteArray method;
+        QString endpoint; // Последний сегмент пути ("auth.php")
+        QUrlQuery query;
+        QHash<QByteArray, QByteArray> headers; // Имена в нижнем регистре
+        QByteArray body;
+    };
+
+    struct Response {
+        int status = 200;
+        QByteArray contentType = "application/json";
+        QList<QPair<QByteArray, QByteArray>> headers;
+        QByteArray body;
+    };
+
+    struct FormPart {
+        QByteArray fileName; // Пусто у обычных полей
+        QByteArray data;
+    };
+
+    QTcpServer *tcpServer;
+    QHash<QTcpSocket *, QByteArray> pending; // Недочитанные запросы по соединениям
+    QHash<QString, QString> tokens;          // Токен -> имя пользователя
+    QHash<QString, StoredFile> files;        // ID -> файл
+    QHash<QString, QString> filesByUrl;      // Идентификатор из file_url -> ID
+    QHash<QString, QStringList> userFiles;   // Имя -> ID в порядке загрузки
+    QList<QByteArray> seedContent;           // Общие тела начальных файлов
+    QHash<QByteArray, QByteArray> chunks;    // Куски загрузок по частям: hex SHA-256 -> данные
+    QList<QByteArray> chunkOrder;            // Порядок поступления кусков (для вытеснения)
+    qint64 chunkBytes;
+    quint64 nextFileId;
+    std::atomic<qint64> served;
+
+    void acceptConnections();
+    void readRequests(QTcpSocket *socket);
+    void writeResponse(QTcpSocket *socket, const Response &response, bool keepAlive);
+    Response handle(const Request &request);
+
+    Response handleAuth(const QUrlQuery &form);
+    Response handleSessionCheck(const QString &user);
+    Response handleUserFiles(const QString &user);
+    Response handleFileInfo(const QUrlQuery &form);
+    Response handleUpload(const QString &user, const QHash<QByteArray, FormPart> &parts);
+    Response handleUploadBatch(const QString &user, const QHash<QByteArray, FormPart> &parts);
+    Response handleDownload(const Request &request);
+    Response handleChunkQuery(const QUrlQuery &form);
+    Response handleChunkUpload(const QHash<QByteArray, FormPart> &parts);
+    Response handleChunkCommit(const QString &user, const QUrlQuery &form);
+
+    QString userForToken(const QString &token) const;
+    void seedUser(const QString &user);
+    QString addFile(const QString &user, const QString &name, const QByteArray &data);
+    QString fileUrl(const StoredFile &file) const;
+
+    static Response jsonResponse(int status, const QJsonObject &object);
+    static Response errorResponse(int status, const QString &message);
+    static QHash<QByteArray, FormPart> parseMultipart(const Request &request);
+};
+
+#endif // STANDINSERVER_H
@@ -0,0 +1,107 @@
+#include "synccli.h"
+#include "apiclient.h"
+#include "syncengine.h"
+#include "bandwidthlimiter.h"
+#include "progressaggregator.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QLocale>
+#include <QTextStream>
+#include <cstring>
+#include <memory>
+
+namespace SyncCli {
+
+const int kConsoleProgressMs = 500; // Период строки прогресса в консоли
+
+bool isRequested(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--sync") == 0) return true;
+    }
+    return false;
+}
+
+int run(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName("FilesExchange");
+    QCoreApplication::setApplicationName("FilesExchangePC");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Синхронизация файлов пользователя FilesExchange в локальную папку");
+    parser.addHelpOption();
+    QCommandLineOption syncOption("sync", "Папка для локальной копии.", "dir");
+    QCommandLineOption userOption("user", "Имя пользователя.", "name");
+    QCommandLineOption passwordOption("password", "Пароль (или переменная окружения FX_PASSWORD).", "password");
+    QCommandLineOption serverOption("server", "Адрес API.", "url", ApiClient::defaultBaseUrl());
+    QCommandLineOption jobsOption("jobs", "Одновременных скачиваний.", "n", "4");
+    QCommandLineOption deleteOption("delete", "Удалять локальные копии файлов, удаленных на сервере.");
+    QCommandLineOption verifyOption("verify", "Сверять SHA-256 локальных копий с манифестом.");
+    QCommandLineOption limitOption("limit-rate", "Ограничение скорости скачивания, КиБ/с (0 - без ограничения).", "kbps");
+    parser.addOptions({syncOption, userOption, passwordOption, serverOption, jobsOption, deleteOption, verifyOption, limitOption});
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    const QString password = parser.isSet(passwordOption) ? parser.value(passwordOption)
+                                                           : qEnvironmentVariable("FX_PASSWORD");
+    if (parser.value(syncOption).isEmpty() || parser.value(userOption).isEmpty() || password.isEmpty()) {
+        err << "Нужно указать --sync <папка>, --user и пароль (--password или FX_PASSWORD)." << Qt::endl;
+        return 2;
+    }
+
+    SyncEngine::Options options;
+    options.targetDir = parser.value(syncOption);
+    options.deleteRemoved = parser.isSet(deleteOption);
+    options.verifyHashes = parser.isSet(verifyOption);
+    options.maxParallel = parser.value(jobsOption).toInt();
+
+    ApiClient client(parser.value(serverOption));
+    if (parser.isSet(limitOption)) {
+        // Только на этот запуск: сохраненные настройки GUI не меняются
+        client.bandwidthLimiter()->setGlobalLimit(BandwidthLimiter::Download, parser.value(limitOption).toLongLong() * 1024);
+    }
+
+    QObject::connect(&client, &ApiClient::loginFailed, &app, [&](const QString &errorString, int) {
+        err << "Ошибка входа: " << errorString << Qt::endl;
+        app.exit(1);
+    });
+    QObject::connect(&client, &ApiClient::loginSuccess, &app, [&](const QString &token, const QString &) {
+        SyncEngine *engine = new SyncEngine(&client, token, options, &app);
+        QObject::connect(engine, &SyncEngine::statusChanged, &app, [&](const QString &text) {
+            out << text << Qt::endl;
+        });
+        QObject::connect(engine, &SyncEngine::fileFailed, &app, [&](const QString &fileName, const QString &errorString) {
+            err << "Ошибка: " << fileName << ": " << errorString << Qt::endl;
+        });
+        // Строка на каждый файл при тысячах мелких файлов упирается в вывод - печатаем дважды в секунду
+        ProgressAggregator *rate = new ProgressAggregator(engine, kConsoleProgressMs);
+        auto files = std::make_shared<QPair<int, int>>(0, 0);
+        QObject::connect(engine, &SyncEngine::progress, rate, [rate, files](int done, int total, qint64 bytes) {
+            *files = qMakePair(done, total);
+            rate->update(bytes, -1);
+        });
+        QObject::connect(rate, &ProgressAggregator::progressChanged, &app, [&out, files](const TransferProgress &progress) {
+            out << QString("[%1/%2] %3").arg(files->first).arg(files->second).arg(ProgressAggregator::describe(progress)) << Qt::endl;
+        });
+        QObject::connect(engine, &SyncEngine::finished, &app, [&, rate](const SyncReport &report) {
+            rate->reset(); // Итог ниже, промежуточная строка после него не нужна
+            out << QString("Файлов на сервере: %1, скачано: %2, без изменений: %3, удалено: %4, изменено локально: %5, ошибок: %6")
+                       .arg(report.remoteFiles).arg(report.downloaded).arg(report.unchanged)
+                       .arg(report.deleted).arg(report.skipped).arg(report.failed) << Qt::endl;
+            out << QString("Время: %1 с, %2 файлов/с, %3/с")
+                       .arg(report.elapsedMs / 1000.0, 0, 'f', 1)
+                       .arg(report.filesPerSecond(), 0, 'f', 1)
+                       .arg(QLocale::system().formattedDataSize(static_cast<qint64>(report.bytesPerSecond()))) << Qt::endl;
+            app.exit(report.failed == 0 ? 0 : 1);
+        });
+        engine->start();
+    });
+
+    client.login(parser.value(userOption), password);
+    return app.exec();
+}
+
+}
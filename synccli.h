@@ -0,0 +1,15 @@
+#ifndef SYNCCLI_H
+#define SYNCCLI_H
+
+// Режим командной строки: синхронизация файлов пользователя в папку без GUI.
+//   FilesExchangePC --sync <папка> --user <имя> [--password <пароль>] [--server <url>]
+//                   [--jobs N] [--delete] [--verify]
+// Пароль можно передать через переменную окружения FX_PASSWORD
+namespace SyncCli {
+
+bool isRequested(int argc, char *argv[]);
+int run(int argc, char *argv[]);
+
+}
+
+#endif // SYNCCLI_H
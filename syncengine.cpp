@@ -0,0 +1,344 @@
+#include "syncengine.h"
+#include "apiclient.h"
+#include "requesthandle.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QSet>
+#include <QDebug>
+#include <QtConcurrent/QtConcurrentRun>
+
+const char *const SyncEngine::kManifestName = ".fx-manifest.json";
+
+namespace {
+
+const int kManifestVersion = 1;
+
+// Манифест сохраняется и по ходу синхронизации, чтобы прерванный проход не начинался с нуля
+const int kManifestSaveEvery = 25;
+
+QByteArray hashFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) return QByteArray();
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    hash.addData(&file);
+    return hash.result().toHex();
+}
+
+}
+
+SyncEngine::SyncEngine(ApiClient *client, const QString &token, const Options &options, QObject *parent)
+    : QObject(parent),
+      apiClient(client),
+      apiToken(token),
+      options(options),
+      inFlight(0),
+      downloadsTotal(0),
+      downloadsDone(0),
+      cancelled(false),
+      running(false)
+{
+    this->options.maxParallel = qMax(1, options.maxParallel);
+}
+
+void SyncEngine::start()
+{
+    if (running) return;
+    running = true;
+    cancelled = false;
+    report = SyncReport();
+    timer.start();
+
+    if (!QDir().mkpath(options.targetDir)) {
+        report.errors.append(QString("Не удалось создать папку %1").arg(options.targetDir));
+        report.failed++;
+        finish();
+        return;
+    }
+    loadManifest();
+
+    emit statusChanged("Получение списка файлов...");
+    // Список приходит общим сигналом ApiClient - слушаем только один ответ
+    listSuccessConnection = connect(apiClient, &ApiClient::userFilesSuccess, this, [this](const QList<FileInfo> &files) {
+        disconnect(listSuccessConnection);
+        disconnect(listFailedConnection);
+        handleFileList(files);
+    });
+    listFailedConnection = connect(apiClient, &ApiClient::userFilesFailed, this, [this](const QString &errorString, int) {
+        disconnect(listSuccessConnection);
+        disconnect(listFailedConnection);
+        report.errors.append(errorString);
+        report.failed++;
+        finish();
+    });
+    apiClient->getUserFiles(apiToken);
+}
+
+void SyncEngine::cancel()
+{
+    if (!running || cancelled) return;
+    cancelled = true;
+    queue.clear();
+    qDebug() << "SyncEngine: Синхронизация остановлена пользователем.";
+    if (inFlight == 0) finish();
+}
+
+void SyncEngine::handleFileList(const QList<FileInfo> &files)
+{
+    if (cancelled) {
+        finish();
+        return;
+    }
+    report.remoteFiles = files.count();
+    emit statusChanged(QString("Сверка %1 файлов с локальной копией...").arg(files.count()));
+
+    // Сверка читает диск (а с verifyHashes - и хэширует файлы), поэтому идет в пуле потоков
+    QFutureWatcher<Plan> *watcher = new QFutureWatcher<Plan>(this);
+    connect(watcher, &QFutureWatcher<Plan>::finished, this, [this, watcher]() {
+        applyPlan(watcher->result());
+        watcher->deleteLater();
+    });
+    watcher->setFuture(QtConcurrent::run(&SyncEngine::buildPlan, files, manifest, options.targetDir, options.verifyHashes,
+                                         options.deleteRemoved));
+}
+
+SyncEngine::Plan SyncEngine::buildPlan(const QList<FileInfo> &files, const QHash<QString, ManifestEntry> &manifest,
+                                       const QString &targetDir, bool verifyHashes, bool checkRemoved)
+{
+    Plan plan;
+    QDir dir(targetDir);
+    QSet<QString> remoteIds;
+    QSet<QString> usedNames;
+
+    // Имена, уже занятые файлами из манифеста, закреплены за своими ID
+    for (auto it = manifest.constBegin(); it != manifest.constEnd(); ++it) {
+        usedNames.insert(it->localName.toLower());
+    }
+
+    for (const FileInfo &file : files) {
+        remoteIds.insert(file.id);
+        PlanItem item;
+        item.remote = file;
+
+        auto entry = manifest.constFind(file.id);
+        if (entry != manifest.constEnd()) {
+            item.localName = entry->localName;
+            const QFileInfo local(dir.filePath(entry->localName));
+            const bool remoteChanged = entry->remoteSize != file.fileSize || entry->uploadDate != file.uploadDate;
+            if (!local.exists()) {
+                item.needsDownload = true; // Локальная копия удалена - восстанавливаем
+            } else if (isLocallyModified(local, *entry, verifyHashes || remoteChanged)) {
+                // Правки пользователя важнее: копия остается как есть, даже если файл заменен на сервере.
+                // Без verifyHashes хэш считается только перед перезаписью
+                item.locallyModified = true;
+            } else if (remoteChanged) {
+                item.needsDownload = true; // Файл заменен на сервере
+            }
+        } else {
+            // Новый файл: одинаковые имена разных файлов и чужие файлы в папке не перезаписываем,
+            // а разводим по ID
+            const QString sanitized = sanitizeFileName(file.fileName);
+            QString name = sanitized;
+            const QFileInfo nameInfo(sanitized);
+            const QString suffix = nameInfo.completeSuffix().isEmpty() ? QString() : "." + nameInfo.completeSuffix();
+            for (int attempt = 1; usedNames.contains(name.toLower()) || dir.exists(name); ++attempt) {
+                const QString tag = attempt == 1 ? file.id : QString("%1-%2").arg(file.id).arg(attempt);
+                name = nameInfo.baseName() + QString(" (%1)").arg(tag) + suffix;
+            }
+            usedNames.insert(name.toLower());
+            item.localName = name;
+            item.needsDownload = true;
+        }
+        plan.items.append(item);
+    }
+
+    for (auto it = manifest.constBegin(); it != manifest.constEnd(); ++it) {
+        if (remoteIds.contains(it.key())) continue;
+        plan.removedIds.append(it.key());
+        // Удаление необратимо: перед ним сверяем копию с манифестом и по хэшу
+        const QFileInfo local(dir.filePath(it->localName));
+        if (checkRemoved && local.exists() && isLocallyModified(local, *it, true)) plan.modifiedIds.append(it.key());
+    }
+    return plan;
+}
+
+bool SyncEngine::isLocallyModified(const QFileInfo &local, const ManifestEntry &entry, bool verifyHash)
+{
+    if (local.size() != entry.localSize) return true;
+    return verifyHash && hashFile(local.filePath()) != entry.sha256;
+}
+
+void SyncEngine::applyPlan(const Plan &plan)
+{
+    if (cancelled) return; // finish() уже вызван из cancel()
+    QDir dir(options.targetDir);
+    for (const QString &id : plan.removedIds) {
+        if (!options.deleteRemoved) continue;
+        const ManifestEntry entry = manifest.take(id);
+        if (plan.modifiedIds.contains(id)) {
+            // Файл больше не синхронизируется, но правки пользователя остаются на диске
+            qWarning() << "SyncEngine: Локальная копия изменена, не удалена:" << entry.localName;
+            report.skipped++;
+            report.errors.append(QString("%1: изменен локально, не удален").arg(entry.localName));
+            continue;
+        }
+        if (QFile::remove(dir.filePath(entry.localName)) || !QFileInfo::exists(dir.filePath(entry.localName))) {
+            qDebug() << "SyncEngine: Удалена локальная копия" << entry.localName;
+            report.deleted++;
+        }
+    }
+
+    for (const PlanItem &item : plan.items) {
+        if (item.locallyModified) {
+            qWarning() << "SyncEngine: Локальная копия изменена, не перезаписана:" << item.localName;
+            report.skipped++;
+            report.errors.append(QString("%1: изменен локально, не перезаписан").arg(item.localName));
+        } else if (item.needsDownload) {
+            queue.enqueue(item);
+        } else {
+            report.unchanged++;
+        }
+    }
+    downloadsTotal = queue.count();
+    qDebug() << "SyncEngine: К скачиванию:" << downloadsTotal << "без изменений:" << report.unchanged
+             << "удалено:" << report.deleted << "изменено локально:" << report.skipped;
+    emit statusChanged(QString("Скачивание %1 файлов...").arg(downloadsTotal));
+    emit progress(0, downloadsTotal, 0);
+    dispatch();
+}
+
+void SyncEngine::dispatch()
+{
+    while (!cancelled && inFlight < options.maxParallel && !queue.isEmpty()) {
+        inFlight++;
+        downloadItem(queue.dequeue());
+    }
+    if (inFlight == 0 && (queue.isEmpty() || cancelled)) finish();
+}
+
+void SyncEngine::downloadItem(const PlanItem &item)
+{
+    // Тело пишется прямо в целевой каталог через QSaveFile, хэш считается по ходу приема:
+    // в памяти только текущий кусок, а не весь файл
+    const QString path = QDir(options.targetDir).filePath(item.localName);
+    RequestHandle *handle = apiClient->downloadFileTo(apiToken, item.remote.id, item.remote.fileName, path);
+    connect(handle, &RequestHandle::jsonReady, this, [this, item](const QJsonObject &result) {
+        ManifestEntry entry;
+        entry.fileName = item.remote.fileName;
+        entry.remoteSize = item.remote.fileSize;
+        entry.uploadDate = item.remote.uploadDate;
+        entry.localName = item.localName;
+        entry.localSize = result.value("size").toInteger();
+        entry.sha256 = result.value("sha256").toString().toLatin1();
+        manifest.insert(item.remote.id, entry);
+        report.downloaded++;
+        report.bytesDownloaded += entry.localSize;
+        itemFinished();
+    });
+    connect(handle, &RequestHandle::failed, this, [this, item](const QString &errorString, int) {
+        qWarning() << "SyncEngine: Не удалось скачать" << item.remote.fileName << ":" << errorString;
+        report.failed++;
+        report.errors.append(QString("%1: %2").arg(item.remote.fileName, errorString));
+        emit fileFailed(item.remote.fileName, errorString);
+        itemFinished();
+    });
+}
+
+void SyncEngine::itemFinished()
+{
+    inFlight--;
+    downloadsDone++;
+    emit progress(downloadsDone, downloadsTotal, report.bytesDownloaded);
+    if (downloadsDone % kManifestSaveEvery == 0) saveManifest();
+    dispatch();
+}
+
+void SyncEngine::finish()
+{
+    if (!running) return;
+    running = false;
+    saveManifest();
+    report.elapsedMs = timer.elapsed();
+    qDebug() << "SyncEngine: Готово. Скачано:" << report.downloaded << "без изменений:" << report.unchanged
+             << "удалено:" << report.deleted << "изменено локально:" << report.skipped << "ошибок:" << report.failed
+             << QString("(%1 файлов/с, %2 байт/с)").arg(report.filesPerSecond(), 0, 'f', 1).arg(report.bytesPerSecond(), 0, 'f', 0);
+    emit finished(report);
+}
+
+QString SyncEngine::manifestPath() const
+{
+    return QDir(options.targetDir).filePath(kManifestName);
+}
+
+bool SyncEngine::loadManifest()
+{
+    manifest.clear();
+    QFile file(manifestPath());
+    if (!file.open(QIODevice::ReadOnly)) return false; // Первая синхронизация в эту папку
+
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    if (root.value("version").toInt() != kManifestVersion) {
+        qWarning() << "SyncEngine: Манифест неизвестной версии, все файлы будут сверены заново:" << manifestPath();
+        return false;
+    }
+    const QJsonObject files = root.value("files").toObject();
+    for (auto it = files.constBegin(); it != files.constEnd(); ++it) {
+        const QJsonObject obj = it.value().toObject();
+        ManifestEntry entry;
+        entry.fileName = obj.value("file_name").toString();
+        entry.remoteSize = obj.value("file_size").toString();
+        entry.uploadDate = obj.value("upload_date").toString();
+        entry.localName = obj.value("local_name").toString();
+        entry.localSize = obj.value("local_size").toInteger();
+        entry.sha256 = obj.value("sha256").toString().toLatin1();
+        if (!entry.localName.isEmpty()) manifest.insert(it.key(), entry);
+    }
+    qDebug() << "SyncEngine: Манифест загружен, записей:" << manifest.count();
+    return true;
+}
+
+bool SyncEngine::saveManifest() const
+{
+    QJsonObject files;
+    for (auto it = manifest.constBegin(); it != manifest.constEnd(); ++it) {
+        QJsonObject obj;
+        obj.insert("file_name", it->fileName);
+        obj.insert("file_size", it->remoteSize);
+        obj.insert("upload_date", it->uploadDate);
+        obj.insert("local_name", it->localName);
+        obj.insert("local_size", it->localSize);
+        obj.insert("sha256", QString::fromLatin1(it->sha256));
+        files.insert(it.key(), obj);
+    }
+    QJsonObject root;
+    root.insert("version", kManifestVersion);
+    root.insert("files", files);
+
+    QSaveFile file(manifestPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "SyncEngine: Не удалось сохранить манифест:" << file.errorString();
+        return false;
+    }
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+    return file.commit();
+}
+
+QString SyncEngine::sanitizeFileName(const QString &name)
+{
+    QString result = name;
+    static const QString forbidden = "/\\:*?\"<>|";
+    for (QChar &ch : result) {
+        if (forbidden.contains(ch) || ch.unicode() < 32) ch = '_';
+    }
+    result = result.trimmed();
+    if (result.isEmpty() || result == "." || result == ".." || result == SyncEngine::kManifestName) result = "_" + result;
+    return result;
+}
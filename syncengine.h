@@ -0,0 +1,118 @@
+#ifndef SYNCENGINE_H
+#define SYNCENGINE_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QMetaObject>
+#include <QQueue>
+#include <QString>
+#include <QStringList>
+#include "datatypes.h"
+
+class ApiClient;
+class QFileInfo;
+
+// Итог одного прохода синхронизации
+struct SyncReport {
+    int remoteFiles = 0;
+    int downloaded = 0;
+    int unchanged = 0;
+    int deleted = 0;
+    int skipped = 0; // Локальная копия изменена пользователем - не перезаписана и не удалена
+    int failed = 0;
+    qint64 bytesDownloaded = 0;
+    qint64 elapsedMs = 0;
+    QStringList errors;
+
+    double filesPerSecond() const { return elapsedMs > 0 ? downloaded * 1000.0 / elapsedMs : 0.0; }
+    double bytesPerSecond() const { return elapsedMs > 0 ? bytesDownloaded * 1000.0 / elapsedMs : 0.0; }
+};
+Q_DECLARE_METATYPE(SyncReport)
+
+// Зеркало файлов пользователя (список user_files.php) в локальной папке.
+// Состояние прошлой синхронизации хранится в манифесте .fx-manifest.json в этой же папке:
+// скачиваются только новые и изменившиеся (размер/дата на сервере, размер/хэш на диске) файлы.
+// Чужие файлы в папке и локально измененные копии не перезаписываются и не удаляются
+class SyncEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QString targetDir;
+        bool deleteRemoved = false; // Удалять локальные копии файлов, удаленных на сервере
+        bool verifyHashes = false;  // Сверять SHA-256 локальных копий с манифестом (медленно)
+        int maxParallel = 4;        // Одновременных скачиваний
+    };
+
+    // Одна запись манифеста: что было скачано и куда
+    struct ManifestEntry {
+        QString fileName;
+        QString remoteSize;
+        QString uploadDate;
+        QString localName;
+        qint64 localSize = 0;
+        QByteArray sha256; // hex
+    };
+
+    static const char *const kManifestName;
+
+    explicit SyncEngine(ApiClient *client, const QString &token, const Options &options, QObject *parent = nullptr);
+
+    void start();
+    void cancel(); // Новые скачивания не начинаются, манифест сохраняется
+
+signals:
+    void statusChanged(const QString &text);
+    void progress(int filesDone, int filesTotal, qint64 bytesDone);
+    void fileFailed(const QString &fileName, const QString &errorString);
+    void finished(const SyncReport &report);
+
+private:
+    // Решение по одному файлу, принятое при сверке с манифестом
+    struct PlanItem {
+        FileInfo remote;
+        QString localName;
+        bool needsDownload = false;
+        bool locallyModified = false; // Копию правили на диске: не перезаписываем
+    };
+    struct Plan {
+        QList<PlanItem> items;
+        QStringList removedIds;  // Есть в манифесте, но не на сервере
+        QStringList modifiedIds; // Из removedIds: локальная копия изменена, удалять нельзя
+    };
+
+    ApiClient *apiClient;
+    QString apiToken;
+    Options options;
+    QHash<QString, ManifestEntry> manifest; // ID файла -> запись
+    QQueue<PlanItem> queue;
+    int inFlight;
+    int downloadsTotal;
+    int downloadsDone;
+    bool cancelled;
+    bool running;
+    QElapsedTimer timer;
+    SyncReport report;
+    QMetaObject::Connection listSuccessConnection;
+    QMetaObject::Connection listFailedConnection;
+
+    void handleFileList(const QList<FileInfo> &files);
+    void applyPlan(const Plan &plan);
+    void dispatch();
+    void downloadItem(const PlanItem &item);
+    void itemFinished();
+    void finish();
+
+    bool loadManifest();
+    bool saveManifest() const;
+    QString manifestPath() const;
+    static Plan buildPlan(const QList<FileInfo> &files, const QHash<QString, ManifestEntry> &manifest,
+                          const QString &targetDir, bool verifyHashes, bool checkRemoved);
+    static bool isLocallyModified(const QFileInfo &local, const ManifestEntry &entry, bool verifyHash);
+    static QString sanitizeFileName(const QString &name);
+};
+
+#endif // SYNCENGINE_H
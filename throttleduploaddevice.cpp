@@ -0,0 +1,90 @@
+#include "throttleduploaddevice.h"
+
+#include <cstring>
+
+ThrottledUploadDevice::ThrottledUploadDevice(const QByteArray &head, QIODevice *body, const QByteArray &tail,
+                                             BandwidthLimiter *limiter, QObject *parent)
+    : QIODevice(parent),
+      head(head),
+      body(body),
+      tail(tail),
+      bodySize(body->size()),
+      limiter(limiter)
+{
+    body->setParent(this);
+    wakeTimer.setSingleShot(true);
+    connect(&wakeTimer, &QTimer::timeout, this, &QIODevice::readyRead);
+    // Небуферизованный режим: QIODevice не читает наперед, каждое чтение проходит через ведро
+    QIODevice::open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+}
+
+bool ThrottledUploadDevice::isSequential() const
+{
+    return false; // Размер известен заранее - QNAM выставит Content-Length и сможет перемотать тело
+}
+
+qint64 ThrottledUploadDevice::size() const
+{
+    return head.size() + bodySize + tail.size();
+}
+
+bool ThrottledUploadDevice::seek(qint64 pos)
+{
+    if (pos < 0 || pos > size()) return false;
+    return QIODevice::seek(pos);
+}
+
+bool ThrottledUploadDevice::reset()
+{
+    return seek(0);
+}
+
+qint64 ThrottledUploadDevice::readData(char *data, qint64 maxSize)
+{
+    const qint64 position = pos();
+    maxSize = qMin(maxSize, size() - position);
+    if (maxSize <= 0) return -1; // Конец тела
+
+    if (limiter) {
+        const qint64 granted = limiter->take(BandwidthLimiter::Upload, maxSize, &transferBucket);
+        if (granted == 0) {
+            // Токенов нет: сеть подождет readyRead
+            if (!wakeTimer.isActive()) wakeTimer.start(limiter->retryDelayMs(BandwidthLimiter::Upload, &transferBucket));
+            return 0;
+        }
+        maxSize = granted;
+    }
+
+    qint64 done = 0;
+    // Заголовки полей
+    if (position < head.size()) {
+        const qint64 count = qMin(maxSize, head.size() - position);
+        std::memcpy(data, head.constData() + position, count);
+        done += count;
+    }
+    // Содержимое файла
+    const qint64 bodyPos = position + done - head.size();
+    if (done < maxSize && bodyPos >= 0 && bodyPos < bodySize) {
+        if (body->pos() != bodyPos && !body->seek(bodyPos)) return -1;
+        const qint64 count = body->read(data + done, qMin(maxSize - done, bodySize - bodyPos));
+        if (count < 0) {
+            setErrorString(body->errorString());
+            return -1;
+        }
+        done += count;
+        if (count == 0) return done;
+    }
+    // Закрывающая граница
+    const qint64 tailPos = position + done - head.size() - bodySize;
+    if (done < maxSize && tailPos >= 0 && tailPos < tail.size()) {
+        const qint64 count = qMin(maxSize - done, tail.size() - tailPos);
+        std::memcpy(data + done, tail.constData() + tailPos, count);
+        done += count;
+    }
+    return done;
+}
+
+qint64 ThrottledUploadDevice::writeData(const char *, qint64)
+{
+    return -1;
+}
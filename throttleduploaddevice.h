@@ -0,0 +1,41 @@
+#ifndef THROTTLEDUPLOADDEVICE_H
+#define THROTTLEDUPLOADDEVICE_H
+
+#include <QIODevice>
+#include <QPointer>
+#include <QTimer>
+#include "bandwidthlimiter.h"
+
+// Тело multipart-запроса: заголовки полей + содержимое файла + закрывающая граница.
+// Чтения дозируются BandwidthLimiter: когда токенов нет, read() возвращает 0, а readyRead
+// приходит, когда их снова хватает (QNetworkAccessManager ждет его и продолжает отправку).
+// QHttpMultiPart для этого не годится: он читает части в цикле и не умеет ждать
+class ThrottledUploadDevice : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    // body становится дочерним объектом устройства и должен быть уже открыт
+    ThrottledUploadDevice(const QByteArray &head, QIODevice *body, const QByteArray &tail,
+                          BandwidthLimiter *limiter, QObject *parent = nullptr);
+
+    bool isSequential() const override;
+    qint64 size() const override;
+    bool seek(qint64 pos) override;
+    bool reset() override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    QByteArray head;
+    QIODevice *body;
+    QByteArray tail;
+    qint64 bodySize;
+    QPointer<BandwidthLimiter> limiter;
+    TokenBucket transferBucket;
+    QTimer wakeTimer;
+};
+
+#endif // THROTTLEDUPLOADDEVICE_H
@@ -0,0 +1,206 @@
+#include "tracer.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QNetworkReply>
+#include <QSaveFile>
+#include <QThread>
+#include <QDebug>
+#include <memory>
+
+std::atomic<bool> Tracer::enabled(false);
+
+namespace {
+
+// Состояние записи; события хранятся уже сериализованными, чтобы при выходе только склеить их
+struct TraceLog {
+    QMutex mutex;
+    QString path;
+    QElapsedTimer clock;
+    QList<QByteArray> events;
+    bool overflowReported = false;
+    std::atomic<quint64> nextAsyncId{1};
+    std::atomic<int> nextThreadId{1};
+};
+
+TraceLog &traceLog()
+{
+    static TraceLog log;
+    return log;
+}
+
+qint64 processId()
+{
+    return QCoreApplication::applicationPid();
+}
+
+void append(const QJsonObject &event)
+{
+    TraceLog &log = traceLog();
+    const QByteArray line = QJsonDocument(event).toJson(QJsonDocument::Compact);
+    QMutexLocker locker(&log.mutex);
+    if (log.events.size() >= Tracer::kMaxEvents) {
+        if (!log.overflowReported) {
+            log.overflowReported = true;
+            qWarning() << "Tracer: Достигнут предел" << Tracer::kMaxEvents << "событий, дальнейшие отбрасываются.";
+        }
+        return;
+    }
+    log.events.append(line);
+}
+
+// Короткий номер потока для "tid"; при первом событии потока записывается его имя
+int currentThreadId()
+{
+    thread_local int id = 0;
+    if (id == 0) {
+        id = traceLog().nextThreadId.fetch_add(1);
+        QString name = QThread::currentThread() ? QThread::currentThread()->objectName() : QString();
+        if (name.isEmpty()) {
+            name = QCoreApplication::instance() && QThread::currentThread() == QCoreApplication::instance()->thread()
+                       ? QStringLiteral("GUI") : QString("Поток %1").arg(id);
+        }
+        QJsonObject meta;
+        meta.insert("ph", "M");
+        meta.insert("name", "thread_name");
+        meta.insert("pid", processId());
+        meta.insert("tid", id);
+        meta.insert("args", QJsonObject{{"name", name}});
+        append(meta);
+    }
+    return id;
+}
+
+QJsonObject baseEvent(const char *phase, const char *category, const QString &name, qint64 timestampUs)
+{
+    QJsonObject event;
+    event.insert("ph", QLatin1String(phase));
+    event.insert("cat", QLatin1String(category));
+    event.insert("name", name);
+    event.insert("ts", timestampUs);
+    event.insert("pid", processId());
+    event.insert("tid", currentThreadId());
+    return event;
+}
+
+QString asyncIdString(quint64 id)
+{
+    return QString("0x%1").arg(id, 0, 16);
+}
+
+}
+
+void Tracer::startFromEnvironment()
+{
+    const QString path = qEnvironmentVariable("FX_TRACE");
+    if (!path.isEmpty()) start(path);
+}
+
+void Tracer::start(const QString &filePath)
+{
+    TraceLog &log = traceLog();
+    {
+        QMutexLocker locker(&log.mutex);
+        log.path = filePath;
+        log.events.clear();
+        log.overflowReported = false;
+        log.clock.start();
+    }
+    enabled.store(true, std::memory_order_relaxed);
+    qDebug() << "Tracer: Запись временной шкалы в" << filePath;
+}
+
+void Tracer::finish()
+{
+    if (!enabled.exchange(false)) return;
+    TraceLog &log = traceLog();
+    QMutexLocker locker(&log.mutex);
+    QSaveFile file(log.path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Tracer: Не удалось открыть" << log.path << file.errorString();
+        return;
+    }
+    file.write("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int i = 0; i < log.events.size(); ++i) {
+        if (i > 0) file.write(",\n");
+        file.write(log.events.at(i));
+    }
+    file.write("\n]}\n");
+    if (!file.commit()) {
+        qWarning() << "Tracer: Не удалось записать" << log.path << file.errorString();
+        return;
+    }
+    qDebug() << "Tracer: Записано" << log.events.size() << "событий в" << log.path;
+    log.events.clear();
+}
+
+qint64 Tracer::nowUs()
+{
+    return traceLog().clock.nsecsElapsed() / 1000;
+}
+
+void Tracer::complete(const char *category, const QString &name, qint64 startUs, qint64 durationUs, const QVariantMap &args)
+{
+    if (!isEnabled()) return;
+    QJsonObject event = baseEvent("X", category, name, startUs);
+    event.insert("dur", durationUs);
+    if (!args.isEmpty()) event.insert("args", QJsonObject::fromVariantMap(args));
+    append(event);
+}
+
+quint64 Tracer::asyncBegin(const char *category, const QString &name, const QVariantMap &args)
+{
+    if (!isEnabled()) return 0;
+    const quint64 id = traceLog().nextAsyncId.fetch_add(1);
+    QJsonObject event = baseEvent("b", category, name, nowUs());
+    event.insert("id", asyncIdString(id));
+    if (!args.isEmpty()) event.insert("args", QJsonObject::fromVariantMap(args));
+    append(event);
+    return id;
+}
+
+void Tracer::asyncStep(const char *category, const QString &name, quint64 id, const QString &step)
+{
+    if (!isEnabled() || id == 0) return;
+    QJsonObject event = baseEvent("n", category, name, nowUs());
+    event.insert("id", asyncIdString(id));
+    event.insert("args", QJsonObject{{"step", step}});
+    append(event);
+}
+
+void Tracer::asyncEnd(const char *category, const QString &name, quint64 id, const QVariantMap &args)
+{
+    if (!isEnabled() || id == 0) return;
+    QJsonObject event = baseEvent("e", category, name, nowUs());
+    event.insert("id", asyncIdString(id));
+    if (!args.isEmpty()) event.insert("args", QJsonObject::fromVariantMap(args));
+    append(event);
+}
+
+void Tracer::traceReply(QNetworkReply *reply, const QString &name)
+{
+    if (!isEnabled() || !reply) return;
+    const quint64 id = asyncBegin("network", name, {{"url", reply->url().toString(QUrl::RemoveQuery)}});
+    // Конец отрезка - один раз: по finished или, если ответ удалили раньше, по destroyed
+    std::shared_ptr<bool> ended = std::make_shared<bool>(false);
+    QObject::connect(reply, &QNetworkReply::metaDataChanged, reply, [name, id]() {
+        asyncStep("network", name, id, "headers");
+    });
+    QObject::connect(reply, &QNetworkReply::finished, reply, [reply, name, id, ended]() {
+        if (*ended) return;
+        *ended = true;
+        asyncEnd("network", name, id, {
+            {"status", reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt()},
+            {"error", static_cast<int>(reply->error())},
+            {"bytes", reply->header(QNetworkRequest::ContentLengthHeader).toLongLong()}
+        });
+    });
+    QObject::connect(reply, &QObject::destroyed, [name, id, ended]() {
+        if (*ended) return;
+        *ended = true;
+        asyncEnd("network", name, id, {{"destroyed", true}});
+    });
+}
@@ -0,0 +1,76 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <QVariantMap>
+#include <atomic>
+
+class QNetworkReply;
+
+// Запись временной шкалы в формате Chrome trace events (открывается в Perfetto / chrome://tracing).
+// Включается переменной окружения FX_TRACE=<файл.json>, файл пишется при выходе (finish()).
+// Выключенный трассировщик стоит одной проверки атомарного флага на отрезок:
+// имена - строковые литералы, подробности вычисляются только при включенной записи
+class Tracer
+{
+public:
+    static const int kMaxEvents = 1000000; // Дальше события отбрасываются (~100 МБ JSON)
+
+    static void startFromEnvironment();
+    static void start(const QString &filePath);
+    static void finish(); // Записывает файл и выключает запись
+
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+    static qint64 nowUs();
+
+    // Завершенный отрезок в текущем потоке
+    static void complete(const char *category, const QString &name, qint64 startUs, qint64 durationUs,
+                         const QVariantMap &args = QVariantMap());
+    // Отрезок через несколько обработчиков (жизнь запроса): начало, отметки и конец с одним id
+    static quint64 asyncBegin(const char *category, const QString &name, const QVariantMap &args = QVariantMap());
+    static void asyncStep(const char *category, const QString &name, quint64 id, const QString &step);
+    static void asyncEnd(const char *category, const QString &name, quint64 id, const QVariantMap &args = QVariantMap());
+
+    // Жизнь сетевого запроса: от отправки до заголовков ответа и до конца тела
+    static void traceReply(QNetworkReply *reply, const QString &name);
+
+private:
+    static std::atomic<bool> enabled;
+
+    Tracer() = delete;
+};
+
+// Отрезок от объявления до конца блока
+class TraceScope
+{
+public:
+    TraceScope(const char *category, const char *name)
+        : category(category), name(name), startUs(Tracer::isEnabled() ? Tracer::nowUs() : -1) {}
+    ~TraceScope()
+    {
+        if (startUs >= 0) Tracer::complete(category, QString::fromLatin1(name), startUs, Tracer::nowUs() - startUs, args);
+    }
+
+    bool isActive() const { return startUs >= 0; }
+    void setArg(const QString &key, const QVariant &value) { args.insert(key, value); }
+
+private:
+    const char *category;
+    const char *name;
+    qint64 startUs;
+    QVariantMap args;
+
+    Q_DISABLE_COPY(TraceScope)
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+// TRACE_SCOPE("ui", "populateTable");
+#define TRACE_SCOPE(category, name) TraceScope TRACE_CONCAT(traceScope_, __LINE__)(category, name)
+// TRACE_SCOPE_ARG("parse", "user_files.php", "bytes", data.size()) - значение вычисляется только при записи
+#define TRACE_SCOPE_ARG(category, name, key, value) \
+    TraceScope TRACE_CONCAT(traceScope_, __LINE__)(category, name); \
+    if (TRACE_CONCAT(traceScope_, __LINE__).isActive()) TRACE_CONCAT(traceScope_, __LINE__).setArg(key, value)
+
+#endif // TRACER_H
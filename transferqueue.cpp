@@ -0,0 +1,190 @@
+#include "transferqueue.h"
+#include "apiclient.h"
+#include "batcharchive.h"
+#include "requesthandle.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+
+TransferQueue::TransferQueue(ApiClient *client, QObject *parent)
+    : QObject(parent),
+      apiClient(client),
+      concurrency(kDefaultConcurrency),
+      activeRequests(0),
+      sentRequests(0)
+{
+}
+
+void TransferQueue::setToken(const QString &token)
+{
+    apiToken = token;
+}
+
+void TransferQueue::setConcurrency(int maxInFlight)
+{
+    concurrency = qMax(1, maxInFlight);
+    dispatch();
+}
+
+void TransferQueue::enqueueUpload(const QString &filePath)
+{
+    // Файл, который уже ждет отправки, второй раз не ставим: отправится его текущая версия
+    if (queued.contains(filePath)) return;
+    queued.insert(filePath);
+    queue.enqueue(filePath);
+    dispatch();
+}
+
+bool TransferQueue::contains(const QString &filePath) const
+{
+    return queued.contains(filePath) || inFlight.contains(filePath);
+}
+
+int TransferQueue::pendingCount() const
+{
+    return queue.count() + inFlight.count();
+}
+
+int TransferQueue::requestsSent() const
+{
+    return sentRequests;
+}
+
+void TransferQueue::dispatch()
+{
+    // Каждый элемент очереди просматривается не больше одного раза за проход
+    int remaining = queue.count();
+    while (activeRequests < concurrency && remaining > 0) {
+        if (apiClient->batchUploadsEnabled()) {
+            const QStringList batch = takeBatch();
+            if (!batch.isEmpty()) {
+                remaining -= batch.count();
+                startBatch(batch);
+                continue;
+            }
+        }
+        remaining--;
+        const QString filePath = queue.dequeue();
+        if (inFlight.contains(filePath)) {
+            // Предыдущая версия еще отправляется - эту отправим следом
+            queue.enqueue(filePath);
+            continue;
+        }
+        queued.remove(filePath);
+        inFlight.insert(filePath);
+        activeRequests++;
+        sentRequests++;
+        emit uploadStarted(filePath);
+        qDebug() << "TransferQueue: Отправка" << filePath << "(в очереди еще" << queue.count() << ")";
+
+        RequestHandle *handle = apiClient->upload(apiToken, filePath);
+        connect(handle, &RequestHandle::progress, this, [this, filePath](qint64 bytesSent, qint64 bytesTotal) {
+            emit uploadProgress(filePath, bytesSent, bytesTotal);
+        });
+        connect(handle, &RequestHandle::jsonReady, this, [this, filePath](const QJsonObject &) {
+            activeRequests--;
+            finishUpload(filePath, true, QString());
+            dispatch();
+            if (pendingCount() == 0) emit idle();
+        });
+        connect(handle, &RequestHandle::failed, this, [this, filePath](const QString &errorString, int) {
+            activeRequests--;
+            finishUpload(filePath, false, errorString);
+            dispatch();
+            if (pendingCount() == 0) emit idle();
+        });
+    }
+}
+
+QStringList TransferQueue::takeBatch()
+{
+    QStringList batch;
+    QList<int> taken;
+    qint64 batchBytes = 0;
+    // Просматривается только начало очереди: при длинной очереди больших файлов каждый вызов
+    // иначе перебирал бы (и опрашивал на диске) ее целиком
+    const int window = qMin(queue.count(), kBatchScanWindow);
+    for (int i = 0; i < window && batch.count() < BatchArchive::kMaxBatchFiles; ++i) {
+        const QString &filePath = queue.at(i);
+        if (inFlight.contains(filePath)) continue;
+        const qint64 size = QFileInfo(filePath).size();
+        if (!BatchArchive::isBatchable(size)) continue;
+        if (batchBytes + size > BatchArchive::kMaxBatchBytes) break;
+        batchBytes += size;
+        batch.append(filePath);
+        taken.append(i);
+    }
+    if (batch.count() < BatchArchive::kMinBatchFiles) return QStringList();
+
+    // Большие файлы и ждущие своей очереди версии остаются на месте
+    for (int i = taken.count() - 1; i >= 0; --i) queue.removeAt(taken[i]);
+    for (const QString &filePath : batch) {
+        queued.remove(filePath);
+        inFlight.insert(filePath);
+    }
+    return batch;
+}
+
+void TransferQueue::startBatch(const QStringList &filePaths)
+{
+    activeRequests++;
+    sentRequests++;
+    for (const QString &filePath : filePaths) emit uploadStarted(filePath);
+    qDebug() << "TransferQueue: Отправка пакета из" << filePaths.count() << "файлов (в очереди еще" << queue.count() << ")";
+
+    RequestHandle *handle = apiClient->uploadBatch(apiToken, filePaths);
+    connect(handle, &RequestHandle::jsonReady, this, [this, filePaths](const QJsonObject &data) {
+        activeRequests--;
+        QSet<QString> reported;
+        QStringList retrySingle;
+        for (const QJsonValue &value : data.value("files").toArray()) {
+            const QJsonObject result = value.toObject();
+            const QString filePath = result.value("path").toString();
+            if (!inFlight.contains(filePath) || reported.contains(filePath)) continue;
+            reported.insert(filePath);
+            if (result.value("status").toString() == "not_batched") {
+                retrySingle.append(filePath);
+                continue;
+            }
+            finishUpload(filePath, result.value("status").toString() == "success", result.value("message").toString());
+        }
+        // Выросшие после постановки в очередь файлы - в начало очереди: takeBatch их уже не возьмет
+        for (int i = retrySingle.count() - 1; i >= 0; --i) {
+            inFlight.remove(retrySingle[i]);
+            if (queued.contains(retrySingle[i])) continue; // Более новая версия уже ждет
+            queued.insert(retrySingle[i]);
+            queue.prepend(retrySingle[i]);
+        }
+        for (const QString &filePath : filePaths) {
+            if (!reported.contains(filePath)) finishUpload(filePath, false, "Нет результата загрузки в ответе сервера");
+        }
+        dispatch();
+        if (pendingCount() == 0) emit idle();
+    });
+    connect(handle, &RequestHandle::failed, this, [this, filePaths](const QString &errorString, int statusCode) {
+        activeRequests--;
+        if (statusCode == 404 && !apiClient->batchUploadsEnabled()) {
+            // Сервер без пакетов: те же файлы уходят по одному, в начале очереди
+            qDebug() << "TransferQueue: Пакеты не поддерживаются, файлы отправятся по одному.";
+            for (int i = filePaths.count() - 1; i >= 0; --i) {
+                inFlight.remove(filePaths[i]);
+                if (queued.contains(filePaths[i])) continue; // Более новая версия уже ждет
+                queued.insert(filePaths[i]);
+                queue.prepend(filePaths[i]);
+            }
+        } else {
+            for (const QString &filePath : filePaths) finishUpload(filePath, false, errorString);
+        }
+        dispatch();
+        if (pendingCount() == 0) emit idle();
+    });
+}
+
+void TransferQueue::finishUpload(const QString &filePath, bool ok, const QString &errorString)
+{
+    inFlight.remove(filePath);
+    if (!ok) qWarning() << "TransferQueue: Не удалось отправить" << filePath << ":" << errorString;
+    emit uploadFinished(filePath, ok, errorString);
+}
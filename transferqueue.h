@@ -0,0 +1,56 @@
+#ifndef TRANSFERQUEUE_H
+#define TRANSFERQUEUE_H
+
+#include <QObject>
+#include <QQueue>
+#include <QSet>
+#include <QString>
+
+class ApiClient;
+
+// Очередь фоновых загрузок: файлы отправляются пачкой с ограничением параллельности,
+// повторная постановка уже ожидающего файла игнорируется. Мелкие файлы (BatchArchive)
+// уходят пакетами по одному запросу, если сервер их принимает. Результат по каждому файлу
+// приходит сигналом uploadFinished, окончание всей пачки - сигналом idle
+class TransferQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    static const int kDefaultConcurrency = 2;
+    static const int kBatchScanWindow = 2000; // Сколько файлов из начала очереди рассматривается для пакета
+
+    explicit TransferQueue(ApiClient *client, QObject *parent = nullptr);
+
+    void setToken(const QString &token);
+    void setConcurrency(int maxInFlight);
+
+    void enqueueUpload(const QString &filePath);
+    bool contains(const QString &filePath) const;
+    int pendingCount() const; // Ожидают + отправляются сейчас
+    int requestsSent() const; // Запросов загрузки с начала работы (пакет - один запрос)
+
+signals:
+    void uploadStarted(const QString &filePath);
+    void uploadProgress(const QString &filePath, qint64 bytesSent, qint64 bytesTotal);
+    void uploadFinished(const QString &filePath, bool ok, const QString &errorString);
+    void idle(); // Очередь опустела после хотя бы одной передачи
+
+private:
+    ApiClient *apiClient;
+    QString apiToken;
+    QQueue<QString> queue;
+    QSet<QString> queued;   // Ожидают в очереди
+    QSet<QString> inFlight; // Отправляются сейчас
+    int concurrency;
+    int activeRequests;     // Занятые места: одиночная загрузка или пакет
+    int sentRequests;
+
+    void dispatch();
+    // Забирает из очереди мелкие файлы для пакета; меньше kMinBatchFiles - очередь не меняется
+    QStringList takeBatch();
+    void startBatch(const QStringList &filePaths);
+    void finishUpload(const QString &filePath, bool ok, const QString &errorString);
+};
+
+#endif // TRANSFERQUEUE_H
@@ -0,0 +1,73 @@
+#include "transferworker.h"
+#include "requesthandle.h"
+
+#include <QNetworkAccessManager>
+#include <QDebug>
+
+TransferWorker::TransferWorker(QObject *parent)
+    : QObject(parent),
+      workerContext(new QObject),
+      workerManager(nullptr)
+{
+    workerThread.setObjectName("TransferWorker");
+    workerContext->moveToThread(&workerThread);
+    connect(&workerThread, &QThread::finished, workerContext, &QObject::deleteLater);
+    workerThread.start();
+
+    // Менеджер создается в своем потоке: там живут его сокеты и ответы
+    QMetaObject::invokeMethod(workerContext, [this]() {
+        workerManager = new QNetworkAccessManager(workerContext);
+    }, Qt::BlockingQueuedConnection);
+    qDebug() << "TransferWorker: Поток передач запущен.";
+}
+
+TransferWorker::~TransferWorker()
+{
+    stop();
+}
+
+void TransferWorker::stop()
+{
+    if (!workerThread.isRunning()) return;
+    workerThread.quit();
+    workerThread.wait();
+    qDebug() << "TransferWorker: Поток передач остановлен.";
+}
+
+QThread *TransferWorker::networkThread() const
+{
+    return const_cast<QThread *>(&workerThread);
+}
+
+QObject *TransferWorker::context() const
+{
+    return workerContext;
+}
+
+QNetworkAccessManager *TransferWorker::manager() const
+{
+    return workerManager;
+}
+
+QNetworkAccessManager *TransferWorker::createManager()
+{
+    QNetworkAccessManager *created = nullptr;
+    QMetaObject::invokeMethod(workerContext, [this, &created]() {
+        created = new QNetworkAccessManager(workerContext);
+    }, Qt::BlockingQueuedConnection);
+    return created;
+}
+
+RequestHandle *TransferWorker::createRelay(RequestHandle *handle)
+{
+    RequestHandle *relay = new RequestHandle;
+    // Соединения между потоками - очередью: вызовы handle выполнятся в его потоке,
+    // а если handle уже удален, Qt просто не доставит событие
+    connect(relay, &RequestHandle::progress, handle, &RequestHandle::reportProgress);
+    connect(relay, &RequestHandle::jsonReady, handle, &RequestHandle::finishWithJson);
+    connect(relay, &RequestHandle::dataReady, handle, &RequestHandle::finishWithData);
+    connect(relay, &RequestHandle::failed, handle, &RequestHandle::fail);
+    connect(handle, &RequestHandle::abortRequested, relay, &RequestHandle::abort);
+    relay->moveToThread(&workerThread);
+    return relay;
+}
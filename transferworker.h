@@ -0,0 +1,44 @@
+#ifndef TRANSFERWORKER_H
+#define TRANSFERWORKER_H
+
+#include <QObject>
+#include <QThread>
+
+class QNetworkAccessManager;
+class RequestHandle;
+
+// Отдельный поток для передач файлов: свой QNetworkAccessManager, чтение тел загрузок,
+// распаковка/хэширование скачиваний и прогресс обрабатываются в нем, а не в цикле событий GUI.
+// Модальные окна и долгая перерисовка таблицы больше не тормозят передачи.
+// Результаты доходят до дескрипторов в GUI через посредника (createRelay) очередью событий
+class TransferWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit TransferWorker(QObject *parent = nullptr);
+    ~TransferWorker();
+
+    QThread *networkThread() const;
+    QObject *context() const;               // Объект потока передач - контекст для connect и invokeMethod
+    QNetworkAccessManager *manager() const; // Пользоваться только из потока передач
+    // Еще один менеджер в потоке передач - свой пул соединений для клиента, которому поток
+    // достался общим (см. RequestScheduler). Удаляется вместе с потоком
+    QNetworkAccessManager *createManager();
+
+    // Дескриптор-посредник для кода, работающего в потоке передач. Его прогресс и результат
+    // пересылаются в handle, отмена handle пересылается в посредника (abortRequested там же,
+    // где ответ сети). Вызывать из потока handle
+    RequestHandle *createRelay(RequestHandle *handle);
+
+    // Останавливает поток (незавершенные передачи обрываются). Вызывать до удаления объектов,
+    // которые используют обработчики в потоке передач
+    void stop();
+
+private:
+    QThread workerThread;
+    QObject *workerContext;
+    QNetworkAccessManager *workerManager;
+};
+
+#endif // TRANSFERWORKER_H
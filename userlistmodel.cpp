@@ -0,0 +1,226 @@
+#include "userlistmodel.h"
+#include "apiclient.h"
+#include "requesthandle.h"
+#include "tracer.h"
+
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QDebug>
+
+// Первая страница запрашивается еще при входе (ApiClient::prefetchSessionData) - размеры должны совпадать
+static_assert(UserListModel::kPageSize == ApiClient::kUserPageSize, "Размер страницы модели и начального запроса различается");
+
+UserListModel::UserListModel(ApiClient *client, QObject *parent)
+    : QAbstractTableModel(parent),
+      apiClient(client),
+      totalRows(0),
+      generation(0),
+      failureReported(false)
+{
+}
+
+void UserListModel::setToken(const QString &token)
+{
+    apiToken = token;
+}
+
+QString UserListModel::filter() const
+{
+    return currentFilter;
+}
+
+bool UserListModel::userAt(int row, UserData *user) const
+{
+    if (row < 0 || row >= totalRows) return false;
+    auto it = pages.constFind(row / kPageSize);
+    if (it == pages.constEnd()) return false;
+    const int offsetInPage = row % kPageSize;
+    if (offsetInPage >= it->size()) return false;
+    if (user) *user = it->at(offsetInPage);
+    return true;
+}
+
+void UserListModel::fetchRows(int first, int last)
+{
+    if (totalRows <= 0) return;
+    first = qBound(0, first, totalRows - 1);
+    last = qBound(first, last, totalRows - 1);
+    for (int page = first / kPageSize; page <= last / kPageSize; ++page) {
+        if (!pages.contains(page) && !failedPages.contains(page)) requestPage(page);
+    }
+}
+
+void UserListModel::showCachedUsers(const QList<UserData> &users)
+{
+    // Кэш показываем только пока с сервера еще ничего не пришло
+    if (users.isEmpty() || totalRows > 0 || !currentFilter.isEmpty()) return;
+    beginResetModel();
+    pages.clear();
+    pageOrder.clear();
+    pages.insert(0, users.mid(0, kPageSize));
+    pageOrder.append(0);
+    totalRows = pages.value(0).size();
+    endResetModel();
+}
+
+int UserListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : totalRows;
+}
+
+int UserListModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant UserListModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= totalRows) return QVariant();
+    if (role != Qt::DisplayRole && role != Qt::UserRole) return QVariant();
+
+    UserData user;
+    if (!userAt(index.row(), &user)) {
+        // Заглушка, пока страница не загружена (ее запрашивает fetchRows). Строки за концом
+        // загруженной короткой страницы остаются пустыми: сервер их уже не отдал
+        const int page = index.row() / kPageSize;
+        if (role != Qt::DisplayRole || index.column() != UsernameColumn || pages.contains(page)) return QVariant();
+        return failedPages.contains(page) ? QString("Не загружено") : QString("Загрузка...");
+    }
+
+    if (role == Qt::UserRole) return user.id;
+    switch (index.column()) {
+    case UsernameColumn: return user.username;
+    case IdColumn: return user.id;
+    default: return QVariant();
+    }
+}
+
+QVariant UserListModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+    switch (section) {
+    case UsernameColumn: return QString("Имя пользователя");
+    case IdColumn: return QString("ID");
+    default: return QVariant();
+    }
+}
+
+void UserListModel::setFilter(const QString &prefix)
+{
+    TRACE_SCOPE("ui", "UserListModel::setFilter");
+    const QString trimmed = prefix.trimmed();
+    if (trimmed == currentFilter && totalRows > 0) return;
+    qDebug() << "UserListModel: Новый фильтр пользователей:" << trimmed;
+
+    beginResetModel();
+    currentFilter = trimmed;
+    generation++;
+    pages.clear();
+    pageOrder.clear();
+    pendingPages.clear();
+    resetFailures();
+    totalRows = 0;
+    endResetModel();
+
+    requestPage(0);
+}
+
+void UserListModel::refresh()
+{
+    // Строки остаются на экране: загруженные страницы перезапрашиваются и заменяются на месте
+    generation++;
+    pendingPages.clear();
+    resetFailures();
+    const QList<int> loaded = pageOrder;
+    if (loaded.isEmpty()) {
+        requestPage(0);
+        return;
+    }
+    for (int page : loaded) requestPage(page);
+}
+
+void UserListModel::requestPage(int page)
+{
+    if (!apiClient || apiToken.isEmpty() || pendingPages.contains(page)) return;
+
+    const bool wasIdle = pendingPages.isEmpty();
+    pendingPages.insert(page);
+    if (wasIdle) emit loadingChanged(true);
+
+    const quint64 requestGeneration = generation;
+    RequestHandle *handle = apiClient->getUserPage(apiToken, currentFilter, page * kPageSize, kPageSize);
+    connect(handle, &RequestHandle::jsonReady, this, [this, requestGeneration, page](const QJsonObject &response) {
+        handlePage(requestGeneration, page, response);
+    });
+    connect(handle, &RequestHandle::failed, this, [this, requestGeneration, page](const QString &errorString, int statusCode) {
+        if (requestGeneration != generation) return;
+        pendingPages.remove(page);
+        failedPages.insert(page);
+        qWarning() << "UserListModel: Не удалось загрузить страницу" << page << ":" << errorString;
+        const int first = page * kPageSize;
+        const int last = qMin(first + kPageSize, totalRows) - 1;
+        if (first <= last) emit dataChanged(index(first, 0), index(last, ColumnCount - 1));
+        if (!failureReported) {
+            failureReported = true;
+            emit loadFailed(errorString, statusCode);
+        }
+        if (pendingPages.isEmpty()) emit loadingChanged(false);
+    });
+}
+
+void UserListModel::handlePage(quint64 requestGeneration, int page, const QJsonObject &response)
+{
+    TRACE_SCOPE_ARG("ui", "UserListModel::handlePage", "page", page);
+    if (requestGeneration != generation) return; // Ответ на старый фильтр
+    pendingPages.remove(page);
+
+    QList<UserData> users;
+    const QJsonArray usersArray = response.value("users").toArray();
+    users.reserve(usersArray.size());
+    for (const QJsonValue &val : usersArray) {
+        const QJsonObject userObj = val.toObject();
+        UserData user;
+        user.id = userObj.value("id").toString();
+        user.username = userObj.value("username").toString();
+        if (!user.id.isEmpty()) users.append(user);
+    }
+
+    // Общее число строк могло измениться (пользователи добавлены/удалены). Короткая страница
+    // значит, что на сервере список кончился раньше: total из ответа устарел
+    int newTotal = response.value("total").toInt(totalRows);
+    if (users.size() < kPageSize) newTotal = qMin(newTotal, page * kPageSize + int(users.size()));
+    if (newTotal > totalRows) {
+        beginInsertRows(QModelIndex(), totalRows, newTotal - 1);
+        totalRows = newTotal;
+        endInsertRows();
+    } else if (newTotal < totalRows) {
+        beginRemoveRows(QModelIndex(), newTotal, totalRows - 1);
+        totalRows = newTotal;
+        endRemoveRows();
+    }
+
+    pages.insert(page, users);
+    failedPages.remove(page);
+    pageOrder.removeAll(page);
+    pageOrder.append(page);
+    evictPages();
+
+    const int first = page * kPageSize;
+    const int last = qMin(first + kPageSize, totalRows) - 1;
+    if (first <= last) emit dataChanged(index(first, 0), index(last, ColumnCount - 1));
+    if (pendingPages.isEmpty()) emit loadingChanged(false);
+}
+
+void UserListModel::evictPages()
+{
+    // Вытесняем страницы, к которым дольше всего не обращались; при прокрутке назад они запросятся снова
+    while (pageOrder.size() > kMaxCachedPages) {
+        pages.remove(pageOrder.takeFirst());
+    }
+}
+
+void UserListModel::resetFailures()
+{
+    failedPages.clear();
+    failureReported = false;
+}
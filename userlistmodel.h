@@ -0,0 +1,77 @@
+#ifndef USERLISTMODEL_H
+#define USERLISTMODEL_H
+
+#include <QAbstractTableModel>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include "datatypes.h"
+
+class QJsonObject;
+class ApiClient;
+
+// Ленивая модель списка пользователей для админки.
+// Сервер отдает страницы (offset/limit) с фильтром по префиксу имени; модель знает только
+// общее число строк и держит в памяти ограниченное число страниц вокруг видимой области
+class UserListModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        UsernameColumn = 0,
+        IdColumn,
+        ColumnCount
+    };
+
+    static const int kPageSize = 200;
+    static const int kMaxCachedPages = 20;
+
+    explicit UserListModel(ApiClient *client, QObject *parent = nullptr);
+
+    void setToken(const QString &token);
+    QString filter() const;
+
+    // Пользователь в строке row, если его страница уже загружена
+    bool userAt(int row, UserData *user) const;
+
+    // Запрос незагруженных страниц для видимых строк [first, last]. Вызывается представлением
+    // при прокрутке: data() сам ничего не запрашивает, иначе отрисовка порождает запросы
+    void fetchRows(int first, int last);
+
+    // Показ списка из локального кэша до ответа сервера
+    void showCachedUsers(const QList<UserData> &users);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+public slots:
+    void setFilter(const QString &prefix); // Новый поиск: сброс страниц и запрос первой
+    void refresh();                        // Перезапрос с текущим фильтром (после изменений)
+
+signals:
+    void loadingChanged(bool loading);
+    void loadFailed(const QString &errorString, int statusCode);
+
+private:
+    ApiClient *apiClient;
+    QString apiToken;
+    QString currentFilter;
+    int totalRows;
+    quint64 generation;            // Ответы на запросы прошлого фильтра отбрасываются
+    QHash<int, QList<UserData>> pages;
+    QList<int> pageOrder;          // Порядок запроса страниц (последняя - самая свежая)
+    QSet<int> pendingPages;
+    QSet<int> failedPages;         // Не перезапрашиваются до смены фильтра или refresh()
+    bool failureReported;          // loadFailed - один раз на поколение
+
+    void requestPage(int page);
+    void handlePage(quint64 requestGeneration, int page, const QJsonObject &response);
+    void evictPages();
+    void resetFailures();
+};
+
+#endif // USERLISTMODEL_H
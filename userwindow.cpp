@@ -2,6 +2,12 @@
 #include "ui_userwindow.h"
 #include "apiclient.h"
 #include "filedetailswindow.h"
+#include "previewservice.h"
+#include "syncengine.h"
+#include "transferqueue.h"
+#include "folderwatcher.h"
+#include "progressaggregator.h"
+#include "tracer.h"
 
 #include <QMessageBox>
 #include <QDebug>
@@ -15,13 +21,28 @@
 #include <QApplication>
 #include <QToolTip>
 #include <QHBoxLayout>
+#include <QIcon>
+#include <QPixmap>
+#include <QTimer>
+#include <QScrollBar>
+#include <QSettings>
+#include <QProgressDialog>
+#include <QBoxLayout>
+#include <QLocale>
 
 UserWindow::UserWindow(const QString &token, ApiClient *client, QWidget *parent) :
     QWidget(parent), // или QMainWindow(parent)
     ui(nullptr),
     apiToken(token),
-    apiClient(client)
+    apiClient(client),
+    firstRowsShown(false),
+    serverFilesShown(false),
+    idlePrefetchTimer(nullptr),
+    transferQueue(nullptr),
+    folderWatcher(nullptr),
+    uploadProgress(new ProgressAggregator(this))
 {
+    openTimer.start();
 
     // Общая инициализация для обоих случаев (UserWindow и AdminWindow)
     if (!apiClient) {
@@ -33,11 +54,23 @@ UserWindow::UserWindow(const QString &token, ApiClient *client, QWidget *parent)
     connect(apiClient, &ApiClient::userFilesSuccess, this, &UserWindow::handleFilesSuccess, Qt::UniqueConnection);
     connect(apiClient, &ApiClient::userFilesFailed, this, &UserWindow::handleFilesFailed, Qt::UniqueConnection);
     connect(apiClient, &ApiClient::uploadSuccess, this, &UserWindow::handleUploadSuccess);
-    connect(apiClient, &ApiClient::uploadProgress, this, &UserWindow::handleUploadProgress);
+    connect(apiClient, &ApiClient::uploadProgress, uploadProgress, &ProgressAggregator::update);
+    connect(uploadProgress, &ProgressAggregator::progressChanged, this, &UserWindow::handleUploadProgress);
     connect(apiClient, &ApiClient::uploadFailed, this, &UserWindow::handleUploadFailed);
     connect(apiClient, &ApiClient::deleteSuccess, this, &UserWindow::handleDeleteSuccess);
     connect(apiClient, &ApiClient::deleteFailed, this, &UserWindow::handleDeleteFailed);
-
+    connect(apiClient->previewService(), &PreviewService::previewReady, this, &UserWindow::handlePreviewReady);
+
+    transferQueue = new TransferQueue(apiClient, this);
+    transferQueue->setToken(apiToken);
+    folderWatcher = new FolderWatcher(transferQueue, this);
+    connect(transferQueue, &TransferQueue::uploadStarted, this, &UserWindow::updateWatchButton);
+    connect(transferQueue, &TransferQueue::uploadFinished, this, &UserWindow::updateWatchButton);
+    // Пачка автозагрузок закончилась - один раз обновляем список файлов
+    connect(transferQueue, &TransferQueue::idle, this, &UserWindow::requestUserFiles);
+
+    // Список из кэша отрисуется сразу после настройки UI, а запрос ниже его обновит
+    apiClient->metadataCache()->loadFiles(&allFiles);
     requestUserFiles(); // Запрашиваем файлы при открытии окна
 }
 
@@ -48,15 +81,24 @@ UserWindow::~UserWindow()
         disconnect(apiClient, &ApiClient::userFilesSuccess, this, &UserWindow::handleFilesSuccess);
         disconnect(apiClient, &ApiClient::userFilesFailed, this, &UserWindow::handleFilesFailed);
         disconnect(apiClient, &ApiClient::uploadSuccess, this, &UserWindow::handleUploadSuccess);
-        disconnect(apiClient, &ApiClient::uploadProgress, this, &UserWindow::handleUploadProgress);
+        disconnect(apiClient, &ApiClient::uploadProgress, uploadProgress, &ProgressAggregator::update);
         disconnect(apiClient, &ApiClient::uploadFailed, this, &UserWindow::handleUploadFailed);
         disconnect(apiClient, &ApiClient::deleteSuccess, this, &UserWindow::handleDeleteSuccess);
         disconnect(apiClient, &ApiClient::deleteFailed, this, &UserWindow::handleDeleteFailed);
+        disconnect(apiClient->previewService(), &PreviewService::previewReady, this, &UserWindow::handlePreviewReady);
     }
     delete ui;
     qDebug() << "UserWindow уничтожен.";
 }
 
+void UserWindow::setToken(const QString &token)
+{
+    apiToken = token;
+    if (transferQueue) transferQueue->setToken(token);
+    const QList<FileDetailsWindow *> detailWindows = findChildren<FileDetailsWindow *>();
+    for (FileDetailsWindow *detailsWin : detailWindows) detailsWin->setToken(token);
+}
+
 void UserWindow::setupUserInterface()
 {
     if (ui) return; // Избегаем повторной настройки
@@ -86,8 +128,137 @@ void UserWindow::setupUserInterface()
         qDebug() << "UserWindow UI: searchLineEdit подключен.";
     }
 
+    setupSyncButton();
+
     // Настраиваем таблицу UserWindow
     setupTable();
+    showCachedFiles();
+}
+
+// Кнопка синхронизации создается в коде: общая для окна пользователя и админки,
+// у которых разные .ui
+void UserWindow::setupSyncButton()
+{
+    QBoxLayout *toolbarLayout = this->findChild<QBoxLayout*>("horizontalLayout");
+    if (!toolbarLayout || this->findChild<QPushButton*>("syncButton")) return;
+    QPushButton *syncButton = new QPushButton("Синхронизировать...", this);
+    syncButton->setObjectName("syncButton");
+    syncButton->setToolTip("Скачать новые и изменившиеся файлы в локальную папку");
+    connect(syncButton, &QPushButton::clicked, this, &UserWindow::startSync);
+    toolbarLayout->addWidget(syncButton);
+
+    QPushButton *watchButton = new QPushButton("Автозагрузка...", this);
+    watchButton->setObjectName("watchButton");
+    connect(watchButton, &QPushButton::clicked, this, &UserWindow::toggleFolderWatch);
+    toolbarLayout->addWidget(watchButton);
+
+    // Автозагрузка, включенная в прошлый раз, продолжает работать
+    const QString watchDir = QSettings().value("watch/directory").toString();
+    if (!watchDir.isEmpty() && folderWatcher && !folderWatcher->start(watchDir)) {
+        qWarning() << "UserWindow: Папка автозагрузки недоступна:" << watchDir;
+    }
+    updateWatchButton();
+}
+
+void UserWindow::toggleFolderWatch()
+{
+    if (!folderWatcher) return;
+    QSettings settings;
+    if (folderWatcher->isActive()) {
+        if (QMessageBox::question(this, "Автозагрузка",
+                                  QString("Остановить автозагрузку из папки\n%1?").arg(folderWatcher->directory()))
+            != QMessageBox::Yes) {
+            return;
+        }
+        folderWatcher->stop();
+        settings.remove("watch/directory");
+    } else {
+        QString dir = QFileDialog::getExistingDirectory(this, "Папка для автозагрузки",
+                                                        settings.value("watch/lastDirectory", QDir::homePath()).toString());
+        if (dir.isEmpty()) return;
+        settings.setValue("watch/lastDirectory", dir);
+        if (!folderWatcher->start(dir)) {
+            QMessageBox::warning(this, "Автозагрузка", QString("Не удалось начать наблюдение за папкой:\n%1").arg(dir));
+            return;
+        }
+        settings.setValue("watch/directory", dir);
+    }
+    updateWatchButton();
+}
+
+void UserWindow::updateWatchButton()
+{
+    QPushButton *watchButton = this->findChild<QPushButton*>("watchButton");
+    if (!watchButton || !folderWatcher) return;
+    if (!folderWatcher->isActive()) {
+        watchButton->setText("Автозагрузка...");
+        watchButton->setToolTip("Автоматически загружать новые и измененные файлы из папки");
+        return;
+    }
+    const int pending = transferQueue->pendingCount();
+    watchButton->setText(pending > 0 ? QString("Автозагрузка: %1 в очереди").arg(pending) : QString("Автозагрузка: вкл"));
+    watchButton->setToolTip(QString("Наблюдение за папкой %1. Нажмите, чтобы остановить").arg(folderWatcher->directory()));
+}
+
+void UserWindow::startSync()
+{
+    QSettings settings;
+    QString targetDir = QFileDialog::getExistingDirectory(this, "Папка для синхронизации",
+                                                          settings.value("sync/lastDirectory", QDir::homePath()).toString());
+    if (targetDir.isEmpty()) return;
+    settings.setValue("sync/lastDirectory", targetDir);
+
+    SyncEngine::Options options;
+    options.targetDir = targetDir;
+    options.deleteRemoved = settings.value("sync/deleteRemoved", false).toBool();
+    options.maxParallel = settings.value("sync/parallelDownloads", 4).toInt();
+
+    SyncEngine *engine = new SyncEngine(apiClient, apiToken, options, this);
+    QProgressDialog *progressDialog = new QProgressDialog("Синхронизация...", "Остановить", 0, 0, this);
+    progressDialog->setWindowModality(Qt::WindowModal);
+    progressDialog->setMinimumDuration(0);
+    progressDialog->setAttribute(Qt::WA_DeleteOnClose);
+    connect(engine, &SyncEngine::statusChanged, progressDialog, &QProgressDialog::setLabelText);
+    connect(engine, &SyncEngine::progress, progressDialog, [progressDialog](int done, int total, qint64 bytes) {
+        progressDialog->setMaximum(total);
+        progressDialog->setValue(done);
+        progressDialog->setLabelText(QString("Скачано файлов: %1 из %2 (%3)")
+                                         .arg(done).arg(total).arg(QLocale::system().formattedDataSize(bytes)));
+    });
+    connect(progressDialog, &QProgressDialog::canceled, engine, &SyncEngine::cancel);
+    connect(engine, &SyncEngine::finished, progressDialog, &QProgressDialog::close);
+    connect(engine, &SyncEngine::finished, this, [this, engine](const SyncReport &report) {
+        engine->deleteLater();
+        QString summary = QString("Файлов на сервере: %1\nСкачано: %2\nБез изменений: %3\nУдалено локально: %4\n"
+                                  "Изменено локально (не тронуто): %5\nОшибок: %6\n\nСкорость: %7 файлов/с, %8/с")
+                              .arg(report.remoteFiles).arg(report.downloaded).arg(report.unchanged)
+                              .arg(report.deleted).arg(report.skipped).arg(report.failed)
+                              .arg(report.filesPerSecond(), 0, 'f', 1)
+                              .arg(QLocale::system().formattedDataSize(static_cast<qint64>(report.bytesPerSecond())));
+        if (!report.errors.isEmpty()) summary += "\n\n" + report.errors.mid(0, 10).join("\n");
+        if (report.failed > 0 || report.skipped > 0) {
+            QMessageBox::warning(this, "Синхронизация", summary);
+        } else {
+            QMessageBox::information(this, "Синхронизация", summary);
+        }
+    });
+    engine->start();
+}
+
+// Отрисовка закэшированного списка до ответа сервера
+void UserWindow::showCachedFiles()
+{
+    if (allFiles.isEmpty()) return;
+    populateTable(allFiles);
+    reportFirstRows("кэш", allFiles.count());
+}
+
+// Замер времени от открытия окна до первых строк в таблице
+void UserWindow::reportFirstRows(const QString &source, int rowCount)
+{
+    if (firstRowsShown || rowCount == 0) return;
+    firstRowsShown = true;
+    qDebug() << "UserWindow: Первые строки таблицы (" << source << ") показаны через" << openTimer.elapsed() << "мс после открытия окна.";
 }
 
 // Вспомогательный метод для управления состоянием UI во время загрузки
@@ -122,18 +293,63 @@ void UserWindow::setupTable()
     table->horizontalHeader()->setSectionResizeMode(2, QHeaderView::ResizeToContents);
     table->horizontalHeader()->setSectionResizeMode(3, QHeaderView::ResizeToContents);
     table->horizontalHeader()->setSectionResizeMode(4, QHeaderView::ResizeToContents);
+    table->setIconSize(QSize(32, 32)); // Миниатюры в колонке имени
     table->setRowCount(0);
+    setupDetailsPrefetch();
+}
+
+// Предзагрузка file_info: при наведении на строку и для видимых строк в простое
+void UserWindow::setupDetailsPrefetch()
+{
+    QTableWidget* table = this->findChild<QTableWidget*>("filesTableWidget");
+    if (!table || idlePrefetchTimer) return;
+
+    table->setMouseTracking(true); // Нужно для cellEntered без нажатия кнопки
+    connect(table, &QTableWidget::cellEntered, this, &UserWindow::prefetchHoveredRow);
+
+    idlePrefetchTimer = new QTimer(this);
+    idlePrefetchTimer->setSingleShot(true);
+    idlePrefetchTimer->setInterval(1500);
+    connect(idlePrefetchTimer, &QTimer::timeout, this, &UserWindow::prefetchVisibleRows);
+    // Прокрутка - признак активности: откладываем фоновую предзагрузку
+    connect(table->verticalScrollBar(), &QScrollBar::valueChanged, idlePrefetchTimer, qOverload<>(&QTimer::start));
+}
+
+void UserWindow::prefetchHoveredRow(int row, int column)
+{
+    Q_UNUSED(column);
+    QTableWidget* table = this->findChild<QTableWidget*>("filesTableWidget");
+    if (!table || !apiClient) return;
+    QTableWidgetItem *item = table->item(row, 0);
+    if (item) apiClient->prefetchFileInfo(apiToken, item->data(Qt::UserRole + 1).toString());
+}
+
+void UserWindow::prefetchVisibleRows()
+{
+    QTableWidget* table = this->findChild<QTableWidget*>("filesTableWidget");
+    if (!table || !apiClient || table->rowCount() == 0) return;
+    int first = table->rowAt(0);
+    int last = table->rowAt(table->viewport()->height() - 1);
+    if (first < 0) first = 0;
+    if (last < 0) last = table->rowCount() - 1;
+    for (int row = first; row <= last; ++row) {
+        QTableWidgetItem *item = table->item(row, 0);
+        if (item) apiClient->prefetchFileInfo(apiToken, item->data(Qt::UserRole + 1).toString());
+    }
 }
 
 // Инициирование запроса списка файлов
 void UserWindow::requestUserFiles()
 {
     if (!apiClient) return;
-    // Блокируем UI, если он уже настроен
+    // Блокируем UI, если он уже настроен и показывать пока нечего.
+    // Закэшированный список остается доступным, пока идет обновление в фоне
     QLineEdit* search = this->findChild<QLineEdit*>("searchLineEdit");
     QTableWidget* table = this->findChild<QTableWidget*>("filesTableWidget");
-    if(search) search->setEnabled(false);
-    if(table) table->setEnabled(false);
+    if (allFiles.isEmpty()) {
+        if(search) search->setEnabled(false);
+        if(table) table->setEnabled(false);
+    }
     qDebug() << "UserWindow: Запрос списка файлов...";
     apiClient->getUserFiles(apiToken);
 }
@@ -142,7 +358,19 @@ void UserWindow::requestUserFiles()
 void UserWindow::handleFilesSuccess(const QList<FileInfo> &files) {
     qDebug() << "UserWindow: Получен список из" << files.count() << "файлов.";
     allFiles = files;
-    populateTable(allFiles);
+    // Сохраняем текущий фильтр поиска при обновлении списка
+    QLineEdit* searchEdit = this->findChild<QLineEdit*>("searchLineEdit");
+    if (searchEdit && !searchEdit->text().trimmed().isEmpty()) {
+        on_searchLineEdit_textChanged(searchEdit->text());
+    } else {
+        populateTable(allFiles);
+    }
+    reportFirstRows("сеть", allFiles.count());
+    if (!serverFilesShown) {
+        serverFilesShown = true;
+        const qint64 sinceLogin = apiClient->sessionElapsedMs();
+        if (sinceLogin >= 0) qDebug() << "UserWindow: Таблица файлов заполнена ответом сервера через" << sinceLogin << "мс после входа.";
+    }
     // Разблокировка UI
     QLineEdit* search = this->findChild<QLineEdit*>("searchLineEdit");
     QTableWidget* table = this->findChild<QTableWidget*>("filesTableWidget");
@@ -165,6 +393,7 @@ void UserWindow::handleFilesFailed(const QString &errorString, int statusCode) {
 
 // Заполнение таблицы данными
 void UserWindow::populateTable(const QList<FileInfo> &filesToDisplay) {
+    TRACE_SCOPE_ARG("ui", "populateTable", "rows", static_cast<int>(filesToDisplay.count()));
     QTableWidget* table = this->findChild<QTableWidget*>("filesTableWidget");
     if (!table) {
         qWarning() << "UserWindow::populateTable: Не удалось найти filesTableWidget!";
@@ -176,7 +405,18 @@ void UserWindow::populateTable(const QList<FileInfo> &filesToDisplay) {
         const FileInfo &file = filesToDisplay.at(row);
         table->insertRow(row);
 
-        table->setItem(row, 0, new QTableWidgetItem(file.fileName));
+        QTableWidgetItem *nameItem = new QTableWidgetItem(file.fileName);
+        nameItem->setData(Qt::UserRole, file.id); // Для поиска строки при готовности миниатюры
+        PreviewService *previews = apiClient->previewService();
+        if (PreviewService::isPreviewable(file.fileName)) {
+            QImage preview = previews->cachedPreview(file.id);
+            if (!preview.isNull()) {
+                nameItem->setIcon(QIcon(QPixmap::fromImage(preview)));
+            } else {
+                previews->requestPreview(apiToken, file.id, file.fileName); // Придет через handlePreviewReady
+            }
+        }
+        table->setItem(row, 0, nameItem);
         table->setItem(row, 1, new QTableWidgetItem(file.fileSize));
         table->setItem(row, 2, new QTableWidgetItem(file.uploadDate));
         table->setItem(row, 3, new QTableWidgetItem(file.countViews));
@@ -194,6 +434,7 @@ void UserWindow::populateTable(const QList<FileInfo> &filesToDisplay) {
             QStringList urlParts = file.fileUrl.split('/');
             if (!urlParts.isEmpty()) urlIdentifier = urlParts.last();
         }
+        nameItem->setData(Qt::UserRole + 1, urlIdentifier); // Для предзагрузки деталей
         detailsButton->setProperty("fileId", file.id);
         if (!urlIdentifier.isEmpty()) { detailsButton->setProperty("urlIdentifier", urlIdentifier); }
         else { detailsButton->setEnabled(false); detailsButton->setToolTip("Нет URL ID"); }
@@ -220,11 +461,27 @@ void UserWindow::populateTable(const QList<FileInfo> &filesToDisplay) {
         table->setCellWidget(row, 4, actionsWidget);
     }
     table->setSortingEnabled(true);
+    if (idlePrefetchTimer) idlePrefetchTimer->start();
+}
+
+// Миниатюра готова (декодирована в фоне) - ставим иконку в строку файла
+void UserWindow::handlePreviewReady(const QString &fileId, const QImage &image)
+{
+    QTableWidget* table = this->findChild<QTableWidget*>("filesTableWidget");
+    if (!table) return;
+    for (int row = 0; row < table->rowCount(); ++row) {
+        QTableWidgetItem *item = table->item(row, 0);
+        if (item && item->data(Qt::UserRole).toString() == fileId) {
+            item->setIcon(QIcon(QPixmap::fromImage(image)));
+            break;
+        }
+    }
 }
 
 // Слот для фильтрации таблицы
 void UserWindow::on_searchLineEdit_textChanged(const QString &text)
 {
+    TRACE_SCOPE("ui", "filterFiles");
     QString filter = text.trimmed().toLower();
     if (filter.isEmpty()) {
         populateTable(allFiles);
@@ -287,6 +544,7 @@ void UserWindow::on_uploadButton_clicked()
         setUploadingState(true);
         QProgressBar* progress = this->findChild<QProgressBar*>("uploadProgressBar");
         if(progress) progress->setFormat("Загрузка: %p%");
+        uploadProgress->reset();
         apiClient->uploadFile(apiToken, filePath);
     } else {
         qDebug() << "UserWindow: Выбор файла отменен.";
@@ -309,13 +567,16 @@ void UserWindow::handleUploadFailed(const QString &errorString, int statusCode)
 }
 
 // Слот для обновления прогресс бара
-void UserWindow::handleUploadProgress(qint64 bytesSent, qint64 bytesTotal) {
+void UserWindow::handleUploadProgress(const TransferProgress &transfer) {
     QProgressBar* progress = this->findChild<QProgressBar*>("uploadProgressBar");
-    if (progress && bytesTotal > 0) {
-        int percent = static_cast<int>((static_cast<double>(bytesSent) / static_cast<double>(bytesTotal)) * 100.0);
-        progress->setValue(percent);
-    } else if (progress && bytesTotal <= 0) {
-        progress->setMaximum(0); progress->setMinimum(0); progress->setValue(-1);
+    if (!progress) return;
+    if (transfer.percent >= 0) {
+        progress->setRange(0, 100);
+        progress->setValue(transfer.percent);
+        progress->setFormat("Загрузка: %p% (" + ProgressAggregator::describe(transfer) + ")");
+    } else {
+        progress->setRange(0, 0);
+        progress->setFormat("Загрузка: " + ProgressAggregator::describe(transfer));
     }
 }
 
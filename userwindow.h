@@ -3,6 +3,7 @@
 
 #include <QWidget> // или QMainWindow
 #include <QList>
+#include <QElapsedTimer>
 #include "datatypes.h" // Наша структура FileInfo
 
 
@@ -10,7 +11,12 @@ namespace Ui { class UserWindow; }
 class ApiClient;
 class QTableWidgetItem;
 class QProgressBar;
+class QImage;
+class QTimer;
 class FileDetailsWindow;
+class TransferQueue;
+class FolderWatcher;
+class ProgressAggregator;
 
 class UserWindow : public QWidget // или QMainWindow
 {
@@ -21,6 +27,9 @@ public:
     explicit UserWindow(const QString &token, ApiClient *client, QWidget *parent = nullptr);
     virtual ~UserWindow();
     void setupUserInterface();
+    // Сервер выдал новый токен (проверка сохраненной сессии): дальше окно, его очередь
+    // загрузок и открытые окна деталей работают с ним
+    virtual void setToken(const QString &token);
 
 protected slots:
     // Слоты для connect в setupUserInterface и для наследников
@@ -33,22 +42,39 @@ private slots:
     void handleFilesFailed(const QString &errorString, int statusCode);
     void handleUploadSuccess();
     void handleUploadFailed(const QString &errorString, int statusCode);
-    void handleUploadProgress(qint64 bytesSent, qint64 bytesTotal);
+    void handleUploadProgress(const TransferProgress &progress);
     void copyFileLink();
     void viewFileDetails();
     void deleteFileClicked();
     void handleDeleteSuccess(const QString &deletedFileId);
     void handleDeleteFailed(const QString &failedFileId, const QString &errorString, int statusCode);
+    void handlePreviewReady(const QString &fileId, const QImage &image);
+    void prefetchHoveredRow(int row, int column);
+    void prefetchVisibleRows();
+    void startSync(); // Зеркалирование всех файлов в локальную папку
+    void toggleFolderWatch(); // Включение/выключение автозагрузки из папки
+    void updateWatchButton();
 
 protected:
     Ui::UserWindow *ui;
     QString apiToken;       // Храним токен для возможных будущих запросов из этого окна
     ApiClient *apiClient;   // Используем переданный экземпляр клиента
     QList<FileInfo> allFiles; // Полный список файлов для фильтрации
+    QElapsedTimer openTimer;  // Время с открытия окна (замер time-to-first-row)
+    bool firstRowsShown;      // Первые строки уже показаны (из кэша или из сети)
+    bool serverFilesShown;    // Список с сервера уже показан (замер от входа до заполненной таблицы)
+    QTimer *idlePrefetchTimer; // Предзагрузка деталей видимых строк, когда пользователь ничего не делает
+    TransferQueue *transferQueue; // Фоновые загрузки (автозагрузка из папки)
+    FolderWatcher *folderWatcher;
+    ProgressAggregator *uploadProgress; // Прореживает отметки прогресса загрузки, считает скорость
     void requestUserFiles(); // Метод для инициирования запроса файлов
     void setupTable();       // Настройка таблицы (заголовки, колонки)
     virtual void populateTable(const QList<FileInfo> &filesToDisplay); // Заполнение таблицы данными
     void setUploadingState(bool uploading); // Вспомогательный метод для блокировки/разблокировки UI
+    void showCachedFiles();  // Показ списка из локального кэша, пока идет запрос к серверу
+    void reportFirstRows(const QString &source, int rowCount);
+    void setupDetailsPrefetch(); // Наведение и простой -> фоновый file_info
+    void setupSyncButton();      // Кнопки "Синхронизировать" и "Автозагрузка" рядом с загрузкой
 };
 
 #endif // USERWINDOW_H